@@ -0,0 +1,596 @@
+/******************************************************************************
+  ntcir_bench.c
+
+ synthetic scale benchmark for libntcireval ("make bench"):
+ generates deterministic per-topic qrels and runs and times each subcommand
+******************************************************************************/
+#include "ntcir_eval.h"
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_SEED 1         /* default seed of the generator */
+#define BENCH_TOPICS 100     /* default number of topics */
+#define BENCH_DEPTH 1000     /* default run depth (docs per topic) */
+#define BENCH_JUDGED 500     /* default number of judged docs per topic */
+#define BENCH_LEVELS 3       /* default number of relevance levels (L1-L3) */
+#define BENCH_INTENTS 5      /* default number of intents per topic */
+#define BENCH_ECS 50         /* default number of equivalence classes */
+#define BENCH_NUGGETS 100    /* default number of 1click nuggets per topic */
+#define BENCH_L "500"        /* L param for 1click */
+#define BENCH_ALPHA "0.5"    /* alpha for irec (alpha-nDCG and NRBP) */
+#define BENCH_CUTOFFS "10,100,1000"
+
+#define OPTSTR_BENCH_SEED "-seed"
+#define OPTSTR_BENCH_TOPICS "-topics"
+#define OPTSTR_BENCH_DEPTH "-depth"
+#define OPTSTR_BENCH_JUDGED "-judged"
+#define OPTSTR_BENCH_LEVELS "-levels"
+#define OPTSTR_BENCH_INTENTS "-intents"
+#define OPTSTR_BENCH_ECS "-ecs"
+#define OPTSTR_BENCH_NUGGETS "-nuggets"
+#define OPTSTR_BENCH_GENONLY "-gen" /* generate data only */
+#define OPTSTR_BENCH_RUNONLY "-run" /* time existing data only */
+
+struct benchconf
+{
+  unsigned long long seed;
+  long topics;
+  long depth;
+  long judged;
+  long levels;
+  long intents;
+  long ecs;
+  long nuggets;
+  char *dir;
+};
+
+static unsigned long long bench_rand( unsigned long long * );
+static int bench_member( long, long );
+static int bench_gen( struct benchconf * );
+static int bench_gentopic( struct benchconf *, unsigned long long *, long );
+static int bench_run( struct benchconf *, char *, char *, char *, char **,
+		      char * );
+static int bench_usage( char * );
+
+int main( int ac, char **av )
+{
+  int argc = 1;
+  int genonly = 0;
+  int runonly = 0;
+  long i;
+
+  char gains[ 4 * MAXRL_MAX ];
+  char intents[ 32 ];
+
+  struct benchconf c;
+
+  c.seed = BENCH_SEED;
+  c.topics = BENCH_TOPICS;
+  c.depth = BENCH_DEPTH;
+  c.judged = BENCH_JUDGED;
+  c.levels = BENCH_LEVELS;
+  c.intents = BENCH_INTENTS;
+  c.ecs = BENCH_ECS;
+  c.nuggets = BENCH_NUGGETS;
+  c.dir = NULL;
+
+  while( argc < ac ){
+
+    if( !strcmp( av[ argc ], OPTSTR_BENCH_GENONLY ) ){
+      genonly = 1;
+      argc++;
+    }
+    else if( !strcmp( av[ argc ], OPTSTR_BENCH_RUNONLY ) ){
+      runonly = 1;
+      argc++;
+    }
+    else if( argc + 1 < ac && av[ argc ][ 0 ] == '-' ){
+
+      if( !strcmp( av[ argc ], OPTSTR_BENCH_SEED ) ){
+	c.seed = strtoull( av[ argc + 1 ], NULL, 10 );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_TOPICS ) ){
+	c.topics = atol( av[ argc + 1 ] );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_DEPTH ) ){
+	c.depth = atol( av[ argc + 1 ] );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_JUDGED ) ){
+	c.judged = atol( av[ argc + 1 ] );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_LEVELS ) ){
+	c.levels = atol( av[ argc + 1 ] );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_INTENTS ) ){
+	c.intents = atol( av[ argc + 1 ] );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_ECS ) ){
+	c.ecs = atol( av[ argc + 1 ] );
+      }
+      else if( !strcmp( av[ argc ], OPTSTR_BENCH_NUGGETS ) ){
+	c.nuggets = atol( av[ argc + 1 ] );
+      }
+      else{
+	return( bench_usage( av[ 0 ] ) );
+      }
+      argc += 2;
+    }
+    else if( argc + 1 == ac && av[ argc ][ 0 ] != '-' ){
+      c.dir = av[ argc ];
+      argc++;
+    }
+    else{
+      return( bench_usage( av[ 0 ] ) );
+    }
+  }
+
+  if( c.dir == NULL || c.topics < 1 || c.depth < 1 || c.judged < 1 ||
+      c.levels < 1 || c.levels > MAXRL_MAX || c.intents < 1 || c.ecs < 1 ||
+      c.nuggets < 1 ){
+    return( bench_usage( av[ 0 ] ) );
+  }
+
+  if( !runonly ){
+    if( bench_gen( &c ) < 0 ){
+      exit( 1 );
+    }
+  }
+  if( genonly ){
+    return( 0 );
+  }
+
+  /* gain values 1:2:...:levels for compute */
+  gains[ 0 ] = '\0';
+  for( i = 1; i <= c.levels; i++ ){
+    sprintf( gains + strlen( gains ), "%s%ld", i > 1 ? RLEVEL_RLEVEL_SEP : "",
+	     i );
+  }
+  sprintf( intents, "%ld", c.intents );
+
+  printf( "# ntcir_bench seed=%llu topics=%ld depth=%ld judged=%ld levels=%ld intents=%ld ecs=%ld nuggets=%ld\n",
+	  c.seed, c.topics, c.depth, c.judged, c.levels, c.intents, c.ecs,
+	  c.nuggets );
+  printf( "%-11s %8s %10s %9s %12s %11s\n",
+	  "#command", "topics", "docs", "seconds", "docs/s", "maxrss(KB)" );
+  fflush( stdout );
+
+  {
+    char *label[] = { "label", "-r", "%s.rel", NULL };
+    char *compute[] = { "compute", "-r", "%s.rel", "-g", gains,
+			"-cutoffs", BENCH_CUTOFFS, "-out", "%t", NULL };
+    char *labelec[] = { "label", "-ec", "-r", "%s.erel", NULL };
+    char *computeec[] = { "compute", "-ec", "-r", "%s.erel", "-g", gains,
+			  "-cutoffs", BENCH_CUTOFFS, "-out", "%t", NULL };
+    char *glabel[] = { "glabel", "-I", "%s.Grelv", NULL };
+    char *gcompute[] = { "gcompute", "-I", "%s.Grelv",
+			 "-cutoffs", BENCH_CUTOFFS, "-out", "%t", NULL };
+    char *dinlabel[] = { "dinlabel", "-din", "%s.din", NULL };
+    char *irec[] = { "irec", "-alpha", BENCH_ALPHA,
+		     "-cutoffs", BENCH_CUTOFFS, "-out", "%t", "%s.res",
+		     "%i", NULL };
+    char *oneclick[] = { "1click", "-L", BENCH_L, "-out", "%t",
+			 "-N", "%s.nug", "%s.mat", NULL };
+
+    if( bench_run( &c, "label", ".res", ".lab", label, intents ) < 0 ||
+	bench_run( &c, "compute", ".lab", NULL, compute, intents ) < 0 ||
+	bench_run( &c, "label-ec", ".res", ".elab", labelec, intents ) < 0 ||
+	bench_run( &c, "compute-ec", ".elab", NULL, computeec, intents ) < 0 ||
+	bench_run( &c, "glabel", ".res", ".glab", glabel, intents ) < 0 ||
+	bench_run( &c, "gcompute", ".glab", NULL, gcompute, intents ) < 0 ||
+	bench_run( &c, "dinlabel", ".res", NULL, dinlabel, intents ) < 0 ||
+	bench_run( &c, "irec", NULL, NULL, irec, intents ) < 0 ||
+	bench_run( &c, "1click", NULL, NULL, oneclick, intents ) < 0 ){
+      exit( 1 );
+    }
+  }
+
+  return( 0 );
+
+}/* of main */
+
+/******************************************************************************
+  bench_rand
+
+xorshift64*: the same sequence on every platform for a given seed
+
+return value: next pseudo-random number
+******************************************************************************/
+static unsigned long long bench_rand( unsigned long long *s )
+{
+  *s ^= *s >> 12;
+  *s ^= *s << 25;
+  *s ^= *s >> 27;
+
+  return( *s * 2685821657736338717ULL );
+
+}/* of bench_rand */
+
+/******************************************************************************
+  bench_member
+
+whether pool doc is relevant to intent (1 is navigational and gets
+every relevant doc); a function of its arguments only, so that
+the din file and the Irelv files agree
+
+return value: 1 (relevant), 0 (not relevant)
+******************************************************************************/
+static int bench_member( long doc, long intent )
+{
+  unsigned long long h;
+
+  if( intent == 1 ){
+    return( 1 );
+  }
+  h = ( unsigned long long )doc * 2654435761ULL +
+    ( unsigned long long )intent * 40503ULL;
+
+  return( ( int )( ( h >> 11 ) & 1 ) );
+
+}/* of bench_member */
+
+/******************************************************************************
+  bench_gen
+
+generates the data of all topics under c->dir:
+<dir>/<topicID>/<topicID>.<suffix>, as the NTCIR-eval scripts expect
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bench_gen( struct benchconf *c )
+{
+  long t;
+
+  unsigned long long s;
+
+  if( mkdir( c->dir, 0777 ) < 0 && errno != EEXIST ){
+
+#ifdef OUTERR
+    fprintf( stderr, "Cannot create %s\n", c->dir );
+#endif
+    return( -1 );
+  }
+
+  s = c->seed ? c->seed : BENCH_SEED; /* xorshift state must be nonzero */
+  for( t = 1; t <= c->topics; t++ ){
+    if( bench_gentopic( c, &s, t ) < 0 ){
+      return( -1 );
+    }
+  }
+
+  return( 0 );
+
+}/* of bench_gen */
+
+/******************************************************************************
+  bench_gentopic
+
+generates one topic: a pool of 2*max(depth,judged) docIDs, of which
+judged docs get a rel level in L0..Llevels (and relevant ones one of
+ecs equivalence classes),
+and the run ranks depth docs of the pool. Writes
+ .rel   judged docs with rel levels (label/compute)
+ .erel  ditto with EC IDs (label -ec/compute -ec)
+ .Grelv judged docs with gains sorted by gain, nonrelevant ones (gain 0)
+        last (glabel/gcompute)
+ .IrelvN relevant docs of intent N (irec)
+ .din   intent/inf-nav/doc/gain (dinlabel)
+ .res   the run
+ .nug   1click nuggets
+ .mat   1click matched nuggets
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bench_gentopic( struct benchconf *c, unsigned long long *s,
+			   long t )
+{
+  FILE *f[ 7 ];
+
+  long i, j, k;
+  long pool;
+  long tmp;
+  long nrel = 0;
+  long Xlen;
+
+  long *perm;  /* pool order: judged docs first, then the run */
+  long *level; /* rel level of perm[ i ] (judged docs only) */
+  long *rel;   /* relevant docs by decreasing level */
+
+  char tid[ 32 ];
+  char path[ BUFSIZ ];
+  static char *suf[] = { "rel", "erel", "Grelv", "din", "res", "nug", "mat" };
+
+  sprintf( tid, "T%05ld", t );
+  sprintf( path, "%s/%s", c->dir, tid );
+  if( mkdir( path, 0777 ) < 0 && errno != EEXIST ){
+
+#ifdef OUTERR
+    fprintf( stderr, "Cannot create %s\n", path );
+#endif
+    return( -1 );
+  }
+
+  pool = 2 * ( c->depth > c->judged ? c->depth : c->judged );
+  if( ( perm = ( long *)malloc( pool * sizeof( long ) ) ) == NULL ||
+      ( level = ( long *)malloc( pool * sizeof( long ) ) ) == NULL ||
+      ( rel = ( long *)malloc( pool * sizeof( long ) ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+
+  for( k = 0; k < 7; k++ ){
+    sprintf( path, "%s/%s/%s.%s", c->dir, tid, tid, suf[ k ] );
+    if( ( f[ k ] = fopen( path, "w" ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "Cannot open %s\n", path );
+#endif
+      return( -1 );
+    }
+  }
+
+  /* judged docs: a random sample of the pool, levels skewed towards L0 */
+  for( i = 0; i < pool; i++ ){
+    perm[ i ] = i;
+  }
+  for( i = 0; i < c->judged; i++ ){
+    j = i + ( long )( bench_rand( s ) % ( pool - i ) );
+    tmp = perm[ i ]; perm[ i ] = perm[ j ]; perm[ j ] = tmp;
+    level[ i ] = ( bench_rand( s ) % 2 ) ?
+      0 : 1 + ( long )( bench_rand( s ) % c->levels );
+    fprintf( f[ 0 ], "D%08ld L%ld\n", perm[ i ], level[ i ] );
+    fprintf( f[ 1 ], "D%08ld L%ld %ld\n", perm[ i ], level[ i ],
+	     level[ i ] ? 1 + ( long )( bench_rand( s ) % c->ecs ) :
+	     c->ecs + 1 + i ); /* a nonrelevant doc is a class of its own */
+  }
+
+  /* ideal list and intents: relevant docs by decreasing level */
+  for( k = c->levels; k >= 1; k-- ){
+    for( i = 0; i < c->judged; i++ ){
+      if( level[ i ] != k ){
+	continue;
+      }
+      rel[ nrel++ ] = perm[ i ];
+      fprintf( f[ 2 ], "D%08ld %.4f\n", perm[ i ], ( double )k );
+      for( j = 1; j <= c->intents; j++ ){
+	if( bench_member( perm[ i ], j ) ){
+	  fprintf( f[ 3 ], "%ld %s D%08ld %.4f\n", j,
+		   j == 1 ? NAVSTR : INFSTR, perm[ i ],
+		   ( double )k / c->intents );
+	}
+      }
+    }
+  }
+  for( i = 0; i < c->judged; i++ ){
+    if( level[ i ] == 0 ){
+      fprintf( f[ 2 ], "D%08ld %.4f\n", perm[ i ], 0.0 );
+    }
+  }
+
+  /* run: depth docs of the pool in random order */
+  for( i = 0; i < c->depth; i++ ){
+    j = i + ( long )( bench_rand( s ) % ( pool - i ) );
+    tmp = perm[ i ]; perm[ i ] = perm[ j ]; perm[ j ] = tmp;
+    fprintf( f[ 4 ], "D%08ld\n", perm[ i ] );
+  }
+
+  /* 1click: nuggets and a system output that matches half of them */
+  Xlen = 10 * c->nuggets;
+  fprintf( f[ 6 ], "syslen= %ld\n", Xlen );
+  for( i = 1; i <= c->nuggets; i++ ){
+    fprintf( f[ 5 ], "N%05ld %ld %ld\n", i,
+	     1 + ( long )( bench_rand( s ) % 3 ),
+	     5 + ( long )( bench_rand( s ) % 20 ) );
+    if( bench_rand( s ) % 2 ){
+      fprintf( f[ 6 ], "N%05ld %ld\n", i, ( long )( bench_rand( s ) % Xlen ) );
+    }
+  }
+
+  for( k = 0; k < 7; k++ ){
+    fclose( f[ k ] );
+  }
+
+  /* intent rellists */
+  for( j = 1; j <= c->intents; j++ ){
+
+    sprintf( path, "%s/%s/%s.Irelv%ld", c->dir, tid, tid, j );
+    if( ( f[ 0 ] = fopen( path, "w" ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "Cannot open %s\n", path );
+#endif
+      return( -1 );
+    }
+    for( i = 0; i < nrel; i++ ){
+      if( bench_member( rel[ i ], j ) ){
+	fprintf( f[ 0 ], "D%08ld 1\n", rel[ i ] );
+      }
+    }
+    fclose( f[ 0 ] );
+  }
+
+  free( perm );
+  free( level );
+  free( rel );
+
+  return( 0 );
+
+}/* of bench_gentopic */
+
+/******************************************************************************
+  bench_run
+
+runs a subcommand on every topic in a child process (one context for all
+topics) and reports elapsed time, docs/s and the child's peak RSS.
+In args, "%s" is replaced with <dir>/<topicID>/<topicID>, "%t" with the
+topicID and "%i" with the intent rellists <...>.Irelv1 ... <...>.IrelvN.
+The system input is <...><in> (if any) and the output is written to
+<...><out> (or discarded).
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bench_run( struct benchconf *c, char *name, char *in, char *out,
+		      char **args, char *intents )
+{
+  pid_t pid;
+  int status;
+  int ac;
+  long t, i, j;
+  long nint = atol( intents );
+  double sec;
+
+  char tid[ 32 ];
+  char base[ BUFSIZ ];
+  char path[ BUFSIZ ];
+  char **av;
+  char *buf;
+
+  FILE *null;
+
+  struct timeval t0, t1;
+  struct rusage ru;
+  struct nev_ctx ctx;
+
+  gettimeofday( &t0, NULL );
+
+  if( ( pid = fork() ) < 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "fork failed\n" );
+#endif
+    return( -1 );
+  }
+
+  if( pid == 0 ){ /* child: evaluate all topics */
+
+    if( ( av = ( char **)malloc( ( 16 + MAXRL_MAX + nint ) * sizeof( char *) ) )
+	== NULL ||
+	( buf = ( char *)malloc( ( 16 + MAXRL_MAX + nint ) * BUFSIZ ) ) == NULL ||
+	( null = fopen( "/dev/null", "w" ) ) == NULL ){
+      _exit( 1 );
+    }
+
+    nev_init( &ctx );
+    for( t = 1; t <= c->topics; t++ ){
+
+      sprintf( tid, "T%05ld", t );
+      sprintf( base, "%s/%s/%s", c->dir, tid, tid );
+
+      av[ 0 ] = "ntcir_bench";
+      for( i = 0, ac = 1; args[ i ]; i++ ){
+	if( !strcmp( args[ i ], "%i" ) ){
+	  for( j = 1; j <= nint; j++ ){
+	    av[ ac ] = buf + ac * BUFSIZ;
+	    sprintf( av[ ac++ ], "%s.Irelv%ld", base, j );
+	  }
+	}
+	else if( !strncmp( args[ i ], "%s", 2 ) ){
+	  av[ ac ] = buf + ac * BUFSIZ;
+	  sprintf( av[ ac++ ], "%s%s", base, args[ i ] + 2 );
+	}
+	else if( !strcmp( args[ i ], "%t" ) ){
+	  av[ ac++ ] = tid;
+	}
+	else{
+	  av[ ac++ ] = args[ i ];
+	}
+      }
+      av[ ac ] = NULL;
+
+      ctx.in = stdin;
+      if( in ){
+	sprintf( path, "%s%s", base, in );
+	if( ( ctx.in = fopen( path, "r" ) ) == NULL ){
+#ifdef OUTERR
+	  fprintf( stderr, "Cannot open %s\n", path );
+#endif
+	  _exit( 1 );
+	}
+      }
+      ctx.out = null;
+      if( out ){
+	sprintf( path, "%s%s", base, out );
+	if( ( ctx.out = fopen( path, "w" ) ) == NULL ){
+#ifdef OUTERR
+	  fprintf( stderr, "Cannot open %s\n", path );
+#endif
+	  _exit( 1 );
+	}
+      }
+
+      if( nev_run( &ctx, ac, av ) != 0 ){
+#ifdef OUTERR
+	fprintf( stderr, "%s failed for %s\n", name, tid );
+#endif
+	_exit( 1 );
+      }
+
+      if( in ){
+	fclose( ctx.in );
+      }
+      if( out ){
+	fclose( ctx.out );
+      }
+    }
+    nev_free( &ctx );
+    fclose( null );
+    _exit( 0 );
+  }
+
+  if( wait4( pid, &status, 0, &ru ) < 0 ||
+      !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "%s failed\n", name );
+#endif
+    return( -1 );
+  }
+  gettimeofday( &t1, NULL );
+
+  sec = ( t1.tv_sec - t0.tv_sec ) + ( t1.tv_usec - t0.tv_usec ) / 1e6;
+  if( !strcmp( name, "1click" ) ){ /* no ranked list: count nuggets */
+    t = c->topics * c->nuggets;
+  }
+  else{
+    t = c->topics * c->depth;
+  }
+  printf( "%-11s %8ld %10ld %9.3f %12.0f %11ld\n",
+	  name, c->topics, t, sec, sec > 0.0 ? t / sec : 0.0,
+	  ( long )ru.ru_maxrss );
+  fflush( stdout );
+
+  return( 0 );
+
+}/* of bench_run */
+
+/******************************************************************************
+  bench_usage
+
+return value: 0 (OK)
+******************************************************************************/
+static int bench_usage( char *prog )
+{
+#ifdef OUTERR
+  fprintf( stderr, "Usage: %s [%s|%s] [%s <seed>] [%s <num>] [%s <num>] [%s <num>]\n"
+	   "       [%s <num>] [%s <num>] [%s <num>] [%s <num>] <workdir>\n",
+	   prog, OPTSTR_BENCH_GENONLY, OPTSTR_BENCH_RUNONLY,
+	   OPTSTR_BENCH_SEED, OPTSTR_BENCH_TOPICS, OPTSTR_BENCH_DEPTH,
+	   OPTSTR_BENCH_JUDGED, OPTSTR_BENCH_LEVELS, OPTSTR_BENCH_INTENTS,
+	   OPTSTR_BENCH_ECS, OPTSTR_BENCH_NUGGETS );
+  fprintf( stderr, " generates topics with a run of depth docs, judged docs\n"
+	   " with rel levels L0..L<levels>, intents and equivalence classes,\n"
+	   " and 1click nuggets, under <workdir> (%s: generate only);\n"
+	   " then times each subcommand over all topics (%s: existing data)\n",
+	   OPTSTR_BENCH_GENONLY, OPTSTR_BENCH_RUNONLY );
+#endif
+
+  return( 1 );
+
+}/* of bench_usage */
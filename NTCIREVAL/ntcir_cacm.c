@@ -0,0 +1,2454 @@
+/******************************************************************************
+  ntcir_cacm.c
+
+ tools for the CACM demo in the parent directory (see ../README):
+ "docs" streams cacm/cacm.all into a Solr update file (XML or JSON lines)
+ "query" runs cacm/query.text against a Solr select handler concurrently
+ and writes a TREC run
+ "bm25" writes such a run without Solr, from an index of cacm.all
+******************************************************************************/
+#include "ntcir_eval.h"
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define CACM_BUFSIZ 65536 /* output buffer size */
+
+#define CACM_URL "http://localhost:8983/solr/cacm/select" /* query: default
+							     endpoint */
+#define CACM_ROWS 3000    /* query: docs per query (as getResults.py) */
+#define CACM_THREADS 4    /* query: concurrent connections */
+#define CACM_TIMEOUT 30   /* query: seconds to wait for a response */
+#define CACM_RUNNAME "cacm" /* query: last field of the TREC run */
+#define CACM_IDWIDTH 4    /* query: topicIDs and docIDs are zero-padded
+			     to this width (as zfill(4) of getResults.py) */
+#define CACM_RECVSIZ 16384 /* query: bytes per recv() */
+
+#define OPTSTR_CACM_JSON "-json" /* docs: JSON lines instead of Solr XML */
+#define OPTSTR_CACM_OUT "-o"     /* output file (default: stdout) */
+#define OPTSTR_CACM_MAX "-max"   /* docs: stop after this many records */
+#define OPTSTR_CACM_URL "-url"   /* query: http://host[:port]/path */
+#define OPTSTR_CACM_ROWS "-rows" /* query: docs per query */
+#define OPTSTR_CACM_THREADS "-threads" /* query: concurrent connections */
+#define OPTSTR_CACM_PARAMS "-params" /* query: extra request parameters,
+					e.g. "df=Abstrat&q.op=OR" */
+#define OPTSTR_CACM_SKIP "-skip" /* query: comma separated queryIDs
+				    not to run */
+#define OPTSTR_CACM_RUN "-run"   /* query: run name */
+#define OPTSTR_CACM_TIMEOUT "-timeout" /* query: seconds */
+
+#define BM25_K1 1.2       /* bm25: term frequency saturation */
+#define BM25_B 0.75       /* bm25: document length normalisation */
+#define BM25_RUNNAME "bm25"
+
+#define OPTSTR_BM25_STOP "-stop" /* bm25: stopword file */
+#define OPTSTR_BM25_K1 "-k1"
+#define OPTSTR_BM25_B "-b"
+
+struct cacmfield /* a section of a cacm.all record, e.g. ".T" */
+{
+  int mark;   /* letter after the dot */
+  char *name; /* Solr field name */
+  int multi;  /* one field value per line (otherwise lines are joined) */
+  int indexed; /* searched by bm25 */
+};
+
+/* field names as in the Solr core of the demo (built from the output
+   of allToParser.py, hence "Abstrat") */
+static struct cacmfield cacmfields[] = {
+  { 'T', "title", 0, 1 },
+  { 'W', "Abstrat", 0, 1 },
+  { 'B', "date", 0, 0 },
+  { 'A', "authors", 1, 1 },
+  { 'N', "entry_date", 0, 0 },
+  { 'X', "references", 1, 0 },
+  { 'K', "keywords", 0, 1 },
+  { 'C', "categories", 0, 0 },
+  { 0, NULL, 0, 0 }
+};
+
+#define CACM_FIELDNUM ( ( int )( sizeof( cacmfields ) / sizeof( cacmfields[ 0 ] ) ) - 1 )
+
+struct cacmtext /* growing text buffer, reused from record to record */
+{
+  char *s;
+  size_t len;
+  size_t size;
+};
+
+struct cacmrec /* the record being read */
+{
+  struct cacmtext id;
+  struct cacmtext text[ CACM_FIELDNUM ]; /* lines of each section */
+};
+
+struct cacmhit /* a retrieved doc */
+{
+  char *doc;
+  char *score; /* as in the response */
+};
+
+struct cacmquery /* a query of query.text and its results */
+{
+  char *qid;
+  char *text;  /* .W lines joined by a space */
+  struct cacmhit *hits;
+  long nhits;
+  double msec; /* latency */
+  int status;  /* 0: OK, -1: failed */
+};
+
+struct cacmhttp /* the endpoint of query */
+{
+  char host[ 256 ];
+  char port[ 16 ];
+  char *path;
+  char *params;
+  long rows;
+  int timeout;
+  struct addrinfo *addr;
+};
+
+struct cacmconn /* a persistent connection of a query thread */
+{
+  int fd;                /* -1: not connected */
+  struct cacmtext req;   /* request */
+  struct cacmtext buf;   /* response as received */
+  struct cacmtext body;  /* response body (chunks decoded) */
+  struct cacmtext key;   /* JSON keys and strings */
+  struct cacmtext val;
+};
+
+struct cacmpool /* queries shared by the query threads */
+{
+  struct cacmhttp *http;
+  struct cacmquery *q;
+  long nq;
+  long next; /* next query to run */
+  pthread_mutex_t lock;
+};
+
+struct bm25post /* postings of a term: varint (docno gap - 1, tf) pairs */
+{
+  unsigned char *buf;
+  size_t len;
+  size_t size;
+  long df;
+  long last; /* docno of the last posting (-1: none) */
+};
+
+struct bm25index /* the in-memory index of bm25 */
+{
+  struct strhash vocab; /* term -> term ID */
+  struct strhash stop;  /* stopwords */
+  struct bm25post *post; /* per term ID */
+  long nterms;
+  long tsize;
+  char **docid; /* per docno */
+  long *dlen;   /* terms per doc */
+  long ndocs;
+  long npost;
+  long pbytes;
+  double avgdl;
+  double *acc;  /* score accumulators of a query */
+  long *touched; /* docnos with acc > 0 */
+};
+
+struct bm25hit
+{
+  long doc; /* docno */
+  double score;
+};
+
+static int cacm_docs( int, char ** );
+static int cacm_query( int, char ** );
+static long cacm_readline( char *, int, FILE * );
+static int cacm_mark( char * );
+static int cacm_grow( struct cacmtext *, size_t );
+static int cacm_append( struct cacmtext *, const char *, size_t );
+static int cacm_readqueries( FILE *, char *, struct cacmquery **, long * );
+static char *cacm_pad( const char * );
+static int cacm_endpoint( char *, struct cacmhttp * );
+static void *cacm_worker( void * );
+static int cacm_request( struct cacmhttp *, struct cacmconn *,
+			 struct cacmquery * );
+static int cacm_connect( struct cacmhttp *, struct cacmconn * );
+static int cacm_response( struct cacmconn *, int *, int * );
+static long cacm_recv( struct cacmconn * );
+static int cacm_parsedocs( struct cacmconn *, struct cacmquery * );
+static const char *json_ws( const char * );
+static const char *json_str( const char *, struct cacmtext * );
+static const char *json_scalar( const char *, struct cacmtext * );
+static const char *json_skip( const char * );
+static int json_next( const char **, struct cacmtext * );
+static int json_elem( const char ** );
+static double cacm_now( void );
+static int cacm_bm25( int, char ** );
+static int bm25_stoplist( struct bm25index *, char * );
+static int bm25_index( struct bm25index *, FILE * );
+static int bm25_tokens( struct bm25index *, char *, long **, long *, long *,
+			int );
+static int bm25_varint( struct bm25post *, long );
+static long bm25_search( struct bm25index *, long *, long, double, double,
+			 struct bm25hit *, long );
+static int bm25_worse( struct bm25hit *, struct bm25hit * );
+static void bm25_siftup( struct bm25hit *, long );
+static void bm25_siftdown( struct bm25hit *, long, long );
+static int bm25_cmplong( const void *, const void * );
+static void bm25_free( struct bm25index * );
+static int cacm_cmpdouble( const void *, const void * );
+static int cacm_putdoc( FILE *, struct cacmrec *, int );
+static void cacm_putxml( FILE *, const char *, size_t );
+static void cacm_putjson( FILE *, const char *, size_t );
+static FILE *cacm_open( char *, char * );
+static int cacm_usage( char * );
+
+static struct
+{
+  char *cmd;
+  int ( *func )( int, char ** );
+} cacmtable[] = {
+  { "docs", cacm_docs },
+  { "query", cacm_query },
+  { "bm25", cacm_bm25 },
+  { NULL, NULL }
+};
+
+int main( int ac, char **av )
+{
+  int i;
+
+  if( ac < 2 ){
+    return( cacm_usage( av[ 0 ] ) );
+  }
+
+  for( i = 0; cacmtable[ i ].cmd; i++ ){
+    if( strcmp( cacmtable[ i ].cmd, av[ 1 ] ) == 0 ){
+      return( cacmtable[ i ].func( ac, av ) < 0 ? 1 : 0 );
+    }
+  }
+
+  return( cacm_usage( av[ 0 ] ) );
+
+}/* of main */
+
+/******************************************************************************
+  cacm_docs
+
+  ntcir_cacm docs [-json] [-max <num>] [-o <file>] [cacm.all]
+
+reads cacm.all (default: stdin) record by record and writes each record
+as soon as it is complete, so memory does not grow with the collection:
+
+.I <docID>
+.T
+<title lines>
+.W
+<abstract lines>
+ :
+
+becomes (Solr XML, as allToParser.py but for all records)
+
+<add>
+<doc>
+<field name="id">docID</field>
+<field name="title">title lines joined by a space</field>
+<field name="authors">one field per .A line</field>
+ :
+</doc>
+ :
+</add>
+
+or, with -json, one JSON object per line:
+{"id":"docID","title":"...","authors":["...","..."],...}
+
+.A and .X lines become one value each; the lines of the other sections
+are joined. Sections without lines are left out.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_docs( int ac, char **av )
+{
+  int argc = 2;
+  int json = 0;
+  int cur = -1; /* section being read (index of cacmfields) */
+  int i;
+
+  long max = 0; /* 0: all records */
+  long ndocs = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char *p;
+  char *outfile = NULL;
+
+  long len;
+
+  FILE *fs = stdin;
+  FILE *fo = stdout;
+
+  struct cacmrec rec;
+
+  while( argc < ac ){
+
+    if( strcmp( av[ argc ], OPTSTR_CACM_JSON ) == 0 ){
+      json = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_CACM_MAX ) == 0 && argc + 1 < ac ){
+      if( ( max = atol( av[ argc + 1 ] ) ) < 1 ){
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_CACM_MAX );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_CACM_OUT ) == 0 && argc + 1 < ac ){
+      outfile = av[ argc + 1 ];
+      argc += 2;
+    }
+    else if( argc + 1 == ac && av[ argc ][ 0 ] != '-' ){
+      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+#endif
+	return( -1 );
+      }
+      argc++;
+    }
+    else{
+      cacm_usage( av[ 0 ] );
+      return( -1 );
+    }
+  }
+
+  if( ( fo = cacm_open( outfile, "w" ) ) == NULL ){
+    return( -1 );
+  }
+  memset( &rec, 0, sizeof( struct cacmrec ) );
+
+  if( !json ){
+    fprintf( fo, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<add>\n" );
+  }
+
+  while( ( len = cacm_readline( line, sizeof( line ), fs ) ) >= 0 ){
+
+    if( cacm_mark( line ) == 0 ){ /* text of a section */
+      if( cur >= 0 && len > 0 &&
+	  cacm_append( &rec.text[ cur ], line, len ) < 0 ){
+	return( -1 );
+      }
+      continue;
+    }
+
+    if( line[ 1 ] == 'I' ){ /* next record */
+
+      if( rec.id.len > 0 ){
+	cacm_putdoc( fo, &rec, json );
+	if( ++ndocs == max ){
+	  break;
+	}
+      }
+      rec.id.len = 0;
+      for( i = 0; i < CACM_FIELDNUM; i++ ){
+	rec.text[ i ].len = 0;
+      }
+      for( p = line + 2; *p == ' '; p++ );
+      if( cacm_append( &rec.id, p, strlen( p ) ) < 0 ){
+	return( -1 );
+      }
+      cur = -1;
+      continue;
+    }
+
+    /* section marker: unknown sections are skipped */
+    for( cur = 0; cacmfields[ cur ].mark &&
+	   cacmfields[ cur ].mark != line[ 1 ]; cur++ );
+    if( cacmfields[ cur ].mark == 0 ){
+      cur = -1;
+    }
+  }
+  if( len == -2 ){
+    return( -1 );
+  }
+
+  if( rec.id.len > 0 && ndocs != max ){
+    cacm_putdoc( fo, &rec, json );
+    ndocs++;
+  }
+
+  if( !json ){
+    fprintf( fo, "</add>\n" );
+  }
+
+  if( fs != stdin ){
+    fclose( fs );
+  }
+  if( outfile ){
+    fclose( fo );
+#ifdef OUTERR
+    fprintf( stderr, "created %s (%ld docs)\n", outfile, ndocs );
+#endif
+  }
+  else{
+    fflush( fo );
+  }
+
+  free( rec.id.s );
+  for( i = 0; i < CACM_FIELDNUM; i++ ){
+    free( rec.text[ i ].s );
+  }
+
+  return( 0 );
+
+}/* of cacm_docs */
+
+/******************************************************************************
+  cacm_readline
+
+reads a line of cacm.all or query.text without the trailing newline
+and blanks
+
+return value: length of the line (OK)
+             -1 (end of file)
+             -2 (line too long)
+******************************************************************************/
+static long cacm_readline( char *line, int size, FILE *fs )
+{
+  size_t len;
+
+  if( fgets( line, size, fs ) == NULL ){
+    return( -1 );
+  }
+
+  len = strlen( line );
+  if( len == ( size_t )size - 1 && line[ len - 1 ] != '\n' ){
+#ifdef OUTERR
+    fprintf( stderr, "Line too long: %s\n", line );
+#endif
+    return( -2 );
+  }
+  while( len > 0 && ( line[ len - 1 ] == '\n' || line[ len - 1 ] == '\r' ||
+		      line[ len - 1 ] == ' ' || line[ len - 1 ] == '\t' ) ){
+    line[ --len ] = '\0';
+  }
+
+  return( ( long )len );
+
+}/* of cacm_readline */
+
+/******************************************************************************
+  cacm_mark
+
+return value: the letter of a section marker line such as ".I 1" or ".W"
+              0 (text of a section)
+******************************************************************************/
+static int cacm_mark( char *line )
+{
+  if( line[ 0 ] != '.' || line[ 1 ] < 'A' || line[ 1 ] > 'Z' ||
+      ( line[ 2 ] != '\0' && line[ 2 ] != ' ' ) ){
+    return( 0 );
+  }
+
+  return( line[ 1 ] );
+
+}/* of cacm_mark */
+
+/******************************************************************************
+  cacm_grow, cacm_append
+
+cacm_grow makes room for len more bytes (and a '\0') in t;
+cacm_append appends a line (without the newline) and a '\n' to t
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_grow( struct cacmtext *t, size_t len )
+{
+  if( t->len + len + 2 > t->size ){
+    t->size = 2 * ( t->len + len + 2 );
+    if( ( t->s = ( char *)realloc( t->s, t->size ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "realloc failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+
+  return( 0 );
+
+}/* of cacm_grow */
+
+static int cacm_append( struct cacmtext *t, const char *s, size_t len )
+{
+  if( cacm_grow( t, len + 1 ) < 0 ){
+    return( -1 );
+  }
+  memcpy( t->s + t->len, s, len );
+  t->len += len;
+  t->s[ t->len++ ] = '\n';
+  t->s[ t->len ] = '\0';
+
+  return( 0 );
+
+}/* of cacm_append */
+
+/******************************************************************************
+  cacm_putdoc
+
+writes a record as a Solr XML <doc> or a JSON line
+
+return value: 0 (OK)
+******************************************************************************/
+static int cacm_putdoc( FILE *fo, struct cacmrec *rec, int json )
+{
+  int i;
+  int n;
+
+  char *p, *q;
+  char *end;
+
+  void ( *put )( FILE *, const char *, size_t );
+
+  put = json ? cacm_putjson : cacm_putxml;
+
+  if( json ){
+    fputs( "{\"id\":\"", fo );
+    put( fo, rec->id.s, rec->id.len - 1 );
+    putc( '"', fo );
+  }
+  else{
+    fputs( "<doc>\n<field name=\"id\">", fo );
+    put( fo, rec->id.s, rec->id.len - 1 );
+    fputs( "</field>\n", fo );
+  }
+
+  for( i = 0; i < CACM_FIELDNUM; i++ ){
+
+    if( rec->text[ i ].len == 0 ){
+      continue;
+    }
+    end = rec->text[ i ].s + rec->text[ i ].len;
+
+    if( json ){
+      fprintf( fo, ",\"%s\":%s\"", cacmfields[ i ].name,
+	       cacmfields[ i ].multi ? "[" : "" );
+    }
+    else if( !cacmfields[ i ].multi ){
+      fprintf( fo, "<field name=\"%s\">", cacmfields[ i ].name );
+    }
+
+    for( n = 0, p = rec->text[ i ].s; p < end; p = q + 1, n++ ){
+
+      q = strchr( p, '\n' );
+      if( cacmfields[ i ].multi ){
+	if( json ){
+	  fputs( n > 0 ? ",\"" : "", fo );
+	}
+	else{
+	  fprintf( fo, "<field name=\"%s\">", cacmfields[ i ].name );
+	}
+      }
+      else if( n > 0 ){ /* joined lines */
+	putc( ' ', fo );
+      }
+      put( fo, p, q - p );
+      if( cacmfields[ i ].multi ){
+	fputs( json ? "\"" : "</field>\n", fo );
+      }
+    }
+
+    if( json ){
+      fputs( cacmfields[ i ].multi ? "]" : "\"", fo );
+    }
+    else if( !cacmfields[ i ].multi ){
+      fputs( "</field>\n", fo );
+    }
+  }
+
+  fputs( json ? "}\n" : "</doc>\n", fo );
+
+  return( 0 );
+
+}/* of cacm_putdoc */
+
+/******************************************************************************
+  cacm_putxml, cacm_putjson
+
+write len bytes of s escaped for XML text / a JSON string
+(cacm.all has a few control characters: blanks in XML)
+******************************************************************************/
+static void cacm_putxml( FILE *fo, const char *s, size_t len )
+{
+  size_t i;
+
+  for( i = 0; i < len; i++ ){
+    switch( s[ i ] ){
+    case '&': fputs( "&amp;", fo ); break;
+    case '<': fputs( "&lt;", fo ); break;
+    case '>': fputs( "&gt;", fo ); break;
+    case '"': fputs( "&quot;", fo ); break;
+    case '\t': putc( '\t', fo ); break;
+    default: /* control characters are not allowed in XML 1.0 */
+      putc( ( unsigned char )s[ i ] < 0x20 ? ' ' : s[ i ], fo );
+    }
+  }
+
+}/* of cacm_putxml */
+
+static void cacm_putjson( FILE *fo, const char *s, size_t len )
+{
+  size_t i;
+
+  for( i = 0; i < len; i++ ){
+    switch( s[ i ] ){
+    case '"': fputs( "\\\"", fo ); break;
+    case '\\': fputs( "\\\\", fo ); break;
+    case '\t': fputs( "\\t", fo ); break;
+    case '\r': fputs( "\\r", fo ); break;
+    case '\n': fputs( "\\n", fo ); break;
+    default:
+      if( ( unsigned char )s[ i ] < 0x20 ){
+	fprintf( fo, "\\u%04x", ( unsigned char )s[ i ] );
+      }
+      else{
+	putc( s[ i ], fo );
+      }
+    }
+  }
+
+}/* of cacm_putjson */
+
+/******************************************************************************
+  cacm_query
+
+  ntcir_cacm query [-url <url>] [-threads <num>] [-rows <num>]
+                   [-params <params>] [-skip <qid,qid...>] [-run <name>]
+                   [-timeout <sec>] [-o <file>] [query.text]
+
+runs the queries of query.text (default: stdin) against a Solr select
+handler (default: CACM_URL) and writes a TREC run, as getResults.py:
+
+<topicID> Q0 <docID> <rank> <score> <runname>
+ :
+
+Queries are sent by -threads threads (default: CACM_THREADS), each over
+its own persistent HTTP/1.1 connection, and the JSON responses are
+parsed for the id and score of each doc. The run is written in
+query.text order whatever order the responses come in; topicIDs and
+docIDs are zero-padded to CACM_IDWIDTH digits. Failed queries are
+reported and left out of the run.
+
+The query text is sent as plain terms: query syntax characters such as
+":" and "/" are escaped, so that queries getResults.py had to skip
+(e.g. 30 and 33) can be run. The latencies of the queries are reported
+on stderr (mean, percentiles, max).
+
+return value: 0 (OK)
+             -1 (ERROR, or some queries failed)
+******************************************************************************/
+static int cacm_query( int ac, char **av )
+{
+  int argc = 2;
+  int nthreads = CACM_THREADS;
+  int i;
+
+  long j, k;
+  long nq = 0;
+  long nok = 0;
+
+  char *url = CACM_URL;
+  char *skip = NULL;
+  char *run = CACM_RUNNAME;
+  char *outfile = NULL;
+  char *qdoc;
+
+  double t0;
+  double wall;
+  double *lat;
+
+  FILE *fs = stdin;
+  FILE *fo;
+
+  struct cacmhttp http;
+  struct cacmpool pool;
+  struct cacmquery *q = NULL;
+
+  pthread_t *tid;
+
+  memset( &http, 0, sizeof( struct cacmhttp ) );
+  http.rows = CACM_ROWS;
+  http.timeout = CACM_TIMEOUT;
+
+  while( argc < ac ){
+
+    if( argc + 1 < ac && av[ argc ][ 0 ] == '-' ){
+
+      if( strcmp( av[ argc ], OPTSTR_CACM_URL ) == 0 ){
+	url = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_THREADS ) == 0 ){
+	nthreads = atoi( av[ argc + 1 ] );
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_ROWS ) == 0 ){
+	http.rows = atol( av[ argc + 1 ] );
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_PARAMS ) == 0 ){
+	http.params = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_SKIP ) == 0 ){
+	skip = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_RUN ) == 0 ){
+	run = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_TIMEOUT ) == 0 ){
+	http.timeout = atoi( av[ argc + 1 ] );
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_OUT ) == 0 ){
+	outfile = av[ argc + 1 ];
+      }
+      else{
+	cacm_usage( av[ 0 ] );
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( argc + 1 == ac && av[ argc ][ 0 ] != '-' ){
+      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+#endif
+	return( -1 );
+      }
+      argc++;
+    }
+    else{
+      cacm_usage( av[ 0 ] );
+      return( -1 );
+    }
+  }
+
+  if( nthreads < 1 || http.rows < 1 || http.timeout < 1 ){
+#ifdef OUTERR
+    fprintf( stderr, "Bad %s, %s or %s value\n",
+	     OPTSTR_CACM_THREADS, OPTSTR_CACM_ROWS, OPTSTR_CACM_TIMEOUT );
+#endif
+    return( -1 );
+  }
+
+  if( cacm_readqueries( fs, skip, &q, &nq ) < 0 ||
+      cacm_endpoint( url, &http ) < 0 ){
+    return( -1 );
+  }
+  if( fs != stdin ){
+    fclose( fs );
+  }
+
+  if( nthreads > nq ){
+    nthreads = nq > 0 ? nq : 1;
+  }
+  if( ( tid = ( pthread_t *)malloc( nthreads * sizeof( pthread_t ) ) )
+      == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+
+  pool.http = &http;
+  pool.q = q;
+  pool.nq = nq;
+  pool.next = 0;
+  pthread_mutex_init( &pool.lock, NULL );
+
+  t0 = cacm_now();
+  for( i = 0; i < nthreads; i++ ){
+    if( pthread_create( &tid[ i ], NULL, cacm_worker, &pool ) != 0 ){
+#ifdef OUTERR
+      fprintf( stderr, "pthread_create failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+  for( i = 0; i < nthreads; i++ ){
+    pthread_join( tid[ i ], NULL );
+  }
+  wall = cacm_now() - t0;
+  pthread_mutex_destroy( &pool.lock );
+  free( tid );
+  freeaddrinfo( http.addr );
+
+  /* the run, in query order */
+  if( ( fo = cacm_open( outfile, "w" ) ) == NULL ){
+    return( -1 );
+  }
+  for( j = 0; j < nq; j++ ){
+    if( q[ j ].status < 0 ){
+      continue;
+    }
+    for( k = 0; k < q[ j ].nhits; k++ ){
+      if( ( qdoc = cacm_pad( q[ j ].hits[ k ].doc ) ) == NULL ){
+	return( -1 );
+      }
+      fprintf( fo, "%s Q0 %s %ld %s %s\n", q[ j ].qid, qdoc, k + 1,
+	       q[ j ].hits[ k ].score, run );
+      free( qdoc );
+    }
+  }
+  if( outfile ){
+    fclose( fo );
+#ifdef OUTERR
+    fprintf( stderr, "created %s\n", outfile );
+#endif
+  }
+  else{
+    fflush( fo );
+  }
+
+  /* latencies of the queries that succeeded */
+  if( ( lat = ( double *)malloc( ( nq + 1 ) * sizeof( double ) ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+  for( j = 0; j < nq; j++ ){
+    if( q[ j ].status == 0 ){
+      lat[ nok++ ] = q[ j ].msec;
+    }
+  }
+  fprintf( stderr, "# query: %ld queries (%ld failed), %d threads, %.3f s, %.1f queries/s\n",
+	   nq, nq - nok, nthreads, wall, wall > 0 ? nok / wall : 0.0 );
+  if( nok > 0 ){
+    double mean = 0;
+
+    qsort( lat, nok, sizeof( double ), cacm_cmpdouble );
+    for( j = 0; j < nok; j++ ){
+      mean += lat[ j ];
+    }
+    /* nearest-rank percentiles */
+#define CACM_PCT( p ) lat[ ( long )ceil( ( p ) / 100.0 * nok ) - 1 ]
+    fprintf( stderr, "# latency (ms): mean=%.2f p50=%.2f p90=%.2f p95=%.2f p99=%.2f max=%.2f\n",
+	     mean / nok, CACM_PCT( 50 ), CACM_PCT( 90 ), CACM_PCT( 95 ),
+	     CACM_PCT( 99 ), lat[ nok - 1 ] );
+#undef CACM_PCT
+  }
+  free( lat );
+
+  for( j = 0; j < nq; j++ ){
+    for( k = 0; k < q[ j ].nhits; k++ ){
+      free( q[ j ].hits[ k ].doc );
+      free( q[ j ].hits[ k ].score );
+    }
+    free( q[ j ].hits );
+    free( q[ j ].qid );
+    free( q[ j ].text );
+  }
+  free( q );
+
+  return( nok == nq ? 0 : -1 );
+
+}/* of cacm_query */
+
+/******************************************************************************
+  cacm_readqueries
+
+reads the .I and .W sections of query.text
+(queries listed in skip, e.g. "30,33", and queries without text
+are left out)
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_readqueries( FILE *fs, char *skip, struct cacmquery **qp,
+			     long *nqp )
+{
+  int mark;
+  int intext = 0;
+
+  long len;
+  long nq = 0;
+  long qsize = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char *p, *e;
+
+  struct cacmtext id;
+  struct cacmtext text;
+  struct cacmquery *q = NULL;
+
+  memset( &id, 0, sizeof( struct cacmtext ) );
+  memset( &text, 0, sizeof( struct cacmtext ) );
+
+  for( ; ; ){
+
+    len = cacm_readline( line, sizeof( line ), fs );
+    if( len == -2 ){
+      return( -1 );
+    }
+    mark = len >= 0 ? cacm_mark( line ) : 'I';
+
+    if( mark == 0 ){
+      if( intext && len > 0 ){
+	for( p = line; *p == ' ' || *p == '\t'; p++ );
+	if( text.len > 0 ){
+	  text.s[ text.len - 1 ] = ' '; /* join lines */
+	}
+	if( cacm_append( &text, p, strlen( p ) ) < 0 ){
+	  return( -1 );
+	}
+      }
+      continue;
+    }
+    intext = ( mark == 'W' );
+    if( mark != 'I' ){
+      continue;
+    }
+
+    /* end of a query */
+    if( id.len > 0 && text.len > 0 ){
+
+      id.s[ id.len - 1 ] = text.s[ text.len - 1 ] = '\0';
+      for( p = skip; p; p = e ? e + 1 : NULL ){ /* in the skip list? */
+	e = strchr( p, ',' );
+	if( ( e ? ( size_t )( e - p ) : strlen( p ) ) == strlen( id.s ) &&
+	    strncmp( p, id.s, strlen( id.s ) ) == 0 ){
+	  break;
+	}
+      }
+
+      if( p == NULL ){
+	if( nq == qsize ){
+	  qsize = qsize ? 2 * qsize : 64;
+	  if( ( q = ( struct cacmquery *)realloc( q, qsize *
+						  sizeof( struct cacmquery ) ) )
+	      == NULL ){
+#ifdef OUTERR
+	    fprintf( stderr, "realloc failed\n" );
+#endif
+	    return( -1 );
+	  }
+	}
+	memset( &q[ nq ], 0, sizeof( struct cacmquery ) );
+	if( ( q[ nq ].qid = cacm_pad( id.s ) ) == NULL ||
+	    ( q[ nq ].text = strdup( text.s ) ) == NULL ){
+	  return( -1 );
+	}
+	nq++;
+      }
+    }
+    if( len < 0 ){ /* end of file */
+      break;
+    }
+
+    id.len = text.len = 0;
+    for( p = line + 2; *p == ' '; p++ );
+    if( cacm_append( &id, p, strlen( p ) ) < 0 ){
+      return( -1 );
+    }
+  }
+
+  free( id.s );
+  free( text.s );
+  *qp = q;
+  *nqp = nq;
+
+  return( 0 );
+
+}/* of cacm_readqueries */
+
+/******************************************************************************
+  cacm_pad
+
+return value: newly allocated copy of id without surrounding blanks,
+              zero-padded to CACM_IDWIDTH characters (as zfill)
+              NULL (ERROR)
+******************************************************************************/
+static char *cacm_pad( const char *id )
+{
+  size_t len;
+  size_t pad = 0;
+
+  char *s;
+
+  while( *id == ' ' || *id == '\t' || *id == '\n' || *id == '\r' ){
+    id++;
+  }
+  for( len = strlen( id );
+       len > 0 && ( id[ len - 1 ] == ' ' || id[ len - 1 ] == '\t' ||
+		    id[ len - 1 ] == '\n' || id[ len - 1 ] == '\r' ); len-- );
+  if( len < CACM_IDWIDTH ){
+    pad = CACM_IDWIDTH - len;
+  }
+
+  if( ( s = ( char *)malloc( pad + len + 1 ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( NULL );
+  }
+  memset( s, '0', pad );
+  memcpy( s + pad, id, len );
+  s[ pad + len ] = '\0';
+
+  return( s );
+
+}/* of cacm_pad */
+
+/******************************************************************************
+  cacm_endpoint
+
+parses http://host[:port]/path and resolves host
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_endpoint( char *url, struct cacmhttp *http )
+{
+  int rc;
+
+  char *p, *e;
+
+  size_t len;
+
+  struct addrinfo hints;
+
+  if( strncmp( url, "http://", 7 ) != 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "Bad %s value (only http:// is supported): %s\n",
+	     OPTSTR_CACM_URL, url );
+#endif
+    return( -1 );
+  }
+  p = url + 7;
+  if( ( http->path = strchr( p, '/' ) ) == NULL ){
+    http->path = "/";
+  }
+  len = ( *http->path == '/' && http->path > p ) ?
+    ( size_t )( http->path - p ) : strlen( p );
+  if( ( e = memchr( p, ':', len ) ) != NULL ){ /* host:port */
+    if( ( size_t )( e - p ) >= sizeof( http->host ) ||
+	len - ( e - p ) - 1 >= sizeof( http->port ) ){
+#ifdef OUTERR
+      fprintf( stderr, "Bad %s value: %s\n", OPTSTR_CACM_URL, url );
+#endif
+      return( -1 );
+    }
+    memcpy( http->host, p, e - p );
+    http->host[ e - p ] = '\0';
+    memcpy( http->port, e + 1, len - ( e - p ) - 1 );
+    http->port[ len - ( e - p ) - 1 ] = '\0';
+  }
+  else{
+    if( len >= sizeof( http->host ) ){
+#ifdef OUTERR
+      fprintf( stderr, "Bad %s value: %s\n", OPTSTR_CACM_URL, url );
+#endif
+      return( -1 );
+    }
+    memcpy( http->host, p, len );
+    http->host[ len ] = '\0';
+    strcpy( http->port, "80" );
+  }
+
+  memset( &hints, 0, sizeof( struct addrinfo ) );
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if( ( rc = getaddrinfo( http->host, http->port, &hints, &http->addr ) )
+      != 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot resolve %s: %s\n", http->host,
+	     gai_strerror( rc ) );
+#endif
+    return( -1 );
+  }
+
+  return( 0 );
+
+}/* of cacm_endpoint */
+
+/******************************************************************************
+  cacm_worker
+
+a query thread: runs queries of the pool until none is left,
+keeping its connection open between them
+
+return value: NULL
+******************************************************************************/
+static void *cacm_worker( void *arg )
+{
+  long j;
+
+  double t0;
+
+  struct cacmpool *pool = ( struct cacmpool *)arg;
+  struct cacmconn c;
+
+  memset( &c, 0, sizeof( struct cacmconn ) );
+  c.fd = -1;
+
+  for( ; ; ){
+
+    pthread_mutex_lock( &pool->lock );
+    j = pool->next++;
+    pthread_mutex_unlock( &pool->lock );
+    if( j >= pool->nq ){
+      break;
+    }
+
+    t0 = cacm_now();
+    pool->q[ j ].status = cacm_request( pool->http, &c, &pool->q[ j ] );
+    pool->q[ j ].msec = 1000 * ( cacm_now() - t0 );
+  }
+
+  if( c.fd >= 0 ){
+    close( c.fd );
+  }
+  free( c.req.s );
+  free( c.buf.s );
+  free( c.body.s );
+  free( c.key.s );
+  free( c.val.s );
+
+  return( NULL );
+
+}/* of cacm_worker */
+
+/******************************************************************************
+  cacm_request
+
+sends a query over c (connecting if necessary; a connection the server
+has closed in the meantime is reopened once) and parses the response
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_request( struct cacmhttp *http, struct cacmconn *c,
+			 struct cacmquery *q )
+{
+  int try;
+  int reused;
+  int status;
+  int keep;
+
+  char tmp[ 512 ];
+  char *p;
+
+  size_t sent;
+
+  ssize_t n;
+
+  c->req.len = 0;
+  sprintf( tmp, "GET %.256s%sq=", http->path,
+	   strchr( http->path, '?' ) ? "&" : "?" );
+  if( cacm_grow( &c->req, strlen( tmp ) + 3 * strlen( q->text ) ) < 0 ){
+    return( -1 );
+  }
+  strcpy( c->req.s, tmp );
+  c->req.len = strlen( tmp );
+
+  /* the text as plain terms: lower case (no AND/OR/NOT operators),
+     query syntax characters escaped, then URL-encoded */
+  for( p = q->text; *p; p++ ){
+    if( cacm_grow( &c->req, 6 ) < 0 ){
+      return( -1 );
+    }
+    if( strchr( "+-&|!(){}[]^\"~*?:\\/", *p ) ){
+      memcpy( c->req.s + c->req.len, "%5C", 3 );
+      c->req.len += 3;
+    }
+    if( ( *p >= 'a' && *p <= 'z' ) || ( *p >= '0' && *p <= '9' ) ||
+	*p == '.' || *p == '_' || *p == '-' ){
+      c->req.s[ c->req.len++ ] = *p;
+    }
+    else if( *p >= 'A' && *p <= 'Z' ){
+      c->req.s[ c->req.len++ ] = *p - 'A' + 'a';
+    }
+    else{
+      sprintf( c->req.s + c->req.len, "%%%02X", ( unsigned char )*p );
+      c->req.len += 3;
+    }
+  }
+
+  snprintf( tmp, sizeof( tmp ),
+	    "&fl=id%%2Cscore&wt=json&rows=%ld%s%s HTTP/1.1\r\n"
+	    "Host: %s:%s\r\nAccept: application/json\r\n"
+	    "Connection: keep-alive\r\n\r\n",
+	    http->rows, http->params ? "&" : "",
+	    http->params ? http->params : "", http->host, http->port );
+  if( cacm_grow( &c->req, strlen( tmp ) ) < 0 ){
+    return( -1 );
+  }
+  strcpy( c->req.s + c->req.len, tmp );
+  c->req.len += strlen( tmp );
+
+  for( try = 0; try < 2; try++ ){
+
+    reused = ( c->fd >= 0 );
+    if( !reused && cacm_connect( http, c ) < 0 ){
+      return( -1 );
+    }
+
+    for( sent = 0; sent < c->req.len; sent += n ){
+      if( ( n = send( c->fd, c->req.s + sent, c->req.len - sent,
+		      MSG_NOSIGNAL ) ) <= 0 ){
+	break;
+      }
+    }
+    if( sent == c->req.len && cacm_response( c, &status, &keep ) == 0 ){
+      break;
+    }
+
+    close( c->fd ); /* closed by the server (or an error) */
+    c->fd = -1;
+    if( !reused ){
+#ifdef OUTERR
+      fprintf( stderr, "Query %s: no response from %s:%s\n",
+	       q->qid, http->host, http->port );
+#endif
+      return( -1 );
+    }
+  }
+  if( try == 2 ){
+    return( -1 );
+  }
+
+  if( !keep ){
+    close( c->fd );
+    c->fd = -1;
+  }
+
+  if( status != 200 ){
+#ifdef OUTERR
+    fprintf( stderr, "Query %s: HTTP status %d: %.200s\n",
+	     q->qid, status, c->body.s ? c->body.s : "" );
+#endif
+    return( -1 );
+  }
+  if( cacm_parsedocs( c, q ) < 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "Query %s: bad JSON response\n", q->qid );
+#endif
+    return( -1 );
+  }
+
+  return( 0 );
+
+}/* of cacm_request */
+
+/******************************************************************************
+  cacm_connect
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_connect( struct cacmhttp *http, struct cacmconn *c )
+{
+  int on = 1;
+
+  struct addrinfo *a;
+  struct timeval tv;
+
+  for( a = http->addr; a; a = a->ai_next ){
+    if( ( c->fd = socket( a->ai_family, a->ai_socktype, a->ai_protocol ) )
+	< 0 ){
+      continue;
+    }
+    if( connect( c->fd, a->ai_addr, a->ai_addrlen ) == 0 ){
+      break;
+    }
+    close( c->fd );
+    c->fd = -1;
+  }
+  if( c->fd < 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot connect to %s:%s: %s\n", http->host, http->port,
+	     strerror( errno ) );
+#endif
+    return( -1 );
+  }
+
+  setsockopt( c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+  tv.tv_sec = http->timeout;
+  tv.tv_usec = 0;
+  setsockopt( c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof( tv ) );
+  setsockopt( c->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof( tv ) );
+
+  return( 0 );
+
+}/* of cacm_connect */
+
+/******************************************************************************
+  cacm_response
+
+reads an HTTP/1.x response into c->body
+(Content-Length, chunked, or up to the end of the connection)
+
+return value: 0 (OK; *status: HTTP status, *keep: connection reusable)
+             -1 (ERROR: connection closed or timed out)
+******************************************************************************/
+static int cacm_response( struct cacmconn *c, int *status, int *keep )
+{
+  int chunked;
+
+  long clen = -1;
+  long size;
+
+  char *p, *e;
+
+  size_t hlen;
+  size_t pos;
+
+  c->buf.len = 0;
+  c->body.len = 0;
+
+  /* status line and headers */
+  while( c->buf.len == 0 || ( e = strstr( c->buf.s, "\r\n\r\n" ) ) == NULL ){
+    if( cacm_recv( c ) <= 0 ){
+      return( -1 );
+    }
+  }
+  hlen = e - c->buf.s + 4;
+  if( strncmp( c->buf.s, "HTTP/1.", 7 ) != 0 ){
+    return( -1 );
+  }
+  *status = atoi( c->buf.s + 9 );
+  *keep = ( c->buf.s[ 7 ] == '1' );
+  for( p = c->buf.s; p < e; p++ ){ /* header names and values in lower case */
+    if( *p >= 'A' && *p <= 'Z' ){
+      *p += 'a' - 'A';
+    }
+  }
+  *e = '\0';
+  if( ( p = strstr( c->buf.s, "\r\nconnection:" ) ) != NULL ){
+    for( p += 13; *p == ' ' || *p == '\t'; p++ );
+    if( strncmp( p, "close", 5 ) == 0 ){
+      *keep = 0;
+    }
+    else if( strncmp( p, "keep-alive", 10 ) == 0 ){
+      *keep = 1;
+    }
+  }
+  chunked = 0;
+  if( ( p = strstr( c->buf.s, "\r\ntransfer-encoding:" ) ) != NULL ){
+    for( p += 20; *p == ' ' || *p == '\t'; p++ );
+    chunked = ( strncmp( p, "chunked", 7 ) == 0 );
+  }
+  if( ( p = strstr( c->buf.s, "\r\ncontent-length:" ) ) != NULL ){
+    clen = atol( p + 17 );
+  }
+  *e = '\r';
+
+  if( chunked ){
+    for( pos = hlen; ; ){
+      while( ( e = strstr( c->buf.s + pos, "\r\n" ) ) == NULL ){
+	if( cacm_recv( c ) <= 0 ){
+	  return( -1 );
+	}
+      }
+      size = strtol( c->buf.s + pos, NULL, 16 );
+      pos = e - c->buf.s + 2;
+      if( size <= 0 ){ /* last chunk (trailers are not used) */
+	break;
+      }
+      while( c->buf.len < pos + size + 2 ){
+	if( cacm_recv( c ) <= 0 ){
+	  return( -1 );
+	}
+      }
+      if( cacm_grow( &c->body, size ) < 0 ){
+	return( -1 );
+      }
+      memcpy( c->body.s + c->body.len, c->buf.s + pos, size );
+      c->body.len += size;
+      pos += size + 2;
+    }
+  }
+  else{
+    while( clen < 0 || c->buf.len < hlen + clen ){
+      if( cacm_recv( c ) <= 0 ){
+	if( clen >= 0 ){
+	  return( -1 );
+	}
+	*keep = 0; /* the body ends with the connection */
+	break;
+      }
+    }
+    if( clen < 0 ){
+      clen = c->buf.len - hlen;
+    }
+    if( cacm_grow( &c->body, clen ) < 0 ){
+      return( -1 );
+    }
+    memcpy( c->body.s, c->buf.s + hlen, clen );
+    c->body.len = clen;
+  }
+  c->body.s[ c->body.len ] = '\0';
+
+  return( 0 );
+
+}/* of cacm_response */
+
+/******************************************************************************
+  cacm_recv
+
+appends what arrives on c->fd to c->buf
+
+return value: bytes received (OK)
+              0 (connection closed)
+             -1 (ERROR)
+******************************************************************************/
+static long cacm_recv( struct cacmconn *c )
+{
+  ssize_t n;
+
+  if( cacm_grow( &c->buf, CACM_RECVSIZ ) < 0 ){
+    return( -1 );
+  }
+  do{
+    n = recv( c->fd, c->buf.s + c->buf.len, CACM_RECVSIZ, 0 );
+  }while( n < 0 && errno == EINTR );
+  if( n > 0 ){
+    c->buf.len += n;
+    c->buf.s[ c->buf.len ] = '\0';
+  }
+
+  return( ( long )n );
+
+}/* of cacm_recv */
+
+/******************************************************************************
+  cacm_parsedocs
+
+collects id and score of response.docs of a Solr JSON response:
+{"responseHeader":{...},"response":{"numFound":...,"docs":[
+ {"id":"1410","score":8.251568},...]}}
+An id may also be a list (the first value is used).
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_parsedocs( struct cacmconn *c, struct cacmquery *q )
+{
+  int r;
+
+  long hsize = 0;
+
+  const char *p = json_ws( c->body.s );
+
+  struct cacmhit h;
+
+  if( *p++ != '{' ){
+    return( -1 );
+  }
+  while( ( r = json_next( &p, &c->key ) ) > 0 ){
+
+    if( strcmp( c->key.s, "response" ) != 0 || *p != '{' ){
+      if( ( p = json_skip( p ) ) == NULL ){
+	return( -1 );
+      }
+      continue;
+    }
+
+    p++;
+    while( ( r = json_next( &p, &c->key ) ) > 0 ){
+
+      if( strcmp( c->key.s, "docs" ) != 0 || *p != '[' ){
+	if( ( p = json_skip( p ) ) == NULL ){
+	  return( -1 );
+	}
+	continue;
+      }
+
+      p++;
+      while( ( r = json_elem( &p ) ) > 0 ){
+
+	if( *p++ != '{' ){
+	  return( -1 );
+	}
+	h.doc = h.score = NULL;
+	while( ( r = json_next( &p, &c->key ) ) > 0 ){
+	  if( strcmp( c->key.s, "id" ) == 0 ){
+	    if( ( p = json_scalar( p, &c->val ) ) == NULL ||
+		( h.doc = strdup( c->val.s ) ) == NULL ){
+	      return( -1 );
+	    }
+	  }
+	  else if( strcmp( c->key.s, "score" ) == 0 ){
+	    if( ( p = json_scalar( p, &c->val ) ) == NULL ||
+		( h.score = strdup( c->val.s ) ) == NULL ){
+	      return( -1 );
+	    }
+	  }
+	  else if( ( p = json_skip( p ) ) == NULL ){
+	    return( -1 );
+	  }
+	}
+	if( r < 0 || h.doc == NULL || h.score == NULL ){
+	  return( -1 );
+	}
+
+	if( q->nhits == hsize ){
+	  hsize = hsize ? 2 * hsize : 256;
+	  if( ( q->hits = ( struct cacmhit *)realloc( q->hits, hsize *
+						      sizeof( struct cacmhit ) ) )
+	      == NULL ){
+	    return( -1 );
+	  }
+	}
+	q->hits[ q->nhits++ ] = h;
+      }
+      if( r < 0 ){
+	return( -1 );
+      }
+    }
+    if( r < 0 ){
+      return( -1 );
+    }
+  }
+
+  return( r );
+
+}/* of cacm_parsedocs */
+
+/******************************************************************************
+  json_ws, json_str, json_scalar, json_skip, json_next, json_elem
+
+a small JSON reader for cacm_parsedocs:
+json_ws skips white space; json_str reads a string (decoded into out
+if out is not NULL); json_scalar reads a string, a number, a literal
+or the first of a list into out; json_skip skips any value;
+json_next reads the next "key": of an object (1), or its end (0);
+json_elem finds the next element of a list (1), or its end (0).
+
+return value: position after what was read; NULL (syntax error)
+              1, 0 (see above), -1 (syntax error)
+******************************************************************************/
+static const char *json_ws( const char *p )
+{
+  while( *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' ){
+    p++;
+  }
+
+  return( p );
+
+}/* of json_ws */
+
+static const char *json_str( const char *p, struct cacmtext *out )
+{
+  unsigned long u;
+
+  char ubuf[ 5 ];
+  char e;
+
+  if( out ){
+    out->len = 0;
+  }
+  if( *p++ != '"' ){
+    return( NULL );
+  }
+
+  for( ; *p != '"'; p++ ){
+
+    if( *p == '\0' ){
+      return( NULL );
+    }
+    if( out && cacm_grow( out, 4 ) < 0 ){
+      return( NULL );
+    }
+    if( *p != '\\' ){
+      if( out ){
+	out->s[ out->len++ ] = *p;
+      }
+      continue;
+    }
+
+    switch( e = *++p ){
+    case 'b': e = '\b'; break;
+    case 'f': e = '\f'; break;
+    case 'n': e = '\n'; break;
+    case 'r': e = '\r'; break;
+    case 't': e = '\t'; break;
+    case 'u':
+      if( strlen( p ) < 5 ){
+	return( NULL );
+      }
+      memcpy( ubuf, p + 1, 4 );
+      ubuf[ 4 ] = '\0';
+      u = strtoul( ubuf, NULL, 16 );
+      p += 4;
+      if( out == NULL ){
+	continue;
+      }
+      if( u < 0x80 ){ /* as UTF-8 */
+	out->s[ out->len++ ] = ( char )u;
+      }
+      else if( u < 0x800 ){
+	out->s[ out->len++ ] = ( char )( 0xc0 | ( u >> 6 ) );
+	out->s[ out->len++ ] = ( char )( 0x80 | ( u & 0x3f ) );
+      }
+      else{
+	out->s[ out->len++ ] = ( char )( 0xe0 | ( u >> 12 ) );
+	out->s[ out->len++ ] = ( char )( 0x80 | ( ( u >> 6 ) & 0x3f ) );
+	out->s[ out->len++ ] = ( char )( 0x80 | ( u & 0x3f ) );
+      }
+      continue;
+    case '\0':
+      return( NULL );
+    }
+    if( out ){
+      out->s[ out->len++ ] = e;
+    }
+  }
+
+  if( out ){
+    if( cacm_grow( out, 1 ) < 0 ){
+      return( NULL );
+    }
+    out->s[ out->len ] = '\0';
+  }
+
+  return( p + 1 );
+
+}/* of json_str */
+
+static const char *json_scalar( const char *p, struct cacmtext *out )
+{
+  int r;
+
+  const char *e;
+
+  p = json_ws( p );
+  if( *p == '"' ){
+    return( json_str( p, out ) );
+  }
+
+  if( *p == '[' ){ /* the first value of a list */
+    p++;
+    if( ( r = json_elem( &p ) ) <= 0 || ( p = json_scalar( p, out ) ) == NULL ){
+      return( NULL );
+    }
+    while( ( r = json_elem( &p ) ) > 0 ){
+      if( ( p = json_skip( p ) ) == NULL ){
+	return( NULL );
+      }
+    }
+    return( r < 0 ? NULL : p );
+  }
+
+  for( e = p; *e && strchr( ",}] \t\r\n", *e ) == NULL; e++ );
+  if( e == p || *p == '{' ){
+    return( NULL );
+  }
+  out->len = 0;
+  if( cacm_grow( out, e - p ) < 0 ){
+    return( NULL );
+  }
+  memcpy( out->s, p, e - p );
+  out->len = e - p;
+  out->s[ out->len ] = '\0';
+
+  return( e );
+
+}/* of json_scalar */
+
+static const char *json_skip( const char *p )
+{
+  int depth = 0;
+
+  p = json_ws( p );
+  if( *p == '"' ){
+    return( json_str( p, NULL ) );
+  }
+  if( *p != '{' && *p != '[' ){
+    for( ; *p && strchr( ",}] \t\r\n", *p ) == NULL; p++ );
+    return( p );
+  }
+
+  for( ; *p; p++ ){
+    if( *p == '"' ){
+      if( ( p = json_str( p, NULL ) ) == NULL ){
+	return( NULL );
+      }
+      p--;
+    }
+    else if( *p == '{' || *p == '[' ){
+      depth++;
+    }
+    else if( ( *p == '}' || *p == ']' ) && --depth == 0 ){
+      return( p + 1 );
+    }
+  }
+
+  return( NULL );
+
+}/* of json_skip */
+
+static int json_next( const char **pp, struct cacmtext *key )
+{
+  const char *p = json_ws( *pp );
+
+  if( *p == ',' ){
+    p = json_ws( p + 1 );
+  }
+  if( *p == '}' ){
+    *pp = p + 1;
+    return( 0 );
+  }
+  if( ( p = json_str( p, key ) ) == NULL ){
+    return( -1 );
+  }
+  p = json_ws( p );
+  if( *p != ':' ){
+    return( -1 );
+  }
+  *pp = json_ws( p + 1 );
+
+  return( 1 );
+
+}/* of json_next */
+
+static int json_elem( const char **pp )
+{
+  const char *p = json_ws( *pp );
+
+  if( *p == ',' ){
+    p = json_ws( p + 1 );
+  }
+  if( *p == ']' ){
+    *pp = p + 1;
+    return( 0 );
+  }
+  if( *p == '\0' ){
+    return( -1 );
+  }
+  *pp = p;
+
+  return( 1 );
+
+}/* of json_elem */
+
+/******************************************************************************
+  cacm_now, cacm_cmpdouble
+
+cacm_now: monotonic clock in seconds; cacm_cmpdouble: qsort in
+ascending order
+******************************************************************************/
+static double cacm_now( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+
+  return( ts.tv_sec + ts.tv_nsec / 1e9 );
+
+}/* of cacm_now */
+
+static int cacm_cmpdouble( const void *a, const void *b )
+{
+  double x = *( const double *)a;
+  double y = *( const double *)b;
+
+  return( x < y ? -1 : x > y ? 1 : 0 );
+
+}/* of cacm_cmpdouble */
+
+/******************************************************************************
+  cacm_bm25
+
+  ntcir_cacm bm25 [-stop <stopword file>] [-k1 <k1>] [-b <b>] [-rows <num>]
+                  [-skip <qid,qid...>] [-run <name>] [-o <file>]
+                  cacm.all query.text
+
+retrieves the queries of query.text from cacm.all without Solr and
+writes a TREC run (as query, default run name BM25_RUNNAME), e.g.
+
+% ntcir_cacm bm25 -stop cacm/common_words cacm/cacm.all cacm/query.text
+
+The .T, .W, .K and .A sections of each record are tokenized
+(alphanumeric runs in lower case, minus the stopwords; no stemming)
+into an inverted index held in memory (bm25_index), and each query
+is scored by BM25:
+
+ score(d,q) = sum_t qtf * idf(t) * tf(t,d) * ( k1 + 1 ) /
+                  ( tf(t,d) + k1 * ( 1 - b + b * dl(d) / avgdl ) )
+ idf(t) = log( 1 + ( N - df(t) + 0.5 ) / ( df(t) + 0.5 ) )
+
+(k1 = BM25_K1 and b = BM25_B by default, and idf as in Lucene).
+The top -rows docs (default: CACM_ROWS) of each query are kept with a
+heap; ties are broken by document order. Index and query times are
+reported on stderr.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int cacm_bm25( int ac, char **av )
+{
+  int argc = 2;
+
+  long i, j;
+  long nq = 0;
+  long rows = CACM_ROWS;
+  long nhits;
+  long *qt = NULL;
+  long nqt = 0;
+  long qtsize = 0;
+
+  char *stopfile = NULL;
+  char *skip = NULL;
+  char *run = BM25_RUNNAME;
+  char *outfile = NULL;
+  char *files[ 2 ];
+  char *qid;
+  char *qdoc;
+
+  double k1 = BM25_K1;
+  double b = BM25_B;
+  double t0, t1;
+
+  FILE *fs;
+  FILE *fo;
+
+  struct bm25index x;
+  struct bm25hit *hits;
+  struct cacmquery *q = NULL;
+
+  int strhash_init();
+
+  memset( &x, 0, sizeof( struct bm25index ) );
+  files[ 0 ] = files[ 1 ] = NULL;
+
+  while( argc < ac ){
+
+    if( argc + 1 < ac && av[ argc ][ 0 ] == '-' ){
+
+      if( strcmp( av[ argc ], OPTSTR_BM25_STOP ) == 0 ){
+	stopfile = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_BM25_K1 ) == 0 ){
+	k1 = atof( av[ argc + 1 ] );
+      }
+      else if( strcmp( av[ argc ], OPTSTR_BM25_B ) == 0 ){
+	b = atof( av[ argc + 1 ] );
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_ROWS ) == 0 ){
+	rows = atol( av[ argc + 1 ] );
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_SKIP ) == 0 ){
+	skip = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_RUN ) == 0 ){
+	run = av[ argc + 1 ];
+      }
+      else if( strcmp( av[ argc ], OPTSTR_CACM_OUT ) == 0 ){
+	outfile = av[ argc + 1 ];
+      }
+      else{
+	cacm_usage( av[ 0 ] );
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( argc + 2 == ac && av[ argc ][ 0 ] != '-' ){
+      files[ 0 ] = av[ argc ];
+      files[ 1 ] = av[ argc + 1 ];
+      argc += 2;
+    }
+    else{
+      cacm_usage( av[ 0 ] );
+      return( -1 );
+    }
+  }
+
+  if( files[ 0 ] == NULL ){
+    cacm_usage( av[ 0 ] );
+    return( -1 );
+  }
+  if( rows < 1 || k1 < 0 || b < 0 || b > 1 ){
+#ifdef OUTERR
+    fprintf( stderr, "Bad %s, %s or %s value\n",
+	     OPTSTR_CACM_ROWS, OPTSTR_BM25_K1, OPTSTR_BM25_B );
+#endif
+    return( -1 );
+  }
+
+  if( strhash_init( &x.vocab, STRHASH_INITSIZE ) < 0 ||
+      strhash_init( &x.stop, STRHASH_INITSIZE ) < 0 ||
+      ( stopfile && bm25_stoplist( &x, stopfile ) < 0 ) ){
+    return( -1 );
+  }
+
+  /* index */
+  t0 = cacm_now();
+  if( ( fs = fopen( files[ 0 ], "r" ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", files[ 0 ] );
+#endif
+    return( -1 );
+  }
+  if( bm25_index( &x, fs ) < 0 ){
+    return( -1 );
+  }
+  fclose( fs );
+  t1 = cacm_now();
+
+  /* queries */
+  if( ( fs = fopen( files[ 1 ], "r" ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", files[ 1 ] );
+#endif
+    return( -1 );
+  }
+  if( cacm_readqueries( fs, skip, &q, &nq ) < 0 ){
+    return( -1 );
+  }
+  fclose( fs );
+
+  if( ( fo = cacm_open( outfile, "w" ) ) == NULL ||
+      ( x.acc = ( double *)calloc( x.ndocs + 1, sizeof( double ) ) ) == NULL ||
+      ( x.touched = ( long *)malloc( ( x.ndocs + 1 ) * sizeof( long ) ) )
+      == NULL ||
+      ( hits = ( struct bm25hit *)malloc( rows * sizeof( struct bm25hit ) ) )
+      == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+
+  for( i = 0; i < nq; i++ ){
+
+    nqt = 0;
+    if( bm25_tokens( &x, q[ i ].text, &qt, &nqt, &qtsize, 0 ) < 0 ){
+      return( -1 );
+    }
+    nhits = bm25_search( &x, qt, nqt, k1, b, hits, rows );
+
+    qid = q[ i ].qid;
+    for( j = 0; j < nhits; j++ ){
+      if( ( qdoc = cacm_pad( x.docid[ hits[ j ].doc ] ) ) == NULL ){
+	return( -1 );
+      }
+      fprintf( fo, "%s Q0 %s %ld %.6f %s\n", qid, qdoc, j + 1,
+	       hits[ j ].score, run );
+      free( qdoc );
+    }
+  }
+
+  if( outfile ){
+    fclose( fo );
+#ifdef OUTERR
+    fprintf( stderr, "created %s\n", outfile );
+#endif
+  }
+  else{
+    fflush( fo );
+  }
+
+  for( x.pbytes = i = 0; i < x.nterms; i++ ){
+    x.pbytes += x.post[ i ].len;
+  }
+  fprintf( stderr, "# bm25: %ld docs, %ld terms, %ld postings in %ld bytes, index %.3f s\n",
+	   x.ndocs, x.nterms, x.npost, x.pbytes, t1 - t0 );
+  fprintf( stderr, "# bm25: %ld queries, %.3f s\n", nq, cacm_now() - t1 );
+
+  bm25_free( &x );
+  for( i = 0; i < nq; i++ ){
+    free( q[ i ].qid );
+    free( q[ i ].text );
+  }
+  free( q );
+  free( qt );
+  free( hits );
+
+  return( 0 );
+
+}/* of cacm_bm25 */
+
+/******************************************************************************
+  bm25_stoplist
+
+reads a stopword file (one word per line, e.g. cacm/common_words)
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bm25_stoplist( struct bm25index *x, char *path )
+{
+  long len;
+
+  char line[ BUFSIZ + 1 ];
+  char *p;
+
+  FILE *f;
+
+  long strhash_add();
+
+  if( ( f = fopen( path, "r" ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", path );
+#endif
+    return( -1 );
+  }
+  while( ( len = cacm_readline( line, sizeof( line ), f ) ) >= 0 ){
+    for( p = line; *p; p++ ){
+      if( *p >= 'A' && *p <= 'Z' ){
+	*p += 'a' - 'A';
+      }
+    }
+    if( len > 0 && strhash_add( &x->stop, line, 0 ) < 0 ){
+      return( -1 );
+    }
+  }
+  fclose( f );
+
+  return( len == -2 ? -1 : 0 );
+
+}/* of bm25_stoplist */
+
+/******************************************************************************
+  bm25_index
+
+builds the inverted index from cacm.all, a record at a time:
+the term IDs of a record are sorted and counted, and (docno gap, tf)
+pairs are appended to the postings of each term as varints
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bm25_index( struct bm25index *x, FILE *fs )
+{
+  int cur = -1; /* section being read (index of cacmfields) */
+
+  long len;
+  long i, j;
+  long *dt = NULL; /* term IDs of the record */
+  long ndt = 0;
+  long dtsize = 0;
+  long dsize = 0;
+  long tf;
+  long total = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char *p;
+
+  struct bm25post *pp;
+
+  for( ; ; ){
+
+    len = cacm_readline( line, sizeof( line ), fs );
+    if( len == -2 ){
+      return( -1 );
+    }
+
+    if( len >= 0 && cacm_mark( line ) == 0 ){ /* text of a section */
+      if( cur >= 0 && cacmfields[ cur ].indexed &&
+	  bm25_tokens( x, line, &dt, &ndt, &dtsize, 1 ) < 0 ){
+	return( -1 );
+      }
+      continue;
+    }
+    if( len >= 0 && line[ 1 ] != 'I' ){ /* section marker */
+      for( cur = 0; cacmfields[ cur ].mark &&
+	     cacmfields[ cur ].mark != line[ 1 ]; cur++ );
+      if( cacmfields[ cur ].mark == 0 ){
+	cur = -1;
+      }
+      continue;
+    }
+
+    /* end of a record */
+    if( x->ndocs > 0 ){
+
+      qsort( dt, ndt, sizeof( long ), bm25_cmplong );
+      for( i = 0; i < ndt; i = j ){
+	for( j = i + 1; j < ndt && dt[ j ] == dt[ i ]; j++ );
+	tf = j - i;
+	pp = &x->post[ dt[ i ] ];
+	if( bm25_varint( pp, x->ndocs - 2 - pp->last ) < 0 ||
+	    bm25_varint( pp, tf ) < 0 ){
+	  return( -1 );
+	}
+	pp->last = x->ndocs - 1;
+	pp->df++;
+	x->npost++;
+      }
+      x->dlen[ x->ndocs - 1 ] = ndt;
+      total += ndt;
+    }
+    if( len < 0 ){ /* end of file */
+      break;
+    }
+
+    /* next record */
+    if( x->ndocs == dsize ){
+      dsize = dsize ? 2 * dsize : 1024;
+      if( ( x->docid = ( char **)realloc( x->docid, dsize * sizeof( char * ) ) )
+	  == NULL ||
+	  ( x->dlen = ( long *)realloc( x->dlen, dsize * sizeof( long ) ) )
+	  == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "realloc failed\n" );
+#endif
+	return( -1 );
+      }
+    }
+    for( p = line + 2; *p == ' '; p++ );
+    if( ( x->docid[ x->ndocs++ ] = strdup( p ) ) == NULL ){
+      return( -1 );
+    }
+    ndt = 0;
+    cur = -1;
+  }
+
+  x->avgdl = x->ndocs > 0 ? ( double )total / x->ndocs : 0;
+  free( dt );
+
+  return( 0 );
+
+}/* of bm25_index */
+
+/******************************************************************************
+  bm25_tokens
+
+appends the term IDs of the words of text to *ids:
+alphanumeric runs in lower case that are not stopwords.
+When indexing (add), new terms are added to the vocabulary;
+otherwise unknown terms are left out.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bm25_tokens( struct bm25index *x, char *text, long **ids,
+			long *n, long *size, int add )
+{
+  long id;
+
+  char word[ BUFSIZ + 1 ];
+  char *p;
+
+  size_t len;
+
+  long strhash_get();
+  long strhash_add();
+
+  for( p = text; *p; ){
+
+    for( len = 0;
+	 ( *p >= 'a' && *p <= 'z' ) || ( *p >= 'A' && *p <= 'Z' ) ||
+	   ( *p >= '0' && *p <= '9' );
+	 p++ ){
+      word[ len++ ] = ( *p >= 'A' && *p <= 'Z' ) ? *p - 'A' + 'a' : *p;
+    }
+    if( len == 0 ){
+      p++;
+      continue;
+    }
+    word[ len ] = '\0';
+    if( strhash_get( &x->stop, word ) >= 0 ){
+      continue;
+    }
+
+    if( !add ){
+      if( ( id = strhash_get( &x->vocab, word ) ) < 0 ){
+	continue;
+      }
+    }
+    else{
+      if( ( id = strhash_add( &x->vocab, word, x->nterms ) ) < 0 ){
+	return( -1 );
+      }
+      if( id == x->nterms ){ /* a new term */
+	if( x->nterms == x->tsize ){
+	  x->tsize = x->tsize ? 2 * x->tsize : 4096;
+	  if( ( x->post = ( struct bm25post *)realloc( x->post, x->tsize *
+						       sizeof( struct bm25post ) ) )
+	      == NULL ){
+#ifdef OUTERR
+	    fprintf( stderr, "realloc failed\n" );
+#endif
+	    return( -1 );
+	  }
+	}
+	memset( &x->post[ x->nterms ], 0, sizeof( struct bm25post ) );
+	x->post[ x->nterms ].last = -1;
+	x->nterms++;
+      }
+    }
+
+    if( *n == *size ){
+      *size = *size ? 2 * *size : 256;
+      if( ( *ids = ( long *)realloc( *ids, *size * sizeof( long ) ) ) == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "realloc failed\n" );
+#endif
+	return( -1 );
+      }
+    }
+    ( *ids )[ ( *n )++ ] = id;
+  }
+
+  return( 0 );
+
+}/* of bm25_tokens */
+
+/******************************************************************************
+  bm25_varint
+
+appends v (>= 0) to the postings of a term, 7 bits per byte
+(the high bit is set on all but the last byte)
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int bm25_varint( struct bm25post *pp, long v )
+{
+  if( pp->len + 10 > pp->size ){
+    pp->size = pp->size ? 2 * pp->size : 16;
+    if( ( pp->buf = ( unsigned char *)realloc( pp->buf, pp->size ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "realloc failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+  while( v >= 0x80 ){
+    pp->buf[ pp->len++ ] = ( unsigned char )( v | 0x80 );
+    v >>= 7;
+  }
+  pp->buf[ pp->len++ ] = ( unsigned char )v;
+
+  return( 0 );
+
+}/* of bm25_varint */
+
+/******************************************************************************
+  bm25_search
+
+scores the docs containing the query terms qt (term IDs; repeated
+terms count qtf times) and keeps the best rows in a min-heap
+
+return value: number of hits, best first
+******************************************************************************/
+static long bm25_search( struct bm25index *x, long *qt, long nqt,
+			 double k1, double b, struct bm25hit *hits, long rows )
+{
+  long i, j;
+  long ntouched = 0;
+  long nhits = 0;
+  long doc;
+  long tf;
+  long v;
+  long qtf;
+
+  int shift;
+
+  double idf;
+  double norm;
+
+  size_t pos;
+
+  struct bm25post *pp;
+  struct bm25hit h;
+
+  qsort( qt, nqt, sizeof( long ), bm25_cmplong );
+
+  for( i = 0; i < nqt; i = j ){
+
+    for( j = i + 1; j < nqt && qt[ j ] == qt[ i ]; j++ );
+    qtf = j - i;
+    pp = &x->post[ qt[ i ] ];
+    idf = log( 1 + ( x->ndocs - pp->df + 0.5 ) / ( pp->df + 0.5 ) );
+
+    for( doc = -1, pos = 0; pos < pp->len; ){
+
+      for( v = 0, shift = 0; pp->buf[ pos ] & 0x80; shift += 7 ){
+	v |= ( long )( pp->buf[ pos++ ] & 0x7f ) << shift;
+      }
+      v |= ( long )pp->buf[ pos++ ] << shift;
+      doc += v + 1;
+      for( tf = 0, shift = 0; pp->buf[ pos ] & 0x80; shift += 7 ){
+	tf |= ( long )( pp->buf[ pos++ ] & 0x7f ) << shift;
+      }
+      tf |= ( long )pp->buf[ pos++ ] << shift;
+
+      if( x->acc[ doc ] == 0 ){
+	x->touched[ ntouched++ ] = doc;
+      }
+      norm = k1 * ( 1 - b + b * x->dlen[ doc ] / x->avgdl );
+      x->acc[ doc ] += qtf * idf * tf * ( k1 + 1 ) / ( tf + norm );
+    }
+  }
+
+  /* top rows: hits[ 0 ] is the worst hit kept */
+  for( i = 0; i < ntouched; i++ ){
+
+    h.doc = x->touched[ i ];
+    h.score = x->acc[ h.doc ];
+    x->acc[ h.doc ] = 0;
+
+    if( nhits < rows ){
+      hits[ nhits++ ] = h;
+      bm25_siftup( hits, nhits - 1 );
+    }
+    else if( bm25_worse( &hits[ 0 ], &h ) ){
+      hits[ 0 ] = h;
+      bm25_siftdown( hits, nhits, 0 );
+    }
+  }
+
+  /* best first */
+  for( i = nhits - 1; i > 0; i-- ){
+    h = hits[ 0 ];
+    hits[ 0 ] = hits[ i ];
+    hits[ i ] = h;
+    bm25_siftdown( hits, i, 0 );
+  }
+
+  return( nhits );
+
+}/* of bm25_search */
+
+/******************************************************************************
+  bm25_worse, bm25_siftup, bm25_siftdown
+
+the min-heap of bm25_search: a hit is worse than another if it has
+a lower score, or the same score and a later doc
+******************************************************************************/
+static int bm25_worse( struct bm25hit *a, struct bm25hit *b )
+{
+  return( a->score < b->score || ( a->score == b->score && a->doc > b->doc ) );
+
+}/* of bm25_worse */
+
+static void bm25_siftup( struct bm25hit *hits, long i )
+{
+  long parent;
+
+  struct bm25hit h;
+
+  for( ; i > 0; i = parent ){
+    parent = ( i - 1 ) / 2;
+    if( !bm25_worse( &hits[ i ], &hits[ parent ] ) ){
+      break;
+    }
+    h = hits[ i ];
+    hits[ i ] = hits[ parent ];
+    hits[ parent ] = h;
+  }
+
+}/* of bm25_siftup */
+
+static void bm25_siftdown( struct bm25hit *hits, long n, long i )
+{
+  long c;
+
+  struct bm25hit h;
+
+  for( ; ( c = 2 * i + 1 ) < n; i = c ){
+    if( c + 1 < n && bm25_worse( &hits[ c + 1 ], &hits[ c ] ) ){
+      c++;
+    }
+    if( !bm25_worse( &hits[ c ], &hits[ i ] ) ){
+      break;
+    }
+    h = hits[ i ];
+    hits[ i ] = hits[ c ];
+    hits[ c ] = h;
+  }
+
+}/* of bm25_siftdown */
+
+/******************************************************************************
+  bm25_cmplong, bm25_free
+******************************************************************************/
+static int bm25_cmplong( const void *a, const void *b )
+{
+  long x = *( const long *)a;
+  long y = *( const long *)b;
+
+  return( x < y ? -1 : x > y ? 1 : 0 );
+
+}/* of bm25_cmplong */
+
+static void bm25_free( struct bm25index *x )
+{
+  long i;
+
+  int strhash_free();
+
+  for( i = 0; i < x->nterms; i++ ){
+    free( x->post[ i ].buf );
+  }
+  for( i = 0; i < x->ndocs; i++ ){
+    free( x->docid[ i ] );
+  }
+  free( x->post );
+  free( x->docid );
+  free( x->dlen );
+  free( x->acc );
+  free( x->touched );
+  strhash_free( &x->vocab );
+  strhash_free( &x->stop );
+
+}/* of bm25_free */
+
+/******************************************************************************
+  cacm_open
+
+opens an output file (stdout if path is NULL) with a large buffer
+
+return value: file pointer (OK)
+              NULL (ERROR)
+******************************************************************************/
+static FILE *cacm_open( char *path, char *mode )
+{
+  FILE *fo = stdout;
+
+  if( path && ( fo = fopen( path, mode ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", path );
+#endif
+    return( NULL );
+  }
+  setvbuf( fo, NULL, _IOFBF, CACM_BUFSIZ );
+
+  return( fo );
+
+}/* of cacm_open */
+
+/******************************************************************************
+  cacm_usage
+
+return value: 1
+******************************************************************************/
+static int cacm_usage( char *prog )
+{
+#ifdef OUTERR
+  fprintf( stderr, "Usage: %s docs [%s] [%s <num>] [%s <file>] [cacm.all]\n",
+	   prog, OPTSTR_CACM_JSON, OPTSTR_CACM_MAX, OPTSTR_CACM_OUT );
+  fprintf( stderr, "       %s query [%s <url>] [%s <num>] [%s <num>] [%s <params>]\n"
+	   "             [%s <qid,qid...>] [%s <name>] [%s <sec>] [%s <file>] [query.text]\n",
+	   prog, OPTSTR_CACM_URL, OPTSTR_CACM_THREADS, OPTSTR_CACM_ROWS,
+	   OPTSTR_CACM_PARAMS, OPTSTR_CACM_SKIP, OPTSTR_CACM_RUN,
+	   OPTSTR_CACM_TIMEOUT, OPTSTR_CACM_OUT );
+  fprintf( stderr, "       %s bm25 [%s <stopword file>] [%s <k1>] [%s <b>] [%s <num>]\n"
+	   "             [%s <qid,qid...>] [%s <name>] [%s <file>] cacm.all query.text\n",
+	   prog, OPTSTR_BM25_STOP, OPTSTR_BM25_K1, OPTSTR_BM25_B,
+	   OPTSTR_CACM_ROWS, OPTSTR_CACM_SKIP, OPTSTR_CACM_RUN, OPTSTR_CACM_OUT );
+  fprintf( stderr, "   *docs* writes the records of cacm.all as a Solr update file\n"
+	   "    (XML, or JSON lines with %s).\n", OPTSTR_CACM_JSON );
+  fprintf( stderr, "   *query* runs the queries against a Solr select handler\n"
+	   "    (default: %s) and writes a TREC run.\n", CACM_URL );
+  fprintf( stderr, "   *bm25* indexes cacm.all and writes a BM25 run of the queries.\n" );
+#endif
+
+  return( 1 );
+
+}/* of cacm_usage */
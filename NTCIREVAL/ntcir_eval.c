@@ -5,25 +5,69 @@
                                                       April 2011 Tetsuya Sakai
                                               updated June 2019
 ******************************************************************************/
+#define _GNU_SOURCE /* fopencookie */
 #include "ntcir_eval.h"
+#ifdef NEVZLIB
+#include <zlib.h>
+#endif
 
-static int ignore_unjudged; /* flag for ignoring unjudged docs */
-static int ec_mode; /* equivalence class based evaluation */
-static char *outstr = NULL; /* used as output prefix for (g)compute/irec.
-			       This can be a topicID, for example. */
-static char *sep = NULL; /* separator for input and output files */
+static int eval_dinlabel( struct nev_ctx *, int, char** );
+static int eval_glabel( struct nev_ctx *, int, char** );
+static int eval_gcompute( struct nev_ctx *, int, char** );
+static int eval_irec( struct nev_ctx *, int, char** );
+static int eval_label( struct nev_ctx *, int, char** );
+static int eval_compute( struct nev_ctx *, int, char** );
+static int eval_1click( struct nev_ctx *, int, char** );
+static int eval_splitqrels( struct nev_ctx *, int, char** );
+static int eval_splitruns( struct nev_ctx *, int, char** );
+static int eval_convqrels( struct nev_ctx *, int, char** );
+static int eval_sortrun( struct nev_ctx *, int, char** );
+static int eval_stream( struct nev_ctx *, int, char** );
+static int gcompute_run( struct nev_ctx *, struct idealcache *, FILE *,
+			 int, int, long *, long,
+			 double, double, double, double );
+static int stream_topic( struct nev_ctx *, struct splittopic *,
+			 char *, size_t, int, char ** );
+static int oneclick_topic( struct nev_ctx *, struct nugtab *,
+			   struct matchlist *, char *,
+			   long *, long, double *, long, int );
+static int oneclick_batch( struct nev_ctx *, char *, char **, long, long *,
+			   long, double *, long, int );
+
+/* gzip input: compiled out unless built with -DNEVZLIB */
+#ifdef NEVZLIB
+static void *gzin_thread( void * );
+static ssize_t gzin_read( void *, char *, size_t );
+static int gzin_close( void * );
+static void gzin_free( struct gzin * );
+#endif
 
-static int eval_dinlabel( int, char** );
-static int eval_glabel( int, char** );
-static int eval_gcompute( int, char** );
-static int eval_irec( int, char** );
-static int eval_label( int, char** );
-static int eval_compute( int, char** );
-static int eval_1click( int, char** );
+/* -stats instrumentation: compiled out unless built with -DNEVSTATS */
+#ifdef NEVSTATS
+#include <time.h>
+static int stats_phase( struct nev_ctx *, int );
+static int stats_report( struct nev_ctx *, const char * );
+#define STATS_PHASE( ctx, ph ) \
+  ( ( ctx )->stats.on ? stats_phase( ( ctx ), ( ph ) ) : 0 )
+#define STATS_LINE( ctx, line ) \
+  ( ( ctx )->stats.on ? \
+    ( ( ctx )->stats.lines++, \
+      ( ctx )->stats.bytes += ( long )strlen( line ) ) : 0 )
+#define STATS_LOOKUP( ctx ) ( ( ctx )->stats.lookups++ )
+#define STATS_ARRAYS( ctx, num, len ) \
+  ( ( ctx )->stats.allocs += ( num ), \
+    ( ( ctx )->stats.peakarray < ( len ) ? \
+      ( ctx )->stats.peakarray = ( len ) : 0 ) )
+#else
+#define STATS_PHASE( ctx, ph ) ( ( void )0 )
+#define STATS_LINE( ctx, line ) ( ( void )0 )
+#define STATS_LOOKUP( ctx ) ( ( void )0 )
+#define STATS_ARRAYS( ctx, num, len ) ( ( void )0 )
+#endif
 
 static struct {
   char *cmd;
-  int (*func)();
+  int (*func)( struct nev_ctx *, int, char** );
 } table[] = {
   { "dinlabel", eval_dinlabel },
   { "glabel", eval_glabel },
@@ -32,281 +76,694 @@ static struct {
   { "label", eval_label },
   { "compute", eval_compute },
   { "1click", eval_1click },
-  {(char *) 0, (int (*)()) 0}
+  { "splitqrels", eval_splitqrels },
+  { "splitruns", eval_splitruns },
+  { "convqrels", eval_convqrels },
+  { "sortrun", eval_sortrun },
+  { "stream", eval_stream },
+  {(char *) 0, 0}
 };
 
-int main( int ac, char **av )
+/******************************************************************************
+  nev_init
+
+initialises an evaluation context:
+system output is read from stdin and text output goes to stdout.
+
+return value: 0 (OK)
+******************************************************************************/
+int nev_init( struct nev_ctx *ctx )
+{
+  memset( ctx, 0, sizeof( struct nev_ctx ) );
+  ctx->in = stdin;
+  ctx->out = stdout;
+
+  return( 0 );
+
+}/* of nev_init */
+
+/******************************************************************************
+  nev_run
+
+runs a subcommand with command line arguments
+av[ 0 ] (program name), av[ 1 ] (command), av[ 2 ]...
+Results from the previous run are cleared;
+ctx->in, ctx->out and the gcompute ideal list cache are kept.
+
+return value: return value of the subcommand (0: OK)
+             -1 (ERROR/unknown command)
+******************************************************************************/
+int nev_run( struct nev_ctx *ctx, int ac, char **av )
 {
   int i;
-    
+  int retv;
+  int sac;
+
+  char **sav = NULL;
+
+  int arena_reset();
+
+  nev_clear( ctx );
+  memset( &ctx->stats, 0, sizeof( struct nev_stats ) );
+  ctx->arena.allocs = 0;
+
   if( ac < 2 ){
+    return( -1 );
+  }
 
-#ifdef OUTERR      
-    fprintf(stderr, "Usage: %s command args...\n", av[0]);
-    fprintf(stderr, " command= glabel|dinlabel|gcompute|irec|label|compute|1click\n\n" );
-    fprintf(stderr, "   *glabel* reads an ideal ranked list with gain values\n" );
-    fprintf(stderr, "    and a system ranked list WITHOUT gain values;\n" );
-    fprintf(stderr, "    outputs a system ranked list WITH gain values.\n\n" );
-    fprintf(stderr, "   *dinlabel* reads a din (diversify for inf and nav) file\n" );
-    fprintf(stderr, "    and a system ranked list WITHOUT gain values;\n" );
-    fprintf(stderr, "    outputs a system ranked list WITH gain values.\n" );
-    fprintf(stderr, "    dup docs for nav intents are ignored.\n\n" );
-    fprintf(stderr, "   *gcompute* reads an ideal ranked list with gain values\n" );
-    fprintf(stderr, "    and a system ranked list WITH gain values;\n" );
-    fprintf(stderr, "    outputs evaluation metric values.\n\n" );
-    fprintf(stderr, "   *irec reads one or more reldoclist (possibly with other info)\n" );
-    fprintf(stderr, "    for each intent, and a system ranked list;\n" );
-    fprintf(stderr, "    outputs I-recall.\n\n" );
-    fprintf(stderr, "   *label* reads a list of judged docs with rel levels\n" );
-    fprintf(stderr, "    and a system ranked list;\n" );
-    fprintf(stderr, "    outputs a system ranked list WITH rel levels.\n\n" );
-    fprintf(stderr, "   *compute* reads a list of judged docs with rel levels\n" );
-    fprintf(stderr, "    and a system ranked list WITH rel levels;\n" );
-    fprintf(stderr, "    outputs evaluation metric values.\n\n" );
-    fprintf(stderr, "   *1click* reads a gold-standard nugget file and a\n" );
-    fprintf(stderr, "    matched nugget file and outputs evaluation metric values\n\n" );
+  /* -stats, -statsfile and -topic apply to every subcommand:
+     remove them before the subcommand parses its options */
+  for( i = 2; i < ac; i++ ){
+    if( strcmp( av[ i ], OPTSTR_STATS ) == 0 ||
+	strcmp( av[ i ], OPTSTR_STATSFILE ) == 0 ||
+	strcmp( av[ i ], OPTSTR_TOPIC ) == 0 ){
+      break;
+    }
+  }
+  if( i < ac ){
+
+    if( ( sav = ( char **)malloc( ( ac + 1 ) * sizeof( char * ) ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "malloc failed\n" );
+#endif
+      return( -1 );
+    }
+    for( sac = i = 0; i < ac; i++ ){
+      if( i >= 2 && strcmp( av[ i ], OPTSTR_STATS ) == 0 ){
+	ctx->stats.on = 1;
+      }
+      else if( i >= 2 && strcmp( av[ i ], OPTSTR_STATSFILE ) == 0 &&
+	       i + 1 < ac ){
+	ctx->stats.on = 1;
+	ctx->stats.file = av[ ++i ];
+      }
+      else if( i >= 2 && strcmp( av[ i ], OPTSTR_TOPIC ) == 0 &&
+	       i + 1 < ac ){
+	ctx->topic = av[ ++i ];
+      }
+      else{
+	sav[ sac++ ] = av[ i ];
+      }
+    }
+    sav[ sac ] = NULL;
+    ac = sac;
+    av = sav;
+
+#ifndef NEVSTATS
+#ifdef OUTERR
+    if( ctx->stats.on ){
+      fprintf( stderr, "%s ignored: rebuild with -DNEVSTATS\n", OPTSTR_STATS );
+    }
+#endif
+    ctx->stats.on = 0;
 #endif
-	
-    exit(1);
   }
 
   for( i = 0; table[i].cmd; i++ )
     if( strcmp( table[i].cmd, av[1] ) == 0 ){
-      table[i].func(ac, av);
-      exit( 0 );
+
+#ifdef NEVSTATS
+      if( ctx->stats.on ){
+	ctx->stats.phase = STATS_OTHER;
+	stats_phase( ctx, STATS_OTHER ); /* start the clock */
+	memset( ctx->stats.sec, 0, sizeof( ctx->stats.sec ) );
+      }
+#endif
+
+      retv = table[i].func( ctx, ac, av );
+
+#ifdef NEVSTATS
+      if( ctx->stats.on ){
+	stats_phase( ctx, STATS_OTHER );
+	ctx->stats.allocs += ctx->arena.allocs;
+	stats_report( ctx, av[ 1 ] );
+      }
+#endif
+
+      /* options and lists are per run */
+      arena_reset( &ctx->arena );
+      free( ctx->sep );
+      free( ctx->outstr );
+      ctx->sep = ctx->outstr = NULL;
+      ctx->ignore_unjudged = ctx->ec_mode = 0;
+      ctx->stats.on = 0;
+      ctx->stats.file = NULL;
+      ctx->topic = NULL;
+      if( ctx->out ){
+	nev_flush( ctx );
+	fflush( ctx->out );
+      }
+      free( sav );
+
+      return( retv );
     }
 
 #ifdef OUTERR
   fprintf( stderr, "Unknown command.\n");
 #endif
+  free( sav );
 
-  return( 0 );
+  return( -1 );
 
-}/* of main */
+}/* of nev_run */
 
 /******************************************************************************
-  eval_dinlabel
+  nev_clear
 
-similar to glabel but is for computing 
-DIN (diversification for informational and navigational intents) metrics.
-Thus, redundant docs for navigational intents are not labelled.
+forgets the results of the last run (the res array itself is reused)
 
-Instead of a global ideal list,
-reads a din file, which is of the form:
-<intnum> <inf/nav> <docID> <P(i|q)*gi>
+return value: 0 (OK)
+******************************************************************************/
+int nev_clear( struct nev_ctx *ctx )
+{
+  int arena_reset();
 
-Also reads a systemfile and labels it.
+  arena_reset( &ctx->resarena );
+  memset( ctx->names, 0, sizeof( ctx->names ) );
+  ctx->resnum = 0;
 
-systemfile format:
-<docID>
-<docID>
-  :
+  return( 0 );
 
-output format (default: judged and unjudged docs):
-<docID> <gv>
-<docID> 0
-<docID> <gv>
-  :
+}/* of nev_clear */
 
-where gv = SUM P(i|q)*gi + SUM isnew(j)P(j|q)*gj
-            i               j
+/******************************************************************************
+  nev_free
 
-i: informational
-j: nagivational
-isnew(j): flag indicating whether the nav intent is new or not
+frees everything held by a context (but does not close ctx->in/out)
 
-    -j option will remove documents not listed in ideal file.
-  
 return value: 0 (OK)
-             -1 (NG)
 ******************************************************************************/
-static int eval_dinlabel( int ac, char **av )
+int nev_free( struct nev_ctx *ctx )
 {
-  FILE *fa = NULL;
-  FILE *fs = stdin;
+  struct idealcache *ic;
+
+  int free_idealcache();
+  int arena_free();
+  int genseen_free();
+
+  nev_flush( ctx );
+  free( ctx->outbuf );
+  ctx->outbuf = NULL;
+  nev_clear( ctx );
+  free( ctx->res );
+  ctx->res = NULL;
+  ctx->ressize = 0;
+  arena_free( &ctx->resarena );
+  arena_free( &ctx->arena );
+  free( ctx->sep );
+  free( ctx->outstr );
+  ctx->sep = ctx->outstr = NULL;
+  while( ( ic = ctx->icache ) != NULL ){
+    ctx->icache = ic->next;
+    free_idealcache( ic );
+  }
+  genseen_free( &ctx->ecseen );
 
-  int argc = 2;
-  int isjudged;
-  int found[ INTENT_NUMMAX ]; /* is intent already seen? */
-
-  long truncaterank = 0;
-  /* by default, do not truncate */
-  long i;
-  long highintnum; /* highest intent number */
+  return( 0 );
 
-  double ggain; /* global gain of doc */
+}/* of nev_free */
 
-  char line[ BUFSIZ + 1 ];
-  char *pos;
+/******************************************************************************
+  nev_flush
 
-  struct strdoublong2list *din = NULL;
-  struct strdoublong2list *p;
+writes the buffered text output to ctx->out
 
-  int freestrdoublong2list();
-  long store_din();
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int nev_flush( struct nev_ctx *ctx )
+{
+  size_t len;
 
-  ignore_unjudged = 0;
-  /* by default, output all docs in system list (=judged + unjudged) */
+  len = ctx->outlen;
+  ctx->outlen = 0;
+  if( len == 0 || ctx->out == NULL ){
+    return( 0 );
+  }
+  if( fwrite( ctx->outbuf, 1, len, ctx->out ) != len ){
+    return( -1 );
+  }
 
-  while( argc < ac ){
+  return( 0 );
 
-    if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
-      ignore_unjudged = 1;
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
-      truncaterank = atol( av[ argc + 1 ] );
-      if( truncaterank < 1 ){
+}/* of nev_flush */
 
-#ifdef OUTERR
-        fprintf( stderr, "Bad %s value\n", OPTSTR_TRUNCATE );
-#endif
-        return( -1 );
-      }
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_DINFILE ) == 0 &&
-	     ( argc + 1 < ac ) ){
-      if( ( fa = fopen( av[ argc + 1 ], "r" ) ) == NULL ){
+/******************************************************************************
+  outbuf_room
 
-#ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
-#endif
-	return( -1 );
-      }
-      argc += 2;
-    }
-      /* ranked list file */
-    else{
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
+makes room for n bytes in the output buffer of ctx
+(allocated on first use)
 
-#ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
-#endif
-	return( -1 );
-      }
-      argc++;
+return value: pointer to the free part of the buffer (OK)
+              NULL (n bytes do not fit even into an empty buffer,
+	            or no buffer: write to ctx->out directly)
+******************************************************************************/
+static char *outbuf_room( struct nev_ctx *ctx, size_t n )
+{
+  if( ctx->outbuf == NULL &&
+      ( ctx->outbuf = ( char *)malloc( OUT_BUFSIZ ) ) == NULL ){
+    return( NULL );
+  }
+  if( ctx->outlen + n > OUT_BUFSIZ ){
+    nev_flush( ctx );
+    if( n > OUT_BUFSIZ ){
+      return( NULL );
     }
   }
 
-  if( fa == NULL ){
+  return( ctx->outbuf + ctx->outlen );
 
-#ifdef OUTERR      
-    fprintf( stderr,
-	     "Usage: %s %s [%s] [%s <separator>] [%s <rank>] %s <din_file> [system ranked list]\n",
-	     av[ 0 ], av[ 1 ],
-	     OPTSTR_IGNORE_UNJUDGED,
-	     OPTSTR_SEP, OPTSTR_TRUNCATE, OPTSTR_DINFILE );
+}/* of outbuf_room */
+
+/******************************************************************************
+  nev_printf
+
+printf to ctx->out (if any), through the output buffer
+
+return value: number of characters printed (OK)
+              0 (no text output)
+             <0 (ERROR)
+******************************************************************************/
+int nev_printf( struct nev_ctx *ctx, const char *fmt, ... )
+{
+  int retv;
+  size_t room;
+  char *p;
+#ifdef NEVSTATS
+  int phase = STATS_OTHER;
 #endif
+
+  va_list ap;
+
+  if( ctx->out == NULL ){
     return( 0 );
   }
 
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
+#ifdef NEVSTATS
+  if( ctx->stats.on ){
+    phase = stats_phase( ctx, STATS_PRINT );
   }
+#endif
 
-  /* store din file */
-  if( ( highintnum = store_din( fa, &din ) ) == 0 ){
+  /* usually a short line: try to format it into the buffer as it is */
+  p = outbuf_room( ctx, 0 );
+  room = p ? OUT_BUFSIZ - ctx->outlen : 0;
+  va_start( ap, fmt );
+  retv = p ? vsnprintf( p, room, fmt, ap ) : -1;
+  va_end( ap );
 
-#ifdef OUTERR
-    fprintf( stderr, "store_din failed\n" );
+  if( retv >= 0 && ( size_t )retv < room ){
+    ctx->outlen += retv;
+  }
+  else if( retv >= 0 && ( p = outbuf_room( ctx, retv + 1 ) ) != NULL ){
+    /* did not fit: retry after flushing */
+    va_start( ap, fmt );
+    retv = vsnprintf( p, retv + 1, fmt, ap );
+    va_end( ap );
+    ctx->outlen += retv;
+  }
+  else{ /* longer than the buffer */
+    nev_flush( ctx );
+    va_start( ap, fmt );
+    retv = vfprintf( ctx->out, fmt, ap );
+    va_end( ap );
+  }
+
+#ifdef NEVSTATS
+  if( ctx->stats.on ){
+    stats_phase( ctx, phase );
+  }
 #endif
+
+  return( retv );
+
+}/* of nev_printf */
+
+/******************************************************************************
+  fmtfixed
+
+writes value with prec digits after the point, exactly as
+sprintf( buf, "%.*f", prec, value ) does, without going through stdio.
+Values that are too large, not finite, or too close to a rounding tie
+for double arithmetic to decide are left to sprintf.
+
+return value: length of the string (OK)
+             -1 (use sprintf)
+******************************************************************************/
+static int fmtfixed( char *buf, double value, int prec )
+{
+  static const double p10[] = {
+    1.0, 10.0, 100.0, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+  };
+  char digits[ 32 ];
+  char *p;
+  int i;
+  int n;
+  double a;
+  double x;
+  double frac;
+  unsigned long u;
+
+  if( prec < 0 || prec > 9 ){
     return( -1 );
   }
-  fclose( fa );
-
-  for( i = 0; i < highintnum; i++ ){
-    found[ i ] = 0; /* intent 1 is stored in found[ 0 ] */
+  a = fabs( value );
+  if( !( a < 2147483648.0 / p10[ prec ] ) ){ /* also NaN */
+    return( -1 );
   }
 
-  /* output system ranked list with gain values */    
+  /* x < 2^31, so x is within 2^-22 of a * 10^prec */
+  x = a * p10[ prec ];
+  frac = x - floor( x );
+  if( fabs( frac - 0.5 ) < 1e-6 ){
+    return( -1 );
+  }
+  u = ( unsigned long )floor( x ) + ( frac > 0.5 );
 
-  i = 1; /* rank */
-  while( fgets( line, sizeof( line ), fs ) ){
+  n = 0;
+  do{
+    digits[ n++ ] = '0' + u % 10;
+    u /= 10;
+  }while( n <= prec || u > 0 );
 
-    if( ( pos = strchr( line, '\n' ) ) == NULL ){
-#ifdef OUTERR   
-      fprintf( stderr, "Line too long: %s\n", line );
-#endif  
-      return( -1 );
+  p = buf;
+  if( signbit( value ) ){ /* as printf: -0.0000 for small negatives */
+    *p++ = '-';
+  }
+  for( i = n - 1; i >= 0; i-- ){
+    *p++ = digits[ i ];
+    if( i == prec && prec > 0 ){
+      *p++ = '.';
     }
-    *pos = '\0';
+  }
+  *p = '\0';
 
-    isjudged = 0; /* is this a judged doc (i.e. one in ideal list?) */
-    ggain = 0.0;
-    p = din;
-    while( p ){
+  return( p - buf );
 
-      if( strcmp( p->string, line ) == 0 ){
+}/* of fmtfixed */
 
-	isjudged = 1;
-	if( p->val3 == NAVIGATIONAL ){
+/******************************************************************************
+  metricname
 
-	  if( found[ p->val2 - 1 ] ){
-	    /* nav intent already seen -> do not add to ggain */
-	  }
-	  else{ /* nav intent seen for the 1st time */
-	    ggain += p->val1;
-	  }
-	}
-	else{ /* INFORMATIONAL: store_din guarantees it */
+returns the rendering of a metric name for nev_metric,
+cached in ctx->names until the next nev_clear.
+Only literal names and names with a single %04ld (e.g. cutoffs)
+are cached; *arg receives the argument of the latter.
 
-	  ggain += p->val1; /* add to ggain unconditionally */
-	}
-	found[ p->val2 - 1 ] = 1; /* this intent has already been covered */
+return value: cached name (OK)
+              NULL (not cacheable, or ERROR: render it every time)
+******************************************************************************/
+static struct nev_name *metricname( struct nev_ctx *ctx,
+				    const char *namefmt, long arg )
+{
+  char buf[ BUFSIZ + 1 ];
+  char *p;
+  unsigned long h;
 
-      }
-      p = p->next;
-    }
+  struct nev_name *nm;
 
-    if( isjudged ){
+  void *arena_alloc();
+  char *arena_strdup();
 
-      printf( "%s%s%.4f\n", line, sep, ggain );
+  h = ( ( unsigned long )namefmt / sizeof( void *) + ( unsigned long )arg ) %
+    NAMECACHE_SIZE;
+  for( nm = ctx->names[ h ]; nm; nm = nm->next ){
+    if( nm->fmtp == namefmt && nm->arg == arg &&
+	strcmp( nm->fmt, namefmt ) == 0 ){
+      return( nm );
     }
-    else{ /* unjudged doc */
+  }
 
-      if( ignore_unjudged ){
-	/* do not print unjudged document */
-      }
-      else{
-	/* print this unjuded document WITHOUT a gain value */
-	printf( "%s\n", line );
-      }
+  snprintf( buf, sizeof( buf ), namefmt, arg );
 
-    }
+  if( ( nm = ( struct nev_name *)
+	arena_alloc( &ctx->resarena, sizeof( struct nev_name ) ) ) == NULL ||
+      ( nm->fmt = arena_strdup( &ctx->resarena, namefmt ) ) == NULL ||
+      ( nm->text = arena_strdup( &ctx->resarena, buf ) ) == NULL ){
+    return( NULL );
+  }
+  nm->fmtp = namefmt;
+  nm->arg = arg;
+  nm->textlen = strlen( buf );
 
-    if( i == truncaterank ){ /* if truncaterank is positive,
-                                truncate system output at this rank */
-      break;
-    }
-    i++;
+  /* "nDCG@0010=           " -> "nDCG@0010" */
+  p = buf + nm->textlen;
+  while( p > buf && ( p[ -1 ] == ' ' || p[ -1 ] == '=' ) ){
+    p--;
+  }
+  *p = '\0';
+  if( ( nm->key = arena_strdup( &ctx->resarena, buf ) ) == NULL ){
+    return( NULL );
   }
-  fclose( fs );
 
-  free( sep );
-  freestrdoublong2list( &din );
-  return( 0 );
+  nm->next = ctx->names[ h ];
+  ctx->names[ h ] = nm;
 
-}/* of eval_dinlabel */
+  return( nm );
 
+}/* of metricname */
 
 /******************************************************************************
-  eval_glabel
+  nev_metric
 
-reads an ideal ranked list with decreasing gain values
-      (possibly with judged nonrel docs at bottom)
-      and a system ranked list WITHOUT gain values;
-outputs a system ranked list WITH gain values.
+outputs a metric line
+<prefix> <name><value>
+e.g. nev_metric( ctx, "0001", 0.51234, 4, "nDCG@%04ld=           ", 10 )
+prints "0001 nDCG@0010=           0.5123"
+and adds ( "0001", "nDCG@0010", 0.51234 ) to ctx->res.
 
-ideal ranked list file format:
-<docID> <gv>
-<docID> <gv>
-  :
-[Sorted by gv.]
+Names are rendered once per run (see metricname) and the line is
+assembled in the output buffer; the strings in ctx->res live in
+ctx->resarena, and consecutive results share their prefix.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int nev_metric( struct nev_ctx *ctx, const char *prefix, double value,
+		int prec, const char *namefmt, ... )
+{
+  char name[ BUFSIZ + 1 ];
+  char num[ 512 ];
+  char *text;
+  char *key;
+  char *p;
+  const char *q;
+  long arg = 0;
+  int numlen;
+  size_t textlen;
+  size_t plen;
+
+  struct nev_name *nm = NULL;
+  struct nev_result *newres;
+  struct nev_result *r;
+
+  va_list ap;
+
+  char *arena_strdup();
+
+#ifdef NEVSTATS
+  int phase = STATS_OTHER;
+
+  if( ctx->stats.on ){
+    phase = stats_phase( ctx, STATS_PRINT );
+  }
+#endif
+
+  /* literal names and names with one %04ld are cached */
+  if( ( q = strchr( namefmt, '%' ) ) == NULL ||
+      ( strncmp( q, "%04ld", 5 ) == 0 && strchr( q + 5, '%' ) == NULL ) ){
+    if( q ){
+      va_start( ap, namefmt );
+      arg = va_arg( ap, long );
+      va_end( ap );
+    }
+    nm = metricname( ctx, namefmt, arg );
+  }
+  if( nm ){
+    text = nm->text;
+    textlen = nm->textlen;
+    key = nm->key;
+  }
+  else{
+    va_start( ap, namefmt );
+    vsnprintf( name, sizeof( name ), namefmt, ap );
+    va_end( ap );
+    text = name;
+    textlen = strlen( name );
+    key = NULL;
+  }
+
+  if( ctx->out ){
+
+    if( ( numlen = fmtfixed( num, value, prec ) ) < 0 ){
+      numlen = snprintf( num, sizeof( num ), "%.*f", prec, value );
+    }
+    plen = strlen( prefix );
+    if( ( p = outbuf_room( ctx, plen + textlen + numlen + 2 ) ) != NULL ){
+      memcpy( p, prefix, plen );
+      p += plen;
+      *p++ = ' ';
+      memcpy( p, text, textlen );
+      p += textlen;
+      memcpy( p, num, numlen );
+      p += numlen;
+      *p++ = '\n';
+      ctx->outlen = p - ctx->outbuf;
+    }
+    else{
+      nev_flush( ctx );
+      fprintf( ctx->out, "%s %s%s\n", prefix, text, num );
+    }
+  }
+
+  if( key == NULL ){
+    /* "nDCG@0010=           " -> "nDCG@0010" */
+    p = name + textlen;
+    while( p > name && ( p[ -1 ] == ' ' || p[ -1 ] == '=' ) ){
+      p--;
+    }
+    *p = '\0';
+    if( ( key = arena_strdup( &ctx->resarena, name ) ) == NULL ){
+      return( -1 );
+    }
+  }
+
+  if( ctx->resnum == ctx->ressize ){
+
+    ctx->ressize = ctx->ressize ? 2 * ctx->ressize : 64;
+    if( ( newres = ( struct nev_result *)
+	  realloc( ctx->res, ctx->ressize * sizeof( struct nev_result ) ) )
+	== NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "realloc failed\n" );
+#endif
+      return( -1 );
+    }
+    ctx->res = newres;
+  }
+  r = &ctx->res[ ctx->resnum ];
+  if( ctx->resnum > 0 && strcmp( r[ -1 ].prefix, prefix ) == 0 ){
+    r->prefix = r[ -1 ].prefix;
+  }
+  else if( ( r->prefix = arena_strdup( &ctx->resarena, prefix ) ) == NULL ){
+    return( -1 );
+  }
+  r->name = key;
+  r->value = value;
+  ctx->resnum++;
+
+#ifdef NEVSTATS
+  if( ctx->stats.on ){
+    stats_phase( ctx, phase );
+  }
+#endif
+
+  return( 0 );
+
+}/* of nev_metric */
+
+#ifdef NEVSTATS
+/******************************************************************************
+  stats_phase
+
+adds the time since the last switch to the current phase
+and starts timing the given phase
+
+return value: the previous phase
+******************************************************************************/
+static int stats_phase( struct nev_ctx *ctx, int phase )
+{
+  int prev;
+  double now;
+
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  now = ts.tv_sec + ts.tv_nsec * 1e-9;
+
+  prev = ctx->stats.phase;
+  ctx->stats.sec[ prev ] += now - ctx->stats.since;
+  ctx->stats.since = now;
+  ctx->stats.phase = phase;
+
+  return( prev );
+
+}/* of stats_phase */
+
+/******************************************************************************
+  stats_report
+
+prints the timings and counters of a run to stderr:
+# stats compute: other=0.000012 load_qrels=0.000105 ... total=0.000530
+# stats compute: lines=123 bytes=2345 lookups=0 allocs=45 peak_array=1000
+
+or writes them to ctx->stats.file (-statsfile) as a JSON object.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int stats_report( struct nev_ctx *ctx, const char *cmd )
+{
+  static const char *phasename[ STATS_PHASENUM ] = {
+    "other", "load_qrels", "load_run", "label", "compute", "print"
+  };
+  int i;
+  double total = 0;
+
+  FILE *f;
+
+  for( i = 0; i < STATS_PHASENUM; i++ ){
+    total += ctx->stats.sec[ i ];
+  }
+
+  if( ctx->stats.file == NULL ){
+
+    fprintf( stderr, "# stats %s:", cmd );
+    for( i = 0; i < STATS_PHASENUM; i++ ){
+      fprintf( stderr, " %s=%.6f", phasename[ i ], ctx->stats.sec[ i ] );
+    }
+    fprintf( stderr, " total=%.6f\n", total );
+    fprintf( stderr,
+	     "# stats %s: lines=%ld bytes=%ld lookups=%ld allocs=%ld peak_array=%ld\n",
+	     cmd, ctx->stats.lines, ctx->stats.bytes, ctx->stats.lookups,
+	     ctx->stats.allocs, ctx->stats.peakarray );
+    return( 0 );
+  }
+
+  if( ( f = fopen( ctx->stats.file, "w" ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", ctx->stats.file );
+#endif
+    return( -1 );
+  }
+  fprintf( f, "{\"command\": \"%s\", \"seconds\": {", cmd );
+  for( i = 0; i < STATS_PHASENUM; i++ ){
+    fprintf( f, "\"%s\": %.6f, ", phasename[ i ], ctx->stats.sec[ i ] );
+  }
+  fprintf( f, "\"total\": %.6f}, ", total );
+  fprintf( f,
+	   "\"lines\": %ld, \"bytes\": %ld, \"lookups\": %ld, \"allocs\": %ld, \"peak_array\": %ld}\n",
+	   ctx->stats.lines, ctx->stats.bytes, ctx->stats.lookups,
+	   ctx->stats.allocs, ctx->stats.peakarray );
+  fclose( f );
+
+  return( 0 );
+
+}/* of stats_report */
+#endif
+
+/******************************************************************************
+  eval_dinlabel
+
+similar to glabel but is for computing 
+DIN (diversification for informational and navigational intents) metrics.
+Thus, redundant docs for navigational intents are not labelled.
+
+Instead of a global ideal list,
+reads a din file, which is of the form:
+<intnum> <inf/nav> <docID> <P(i|q)*gi>
+
+Also reads a systemfile and labels it.
 
 systemfile format:
 <docID>
@@ -319,45 +776,60 @@ output format (default: judged and unjudged docs):
 <docID> <gv>
   :
 
+where gv = SUM P(i|q)*gi + SUM isnew(j)P(j|q)*gj
+            i               j
+
+i: informational
+j: nagivational
+isnew(j): flag indicating whether the nav intent is new or not
+
     -j option will remove documents not listed in ideal file.
   
 return value: 0 (OK)
              -1 (NG)
 ******************************************************************************/
-static int eval_glabel( int ac, char **av )
+static int eval_dinlabel( struct nev_ctx *ctx, int ac, char **av )
 {
   FILE *fa = NULL;
-  FILE *fs = stdin;
+  FILE *fs = ctx->in;
 
   int argc = 2;
   int isjudged;
 
-  long jnonrelnum; /* N: number of judged nonrelevant docs */
-  long jrelnum;    /* R: number of judged relevant docs */
   long truncaterank = 0;
   /* by default, do not truncate */
   long i;
+  long highintnum; /* highest intent number */
+
+  double ggain; /* global gain of doc */
 
   char line[ BUFSIZ + 1 ];
   char *pos;
 
-  struct strdoublist *ideal = NULL; /* ideal list with decreasing gains */
-  struct strdoublist *p;
+  struct strdoublong2list *din = NULL;
+  struct strdoublong2list *p;
 
-  int freestrdoublist();
-  double store_ideal();
+  struct bitset found; /* is intent already seen? */
 
-  ignore_unjudged = 0;
+  FILE *arc_open();
+  long store_din();
+  int bitset_init();
+  int bitset_set();
+  int bitset_test();
+  int bitset_free();
+  FILE *gzin_fopen();
+
+  ctx->ignore_unjudged = 0;
   /* by default, output all docs in system list (=judged + unjudged) */
 
   while( argc < ac ){
 
     if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
-      ignore_unjudged = 1;
+      ctx->ignore_unjudged = 1;
       argc++;
     }
     else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
+      ctx->sep = strdup( av[ argc + 1 ] );
       argc += 2;
     }
     else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
@@ -371,9 +843,9 @@ static int eval_glabel( int ac, char **av )
       }
       argc += 2;
     }
-    else if( strcmp( av[ argc ], OPTSTR_IDEALFILE ) == 0 &&
+    else if( strcmp( av[ argc ], OPTSTR_DINFILE ) == 0 &&
 	     ( argc + 1 < ac ) ){
-      if( ( fa = fopen( av[ argc + 1 ], "r" ) ) == NULL ){
+      if( ( fa = gzin_fopen( av[ argc + 1 ] ) ) == NULL ){
 
 #ifdef OUTERR
 	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
@@ -384,7 +856,7 @@ static int eval_glabel( int ac, char **av )
     }
       /* ranked list file */
     else{
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
+      if( ( fs = arc_open( ctx, NULL, av[ argc ] ) ) == NULL ){
 
 #ifdef OUTERR
 	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
@@ -399,32 +871,51 @@ static int eval_glabel( int ac, char **av )
 
 #ifdef OUTERR      
     fprintf( stderr,
-	     "Usage: %s %s [%s] [%s <separator>] [%s <rank>] %s <ideal_file> [system ranked list]\n",
+	     "Usage: %s %s [%s] [%s <separator>] [%s <rank>] %s <din_file> [system ranked list]\n",
 	     av[ 0 ], av[ 1 ],
 	     OPTSTR_IGNORE_UNJUDGED,
-	     OPTSTR_SEP, OPTSTR_TRUNCATE, OPTSTR_IDEALFILE );
+	     OPTSTR_SEP, OPTSTR_TRUNCATE, OPTSTR_DINFILE );
 #endif
     return( 0 );
   }
 
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
   }
 
-  /* store ideal list with decreasing gain values */
-  if( store_ideal( &ideal, &jrelnum, &jnonrelnum, fa ) <= 0.0 ){
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+  /* store din file */
+  if( ( highintnum = store_din( ctx, fa, &din ) ) == 0 ){
 
 #ifdef OUTERR
-    fprintf( stderr, "store_ideal failed\n" );
+    fprintf( stderr, "store_din failed\n" );
 #endif
     return( -1 );
   }
   fclose( fa );
 
+  /* intent 1 is stored in bit 0 */
+  if( bitset_init( &found, highintnum ) < 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "bitset_init failed\n" );
+#endif
+    return( -1 );
+  }
+
+  if( fs == ctx->in && fs != NULL &&
+      ( fs = arc_open( ctx, fs, NULL ) ) == NULL ){
+    return( -1 ); /* -topic: the topic is not in the archive on stdin */
+  }
+
   /* output system ranked list with gain values */    
+  STATS_PHASE( ctx, STATS_LABEL );
 
   i = 1; /* rank */
   while( fgets( line, sizeof( line ), fs ) ){
+    STATS_LINE( ctx, line );
+    STATS_LOOKUP( ctx );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -435,26 +926,45 @@ static int eval_glabel( int ac, char **av )
     *pos = '\0';
 
     isjudged = 0; /* is this a judged doc (i.e. one in ideal list?) */
-    p = ideal;
+    ggain = 0.0;
+    p = din;
     while( p ){
 
       if( strcmp( p->string, line ) == 0 ){
 
-	printf( "%s%s%.4f\n", line, sep, p->val );
 	isjudged = 1;
-	break;
+	if( p->val3 == NAVIGATIONAL ){
+
+	  if( bitset_test( &found, p->val2 - 1 ) ){
+	    /* nav intent already seen -> do not add to ggain */
+	  }
+	  else{ /* nav intent seen for the 1st time */
+	    ggain += p->val1;
+	  }
+	}
+	else{ /* INFORMATIONAL: store_din guarantees it */
+
+	  ggain += p->val1; /* add to ggain unconditionally */
+	}
+	bitset_set( &found, p->val2 - 1 );
+	/* this intent has already been covered */
+
       }
       p = p->next;
     }
 
-    if( isjudged == 0 ){ /* unjudged doc */
+    if( isjudged ){
 
-      if( ignore_unjudged ){
+      nev_printf( ctx, "%s%s%.4f\n", line, ctx->sep, ggain );
+    }
+    else{ /* unjudged doc */
+
+      if( ctx->ignore_unjudged ){
 	/* do not print unjudged document */
       }
       else{
 	/* print this unjuded document WITHOUT a gain value */
-	printf( "%s\n", line );
+	nev_printf( ctx, "%s\n", line );
       }
 
     }
@@ -465,113 +975,276 @@ static int eval_glabel( int ac, char **av )
     }
     i++;
   }
-  fclose( fs );
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
 
-  free( sep );
-  freestrdoublist( &ideal );
+  bitset_free( &found );
   return( 0 );
 
-}/* of eval_glabel */
+}/* of eval_dinlabel */
 
 
 /******************************************************************************
-  eval_gcompute
-
-reads an ideal list with decreasing gain values
-and a system list with gain values;
-outputs several different evaluation metric values.
-
-If the labelled ranked list is a condensed list,
-use the -j option to compute bpref.
-
-Note that, unlike compute,
-gcompute relies on the highest gain value observed in the ideal list
-(whereas compute uses the highest gain value explictly specified 
-in the command line).
+  eval_glabel
 
-- Does not support graded-uniform NCU
+reads an ideal ranked list with decreasing gain values
+      (possibly with judged nonrel docs at bottom)
+      and a system ranked list WITHOUT gain values;
+outputs a system ranked list WITH gain values.
 
-releavance assessment file format:
+ideal ranked list file format:
 <docID> <gv>
 <docID> <gv>
   :
-(may contain empty lines or comments beginning with #. They will be ignored.)
+[Sorted by gv.]
 
-labelled systemfile format:
-<docID> <gv>
+systemfile format:
 <docID>
+<docID>
+  :
+
+output format (default: judged and unjudged docs):
 <docID> <gv>
- :    
+<docID> 0
+<docID> <gv>
+  :
 
+    -j option will remove documents not listed in ideal file.
+  
+return value: 0 (OK)
+             -1 (NG)
 ******************************************************************************/
-static int eval_gcompute( int ac, char **av )
+static int eval_glabel( struct nev_ctx *ctx, int ac, char **av )
 {
   FILE *fa = NULL;
-  FILE *fs = stdin;
+  FILE *fs = ctx->in;
 
   int argc = 2;
-  int verbose = 0;
-
-  int compute_gap = 0; /* computing GAP is more expensive
-			than others so omit by default */
+  int isjudged;
 
-  long i, j;
-  long cutoff[ CUTOFF_NUMMAX ]; /* cutoff for prec, hit, nDCG... */
-  long cutoff_num = 0; /* 0 means cutoff was not specified by the user */
-  long r1 = 0; /* rank of the first correct doc */
-  long rp = 0; /* preferred rank for P-measure and P-plus */
-  long syslen; /* length of system ranked list */
-  long maxlen; /* max( syslen, jrelnum )
-		    where jrelnum is the length of a minimal
-		    ideal ranked output */
-  long minlen; /* min(cutoff, syslen) */
   long jnonrelnum; /* N: number of judged nonrelevant docs */
   long jrelnum;    /* R: number of judged relevant docs */
+  long truncaterank = 0;
+  /* by default, do not truncate */
+  long i;
 
-  double *CGi, *DCGi, *msDCGi;
-/* (cumulative) gain, discounted (cumulative) gain, 
-   Microsoft's discounted (cumulative) gain for the ideal ranked list */
-  double *Gs, *CGs, *DCGs, *msDCGs;
-/* ditto for system ranked list */
+  char line[ BUFSIZ + 1 ];
+  char *pos;
 
-  double *count; /* treat is as a double rather than an integer */
-  double *BR;    /* blended ratio */
-  double RBPp = 0.0; /* RBP persistence parameter p: should be positive */
-  double *RBPpower;          /* p^(r-1) */
-  double *RBPsum;            /* SUM g(r)p^(r-1) */
-  double *ERR; /* expected reciprocal rank by Chapelle et al CIKM09 */
-  double *ERRdsat; /* dissatisfaction prob at rank r for ERR */
-  double *ERRi; /* ideal ERR for normalisation */
-  double *ERRidsat;
-  double *EBR; /* expected blended ratio, 2018 */
-  double *GAPsum; /* for computing Robertson GAP */
-  double *GAPisum; /* for GAP@l */
+  struct strdoublist *ideal = NULL; /* ideal list with decreasing gains */
+  struct strdoublist *p;
 
-  double ratio, ratio2, ratio3;
-  double sum, sum2, sum3;
-  double mini;
-  double penalty;
-  double denom;
-  double hgain; /* highest gain value in ideal ranked list */
-  double qbeta = DEFAULT_BETA;
-  double gamma = DEFAULT_GAMMA;
-  double logbase = DEFAULT_LOGB;
-  double sysgainmax; /* max gain value in system list
-			      for obtaining preferred rank */
+  FILE *arc_open();
+  double store_ideal();
+  FILE *gzin_fopen();
 
-  char *buf, *p;
+  ctx->ignore_unjudged = 0;
+  /* by default, output all docs in system list (=judged + unjudged) */
 
-  struct strdoublist *ideal = NULL; /* ideal list with decreasing gains */
-  struct strdoublist *syslist = NULL; /* ranked list with gains */
-  struct strdoublist *doc;
+  while( argc < ac ){
 
+    if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
+      ctx->ignore_unjudged = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
+      truncaterank = atol( av[ argc + 1 ] );
+      if( truncaterank < 1 ){
+
+#ifdef OUTERR
+        fprintf( stderr, "Bad %s value\n", OPTSTR_TRUNCATE );
+#endif
+        return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_IDEALFILE ) == 0 &&
+	     ( argc + 1 < ac ) ){
+      if( ( fa = gzin_fopen( av[ argc + 1 ] ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
+      /* ranked list file */
+    else{
+      if( ( fs = arc_open( ctx, NULL, av[ argc ] ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+#endif
+	return( -1 );
+      }
+      argc++;
+    }
+  }
+
+  if( fa == NULL ){
+
+#ifdef OUTERR      
+    fprintf( stderr,
+	     "Usage: %s %s [%s] [%s <separator>] [%s <rank>] %s <ideal_file> [system ranked list]\n",
+	     av[ 0 ], av[ 1 ],
+	     OPTSTR_IGNORE_UNJUDGED,
+	     OPTSTR_SEP, OPTSTR_TRUNCATE, OPTSTR_IDEALFILE );
+#endif
+    return( 0 );
+  }
+
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+  /* store ideal list with decreasing gain values */
+  if( store_ideal( ctx, &ideal, &jrelnum, &jnonrelnum, fa ) <= 0.0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "store_ideal failed\n" );
+#endif
+    return( -1 );
+  }
+  fclose( fa );
+
+  if( fs == ctx->in && fs != NULL &&
+      ( fs = arc_open( ctx, fs, NULL ) ) == NULL ){
+    return( -1 ); /* -topic: the topic is not in the archive on stdin */
+  }
+
+  /* output system ranked list with gain values */    
+  STATS_PHASE( ctx, STATS_LABEL );
+
+  i = 1; /* rank */
+  while( fgets( line, sizeof( line ), fs ) ){
+    STATS_LINE( ctx, line );
+    STATS_LOOKUP( ctx );
+
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR   
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif  
+      return( -1 );
+    }
+    *pos = '\0';
+
+    isjudged = 0; /* is this a judged doc (i.e. one in ideal list?) */
+    p = ideal;
+    while( p ){
+
+      if( strcmp( p->string, line ) == 0 ){
+
+	nev_printf( ctx, "%s%s%.4f\n", line, ctx->sep, p->val );
+	isjudged = 1;
+	break;
+      }
+      p = p->next;
+    }
+
+    if( isjudged == 0 ){ /* unjudged doc */
+
+      if( ctx->ignore_unjudged ){
+	/* do not print unjudged document */
+      }
+      else{
+	/* print this unjuded document WITHOUT a gain value */
+	nev_printf( ctx, "%s\n", line );
+      }
+
+    }
+
+    if( i == truncaterank ){ /* if truncaterank is positive,
+                                truncate system output at this rank */
+      break;
+    }
+    i++;
+  }
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
+
+  return( 0 );
+
+}/* of eval_glabel */
+
+
+/******************************************************************************
+  eval_gcompute
+
+reads an ideal list with decreasing gain values
+and a system list with gain values;
+outputs several different evaluation metric values.
+
+If the labelled ranked list is a condensed list,
+use the -j option to compute bpref.
+
+Note that, unlike compute,
+gcompute relies on the highest gain value observed in the ideal list
+(whereas compute uses the highest gain value explictly specified 
+in the command line).
+
+- Does not support graded-uniform NCU
+
+releavance assessment file format:
+<docID> <gv>
+<docID> <gv>
+  :
+(may contain empty lines or comments beginning with #. They will be ignored.)
+
+labelled systemfile format:
+<docID> <gv>
+<docID>
+<docID> <gv>
+ :    
+
+******************************************************************************/
+static int eval_gcompute( struct nev_ctx *ctx, int ac, char **av )
+{
+  FILE *fs = ctx->in;
+
+  int argc = 2;
+  int verbose = 0;
+  int use_icache = 0; /* read/write the ideal-side sidecar file */
+
+  int compute_gap = 0; /* computing GAP is more expensive
+			than others so omit by default */
+
+  long k;
+  long cutoff[ CUTOFF_NUMMAX ]; /* cutoff for prec, hit, nDCG... */
+  long cutoff_num = 0; /* 0 means cutoff was not specified by the user */
+  long sysfile_num = 0;
+
+  double RBPp = 0.0; /* RBP persistence parameter p: should be positive */
+  double qbeta = DEFAULT_BETA;
+  double gamma = DEFAULT_GAMMA;
+  double logbase = DEFAULT_LOGB;
+
+  char *buf, *p;
+  char *idealfile = NULL;
+  char **sysfile; /* system files; stdin if none */
+  char *saveptr; /* for strtok_r */
+
+  struct idealcache *ic; /* ideal side shared by all system files */
+
+  FILE *arc_open();
   int gcompute_usage();
-  double store_ideal();
-  int store_syslist();
-  int freestrdoublist();
-  double orig_dcglog();
+  struct idealcache *load_idealcache();
+  void *arena_alloc();
+
+  if( ( sysfile = ( char **)arena_alloc( &ctx->arena, ac * sizeof( char * ) ) )
+      == NULL ){
+    return( -1 );
+  }
 
-  ignore_unjudged = 0;
+  ctx->ignore_unjudged = 0;
   /* by default, assume that system list contains unjudged docs.
      if ignore_unjudged == 1, assume that system list is a condensed list,
      so output bpref. */
@@ -590,30 +1263,28 @@ static int eval_gcompute( int ac, char **av )
       argc++;
     }
     else if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
-      ignore_unjudged = 1; /* input contains judged docs only
+      ctx->ignore_unjudged = 1; /* input contains judged docs only
 			      so output bpref etc. */
       argc++;
     }
     else if( strcmp( av[ argc ], OPTSTR_OUTSTR ) == 0 && ( argc + 1 < ac ) ){
       /* user specified string for each output line, e.g. topicID */
-      outstr = strdup( av[ argc + 1 ] );
+      ctx->outstr = strdup( av[ argc + 1 ] );
       argc += 2;
     }
     else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
+      ctx->sep = strdup( av[ argc + 1 ] );
       argc += 2;
     }
     else if( strcmp( av[ argc ], OPTSTR_IDEALFILE ) == 0 &&
 	     ( argc + 1 < ac ) ){
-      if( ( fa = fopen( av[ argc + 1 ], "r" ) ) == NULL ){
-
-#ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
-#endif
-	return( -1 );
-      }
+      idealfile = av[ argc + 1 ];
       argc += 2;
     }
+    else if( strcmp( av[ argc ], OPTSTR_ICACHE ) == 0 ){
+      use_icache = 1;
+      argc++;
+    }
     else if( strcmp( av[ argc ], OPTSTR_BETA ) == 0 && ( argc + 1 < ac ) ){
       /* for blended ratio */
       qbeta = atof( av[ argc + 1 ] );
@@ -651,7 +1322,7 @@ static int eval_gcompute( int ac, char **av )
 
       buf = strdup( av[ argc + 1 ] );
       cutoff_num = 0;
-      if( ( p = strtok( buf, "," ) ) == NULL ){
+      if( ( p = strtok_r( buf, ",", &saveptr ) ) == NULL ){
 
 #ifdef OUTERR
 	fprintf( stderr, "strtok failed\n" );
@@ -668,25 +1339,20 @@ static int eval_gcompute( int ac, char **av )
 #endif
 	  return( -1 );
 	}
-      }while( ( p = strtok( NULL, "," ) ) != NULL );
+      }while( ( p = strtok_r( NULL, ",", &saveptr ) ) != NULL );
 	
       free( buf );
       argc += 2;
     }
-    /* system file with gain values*/
+    /* system file(s) with gain values */
     else{
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
-
-#ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
-#endif
-	return( -1 );
-      }
+      sysfile[ sysfile_num ] = av[ argc ];
+      sysfile_num++;
       argc++;
     }
   }
 
-  if( fa == NULL ){
+  if( idealfile == NULL ){
     return( gcompute_usage( ac, av ) );
   }
 
@@ -694,12 +1360,12 @@ static int eval_gcompute( int ac, char **av )
     RBPp = DEFAULT_RBP;
   }
 
-  if( outstr == NULL ){
+  if( ctx->outstr == NULL ){
     /* output prefix not specified */
-    outstr = strdup( "" );
+    ctx->outstr = strdup( "" );
   }
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
   }
 
   /* if cutoff is not specified, use default */
@@ -708,18 +1374,15 @@ static int eval_gcompute( int ac, char **av )
     cutoff[ 0 ] = DEFAULT_CUTOFF;
   }
 
-  /* set ideal gains, jrelnum and jnonrelnum */
-  if( ( hgain = store_ideal( &ideal, &jrelnum, &jnonrelnum, fa ) ) <= 0.0 ){
+  STATS_PHASE( ctx, STATS_LOADQRELS );
 
-#ifdef OUTERR
-    fprintf( stderr, "store_ideal_gains\n" );
-#endif
+  /* set ideal gains, jrelnum and jnonrelnum:
+     computed once and shared by all system files */
+  if( ( ic = load_idealcache( ctx, idealfile, logbase, use_icache ) ) == NULL ){
     return( -1 );
+  }
 
-    }
-  fclose( fa );
-
-  if( jrelnum == 0 ){
+  if( ic->jrelnum == 0 ){
 
 #ifdef OUTERR
     fprintf( stderr, "no rel doc\n" );
@@ -727,7 +1390,7 @@ static int eval_gcompute( int ac, char **av )
     return( -1 );
   }
 
-  if( ( ignore_unjudged == 1 ) && ( jnonrelnum == 0 ) ){
+  if( ( ctx->ignore_unjudged == 1 ) && ( ic->jnonrelnum == 0 ) ){
 
 #ifdef OUTERR
     fprintf( stderr,
@@ -736,97 +1399,166 @@ static int eval_gcompute( int ac, char **av )
     return( -1 );
   }
 
-  /* store system list with gain values */
-  if( store_syslist( &syslist, &syslen, &sysgainmax, fs ) < 0 ){
+  k = 0;
+  do{
+    if( sysfile_num > 0 ){
+      if( ( fs = arc_open( ctx, NULL, sysfile[ k ] ) ) == NULL ){
 
 #ifdef OUTERR
-    fprintf( stderr, "store_syslist failed\n" );
+	fprintf( stderr, "Cannot open %s\n", sysfile[ k ] );
 #endif
-    return( -1 );
-  }
-  fclose( fs );
-
-  printf( "%s # syslen=%ld jrel=%ld jnonrel=%ld\n",
-	  outstr, syslen, jrelnum, jnonrelnum );
-
-  /* maxlen = max( jrelnum, syslen ) */
-  maxlen = jrelnum;
-  if( maxlen < syslen ){
-    maxlen = syslen;
-  }
-
-  CGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  DCGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  msDCGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-
-  /* it is convenient to store raw system gain values for each rank. */
-  Gs = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  CGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  DCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  msDCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+	return( -1 );
+      }
+      if( sysfile_num > 1 ){
+	nev_printf( ctx, "%s # run=%s\n", ctx->outstr, sysfile[ k ] );
+      }
+    }
+    else if( fs == ctx->in && fs != NULL &&
+	     ( fs = arc_open( ctx, fs, NULL ) ) == NULL ){
+      return( -1 ); /* -topic: the topic is not in the archive on stdin */
+    }
 
-  count = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  BR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+    if( gcompute_run( ctx, ic, fs, verbose, compute_gap, cutoff, cutoff_num,
+		      qbeta, gamma, logbase, RBPp ) < 0 ){
+      return( -1 );
+    }
+    k++;
+  }while( k < sysfile_num );
 
-  RBPpower = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  RBPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  return( 0 );
 
-  ERR = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  ERRdsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  ERRi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  ERRidsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
+}/* of eval_gcompute */
 
-  /* 2018 EBR */
-  EBR = ( double *)calloc( maxlen + 1, sizeof( double ) );
 
-  GAPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  GAPisum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+/******************************************************************************
+  gcompute_run
 
-  /* store ideal cumulative gain etc. */
+evaluates one labelled system list (fs) against the ideal side (ic)
+for eval_gcompute. fs is closed.
 
-  ERRi[ 0 ] = 0;
-  ERRidsat[ 0 ] = 1;
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int gcompute_run( struct nev_ctx *ctx,
+			 struct idealcache *ic, FILE *fs,
+			 int verbose, int compute_gap,
+			 long *cutoff, long cutoff_num,
+			 double qbeta, double gamma, double logbase,
+			 double RBPp )
+{
+  long i, j;
+  long r1 = 0; /* rank of the first correct doc */
+  long rp = 0; /* preferred rank for P-measure and P-plus */
+  long syslen; /* length of system ranked list */
+  long maxlen; /* max( syslen, jrelnum )
+		    where jrelnum is the length of a minimal
+		    ideal ranked output */
+  long minlen; /* min(cutoff, syslen) */
+  long jnonrelnum; /* N: number of judged nonrelevant docs */
+  long jrelnum;    /* R: number of judged relevant docs */
 
-  doc = ideal;
-  for( i = 1; i <= jrelnum; i++ ){
+  double *CGi, *DCGi, *msDCGi;
+/* (cumulative) gain, discounted (cumulative) gain, 
+   Microsoft's discounted (cumulative) gain for the ideal ranked list */
+  double *Gs, *CGs, *DCGs, *msDCGs;
+/* ditto for system ranked list */
 
-    CGi[ i ] = CGi[ i - 1 ] + doc->val;
-    DCGi[ i ] = DCGi[ i - 1 ] + doc->val/orig_dcglog( logbase, i );
-    /* For MSnDCG, the logbase is irrelevant */
-    msDCGi[ i ] = msDCGi[ i - 1 ] + doc->val/log( i + 1 );
+  double *count; /* treat is as a double rather than an integer */
+  double *BR;    /* blended ratio */
+  double *RBPpower;          /* p^(r-1) */
+  double *RBPsum;            /* SUM g(r)p^(r-1) */
+  double *ERR; /* expected reciprocal rank by Chapelle et al CIKM09 */
+  double *ERRdsat; /* dissatisfaction prob at rank r for ERR */
+  double *ERRi; /* ideal ERR for normalisation */
+  double *EBR; /* expected blended ratio, 2018 */
+  double *GAPsum; /* for computing Robertson GAP */
+  double *GAPisum; /* for GAP@l */
 
-    if( compute_gap ){
-      GAPisum[ i ] = GAPisum[ i - 1 ] + doc->val * ( doc->val + 1 );
-    }
+  double ratio, ratio2, ratio3;
+  double sum, sum2, sum3;
+  double mini;
+  double penalty;
+  double denom;
+  double hgain; /* highest gain value in ideal ranked list */
+  double sysgainmax; /* max gain value in system list
+			for obtaining preferred rank */
 
-    ERRi[ i ] = ERRi[ i - 1 ] + ( ERRidsat[ i - 1 ]/i ) * ( doc->val/( hgain+1 ) );
-    ERRidsat[ i ] = ERRidsat[ i - 1 ] * ( 1 - doc->val/( hgain+1 ) );
-    
-    doc = doc->next;
-  }
+  struct strdoublist *syslist = NULL; /* ranked list with gains */
+  struct strdoublist *doc;
 
-  freestrdoublist( &ideal );
+  struct arenamark mark; /* syslist is released after each run */
 
-  /* exhausted reldocs, so copy the cumulative vals at rank jrelnum
-     for the remaining ranks (if any) */
-  for( i = jrelnum + 1; i <= maxlen; i++ ){
+  int store_syslist();
+  int arena_mark();
+  int arena_release();
+  double orig_dcglog();
+  double *idealcache2array();
 
-    CGi[ i ] = CGi[ jrelnum ];
-    DCGi[ i ] = DCGi[ jrelnum ];
-    msDCGi[ i ] = msDCGi[ jrelnum ];
+  arena_mark( &ctx->arena, &mark );
 
-    if( compute_gap ){
-      GAPisum[ i ] = GAPisum[ jrelnum ];
-    }
+  jrelnum = ic->jrelnum;
+  jnonrelnum = ic->jnonrelnum;
+  hgain = ic->hgain;
 
-    ERRi[ i ] = ERRi[ jrelnum ];
+  STATS_PHASE( ctx, STATS_LOADRUN );
+
+  /* store system list with gain values */
+  if( store_syslist( ctx, &syslist, &syslen, &sysgainmax, fs ) < 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "store_syslist failed\n" );
+#endif
+    return( -1 );
+  }
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
+
+  STATS_PHASE( ctx, STATS_COMPUTE );
 
+  nev_printf( ctx, "%s # syslen=%ld jrel=%ld jnonrel=%ld\n",
+	  ctx->outstr, syslen, jrelnum, jnonrelnum );
+
+  /* maxlen = max( jrelnum, syslen ) */
+  maxlen = jrelnum;
+  if( maxlen < syslen ){
+    maxlen = syslen;
   }
+  STATS_ARRAYS( ctx, 12, maxlen + 1 );
+
+  /* it is convenient to store raw system gain values for each rank. */
+  Gs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  CGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  DCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  msDCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  count = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  BR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  RBPpower = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  RBPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  ERR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  ERRdsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  /* 2018 EBR */
+  EBR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  GAPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  /* ideal cumulative gain etc. are precomputed up to rank jrelnum;
+     exhausted reldocs, so copy the cumulative vals at rank jrelnum
+     for the remaining ranks (if any) */
+  CGi = idealcache2array( ic->CGi, jrelnum, maxlen );
+  DCGi = idealcache2array( ic->DCGi, jrelnum, maxlen );
+  msDCGi = idealcache2array( ic->msDCGi, jrelnum, maxlen );
+  ERRi = idealcache2array( ic->ERRi, jrelnum, maxlen );
+  GAPisum = idealcache2array( ic->GAPisum, jrelnum, maxlen );
 
   if( verbose ){
-    printf( "\n" );
+    nev_printf( ctx, "\n" );
     for( i = 1; i <= maxlen; i++ ){
-      printf( "#%ld CGi=%.4f DCGi=%.4f msDCGi=%.4f\n",
+      nev_printf( ctx, "#%ld CGi=%.4f DCGi=%.4f msDCGi=%.4f\n",
 	      i, CGi[ i ], DCGi[ i ], msDCGi[ i ] );
     }
   }
@@ -915,7 +1647,7 @@ static int eval_gcompute( int ac, char **av )
     doc = doc->next;
   }
 
-  freestrdoublist( &syslist );
+  arena_release( &ctx->arena, &mark );
 
   for( i = syslen + 1; i <= maxlen; i++ ){ /* if syslen < jrelnum
 					    no more relevant */
@@ -936,39 +1668,39 @@ static int eval_gcompute( int ac, char **av )
   }
 
   if( verbose ){
-    printf( "\n" );
+    nev_printf( ctx, "\n" );
     for( i = 1; i <= syslen; i++ ){
       if( Gs[ i ] > 0 ){
-	printf( "#%ld count=%ld Gs=%.4f CGs=%.4f DCGs=%.4f msDCGs=%.4f BR=%.4f\n",
+	nev_printf( ctx, "#%ld count=%ld Gs=%.4f CGs=%.4f DCGs=%.4f msDCGs=%.4f BR=%.4f\n",
 		i, (long)count[ i ], Gs[ i ], CGs[ i ], DCGs[ i ], msDCGs[ i ], BR[ i ] );
       }
     }
-    printf( "\n" );
+    nev_printf( ctx, "\n" );
   }
     
-  printf( "%s # r1=%ld rp=%ld\n", outstr, r1, rp );
+  nev_printf( ctx, "%s # r1=%ld rp=%ld\n", ctx->outstr, r1, rp );
 
     
   /***** output evaluation metric values *****/
 
   /* RR, O-measure, P-measure, P-plus */
   if( r1 == 0 ){ /* no relevant doc in system output */
-    printf( "%s RR=                  %.4f\n", outstr, (double)0 );
-    printf( "%s O-measure=           %.4f\n", outstr, (double)0 );
-    printf( "%s P-measure=           %.4f\n", outstr, (double)0 );
-    printf( "%s P-plus=              %.4f\n", outstr, (double)0 );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "RR=                  " );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "O-measure=           " );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "P-measure=           " );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "P-plus=              " );
   }
   else{ /* at least one rel doc in system output */
-    printf( "%s RR=                  %.4f\n", outstr, (double)1/r1 );
-    printf( "%s O-measure=           %.4f\n", outstr, BR[ r1 ] );
-    printf( "%s P-measure=           %.4f\n", outstr, BR[ rp ] );
+    nev_metric( ctx, ctx->outstr, (double)1/r1, 4, "RR=                  " );
+    nev_metric( ctx, ctx->outstr, BR[ r1 ], 4, "O-measure=           " );
+    nev_metric( ctx, ctx->outstr, BR[ rp ], 4, "P-measure=           " );
     sum = 0.0;
     for( i = 1; i <= rp; i++ ){
       if( Gs[ i ] > 0 ){
 	sum += BR[ i ];
       }
     }
-    printf( "%s P-plus=              %.4f\n", outstr, sum/count[ rp ] );
+    nev_metric( ctx, ctx->outstr, sum/count[ rp ], 4, "P-plus=              " );
   }
 
   /* AP and Q */ 
@@ -979,8 +1711,8 @@ static int eval_gcompute( int ac, char **av )
       sum2 += BR[ i ];
     }
   }
-  printf( "%s AP=                  %.4f\n", outstr, sum/jrelnum );
-  printf( "%s Q-measure=           %.4f\n", outstr, sum2/jrelnum );
+  nev_metric( ctx, ctx->outstr, sum/jrelnum, 4, "AP=                  " );
+  nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4, "Q-measure=           " );
 
   /* NCU measures */
 
@@ -997,8 +1729,8 @@ static int eval_gcompute( int ac, char **av )
       sum2 += BR[ i ] * pow( gamma, count[ i ]-1 );
     }
   }
-  printf( "%s NCUrb,P=             %.4f\n", outstr, sum/denom );
-  printf( "%s NCUrb,BR=            %.4f\n", outstr, sum2/denom );
+  nev_metric( ctx, ctx->outstr, sum/denom, 4, "NCUrb,P=             " );
+  nev_metric( ctx, ctx->outstr, sum2/denom, 4, "NCUrb,BR=            " );
 
   /* GAP */
   if( compute_gap ){
@@ -1007,18 +1739,18 @@ static int eval_gcompute( int ac, char **av )
     for( i = 1; i <= syslen; i++ ){
       sum += GAPsum[ i ]/i;
     }
-    printf( "%s GAP=                 %.4f\n",
-	    outstr, sum/GAPisum[ jrelnum ] );
+    nev_metric( ctx, ctx->outstr, sum/GAPisum[ jrelnum ], 4,
+		"GAP=                 " );
 
   }
 
   /* RBP */
-  printf( "%s RBP=                 %.4f\n",
-	  outstr,(1-RBPp)*RBPsum[ syslen ]/hgain );
+  nev_metric( ctx, ctx->outstr, (1-RBPp)*RBPsum[ syslen ]/hgain, 4,
+	      "RBP=                 " );
   /* ERR */
-  printf( "%s ERR=                 %.4f\n", outstr, ERR[ syslen ] );
+  nev_metric( ctx, ctx->outstr, ERR[ syslen ], 4, "ERR=                 " );
   /* 2018 EBR */
-  printf( "%s EBR=                 %.4f\n", outstr, EBR[ syslen ] );
+  nev_metric( ctx, ctx->outstr, EBR[ syslen ], 4, "EBR=                 " );
 
   /* cutoff-based metrics */
   for( i = 0; i < cutoff_num; i++ ){
@@ -1039,16 +1771,16 @@ static int eval_gcompute( int ac, char **av )
 
     /* divide by min(cutoff, jrelnum ) */
     if( cutoff[ i ] < jrelnum ){
-      printf( "%s AP@%04ld=             %.4f\n",
-	      outstr, cutoff[ i ], sum/cutoff[ i ] );
-      printf( "%s Q@%04ld=              %.4f\n",
-	      outstr, cutoff[ i ], sum2/cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, sum/cutoff[ i ], 4,
+		  "AP@%04ld=             ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, sum2/cutoff[ i ], 4,
+		  "Q@%04ld=              ", cutoff[ i ] );
     }
     else{ 
-      printf( "%s AP@%04ld=             %.4f\n",
-	      outstr, cutoff[ i ], sum/jrelnum );
-      printf( "%s Q@%04ld=              %.4f\n",
-	      outstr, cutoff[ i ], sum2/jrelnum );
+      nev_metric( ctx, ctx->outstr, sum/jrelnum, 4,
+		  "AP@%04ld=             ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4,
+		  "Q@%04ld=              ", cutoff[ i ] );
     }
 
     if( compute_gap ){
@@ -1059,12 +1791,12 @@ static int eval_gcompute( int ac, char **av )
       }
 
       if( cutoff[ i ] < jrelnum ){
-        printf( "%s GAP@%04ld=            %.4f\n",
-                outstr, cutoff[ i ], sum/GAPisum[ cutoff[ i ] ] );
+        nev_metric( ctx, ctx->outstr, sum/GAPisum[ cutoff[ i ] ], 4,
+		    "GAP@%04ld=            ", cutoff[ i ] );
       }
       else{
-        printf( "%s GAP@%04ld=            %.4f\n",
-                outstr, cutoff[ i ], sum/GAPisum[ jrelnum ] );
+        nev_metric( ctx, ctx->outstr, sum/GAPisum[ jrelnum ], 4,
+		    "GAP@%04ld=            ", cutoff[ i ] );
       }
       
     }
@@ -1072,72 +1804,72 @@ static int eval_gcompute( int ac, char **av )
 
     if( cutoff[ i ] <= maxlen ){
 
-      printf( "%s nDCG@%04ld=           %.4f\n",
-	      outstr, cutoff[ i ], DCGs[ cutoff[ i ] ]/DCGi[ cutoff[ i ] ]);
-      printf( "%s MSnDCG@%04ld=         %.4f\n",
-	      outstr, cutoff[ i ], msDCGs[ cutoff[ i ] ]/msDCGi[ cutoff[ i ] ]);
-      printf( "%s P@%04ld=              %.4f\n",
-	      outstr, cutoff[ i ], count[ cutoff[ i ] ]/cutoff[ i ]);
-      printf( "%s RBP@%04ld=            %.4f\n",
-              outstr, cutoff[ i ], (1-RBPp)*RBPsum[ cutoff[ i ] ]/hgain );
+      nev_metric( ctx, ctx->outstr, DCGs[ cutoff[ i ] ]/DCGi[ cutoff[ i ] ], 4,
+		  "nDCG@%04ld=           ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, msDCGs[ cutoff[ i ] ]/msDCGi[ cutoff[ i ] ], 4,
+		  "MSnDCG@%04ld=         ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, count[ cutoff[ i ] ]/cutoff[ i ], 4,
+		  "P@%04ld=              ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, (1-RBPp)*RBPsum[ cutoff[ i ] ]/hgain, 4,
+		  "RBP@%04ld=            ", cutoff[ i ] );
       /* 20181003 note that hgain is obtained PER TOPIC */
-      printf( "%s ERR@%04ld=            %.4f\n",
-              outstr, cutoff[ i ], ERR[ cutoff[ i ] ]);
-      printf( "%s nERR@%04ld=           %.4f\n",
-              outstr, cutoff[ i ], ERR[ cutoff[ i ] ]/ERRi[ cutoff[ i ] ]);
+      nev_metric( ctx, ctx->outstr, ERR[ cutoff[ i ] ], 4,
+		  "ERR@%04ld=            ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, ERR[ cutoff[ i ] ]/ERRi[ cutoff[ i ] ], 4,
+		  "nERR@%04ld=           ", cutoff[ i ] );
       /* 2018 */
-      printf( "%s EBR@%04ld=            %.4f\n",
-              outstr, cutoff[ i ], EBR[ cutoff[ i ] ] );
+      nev_metric( ctx, ctx->outstr, EBR[ cutoff[ i ] ], 4,
+		  "EBR@%04ld=            ", cutoff[ i ] );
 
       /* In version 180312, ERR@l was included in gcompute but NOT in compute. */
       /* 20180909 RBP@l */      
 
       if( (long)count[ cutoff[ i ] ] > 0 ){
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)1 );
+	nev_metric( ctx, ctx->outstr, (double)1, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
       }
       else{
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)0 );
+	nev_metric( ctx, ctx->outstr, (double)0, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
       }
 	
     }
     else{ /* cutoff exceeds maxlen */
 
-      printf( "%s nDCG@%04ld=           %.4f\n",
-	      outstr, cutoff[ i ], DCGs[ maxlen ]/DCGi[ maxlen ]);
-      printf( "%s MSnDCG@%04ld=         %.4f\n",
-	      outstr, cutoff[ i ], msDCGs[ maxlen ]/msDCGi[ maxlen ]);
-      printf( "%s P@%04ld=              %.4f\n",
-	      outstr, cutoff[ i ], count[ maxlen ]/cutoff[ i ]);
+      nev_metric( ctx, ctx->outstr, DCGs[ maxlen ]/DCGi[ maxlen ], 4,
+		  "nDCG@%04ld=           ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, msDCGs[ maxlen ]/msDCGi[ maxlen ], 4,
+		  "MSnDCG@%04ld=         ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, count[ maxlen ]/cutoff[ i ], 4,
+		  "P@%04ld=              ", cutoff[ i ] );
       /* note that the above definition of precision is correct. */
-      printf( "%s RBP@%04ld=            %.4f\n",
-              outstr, cutoff[ i ], (1-RBPp)*RBPsum[ maxlen ]/hgain );
+      nev_metric( ctx, ctx->outstr, (1-RBPp)*RBPsum[ maxlen ]/hgain, 4,
+		  "RBP@%04ld=            ", cutoff[ i ] );
       /* 20181003 note that hgain is obtained PER TOPIC */
-      printf( "%s ERR@%04ld=            %.4f\n",
-              outstr, cutoff[ i ], ERR[ maxlen ]);
-      printf( "%s nERR@%04ld=           %.4f\n",
-              outstr, cutoff[ i ], ERR[ maxlen ]/ERRi[ maxlen ]);
+      nev_metric( ctx, ctx->outstr, ERR[ maxlen ], 4,
+		  "ERR@%04ld=            ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, ERR[ maxlen ]/ERRi[ maxlen ], 4,
+		  "nERR@%04ld=           ", cutoff[ i ] );
       /* 2018 */
-      printf( "%s EBR@%04ld=            %.4f\n",
-              outstr, cutoff[ i ], EBR[ maxlen ] );
+      nev_metric( ctx, ctx->outstr, EBR[ maxlen ], 4,
+		  "EBR@%04ld=            ", cutoff[ i ] );
 
       /* In version 180312, ERR@l was included in gcompute but NOT in compute. */
       /* 20180909 RBP@l */
 
       if( (long)count[ maxlen ] > 0 ){
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)1 );
+	nev_metric( ctx, ctx->outstr, (double)1, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
       }
       else{
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)0 );
+	nev_metric( ctx, ctx->outstr, (double)0, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
       }
     }
 
   }
 
-  if( ignore_unjudged ){ /* compute bpref etc */
+  if( ctx->ignore_unjudged ){ /* compute bpref etc */
     
     /* bpref and bpref_R */
     sum = 0.0; sum2 = 0.0;
@@ -1166,8 +1898,8 @@ static int eval_gcompute( int ac, char **av )
       }
 
     }
-    printf( "%s bpref=               %.4f\n", outstr, sum/jrelnum );
-    printf( "%s bpref_R=             %.4f\n", outstr, sum2/jrelnum );
+    nev_metric( ctx, ctx->outstr, sum/jrelnum, 4, "bpref=               " );
+    nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4, "bpref_R=             " );
 
     /* bpref_N and bpref_relative */
     sum = 0.0; sum2 = 0.0;
@@ -1189,8 +1921,8 @@ static int eval_gcompute( int ac, char **av )
 	sum2 += ratio2;
       }
     }
-    printf( "%s bpref_N=             %.4f\n", outstr, sum/jrelnum );
-    printf( "%s bpref_relative=      %.4f\n", outstr, sum2/jrelnum );
+    nev_metric( ctx, ctx->outstr, sum/jrelnum, 4, "bpref_N=             " );
+    nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4, "bpref_relative=      " );
 
     /* rpref_N, rpref_relative and rpref_relative2 */
     sum = 0.0; sum2 = 0.0; sum3 = 0.0;
@@ -1225,15 +1957,11 @@ static int eval_gcompute( int ac, char **av )
     }
 
     /* note: CGi can be used instead of cgi here */
-    printf( "%s rpref_N=             %.4f\n", outstr, sum/CGi[ jrelnum ] );
-    printf( "%s rpref_relative=      %.4f\n", outstr, sum2/CGi[ jrelnum ] );
-    printf( "%s rpref_relative2=     %.4f\n", outstr, sum3/CGi[ jrelnum ] );
+    nev_metric( ctx, ctx->outstr, sum/CGi[ jrelnum ], 4, "rpref_N=             " );
+    nev_metric( ctx, ctx->outstr, sum2/CGi[ jrelnum ], 4, "rpref_relative=      " );
+    nev_metric( ctx, ctx->outstr, sum3/CGi[ jrelnum ], 4, "rpref_relative2=     " );
   }
 
-/* end */
-
-  free( outstr );
-  free( sep );
 
   free( CGi );
   free( DCGi );
@@ -1253,7 +1981,6 @@ static int eval_gcompute( int ac, char **av )
   free( ERR );
   free( ERRdsat );
   free( ERRi );
-  free( ERRidsat );
 
   free( EBR );
 
@@ -1262,7 +1989,7 @@ static int eval_gcompute( int ac, char **av )
 
   return( 0 );
 
-}/* of eval_gcompute */
+}/* of gcompute_run */
 
      
 /******************************************************************************
@@ -1275,16 +2002,21 @@ outputs I-recall
 each reldoc list may contain just docIDs or something extra (these are ignored)
 list may or may not be sorted (makes no difference)
 
+If -alpha is specified, also outputs alpha-nDCG at each cutoff,
+NRBP and nNRBP (Clarke et al. SIGIR08, ICTIR09) with binary
+per-intent relevance. The ideal list for normalisation is constructed greedily
+(see alpha_ideal); with -icache it is kept in a sidecar file and reused
+by later runs.
+
 ******************************************************************************/
-static int eval_irec( int ac, char **av )
+static int eval_irec( struct nev_ctx *ctx, int ac, char **av )
 {
-  FILE *fa[ INTENT_NUMMAX ];
+  FILE **fa = NULL;
   FILE *fs = NULL;
 
   int argc = 2;
   int verbose = 0;
-  int found[ INTENT_NUMMAX ];
-  /* flag indicating whether a reldoc for a particular intent has been found */
+  int use_icache = 0; /* read/write the ideal list sidecar file */
 
   long cutoff[ CUTOFF_NUMMAX ];
   long cutoff_num = 0;
@@ -1292,44 +2024,99 @@ static int eval_irec( int ac, char **av )
   /*  long covered;  intents covered <= intent_num */
   long covered = 0; /* fixed 2016/10/17 to handle empty system files */
   long i, j;
+  long row;
+  long ndocs;      /* number of docs relevant to at least one intent */
+  long syslen;
+  long sgsize = 0; /* allocated size of sg */
+  long k;
+
+  double alpha = 0; /* compute alpha-nDCG and NRBP only if this is specified */
+  double nrbpbeta = DEFAULT_NRBPBETA;
+  double *J = NULL;
+  /* J[ row * intent_num + j ] == 1 iff the doc in row is relevant to intent j.
+     each row is contiguous across intents, as are disc[],
+     so the per-rank updates below are plain loops over intents */
+  double *Jrow;
+  double *disc = NULL; /* (1-alpha)^(#docs ranked so far that cover intent j) */
+  double *sg = NULL;   /* novelty-biased gain at each system rank */
+  double *ig = NULL;   /* ditto for the ideal list */
+  double gain;
+  double sum, sum2, isum, isum2;
+  double power;
 
   char line[ BUFSIZ + 1 ];
   char *pos;
   char *buf, *p;
+  char **relfile = NULL; /* reldoc list files */
+  char *saveptr; /* for strtok_r */
 
-  struct strlist *rellist[ INTENT_NUMMAX ];
+  struct strlist **rellist = NULL;
   /* list of reldocs for each intent */
 
-  int strlistmatch();
+  struct strhash relhash;
+  /* docID -> row of J */
+
+  struct bitset found;
+  /* flag indicating whether a reldoc for a particular intent has been found */
+
+  FILE *arc_open();
   int fprintstrlist();
-  int freestrlist();
   long firstfield2strlist();
-
-  for( i = 0; i < INTENT_NUMMAX; i++ ){
-    fa[ i ] = NULL;
-    found[ i ] = 0;
-    rellist[ i ] = NULL;
-  }
+  long rellist2jmatrix();
+  int load_alpha_ideal();
+  int strhash_init();
+  long strhash_get();
+  int strhash_free();
+  int bitset_init();
+  int bitset_set();
+  int bitset_free();
+  FILE *gzin_fopen();
 
   while( argc < ac ){
     
     if( strcmp( av[ argc ], OPTSTR_OUTSTR ) == 0 && ( argc + 1 < ac ) ){
-      outstr = strdup( av[ argc + 1 ] );
+      ctx->outstr = strdup( av[ argc + 1 ] );
       argc += 2;
     }
     else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
+      ctx->sep = strdup( av[ argc + 1 ] );
       argc += 2;
     }
     else if( strcmp( av[ argc ], OPTSTR_VERBOSE ) == 0 ){
       verbose = 1;
       argc++;
     }
+    else if( strcmp( av[ argc ], OPTSTR_ALPHA ) == 0 && ( argc + 1 < ac ) ){
+      alpha = atof( av[ argc + 1 ] );
+      if( alpha > 1 ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_ALPHA );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_ICACHE ) == 0 ){
+      use_icache = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_NRBPBETA ) == 0 && ( argc + 1 < ac ) ){
+      nrbpbeta = atof( av[ argc + 1 ] );
+      if( nrbpbeta <= 0 || nrbpbeta > 1 ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_NRBPBETA );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
     else if( strcmp( av[ argc ], OPTSTR_CUTOFF ) == 0 && ( argc + 1 < ac ) ){
 
       buf = strdup( av[ argc + 1 ] );
       cutoff_num = 0;
-      if( ( p = strtok( buf, "," ) ) == NULL ){
+      if( ( p = strtok_r( buf, ",", &saveptr ) ) == NULL ){
 
 #ifdef OUTERR
         fprintf( stderr, "strtok failed\n" );
@@ -1346,13 +2133,13 @@ static int eval_irec( int ac, char **av )
 #endif
           return( -1 );
 	}
-      }while( ( p = strtok( NULL, "," ) ) != NULL );
+      }while( ( p = strtok_r( NULL, ",", &saveptr ) ) != NULL );
 
       free( buf );
       argc += 2;
     }
     else{ /* system list */
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
+      if( ( fs = arc_open( ctx, NULL, av[ argc ] ) ) == NULL ){
 
 #ifdef OUTERR
         fprintf( stderr, "Cannot open %s\n", av[ 2 ] );
@@ -1364,11 +2151,11 @@ static int eval_irec( int ac, char **av )
     }
   }
 
-  if( outstr == NULL ){
-    outstr = strdup( "" );
+  if( ctx->outstr == NULL ){
+    ctx->outstr = strdup( "" );
   }
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
   }
 
   if( cutoff_num == 0 ){
@@ -1376,18 +2163,26 @@ static int eval_irec( int ac, char **av )
     cutoff[ 0 ] = DEFAULT_CUTOFF;
   }
 
-  /* open rel files for each intent */
-  j = argc;
-  for( argc = j; argc < ac; argc++ ){
-    i = argc - j;
-    if( i >= INTENT_NUMMAX ){
+  /* open rel files for each intent: the rest of the arguments */
+  if( argc < ac ){
+
+    if( ( fa = ( FILE ** )calloc( ac - argc, sizeof( FILE * ) ) ) == NULL ||
+	( rellist = ( struct strlist ** )
+	  calloc( ac - argc, sizeof( struct strlist * ) ) ) == NULL ){
+
 #ifdef OUTERR
-      fprintf( stderr, "too many rel files\n" );
+      fprintf( stderr, "calloc failed\n" );
 #endif
-        return( -1 );
+      return( -1 );
     }
+  }
+
+  j = argc;
+  relfile = av + j;
+  for( argc = j; argc < ac; argc++ ){
+    i = argc - j;
 
-    if( ( fa[ i ] = fopen( av[ argc ], "r" ) ) == NULL ){
+    if( ( fa[ i ] = gzin_fopen( av[ argc ] ) ) == NULL ){
 
 #ifdef OUTERR
       fprintf( stderr, "Cannot open %s\n", av[ argc ] );
@@ -1400,17 +2195,20 @@ static int eval_irec( int ac, char **av )
   if( fs == NULL || intent_num == 0 ){
 #ifdef OUTERR
     fprintf( stderr,
-	     "Usage: %s %s [%s <cutoff,...>] [%s <separator>] [%s <outstr>] [%s] <system ranked list> <rellist for intent1>...\n",
-	     av[ 0 ], av[ 1 ], OPTSTR_CUTOFF, OPTSTR_SEP, OPTSTR_OUTSTR, OPTSTR_VERBOSE );
+	     "Usage: %s %s [%s <cutoff,...>] [%s <separator>] [%s <outstr>] [%s] [%s <alpha> [%s <beta>] [%s]] <system ranked list> <rellist for intent1>...\n",
+	     av[ 0 ], av[ 1 ], OPTSTR_CUTOFF, OPTSTR_SEP, OPTSTR_OUTSTR, OPTSTR_VERBOSE,
+	     OPTSTR_ALPHA, OPTSTR_NRBPBETA, OPTSTR_ICACHE );
 #endif
     return( -1 );
   }
 
-  printf( "%s #intent_num=%ld\n", outstr, intent_num );
+  nev_printf( ctx, "%s #intent_num=%ld\n", ctx->outstr, intent_num );
+
+  STATS_PHASE( ctx, STATS_LOADQRELS );
 
   /* store reldocs for each intent (file may contain extra fields but ignore)*/
   for( i = 0; i < intent_num; i++ ){
-    if( firstfield2strlist( fa[ i ], &rellist[ i ] ) < 0 ){
+    if( firstfield2strlist( ctx, fa[ i ], &rellist[ i ] ) < 0 ){
       
 #ifdef OUTERR
       fprintf( stderr, "firstfield2strlist failed\n" );
@@ -1422,10 +2220,48 @@ static int eval_irec( int ac, char **av )
 	  fprintstrlist( stdout, rellist[ i ] ); */
     fclose( fa[ i ] );
   }
+  free( fa );
+
+  /* index reldocs by docID so that each system doc is looked up once
+     rather than matched against every reldoc list */
+  if( strhash_init( &relhash, STRHASH_INITSIZE ) < 0 ||
+      ( ndocs = rellist2jmatrix( rellist, intent_num, &relhash, &J ) ) < 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "rellist2jmatrix failed\n" );
+#endif
+    return( -1 );
+  }
+
+  free( rellist );
+
+  if( alpha > 0 ){
+    if( ( disc = ( double *)malloc( intent_num * sizeof( double ) ) ) == NULL ||
+	( ig = ( double *)calloc( ndocs + 1, sizeof( double ) ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "malloc failed\n" );
+#endif
+      return( -1 );
+    }
+    for( j = 0; j < intent_num; j++ ){
+      disc[ j ] = 1.0;
+    }
+  }
+
+  if( bitset_init( &found, intent_num ) < 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "bitset_init failed\n" );
+#endif
+    return( -1 );
+  }
 
   /* read system file and compute I-recall */
+  STATS_PHASE( ctx, STATS_LABEL );
   i = 1; /* rank */
   while( fgets( line, sizeof( line ), fs ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -1436,46 +2272,72 @@ static int eval_irec( int ac, char **av )
     *pos = '\0';
 
     if( verbose ){
-      printf( "#%s", line );
+      nev_printf( ctx, "#%s", line );
     }
       
-    for( j = 0; j < intent_num; j++ ){
+    if( alpha > 0 && i > sgsize ){
+      sgsize = ( sgsize == 0 ) ? BUFSIZ : 2 * sgsize;
+      if( ( sg = ( double *)realloc( sg, ( sgsize + 1 ) * sizeof( double ) ) )
+	  == NULL ){
 
-      if( strlistmatch( rellist[ j ], line ) ){
-	/* this doc covers intent j */
-	found[ j ] = 1;
-	if( verbose ){
-	  printf( " %ld", j + 1 ); /* intent number */
-	}
+#ifdef OUTERR
+	fprintf( stderr, "realloc failed\n" );
+#endif
+	return( -1 );
       }
     }
+    gain = 0.0;
 
-    if( verbose ){
-      printf( "\n" );
-    }
+    STATS_LOOKUP( ctx );
+    if( ( row = strhash_get( &relhash, line ) ) >= 0 ){
 
-    /*    covered = 0; 2016/10/17 now handles empty system files */
+      Jrow = J + row * intent_num;
+      for( j = 0; j < intent_num; j++ ){
 
-    covered = 0; /* 2018/09/22 recovered this to properly compute covered */
-    for( j = 0; j < intent_num; j++ ){
-      if( found[ j ] == 1 ){
-	covered++;
+	if( Jrow[ j ] > 0.0 ){
+	  /* this doc covers intent j */
+	  if( bitset_set( &found, j ) == 0 ){
+	    covered++; /* intent j covered for the first time */
+	  }
+	  if( verbose ){
+	    nev_printf( ctx, " %ld", j + 1 ); /* intent number */
+	  }
+	}
+      }
+
+      if( alpha > 0 ){
+	/* novelty-biased gain: SUM_j J(d,j)(1-alpha)^C(j) */
+	for( j = 0; j < intent_num; j++ ){
+	  gain += Jrow[ j ] * disc[ j ];
+	  disc[ j ] *= 1.0 - alpha * Jrow[ j ];
+	}
       }
     }
 
+    if( alpha > 0 ){
+      sg[ i ] = gain;
+    }
+
+    if( verbose ){
+      nev_printf( ctx, "\n" );
+    }
+
+    /* covered is maintained incrementally above,
+       so an empty system file still yields zero */
+
 
     for( j = 0; j < cutoff_num; j++ ){
       if( i == cutoff[ j ] ){
 
-	printf( "%s I-rec@%04ld=          %.4f\n", outstr, cutoff[ j ],
-		(double)covered/intent_num );
+	nev_metric( ctx, ctx->outstr, (double)covered/intent_num, 4,
+		    "I-rec@%04ld=          ", cutoff[ j ] );
       }
     }
 
     if( i == intent_num ){
 
-      printf( "%s I-rec@n=             %.4f\n", outstr,
-	      (double)covered/intent_num );
+      nev_metric( ctx, ctx->outstr, (double)covered/intent_num, 4,
+		  "I-rec@n=             " );
     }
 
     i++;
@@ -1485,168 +2347,505 @@ static int eval_irec( int ac, char **av )
   for( j = 0; j < cutoff_num; j++ ){
     if( cutoff[ j ] >= i ){ /* cutoff bigger than system size */
 
-      printf( "%s I-rec@%04ld=          %.4f\n", outstr, cutoff[ j ],
-	      (double)covered/intent_num );
+      nev_metric( ctx, ctx->outstr, (double)covered/intent_num, 4,
+		  "I-rec@%04ld=          ", cutoff[ j ] );
     }
   }
 
   if( i <= intent_num ){
     /* I-recall is defined at rank n even if system size is smaller than n */
 
-    printf( "%s I-rec@n=             %.4f\n", outstr,
-	    (double)covered/intent_num );
+    nev_metric( ctx, ctx->outstr, (double)covered/intent_num, 4,
+		"I-rec@n=             " );
+  }
+
+  if( fs != ctx->in ){
+    fclose( fs );
   }
 
-  fclose( fs );
+  if( alpha > 0 ){
 
-  for( i = 0; i < intent_num; i++ ){
-    freestrlist( &rellist[ i ] );
+    STATS_PHASE( ctx, STATS_COMPUTE );
+    syslen = i - 1;
+    STATS_ARRAYS( ctx, 2, ( syslen > ndocs ? syslen : ndocs ) + 1 );
+
+    if( load_alpha_ideal( ctx, relfile, intent_num, J, ndocs, alpha, use_icache,
+			  ig ) < 0 ){
+
+#ifdef OUTERR
+      fprintf( stderr, "load_alpha_ideal failed\n" );
+#endif
+      return( -1 );
+    }
+
+    /* alpha-nDCG@l: log2 discount; both lists are padded with zero gains */
+    for( j = 0; j < cutoff_num; j++ ){
+
+      sum = 0.0; isum = 0.0;
+      for( k = 1; k <= cutoff[ j ]; k++ ){
+	if( k <= syslen ){
+	  sum += sg[ k ] * log( 2 )/log( k + 1 );
+	}
+	if( k <= ndocs ){
+	  isum += ig[ k ] * log( 2 )/log( k + 1 );
+	}
+	if( k > syslen && k > ndocs ){
+	  break;
+	}
+      }
+
+      nev_metric( ctx, ctx->outstr, isum > 0 ? sum/isum : (double)0, 4,
+		  "alpha-nDCG@%04ld=     ", cutoff[ j ] );
+    }
+
+    /* NRBP = (1-(1-alpha)beta)/N SUM_k beta^(k-1) gain(k),
+       nNRBP = NRBP/(NRBP of the ideal list) */
+    sum2 = 0.0;
+    power = 1.0;
+    for( k = 1; k <= syslen; k++ ){
+      sum2 += power * sg[ k ];
+      power *= nrbpbeta;
+    }
+    isum2 = 0.0;
+    power = 1.0;
+    for( k = 1; k <= ndocs; k++ ){
+      isum2 += power * ig[ k ];
+      power *= nrbpbeta;
+    }
+
+    nev_metric( ctx, ctx->outstr,
+		( 1 - ( 1 - alpha ) * nrbpbeta ) * sum2/intent_num, 4,
+		"NRBP=                " );
+    nev_metric( ctx, ctx->outstr, isum2 > 0 ? sum2/isum2 : (double)0, 4,
+		"nNRBP=               " );
   }
 
-  free( outstr );
-  free( sep );
+  strhash_free( &relhash );
+  free( J );
+  free( disc );
+  free( sg );
+  free( ig );
+  bitset_free( &found );
+
   
   return( 0 );
 
 }/* of eval_irec */
 
 /******************************************************************************
-  store_ideal
-
-read ideal ranked output (possibly with judged nonrel docs at bottom) and
-store docIDS with decreasing gain values, preserving the exact order.
-Also set jrel (#judged relevant) and jnonrel (#judged nonrelevant).
-
-returns the highest gain value in ranked output
-for computing RBP, ERR and rpref_N.
+  rellist2jmatrix
 
-each docID MUST be accompanied by a gain value.
+assigns a row to each doc that appears in at least one reldoc list
+(in order of first appearance) and stores the binary intent judgments
+J[ row * intent_num + j ] (1 if the doc is in rellist[ j ], 0 otherwise).
 
-return value: positive highest gain value (OK)
-              nonpositive value (ERROR)
+returns the number of rows (docs)
+return value: >=0 (OK)
+              -1 (ERROR)
 ******************************************************************************/
-double store_ideal( jd, jrel, jnonrel, f )
-     struct strdoublist **jd; /* o */
-     long *jrel;              /* o: R > 0 */
-     long *jnonrel;           /* o: N >= 0 */
-     FILE *f;                 /* i */
+long rellist2jmatrix( rellist, intent_num, h, J )
+     struct strlist **rellist; /* i */
+     long intent_num;          /* i */
+     struct strhash *h;        /* i/o: docID -> row */
+     double **J;               /* o */
 {
-  int i;
-
-  double gv; /* gain value read from ideal file */
-  double hgv = 0.0; /* highest gain value in ideal file to be returned */
+  long j;
+  long row;
+  long ndocs = 0;
+  long size = 0; /* allocated rows */
 
-  char *docid, *p;
-  char line[ BUFSIZ + 1 ];
-  char *pos;
+  struct strlist *p;
 
-  struct strdoublist **pp1, **pp2;
+  long strhash_add();
 
-  struct strdoublist **addtostrdoublist();
+  *J = NULL;
+  for( j = 0; j < intent_num; j++ ){
+    for( p = rellist[ j ]; p != NULL; p = p->next ){
 
-  *jrel = 0;
-  *jnonrel = 0;
+      if( ( row = strhash_add( h, p->string, ndocs ) ) < 0 ){
+	return( -1 );
+      }
 
-  pp1 = jd;
-  while( fgets( line, sizeof( line ), f ) ){
-    if( ( pos = strchr( line, '\n' ) ) == NULL ){
-#ifdef OUTERR   
-      fprintf( stderr, "Line too long: %s\n", line );
-#endif  
-      return( -1 );
-    }
-    *pos = '\0';
-	
-    if( ( p = strtok( line, sep ) ) == NULL ){
+      if( row == ndocs ){ /* new doc */
+	if( ndocs >= size ){
+	  size = ( size == 0 ) ? BUFSIZ : 2 * size;
+	  if( ( *J = ( double *)realloc( *J, size * intent_num * sizeof( double ) ) )
+	      == NULL ){
 
 #ifdef OUTERR
-      fprintf( stderr, "strtok failed: %s\n", line );
+	    fprintf( stderr, "realloc failed\n" );
 #endif
-      return( -1 );
-    }
-    docid = strdup( p );
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+	    return( -1 );
+	  }
+	}
+	memset( *J + ndocs * intent_num, 0, intent_num * sizeof( double ) );
+	ndocs++;
+      }
 
-#ifdef OUTERR
-      fprintf( stderr, "strtok failed: %s\n", p );
-#endif
-      return( -1 );
+      (*J)[ row * intent_num + j ] = 1.0;
     }
+  }
 
-    gv = atof( p );
-    if( gv < 0 ){
+  return( ndocs );
+
+}/* of rellist2jmatrix */
+
+/******************************************************************************
+  alpha_ideal
+
+constructs an ideal ranked list for alpha-nDCG/NRBP greedily:
+at each rank, take the doc with the highest novelty-biased gain
+SUM_j J(d,j)(1-alpha)^C(j), where C(j) is the number of docs ranked
+so far that cover intent j. Ties are broken by row order.
+
+Since gains only decrease as intents get covered, a doc's previously
+computed gain is an upper bound of its current gain.
+So docs are kept in a max-heap keyed by (possibly stale) gains,
+and only the doc at the top is re-evaluated:
+if its current gain still beats the next key, it is taken;
+otherwise its key is lowered and the heap is fixed (lazy greedy).
+Moreover, docs relevant to the same set of intents always have the same
+gain, so only the first unused doc of each such class is in the heap.
+This yields exactly the same list as the naive O(docs^2 x intents) greedy.
+
+ig[ 1..ndocs ] receives the gains of the ideal list.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int alpha_ideal( J, ndocs, intent_num, alpha, ig )
+     double *J;       /* i */
+     long ndocs;      /* i */
+     long intent_num; /* i */
+     double alpha;    /* i */
+     double *ig;      /* o */
+{
+  long r, d, j;
+  long n = 0; /* heap size */
+  long first;
+  long *next; /* next[ d ]: next doc in the class of d (-1 if none) */
+  long *last; /* last[ first ]: last doc so far in the class of first */
+
+  double *disc; /* (1-alpha)^C(j) */
+  double gain;
+  double *Jrow;
+
+  char *pattern; /* intents of a doc as a string of '0'/'1' */
+
+  struct gainheap *heap; /* heap[ 0 ] has the largest key */
+  struct strhash classes; /* pattern -> first doc of the class */
+
+  int gainheap_siftdown();
+  int strhash_init();
+  long strhash_add();
+  int strhash_free();
+
+  if( ( disc = ( double *)malloc( intent_num * sizeof( double ) ) ) == NULL ||
+      ( heap = ( struct gainheap *)malloc( ( ndocs + 1 ) *
+					    sizeof( struct gainheap ) ) )
+      == NULL ||
+      ( next = ( long *)malloc( ( ndocs + 1 ) * sizeof( long ) ) ) == NULL ||
+      ( last = ( long *)malloc( ( ndocs + 1 ) * sizeof( long ) ) ) == NULL ||
+      ( pattern = ( char *)malloc( intent_num + 1 ) ) == NULL ||
+      strhash_init( &classes, STRHASH_INITSIZE ) < 0 ){
 
 #ifdef OUTERR
-      fprintf( stderr, "invalid gain in ideal list\n" );
+    fprintf( stderr, "malloc failed\n" );
 #endif
-      return( -1 );
+    return( -1 );
+  }
+  for( j = 0; j < intent_num; j++ ){
+    disc[ j ] = 1.0;
+  }
+
+  /* group docs into classes (in row order) and
+     put the first doc of each class in the heap:
+     initial gains = number of intents covered */
+  pattern[ intent_num ] = '\0';
+  for( d = 0; d < ndocs; d++ ){
+    Jrow = J + d * intent_num;
+    for( j = 0; j < intent_num; j++ ){
+      pattern[ j ] = ( Jrow[ j ] > 0.0 ) ? '1' : '0';
     }
-    else if( gv == 0.0 ){ /* judged nonrelevant */
-      (*jnonrel)++;
+    if( ( first = strhash_add( &classes, pattern, d ) ) < 0 ){
+      return( -1 );
     }
-    else{ /* judged relevant */
-      (*jrel)++;
 
-      if( hgv < gv ){
-	hgv = gv; /* hgv is kept maximum */
+    next[ d ] = -1;
+    if( first == d ){ /* new class */
+      gain = 0.0;
+      for( j = 0; j < intent_num; j++ ){
+	gain += Jrow[ j ] * disc[ j ];
       }
+      heap[ n ].key = gain;
+      heap[ n ].row = d;
+      n++;
     }
+    else{
+      next[ last[ first ] ] = d;
+    }
+    last[ first ] = d;
+  }
+  strhash_free( &classes );
+  free( pattern );
 
-    if( ( pp2 = addtostrdoublist( pp1, docid, gv ) ) == NULL ){
-	  
-#ifdef OUTERR	  
-      fprintf( stderr, "addtostrdoublist failed\n" );
-#endif
-      return( -1 );
+  for( d = n/2 - 1; d >= 0; d-- ){
+    gainheap_siftdown( heap, n, d );
+  }
+
+  r = 1;
+  while( n > 0 ){
+
+    d = heap[ 0 ].row;
+    Jrow = J + d * intent_num;
+    gain = 0.0;
+    for( j = 0; j < intent_num; j++ ){
+      gain += Jrow[ j ] * disc[ j ];
+    }
+
+    if( gain < heap[ 0 ].key ){ /* stale key */
+      heap[ 0 ].key = gain;
+      gainheap_siftdown( heap, n, 0 );
+      if( heap[ 0 ].row != d ){
+	continue; /* another doc may be better now */
+      }
     }
-    pp1 = pp2;
 
+    /* d is the best doc: replace it with the next doc of its class
+       (whose key is now an upper bound) or remove it from the heap */
+    ig[ r ] = gain;
+    r++;
+    if( next[ d ] >= 0 ){
+      heap[ 0 ].row = next[ d ];
+    }
+    else{
+      n--;
+      heap[ 0 ] = heap[ n ];
+    }
+    gainheap_siftdown( heap, n, 0 );
+
+    for( j = 0; j < intent_num; j++ ){
+      disc[ j ] *= 1.0 - alpha * Jrow[ j ];
+    }
   }
 
-  return( hgv );
-    
-}/* of store_ideal */
+  free( disc );
+  free( heap );
+  free( next );
+  free( last );
+
+  return( 0 );
+
+}/* of alpha_ideal */
 
 /******************************************************************************
-  store_syslist
+  gainheap_siftdown
 
-read system output and
-store docIDs and gain values, preserving the exact order
-(but skip unjudged docs if ignore_unjudged==1)
+restores the max-heap property of heap[ 0..n-1 ] below position i.
+Entries are ordered by key in decreasing order,
+and by row in increasing order for equal keys.
 
-Also return system length, and
-the maximum gain in system list (for preferred rank)
+return value: 0 (OK)
+******************************************************************************/
+int gainheap_siftdown( heap, n, i )
+     struct gainheap *heap; /* i/o */
+     long n;                /* i */
+     long i;                /* i */
+{
+  long c; /* child */
 
-If there are unjudged docs (i.e. ones without gain values),
-zeroes are stored (if ignore_unjudged==0) or
-they are skipped (if ignore_unjudged==1).
+  struct gainheap tmp;
+
+  tmp = heap[ i ];
+  while( ( c = 2 * i + 1 ) < n ){
+
+    if( c + 1 < n &&
+	( heap[ c + 1 ].key > heap[ c ].key ||
+	  ( heap[ c + 1 ].key == heap[ c ].key &&
+	    heap[ c + 1 ].row < heap[ c ].row ) ) ){
+      c++; /* larger child */
+    }
+
+    if( heap[ c ].key > tmp.key ||
+	( heap[ c ].key == tmp.key && heap[ c ].row < tmp.row ) ){
+      heap[ i ] = heap[ c ];
+      i = c;
+    }
+    else{
+      break;
+    }
+  }
+  heap[ i ] = tmp;
+
+  return( 0 );
+
+}/* of gainheap_siftdown */
+
+/******************************************************************************
+  load_alpha_ideal
+
+sets ig[ 1..ndocs ] to the gains of the greedy ideal list for alpha-nDCG/NRBP.
+The ideal list does not depend on the run, so if usefile==1
+it is read from (or, if missing or stale, written to) the sidecar file
+<first rellist with trailing digits removed>AICACHE_SUFFIX.
+The sidecar is stale if alpha, sep, the rellist file names or
+the size/mtime of any rellist differ from what it records.
 
 return value: 0 (OK)
              -1 (ERROR)
 ******************************************************************************/
-int store_syslist( sd, sysl, sysgmax, f )
-struct strdoublist **sd;
-long *sysl;
-double *sysgmax; 
-FILE *f;
+int load_alpha_ideal( ctx, relfile, intent_num, J, ndocs, alpha, usefile, ig )
+     struct nev_ctx *ctx;
+     char **relfile;  /* i: rellist files */
+     long intent_num; /* i */
+     double *J;       /* i */
+     long ndocs;      /* i */
+     double alpha;    /* i */
+     int usefile;     /* i: use sidecar file */
+     double *ig;      /* o */
 {
-  long len;
+  FILE *fc;
 
-  double gv;
+  long i, len;
+  long *finfo; /* (size, mtime) of each rellist */
+  long *cfinfo;
+
+  char *cpath, *tmppath;
+  char *csep;
+
+  struct stat st;
+  struct aicachehead head, chead;
+
+  int alpha_ideal();
+  unsigned long strhash_key();
+
+  if( usefile == 0 ){
+    return( alpha_ideal( J, ndocs, intent_num, alpha, ig ) );
+  }
+
+  len = strlen( relfile[ 0 ] );
+  while( len > 0 && relfile[ 0 ][ len - 1 ] >= '0' &&
+	 relfile[ 0 ][ len - 1 ] <= '9' ){
+    len--;
+  }
+
+  if( ( cpath = ( char *)malloc( len + strlen( AICACHE_SUFFIX ) + 1 ) ) == NULL ||
+      ( tmppath = ( char *)malloc( len + strlen( AICACHE_SUFFIX ) + 32 ) ) == NULL ||
+      ( finfo = ( long *)calloc( 2 * intent_num, sizeof( long ) ) ) == NULL ||
+      ( cfinfo = ( long *)calloc( 2 * intent_num, sizeof( long ) ) ) == NULL ||
+      ( csep = ( char *)calloc( strlen( ctx->sep ) + 1, sizeof( char ) ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+  memcpy( cpath, relfile[ 0 ], len );
+  strcpy( cpath + len, AICACHE_SUFFIX );
+  sprintf( tmppath, "%s.%ld", cpath, (long)getpid() );
+
+  memset( &head, 0, sizeof( head ) );
+  memcpy( head.magic, AICACHE_MAGIC, sizeof( head.magic ) );
+  head.alpha = alpha;
+  head.seplen = strlen( ctx->sep );
+  head.intent_num = intent_num;
+  head.ndocs = ndocs;
+  for( i = 0; i < intent_num; i++ ){
+    head.pathkey = head.pathkey * 31 + strhash_key( relfile[ i ] );
+    if( stat( relfile[ i ], &st ) == 0 ){
+      finfo[ 2 * i ] = (long)st.st_size;
+      finfo[ 2 * i + 1 ] = (long)st.st_mtime;
+    }
+  }
+
+  /* try the sidecar */
+  if( ( fc = fopen( cpath, "rb" ) ) != NULL ){
+
+    if( fread( &chead, sizeof( chead ), 1, fc ) == 1 &&
+	memcmp( &chead, &head, sizeof( head ) ) == 0 &&
+	fread( csep, 1, head.seplen, fc ) == (size_t)head.seplen &&
+	strcmp( csep, ctx->sep ) == 0 &&
+	fread( cfinfo, sizeof( long ), 2 * intent_num, fc )
+	== (size_t)( 2 * intent_num ) &&
+	memcmp( cfinfo, finfo, 2 * intent_num * sizeof( long ) ) == 0 &&
+	fread( ig + 1, sizeof( double ), ndocs, fc ) == (size_t)ndocs &&
+	fgetc( fc ) == EOF ){
+
+      fclose( fc );
+      free( cpath ); free( tmppath ); free( finfo ); free( cfinfo ); free( csep );
+      return( 0 );
+    }
+    fclose( fc );
+  }
+
+  if( alpha_ideal( J, ndocs, intent_num, alpha, ig ) < 0 ){
+    free( cpath ); free( tmppath ); free( finfo ); free( cfinfo ); free( csep );
+    return( -1 );
+  }
+
+  /* write the sidecar under a temporary name and rename it;
+     failures are ignored as the sidecar is only an accelerator */
+  if( ( fc = fopen( tmppath, "wb" ) ) != NULL ){
+
+    if( fwrite( &head, sizeof( head ), 1, fc ) != 1 ||
+	fwrite( ctx->sep, 1, head.seplen, fc ) != (size_t)head.seplen ||
+	fwrite( finfo, sizeof( long ), 2 * intent_num, fc )
+	!= (size_t)( 2 * intent_num ) ||
+	fwrite( ig + 1, sizeof( double ), ndocs, fc ) != (size_t)ndocs ||
+	fclose( fc ) != 0 ||
+	rename( tmppath, cpath ) != 0 ){
+      remove( tmppath );
+    }
+  }
+
+  free( cpath ); free( tmppath ); free( finfo ); free( cfinfo ); free( csep );
+  return( 0 );
+
+}/* of load_alpha_ideal */
+
+/******************************************************************************
+  store_ideal
+
+read ideal ranked output (possibly with judged nonrel docs at bottom) and
+store docIDS with decreasing gain values, preserving the exact order.
+Also set jrel (#judged relevant) and jnonrel (#judged nonrelevant).
+
+returns the highest gain value in ranked output
+for computing RBP, ERR and rpref_N.
+
+each docID MUST be accompanied by a gain value.
+
+return value: positive highest gain value (OK)
+              nonpositive value (ERROR)
+******************************************************************************/
+double store_ideal( ctx, jd, jrel, jnonrel, f )
+     struct nev_ctx *ctx;
+     struct strdoublist **jd; /* o */
+     long *jrel;              /* o: R > 0 */
+     long *jnonrel;           /* o: N >= 0 */
+     FILE *f;                 /* i */
+{
+  int i;
+
+  double gv; /* gain value read from ideal file */
+  double hgv = 0.0; /* highest gain value in ideal file to be returned */
 
   char *docid, *p;
   char line[ BUFSIZ + 1 ];
   char *pos;
+  char *saveptr; /* for strtok_r */
 
   struct strdoublist **pp1, **pp2;
 
   struct strdoublist **addtostrdoublist();
+  char *arena_strdup();
 
-  *sysl = 0;
-  *sysgmax = 0.0;
+  *jrel = 0;
+  *jnonrel = 0;
 
-  pp1 = sd;
+  pp1 = jd;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
       fprintf( stderr, "Line too long: %s\n", line );
@@ -1654,1506 +2853,6480 @@ FILE *f;
       return( -1 );
     }
     *pos = '\0';
-
-    if( ( p = strtok( line, sep ) ) == NULL ){
+	
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR
       fprintf( stderr, "strtok failed: %s\n", line );
 #endif
+      return( -1 );
+    }
+    docid = arena_strdup( &ctx->arena, p );
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
+#ifdef OUTERR
+      fprintf( stderr, "strtok failed: %s\n", p );
+#endif
       return( -1 );
     }
-    docid = strdup( p );
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
-      /* no gv -> unjudged doc */
-      gv = 0.0;
+
+    gv = atof( p );
+    if( gv < 0 ){
+
+#ifdef OUTERR
+      fprintf( stderr, "invalid gain in ideal list\n" );
+#endif
+      return( -1 );
     }
-    else{ /* judged doc */
-      gv = atof( p );
+    else if( gv == 0.0 ){ /* judged nonrelevant */
+      (*jnonrel)++;
     }
+    else{ /* judged relevant */
+      (*jrel)++;
 
-    if( ( ignore_unjudged == 1 && p != NULL ) || /* judged doc */
-	( ignore_unjudged == 0 ) ){
+      if( hgv < gv ){
+	hgv = gv; /* hgv is kept maximum */
+      }
+    }
 
-      /* Thus, if ignore_unjudged == 1 and the doc is unjudged,
-	 it is ignored. */
+    if( ( pp2 = addtostrdoublist( &ctx->arena, pp1, docid, gv ) ) == NULL ){
 	  
-      /* add docID and gv to the bottom of the list */
-      if( ( pp2 = addtostrdoublist( pp1, docid, gv ) ) == NULL ){
-
-#ifdef OUTERR
-	fprintf( stderr, "addtostrdoublist failed: %s\n", docid );
+#ifdef OUTERR	  
+      fprintf( stderr, "addtostrdoublist failed\n" );
 #endif
-	return( -1 );
-      }
-      (*sysl)++;
-      if( gv > *sysgmax ){
-	*sysgmax = gv; /* max gain value within system list */
-      }
-      
-      pp1 = pp2;
+      return( -1 );
     }
-    
+    pp1 = pp2;
+
   }
 
-  return( 0 );
+  return( hgv );
+    
+}/* of store_ideal */
 
-}/* of store_syslist */
+/******************************************************************************
+  load_idealcache
+
+returns the ideal-side arrays of gcompute (CGi, DCGi, msDCGi, ERRi
+and GAPisum up to rank jrelnum) for an ideal file.
+
+Entries are kept in memory (ctx->icache), so a process that
+evaluates several runs reads the ideal file only once.
+An entry whose ideal file has changed since is replaced.
+If usefile==1, the arrays are also read from
+(or, if missing or stale, written to) the sidecar file
+<idealfile>ICACHE_SUFFIX, so that separate processes share them too.
+A sidecar is stale if the size or mtime of the ideal file,
+the log base or the separator differ from what it records.
+
+return value: pointer to the cache entry (OK)
+              NULL (ERROR)
+******************************************************************************/
+struct idealcache *load_idealcache( ctx, path, logbase, usefile )
+     struct nev_ctx *ctx;
+     char *path;     /* i: ideal file */
+     double logbase; /* i: for DCGi */
+     int usefile;    /* i: use sidecar file */
+{
+  struct idealcache *ic;
+  struct idealcache **icp;
+  struct stat st;
 
+  char *cpath;
 
-/******************************************************************************
-  eval_label
+  int fill_idealcache();
+  int read_idealcache();
+  int write_idealcache();
+  int free_idealcache();
 
-reads a relevance assessment file and a ranked list of documents;
-outputs a labelled ranked list - one with relevance level tags.
+  if( stat( path, &st ) != 0 ){
 
-Swallows the rel assessment file AS IS - 
-whether the labels are illegal or not is not of its concern.
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", path );
+#endif
+    return( NULL );
+  }
 
-relevance assessment file format:
-<docID> L0
-<docID> L3
-  :
-(May contain empty lines or comments beginning with #. They will be ignored.)  
+  for( icp = &ctx->icache; ( ic = *icp ) != NULL; icp = &ic->next ){
+    if( strcmp( ic->path, path ) == 0 && ic->logbase == logbase &&
+	strcmp( ic->sep, ctx->sep ) == 0 ){
 
-systemfile format:
-<docID>
-<docID>
-  :
+      if( ic->srcsize == (long)st.st_size &&
+	  ic->srcmtime == (long)st.st_mtime ){
+	return( ic );
+      }
+      *icp = ic->next; /* stale */
+      free_idealcache( ic );
+      break;
+    }
+  }
 
-output format (default: judged and unjudged docs):
-<docID> L3
-<docID>
-<docID> L0
-  :
+  if( ( ic = ( struct idealcache *)calloc( 1, sizeof( struct idealcache ) ) )
+      == NULL ||
+      ( cpath = ( char *)malloc( strlen( path ) + strlen( ICACHE_SUFFIX ) + 1 ) )
+      == NULL ){
 
-    or (-j judged docs only)
-<docID> L3
-<docID> L0
-  :
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( NULL );
+  }
+  ic->path = strdup( path );
+  ic->sep = strdup( ctx->sep );
+  ic->logbase = logbase;
+  ic->srcsize = (long)st.st_size;
+  ic->srcmtime = (long)st.st_mtime;
 
+  sprintf( cpath, "%s%s", path, ICACHE_SUFFIX );
 
-April 11: if -e option is used,
-looks for the third field in the rel file, which should 
-represent an Equivalence Class (EC) ID.
-  
-relevance assessment file format:
-<docID> L0 0
-<docID> L3 1
-<docID> L2 1
+  if( usefile == 0 || read_idealcache( ic, cpath ) < 0 ){
 
-If -e is used, only one item per EC is marked as relevant.
+    if( fill_idealcache( ctx, ic ) < 0 ){
+      free_idealcache( ic );
+      free( cpath );
+      return( NULL );
+    }
+    if( usefile ){
+      /* the sidecar is only an accelerator: ignore write failures
+	 (e.g. read-only qrels directories) */
+      write_idealcache( ic, cpath );
+    }
+  }
+  free( cpath );
 
+  ic->next = ctx->icache;
+  ctx->icache = ic;
 
-NOTE: if -e and -j are to be used simultaneously,
-each L0 doc in rel file should have a distinct EC ID.
+  return( ic );
+
+}/* of load_idealcache */
 
+/******************************************************************************
+  fill_idealcache
+
+reads the ideal file ic->path and
+computes the ideal-side arrays up to rank jrelnum.
 
 return value: 0 (OK)
-             -1 (NG)
+             -1 (ERROR)
 ******************************************************************************/
-static int eval_label( int ac, char **av )
+int fill_idealcache( ctx, ic )
+     struct nev_ctx *ctx;
+     struct idealcache *ic; /* i/o */
 {
-  FILE *fa = NULL;
-  FILE *fs = stdin;
-
-  int argc = 2;
-  int match;
+  FILE *fa;
 
-  long truncaterank = 0;
-  /* by default, do not truncate */
   long i;
 
-  char line[ BUFSIZ + 1 ];
-  char *pos;
-  int seen[ EC_NUMMAX ]; /* for ignoring redundant items from same EC */
+  double dsat; /* dissatisfaction prob at rank i-1 for ideal ERR */
 
-  struct strstrlonglist *jdoclabEC = NULL; /* judged doc, label and EC ID */
-  struct strstrlonglist *p;
+  struct strdoublist *ideal = NULL;
+  struct strdoublist *doc;
 
-  long file2strstrlonglist();
-  long file2strstrcountlist();
-  int freestrstrlonglist();
+  struct arenamark mark;
 
-  ignore_unjudged = 0;
-  /* by default, output all docs in system list (=judged + unjudged) */
+  double store_ideal();
+  double orig_dcglog();
+  int arena_mark();
+  int arena_release();
+  FILE *gzin_fopen();
 
-  ec_mode = 0;
-  /* by default, non-EC mode. Each relevant item consititues one EC. */
+  arena_mark( &ctx->arena, &mark );
 
-  while( argc < ac ){
-    if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
-      /* output judged docs only */
-      ignore_unjudged = 1;
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_EC ) == 0 ){
-      /* equivalence class mode */
-      ec_mode = 1;
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
-      truncaterank = atol( av[ argc + 1 ] );
-      if( truncaterank < 1 ){
-
-#ifdef OUTERR
-        fprintf( stderr, "Bad %s value\n", OPTSTR_TRUNCATE );
-#endif
-        return( -1 );
-      }
-      argc += 2;
-    }
-    /* relevance assessment file */
-    else if( strcmp( av[ argc ], OPTSTR_RELFILE ) == 0 && ( argc + 1 < ac ) ){
-      if( ( fa = fopen( av[ argc + 1 ], "r" ) ) == NULL ){
+  if( ( fa = gzin_fopen( ic->path ) ) == NULL ){
 
 #ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
-#endif
-	return( -1 );
-      }
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
-      argc += 2;
-    }
-    /* ranked list file */
-    else{
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
-#ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+    fprintf( stderr, "Cannot open %s\n", ic->path );
 #endif
-	  return( -1 );
-      }
-      argc++;
-    }
+    return( -1 );
   }
-    
-  if( fa == NULL ){
 
-#ifdef OUTERR      
-    fprintf( stderr,
-	     "Usage: %s %s [%s] [%s] [%s <separator>] [%s <rank>] %s <rel_assessment_file> [ranked list file]\n",
-	     av[ 0 ], av[ 1 ],
-	     OPTSTR_IGNORE_UNJUDGED, OPTSTR_EC, OPTSTR_SEP,
-	     OPTSTR_TRUNCATE, OPTSTR_RELFILE );
+  if( ( ic->hgain = store_ideal( ctx, &ideal, &ic->jrelnum, &ic->jnonrelnum, fa ) )
+      <= 0.0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "store_ideal_gains\n" );
 #endif
-    return( 0 );
+    fclose( fa );
+    arena_release( &ctx->arena, &mark );
+    return( -1 );
   }
+  fclose( fa );
 
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
-  }
+  ic->CGi = ( double *)calloc( ic->jrelnum + 1, sizeof( double ) );
+  ic->DCGi = ( double *)calloc( ic->jrelnum + 1, sizeof( double ) );
+  ic->msDCGi = ( double *)calloc( ic->jrelnum + 1, sizeof( double ) );
+  ic->ERRi = ( double *)calloc( ic->jrelnum + 1, sizeof( double ) );
+  ic->GAPisum = ( double *)calloc( ic->jrelnum + 1, sizeof( double ) );
 
-  if( ec_mode ){ /* store relevant items with the EC IDs */
+  if( ic->CGi == NULL || ic->DCGi == NULL || ic->msDCGi == NULL ||
+      ic->ERRi == NULL || ic->GAPisum == NULL ){
 
-    if( file2strstrlonglist( fa, &jdoclabEC ) < 0 ){
 #ifdef OUTERR
-      fprintf( stderr, "file2strstrlonglist failed\n" );
+    fprintf( stderr, "calloc failed\n" );
 #endif
-      return( -1 );
-    }
+    arena_release( &ctx->arena, &mark );
+    return( -1 );
   }
-  else{ /* non-EC mode: store relevant items, ignore EC info */
 
-    if( file2strstrcountlist( fa, &jdoclabEC ) < 0 ){
-#ifdef OUTERR
-      fprintf( stderr, "file2strstrcountlist failed\n" );
-#endif
-      return( -1 );
-    }
-  }
+  dsat = 1;
+  doc = ideal;
+  for( i = 1; i <= ic->jrelnum; i++ ){
 
-  fclose( fa );
+    ic->CGi[ i ] = ic->CGi[ i - 1 ] + doc->val;
+    ic->DCGi[ i ] = ic->DCGi[ i - 1 ] + doc->val/orig_dcglog( ic->logbase, i );
+    /* For MSnDCG, the logbase is irrelevant */
+    ic->msDCGi[ i ] = ic->msDCGi[ i - 1 ] + doc->val/log( i + 1 );
 
-  /* initialise equivalence classes seen so far */
-  if( ec_mode ){
-    for( i = 0; i < EC_NUMMAX; i++ ){
-      seen[ i ] = 0;
-    }
+    /* cheap compared to GAPsum, so always computed */
+    ic->GAPisum[ i ] = ic->GAPisum[ i - 1 ] + doc->val * ( doc->val + 1 );
+
+    ic->ERRi[ i ] = ic->ERRi[ i - 1 ] +
+      ( dsat/i ) * ( doc->val/( ic->hgain+1 ) );
+    dsat = dsat * ( 1 - doc->val/( ic->hgain+1 ) );
+
+    doc = doc->next;
   }
 
-  /* output labelled ranked list */    
+  arena_release( &ctx->arena, &mark );
 
-  i = 1; /* rank */
-  while( fgets( line, sizeof( line ), fs ) ){
-    if( ( pos = strchr( line, '\n' ) ) == NULL ){
-#ifdef OUTERR   
-      fprintf( stderr, "Line too long: %s\n", line );
-#endif  
-      return( -1 );
-    }
-    *pos = '\0';
+  return( 0 );
 
-    match = -1; /* -1: no match; 0: match but redundant; 1: match and new */
-    p = jdoclabEC;
-    while( p ){
+}/* of fill_idealcache */
 
-      if( strcmp( p->string1, line ) == 0 ){ /* match */
+/******************************************************************************
+  read_idealcache
 
-	if( ec_mode ){
+reads the ideal-side arrays from sidecar file cpath
+if it matches ic (source size/mtime, logbase and sep).
 
-	  if( seen[ p->val - 1 ] == 0 ){ /* EC not previously seen */
-	    printf( "%s%s%s%s%ld\n",
-		    line, sep, p->string2, sep, p->val );
-	    /* with rel label and EC ID */
-	    match = 1;
-	    seen[ p->val - 1 ] = 1; /* this class is now already seen */
-	  }
-	  else{ /* EC already seen */
-	    printf( "%s\n", line ); /* regard as nonrelevant */
-	    match = 0;
-	  }
-	  
-	}
-	else{ /* not ec_mode */
-	  printf( "%s%s%s\n", line, sep, p->string2 ); /* with rel label */
-	  match = 1;
-	}
+return value: 0 (OK)
+             -1 (missing, stale or broken sidecar)
+******************************************************************************/
+int read_idealcache( ic, cpath )
+     struct idealcache *ic; /* i/o */
+     char *cpath;           /* i */
+{
+  FILE *fc;
 
-	break;
+  size_t n;
 
-      }
-      p = p->next;
-    }
+  char *csep;
 
-    if( match == -1 ){ /* unjudged */
+  struct icachehead head;
 
-      if( ignore_unjudged == 0 ){ /* not condensed-list mode */
+  int free_idealcache_arrays();
 
-	printf( "%s\n", line );
-      }
-    }
+  if( ( fc = fopen( cpath, "rb" ) ) == NULL ){
+    return( -1 );
+  }
 
-    if( i == truncaterank ){ /* if truncaterank is positive,
-				truncate system output at this rank */
-      break;
-    }
-    i++;
+  if( fread( &head, sizeof( head ), 1, fc ) != 1 ||
+      memcmp( head.magic, ICACHE_MAGIC, sizeof( head.magic ) ) != 0 ||
+      head.srcsize != ic->srcsize || head.srcmtime != ic->srcmtime ||
+      head.logbase != ic->logbase ||
+      head.seplen != (long)strlen( ic->sep ) ||
+      head.jrelnum < 0 || head.hgain <= 0.0 ){
+    fclose( fc );
+    return( -1 );
   }
-  fclose( fs );
 
-  free( sep );
-  freestrstrlonglist( &jdoclabEC );
-  return( 0 );
+  csep = ( char *)calloc( head.seplen + 1, sizeof( char ) );
+  if( csep == NULL ||
+      fread( csep, 1, head.seplen, fc ) != (size_t)head.seplen ||
+      strcmp( csep, ic->sep ) != 0 ){
+    free( csep );
+    fclose( fc );
+    return( -1 );
+  }
+  free( csep );
+
+  ic->jrelnum = head.jrelnum;
+  ic->jnonrelnum = head.jnonrelnum;
+  ic->hgain = head.hgain;
+
+  n = ic->jrelnum + 1;
+  ic->CGi = ( double *)calloc( n, sizeof( double ) );
+  ic->DCGi = ( double *)calloc( n, sizeof( double ) );
+  ic->msDCGi = ( double *)calloc( n, sizeof( double ) );
+  ic->ERRi = ( double *)calloc( n, sizeof( double ) );
+  ic->GAPisum = ( double *)calloc( n, sizeof( double ) );
+
+  if( ic->CGi == NULL || ic->DCGi == NULL || ic->msDCGi == NULL ||
+      ic->ERRi == NULL || ic->GAPisum == NULL ||
+      fread( ic->CGi, sizeof( double ), n, fc ) != n ||
+      fread( ic->DCGi, sizeof( double ), n, fc ) != n ||
+      fread( ic->msDCGi, sizeof( double ), n, fc ) != n ||
+      fread( ic->ERRi, sizeof( double ), n, fc ) != n ||
+      fread( ic->GAPisum, sizeof( double ), n, fc ) != n ||
+      fgetc( fc ) != EOF ){
+    free_idealcache_arrays( ic );
+    fclose( fc );
+    return( -1 );
+  }
 
-}/* of eval_label */
+  fclose( fc );
+  return( 0 );
 
+}/* of read_idealcache */
 
 /******************************************************************************
-  eval_compute
+  write_idealcache
 
-reads a relevance assessment file and a labelled ranked list;
-outputs several different evaluation metric values.
+writes the ideal-side arrays of ic to sidecar file cpath.
+The file is written under a temporary name and then renamed,
+so that concurrent evaluations never see a partial sidecar.
 
-The labels in the system output may be illegal so check.
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int write_idealcache( ic, cpath )
+     struct idealcache *ic; /* i */
+     char *cpath;           /* i */
+{
+  FILE *fc;
 
-If the labelled ranked list is a condensed list,
-use the -j option to compute bpref.
+  size_t n;
 
-relevance assessment file format:
-<docID> L0
-<docID> L3
-  :
+  char *tmppath;
 
-labelled systemfile format:
-<docID> L0
-<docID>
-<docID> L2
- :
+  struct icachehead head;
 
-If -e option is used, the rel file must contain an EC ID in the third field:
-<docID> L3 1
-<docID> L1 1
-<docID> L0 2
- :
-If -e is used,
-the number of ECs is used as the number of relevant items,
-and the highest rel level within each EC is treated as the 
-rel level of that EC.
+  if( ( tmppath = ( char *)malloc( strlen( cpath ) + 32 ) ) == NULL ){
+    return( -1 );
+  }
+  sprintf( tmppath, "%s.%ld", cpath, (long)getpid() );
 
+  if( ( fc = fopen( tmppath, "wb" ) ) == NULL ){
+    free( tmppath );
+    return( -1 );
+  }
 
-NOTE: if -e and -j are to be used simultaneously,
-each L0 doc in rel file should have a distinct EC ID.
-Otherwise jnonrel would be 1.
+  memset( &head, 0, sizeof( head ) );
+  memcpy( head.magic, ICACHE_MAGIC, sizeof( head.magic ) );
+  head.srcsize = ic->srcsize;
+  head.srcmtime = ic->srcmtime;
+  head.logbase = ic->logbase;
+  head.seplen = strlen( ic->sep );
+  head.jrelnum = ic->jrelnum;
+  head.jnonrelnum = ic->jnonrelnum;
+  head.hgain = ic->hgain;
+
+  n = ic->jrelnum + 1;
+  if( fwrite( &head, sizeof( head ), 1, fc ) != 1 ||
+      fwrite( ic->sep, 1, head.seplen, fc ) != (size_t)head.seplen ||
+      fwrite( ic->CGi, sizeof( double ), n, fc ) != n ||
+      fwrite( ic->DCGi, sizeof( double ), n, fc ) != n ||
+      fwrite( ic->msDCGi, sizeof( double ), n, fc ) != n ||
+      fwrite( ic->ERRi, sizeof( double ), n, fc ) != n ||
+      fwrite( ic->GAPisum, sizeof( double ), n, fc ) != n ){
+    fclose( fc );
+    remove( tmppath );
+    free( tmppath );
+    return( -1 );
+  }
 
-20180909: now computes intentwise RBU (but gcompute does not 
-since RBU is designed to be an IA-measure, not a D-measure).
+  if( fclose( fc ) != 0 || rename( tmppath, cpath ) != 0 ){
+    remove( tmppath );
+    free( tmppath );
+    return( -1 );
+  }
+
+  free( tmppath );
+  return( 0 );
 
+}/* of write_idealcache */
+
+/******************************************************************************
+  idealcache2array
+
+returns a new array of maxlen+1 doubles holding a cached ideal-side array
+(indexed 0..jrelnum), with the value at rank jrelnum copied
+to the remaining ranks.
+
+return value: pointer to the array (OK)
+              NULL (ERROR)
 ******************************************************************************/
-static int eval_compute( int ac, char **av )
+double *idealcache2array( a, jrelnum, maxlen )
+     double *a;    /* i */
+     long jrelnum; /* i */
+     long maxlen;  /* i: >= jrelnum */
 {
+  long i;
 
-  FILE *fa = NULL;
-  FILE *fs = stdin;
+  double *b;
 
-  int argc = 2;
-  int verbose = 0;
+  if( ( b = ( double *)malloc( ( maxlen + 1 ) * sizeof( double ) ) ) == NULL ){
+    return( NULL );
+  }
 
-  int compute_gap = 0; /* computing GAP is more expensive
-			than others so omit by default */
+  memcpy( b, a, ( jrelnum + 1 ) * sizeof( double ) );
+  for( i = jrelnum + 1; i <= maxlen; i++ ){
+    b[ i ] = a[ jrelnum ];
+  }
 
-  long i, j;
-  long rlevel;
-  long rlevel2; /* for GAP */
+  return( b );
 
-  long jrelnum;
-  long Xrelnum[ MAXRL_MAX + 1 ]; /* number of X-rel docs */
-  long maxrl_system = 0; /* max rel level in system output: for rp */
-  long maxrl = 0; /* max rel level obtained from gain values */
-  long maxrl_stop = 0; /* max rel level obtained from stop values */
+}/* of idealcache2array */
 
-  long r1 = 0; /* rank of the first correct doc */
-  long rp = 0; /* preferred rank for P-measure and P-plus */
-  long syslen; /* length of system ranked list */
-  long maxlen; /* max( syslen, jrelnum )
-		  where jrelnum is the length of a
-		  minimal ideal ranked output */
-  long minlen; /* min(cutoff, syslen) */
-  long cutoff_num = 0; /* 0 means cutoff was not specified by the user */
-  long cutoff[ CUTOFF_NUMMAX ]; /* cutoff for prec, hit, nDCG... */
+/******************************************************************************
+  free_idealcache_arrays
 
-  double gv[ MAXRL_MAX + 1 ]; /* gain value for an X-relevant doc */
-  double sv[ MAXRL_MAX + 1 ]; /* stop value for an X-relevant doc */
-  double qbeta = DEFAULT_BETA;
-  double gamma = DEFAULT_GAMMA;
-  double logbase = DEFAULT_LOGB;
+return value: 0 (OK)
+******************************************************************************/
+int free_idealcache_arrays( ic )
+     struct idealcache *ic;
+{
+  free( ic->CGi );
+  free( ic->DCGi );
+  free( ic->msDCGi );
+  free( ic->ERRi );
+  free( ic->GAPisum );
+  ic->CGi = ic->DCGi = ic->msDCGi = ic->ERRi = ic->GAPisum = NULL;
 
-  double *CGi, *DCGi, *msDCGi;
-/* (cumulative) gain, discounted (cumulative) gain, 
-   Microsoft's discounted (cumulative) gain for the ideal ranked list */
-  double *Gs, *CGs, *DCGs, *msDCGs;
-/* ditto for system ranked list */
+  return( 0 );
 
-  double *count; /* treat is as a double rather than an integer */
-  double *BR;    /* blended ratio */
-  double *Ss;    /* stop value at a given rank for graded-uniform NCU */
-  double RBPp = DEFAULT_RBP; /* RBP persistence parameter p */
-  double *RBPpower;          /* p^(r-1) */
-  double *RBPsum;            /* SUM g(r)p^(r-1) */
-  double *ERR; /* expected reciprocal rank by Chapelle et al CIKM09 */
-  double *ERRdsat; /* dissatisfaction prob at rank r for ERR */
-  double *ERRi; /* ideal ERR for normalisation */
-  double *ERRidsat;
-  double *EBR; /* expected blended ratio, 2018 */
-  double RBUp = 0; /* RBU p parameter: compute iRBU only if this is specified */
-  double *iRBU;/* intentwise RBU, where RBU is from SIGIR18 */
-  double *GAPsum; /* for computing Robertson GAP */
-  double *GAPisum; /* for GAP@l */
+}/* of free_idealcache_arrays */
 
-  double ratio, ratio2, ratio3;
-  double sum, sum2, sum3;
-  double mini;
-  double penalty;
-  double denom;
+/******************************************************************************
+  free_idealcache
 
-  char *buf, *p;
+frees a single cache entry (not linked to the in-memory list)
 
-  struct strstrlist *sysdoclab = NULL; /* labelled ranked list */
-  struct strstrlist *doc;
-  struct strstrlist *doc2; /* for GAP */
+return value: 0 (OK)
+******************************************************************************/
+int free_idealcache( ic )
+     struct idealcache *ic;
+{
+  int free_idealcache_arrays();
 
-  int compute_usage();
-  int freestrstrlist();
-  long count_judged();
-  long count_ECjudged();
-  long file2strstrlist2();
-  long lab2level();
-  double orig_dcglog();
+  free_idealcache_arrays( ic );
+  free( ic->path );
+  free( ic->sep );
+  free( ic );
 
-  ignore_unjudged = 0;
-  /* by default, assume that system list contains unjudged docs.
-     if ignore_unjudged == 1, assume that system list is a condensed list,
-     so output bpref. */
+  return( 0 );
 
-  ec_mode = 0;
-  /* by default, every relevant item is treated as one EC. */
+}/* of free_idealcache */
 
-  while( argc < ac ){
+/******************************************************************************
+  store_syslist
 
-    if( strcmp( av[ argc ], OPTSTR_HELP ) == 0 ){
-      return( compute_usage( ac, av ) );
-    }
-    else if( strcmp( av[ argc ], OPTSTR_VERBOSE ) == 0 ){
-      verbose = 1;
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_GAP ) == 0 ){
-      compute_gap = 1;
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
-      ignore_unjudged = 1; /* input contains judged docs only
-			      so output bref etc. */
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_EC ) == 0 ){
-      ec_mode = 1; /* equivalence class mode */
+read system output and
+store docIDs and gain values, preserving the exact order
+(but skip unjudged docs if ignore_unjudged==1)
+
+Also return system length, and
+the maximum gain in system list (for preferred rank)
+
+If there are unjudged docs (i.e. ones without gain values),
+zeroes are stored (if ignore_unjudged==0) or
+they are skipped (if ignore_unjudged==1).
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int store_syslist( ctx, sd, sysl, sysgmax, f )
+struct nev_ctx *ctx;
+struct strdoublist **sd;
+long *sysl;
+double *sysgmax; 
+FILE *f;
+{
+  long len;
+
+  double gv;
+
+  char *docid, *p;
+  char line[ BUFSIZ + 1 ];
+  char *pos;
+  char *saveptr; /* for strtok_r */
+
+  struct strdoublist **pp1, **pp2;
+
+  struct strdoublist **addtostrdoublist();
+  char *arena_strdup();
+
+  *sysl = 0;
+  *sysgmax = 0.0;
+
+  pp1 = sd;
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR   
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif  
+      return( -1 );
+    }
+    *pos = '\0';
+
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "strtok failed: %s\n", line );
+#endif
+
+      return( -1 );
+    }
+    docid = arena_strdup( &ctx->arena, p );
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
+      /* no gv -> unjudged doc */
+      gv = 0.0;
+    }
+    else{ /* judged doc */
+      gv = atof( p );
+    }
+
+    if( ( ctx->ignore_unjudged == 1 && p != NULL ) || /* judged doc */
+	( ctx->ignore_unjudged == 0 ) ){
+
+      /* Thus, if ignore_unjudged == 1 and the doc is unjudged,
+	 it is ignored. */
+	  
+      /* add docID and gv to the bottom of the list */
+      if( ( pp2 = addtostrdoublist( &ctx->arena, pp1, docid, gv ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "addtostrdoublist failed: %s\n", docid );
+#endif
+	return( -1 );
+      }
+      (*sysl)++;
+      if( gv > *sysgmax ){
+	*sysgmax = gv; /* max gain value within system list */
+      }
+      
+      pp1 = pp2;
+    }
+    
+  }
+
+  return( 0 );
+
+}/* of store_syslist */
+
+
+/******************************************************************************
+  eval_label
+
+reads a relevance assessment file and a ranked list of documents;
+outputs a labelled ranked list - one with relevance level tags.
+
+Swallows the rel assessment file AS IS - 
+whether the labels are illegal or not is not of its concern.
+
+relevance assessment file format:
+<docID> L0
+<docID> L3
+  :
+(May contain empty lines or comments beginning with #. They will be ignored.)  
+
+systemfile format:
+<docID>
+<docID>
+  :
+
+output format (default: judged and unjudged docs):
+<docID> L3
+<docID>
+<docID> L0
+  :
+
+    or (-j judged docs only)
+<docID> L3
+<docID> L0
+  :
+
+
+April 11: if -e option is used,
+looks for the third field in the rel file, which should 
+represent an Equivalence Class (EC) ID.
+  
+relevance assessment file format:
+<docID> L0 0
+<docID> L3 1
+<docID> L2 1
+
+If -e is used, only one item per EC is marked as relevant.
+
+
+NOTE: if -e and -j are to be used simultaneously,
+each L0 doc in rel file should have a distinct EC ID.
+
+
+With -dedupe or -sort, the ranked list is validated as it is read:
+each line is either <docID> [<score>] or a TREC run line
+<topicID> Q0 <docID> <rank> <score> <runname>,
+and only the docID is output. Empty lines are skipped.
+
+-dedupe: a docID seen before in the list is dropped.
+Otherwise a relevant doc returned twice would be counted twice
+by compute (in non-EC mode).
+
+-sort: the list is buffered and re-sorted by score (descending);
+ties are broken by docID (descending, as trec_eval does) and
+lines without a score follow in their original order.
+With -dedupe, the highest-scored occurrence of a docID is kept.
+
+-truncate then counts the docs actually output.
+Lines whose score or rank is not monotone are counted
+(and fixed only with -sort); the counts of fixes are reported to stderr.
+
+return value: 0 (OK)
+             -1 (NG)
+******************************************************************************/
+static int eval_label( struct nev_ctx *ctx, int ac, char **av )
+{
+  FILE *fa = NULL;
+  FILE *fs = ctx->in;
+
+  int argc = 2;
+  int retv = 0;
+  int dedupe = 0;
+  int sortrun = 0;
+
+  long truncaterank = 0;
+  /* by default, do not truncate */
+  long i, j;
+  long n;
+  long nrec = 0;
+  long recsize = 0;
+  long nread = 0;
+  long ndup = 0;      /* counts of fixes for -dedupe/-sort */
+  long nempty = 0;
+  long nunsorted = 0;
+  long ntrunc = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char *pos;
+  char *doc;
+
+  struct strstrlonglist *jdoclabEC = NULL; /* judged doc, label and EC ID */
+
+  struct strhash docs; /* -dedupe: docIDs output so far */
+  struct labelrec *rec = NULL; /* -sort: the buffered ranked list */
+  struct labelrec *tmprec;
+  struct labelrec cur, prev;
+
+  FILE *arc_open();
+  long file2strstrlonglist();
+  long file2strstrcountlist();
+  int genseen_init();
+  int genseen_reset();
+  int strhash_init();
+  long strhash_add();
+  int strhash_free();
+  char *arena_strdup();
+  long label_parse();
+  int label_unsorted();
+  int labelrec_cmp();
+  int label_doc();
+  FILE *gzin_fopen();
+
+  ctx->ignore_unjudged = 0;
+  /* by default, output all docs in system list (=judged + unjudged) */
+
+  ctx->ec_mode = 0;
+  /* by default, non-EC mode. Each relevant item consititues one EC. */
+
+  while( argc < ac ){
+    if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
+      /* output judged docs only */
+      ctx->ignore_unjudged = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_EC ) == 0 ){
+      /* equivalence class mode */
+      ctx->ec_mode = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_DEDUPE ) == 0 ){
+      dedupe = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SORT ) == 0 ){
+      sortrun = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
+      truncaterank = atol( av[ argc + 1 ] );
+      if( truncaterank < 1 ){
+
+#ifdef OUTERR
+        fprintf( stderr, "Bad %s value\n", OPTSTR_TRUNCATE );
+#endif
+        return( -1 );
+      }
+      argc += 2;
+    }
+    /* relevance assessment file */
+    else if( strcmp( av[ argc ], OPTSTR_RELFILE ) == 0 && ( argc + 1 < ac ) ){
+      if( ( fa = gzin_fopen( av[ argc + 1 ] ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    /* ranked list file */
+    else{
+      if( ( fs = arc_open( ctx, NULL, av[ argc ] ) ) == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+#endif
+	  return( -1 );
+      }
       argc++;
     }
-    else if( strcmp( av[ argc ], OPTSTR_OUTSTR ) == 0 && ( argc + 1 < ac ) ){
-      outstr = strdup( av[ argc + 1 ] );
-      argc += 2;
+  }
+    
+  if( fa == NULL ){
+
+#ifdef OUTERR      
+    fprintf( stderr,
+	     "Usage: %s %s [%s] [%s] [%s] [%s] [%s <separator>] [%s <rank>] %s <rel_assessment_file> [ranked list file]\n",
+	     av[ 0 ], av[ 1 ],
+	     OPTSTR_IGNORE_UNJUDGED, OPTSTR_EC, OPTSTR_DEDUPE, OPTSTR_SORT,
+	     OPTSTR_SEP, OPTSTR_TRUNCATE, OPTSTR_RELFILE );
+#endif
+    return( 0 );
+  }
+
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+  if( ctx->ec_mode ){ /* store relevant items with the EC IDs */
+
+    if( file2strstrlonglist( ctx, fa, &jdoclabEC ) < 0 ){
+#ifdef OUTERR
+      fprintf( stderr, "file2strstrlonglist failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+  else{ /* non-EC mode: store relevant items, ignore EC info */
+
+    if( file2strstrcountlist( ctx, fa, &jdoclabEC ) < 0 ){
+#ifdef OUTERR
+      fprintf( stderr, "file2strstrcountlist failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+
+  fclose( fa );
+
+  /* forget the equivalence classes seen by the previous label of this
+     context in O(1); the array is allocated once and grows on demand
+     if EC IDs exceed its size */
+  if( ctx->ec_mode ){
+    if( ctx->ecseen.stamp != NULL ){
+      genseen_reset( &ctx->ecseen );
+    }
+    else if( genseen_init( &ctx->ecseen, GENSEEN_INITSIZE ) < 0 ){
+
+#ifdef OUTERR
+      fprintf( stderr, "genseen_init failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+
+  if( fs == ctx->in && fs != NULL &&
+      ( fs = arc_open( ctx, fs, NULL ) ) == NULL ){
+    return( -1 ); /* -topic: the topic is not in the archive on stdin */
+  }
+
+  if( dedupe && strhash_init( &docs, STRHASH_INITSIZE ) < 0 ){
+    if( fs != ctx->in ){
+      fclose( fs );
+    }
+    return( -1 );
+  }
+  memset( &prev, 0, sizeof( struct labelrec ) );
+
+  /* from here on, errors set retv and leave the loops,
+     so that rec, docs and fs are released below */
+
+  if( sortrun ){ /* read the whole ranked list and re-sort it */
+
+    while( fgets( line, sizeof( line ), fs ) ){
+      STATS_LINE( ctx, line );
+      if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR   
+	fprintf( stderr, "Line too long: %s\n", line );
+#endif  
+	retv = -1;
+	break;
+      }
+      *pos = '\0';
+
+      if( label_parse( ctx, line, &cur ) == 0 ){
+	nempty++;
+	continue;
+      }
+      if( nrec > 0 && label_unsorted( &rec[ nrec - 1 ], &cur ) ){
+	nunsorted++;
+      }
+
+      if( nrec >= recsize ){
+	recsize = ( recsize == 0 ) ? BUFSIZ : 2 * recsize;
+	if( ( tmprec = ( struct labelrec *)
+	      realloc( rec, recsize * sizeof( struct labelrec ) ) ) == NULL ){
+
+#ifdef OUTERR
+	  fprintf( stderr, "realloc failed\n" );
+#endif
+	  retv = -1;
+	  break;
+	}
+	rec = tmprec;
+      }
+      if( ( cur.doc = arena_strdup( &ctx->arena, cur.doc ) ) == NULL ){
+	retv = -1;
+	break;
+      }
+      cur.order = nrec;
+      rec[ nrec++ ] = cur;
+    }
+    if( retv == 0 && nrec > 0 ){
+      qsort( rec, nrec, sizeof( struct labelrec ), labelrec_cmp );
+    }
+  }
+
+  /* output labelled ranked list */    
+  STATS_PHASE( ctx, STATS_LABEL );
+
+  i = 1; /* rank */
+  j = 0; /* -sort: next buffered line */
+  while( retv == 0 ){
+
+    if( sortrun ){
+      if( j >= nrec ){
+	break;
+      }
+      doc = rec[ j++ ].doc;
+    }
+    else{
+      if( fgets( line, sizeof( line ), fs ) == NULL ){
+	break;
+      }
+      STATS_LINE( ctx, line );
+      if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR   
+	fprintf( stderr, "Line too long: %s\n", line );
+#endif  
+	retv = -1;
+	break;
+      }
+      *pos = '\0';
+      doc = line;
+
+      if( dedupe ){ /* validate as the line is read */
+	if( label_parse( ctx, line, &cur ) == 0 ){
+	  nempty++;
+	  continue;
+	}
+	if( nread > 0 && label_unsorted( &prev, &cur ) ){
+	  nunsorted++;
+	}
+	prev = cur;
+	nread++;
+	doc = cur.doc;
+      }
+    }
+
+    if( dedupe ){
+      n = docs.num;
+      if( strhash_add( &docs, doc, n ) < 0 ){
+	retv = -1;
+	break;
+      }
+      if( docs.num == n ){ /* seen before */
+	ndup++;
+	continue;
+      }
+    }
+
+    STATS_LOOKUP( ctx );
+    if( label_doc( ctx, doc, jdoclabEC, &ctx->ecseen ) < -1 ){
+      retv = -1;
+      break;
+    }
+
+    if( i == truncaterank ){ /* if truncaterank is positive,
+				truncate system output at this rank */
+      if( sortrun ){
+	ntrunc = nrec - j;
+      }
+      else if( dedupe ){ /* count the lines left for the report */
+	while( fgets( line, sizeof( line ), fs ) ){
+	  ntrunc++;
+	}
+      }
+      break;
+    }
+    i++;
+  }
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
+
+  if( dedupe ){
+    strhash_free( &docs );
+  }
+  free( rec );
+
+#ifdef OUTERR
+  if( retv == 0 && ndup + nempty + nunsorted + ntrunc > 0 ){
+    fprintf( stderr,
+	     "%s: %ld duplicate docs dropped, %ld empty lines skipped, "
+	     "%ld lines out of order%s, %ld lines truncated\n",
+	     av[ 1 ], ndup, nempty, nunsorted,
+	     sortrun ? " (re-sorted)" : "", ntrunc );
+  }
+#endif
+
+  return( retv );
+
+}/* of eval_label */
+
+/******************************************************************************
+  label_doc
+
+outputs a docID of a ranked list for eval_label:
+with its rel label (and EC ID) if judged;
+as is if unjudged, unless in condensed-list mode.
+
+return value:  1 (match and new)
+               0 (match but redundant: EC already seen)
+              -1 (no match)
+              -2 (ERROR: bad EC ID or out of memory)
+******************************************************************************/
+int label_doc( ctx, doc, jdoclabEC, seen )
+     struct nev_ctx *ctx;
+     char *doc;                          /* i */
+     struct strstrlonglist *jdoclabEC;   /* i: judged doc, label and EC ID */
+     struct genseen *seen;               /* i/o: ECs seen so far (-ec) */
+{
+  int match = -1;
+  int r;
+
+  struct strstrlonglist *p;
+
+  int genseen_set();
+
+  p = jdoclabEC;
+  while( p ){
+
+    if( strcmp( p->string1, doc ) == 0 ){ /* match */
+
+      if( ctx->ec_mode ){
+
+	if( ( r = genseen_set( seen, p->val - 1 ) ) < 0 ){
+#ifdef OUTERR
+	  if( p->val < 1 ){ /* otherwise genseen_set has said why */
+	    fprintf( stderr, "Invalid EC ID %ld for %s\n", p->val, doc );
+	  }
+#endif
+	  return( -2 );
+	}
+	if( r == 0 ){
+	  /* EC not previously seen: this class is now already seen */
+	  nev_printf( ctx, "%s%s%s%s%ld\n",
+		      doc, ctx->sep, p->string2, ctx->sep, p->val );
+	  /* with rel label and EC ID */
+	  match = 1;
+	}
+	else{ /* EC already seen */
+	  nev_printf( ctx, "%s\n", doc ); /* regard as nonrelevant */
+	  match = 0;
+	}
+
+      }
+      else{ /* not ec_mode */
+	nev_printf( ctx, "%s%s%s\n", doc, ctx->sep, p->string2 ); /* with rel label */
+	match = 1;
+      }
+
+      break;
+
+    }
+    p = p->next;
+  }
+
+  if( match == -1 ){ /* unjudged */
+
+    if( ctx->ignore_unjudged == 0 ){ /* not condensed-list mode */
+
+      nev_printf( ctx, "%s\n", doc );
+    }
+  }
+
+  return( match );
+
+}/* of label_doc */
+
+/******************************************************************************
+  label_parse
+
+parses a line of a ranked list for label -dedupe/-sort:
+<docID> [<score>] or a TREC run line
+<topicID> Q0 <docID> <rank> <score> <runname>.
+line is modified; r->doc points into it.
+
+return value: number of fields (0: empty line)
+******************************************************************************/
+long label_parse( ctx, line, r )
+     struct nev_ctx *ctx;
+     char *line;          /* i/o */
+     struct labelrec *r;  /* o */
+{
+  long nf;
+
+  char *fld[ 5 ];
+  char *s = NULL;
+  char *end;
+
+  long splitfields();
+
+  r->score = 0.0;
+  r->scored = 0;
+  r->rank = 0;
+  r->order = 0;
+
+  if( ( nf = splitfields( ctx, line, fld, 5 ) ) == 0 ){
+    return( 0 );
+  }
+  if( nf >= 5 ){ /* TREC run line */
+    r->doc = fld[ 2 ];
+    r->rank = atol( fld[ 3 ] );
+    s = fld[ 4 ];
+  }
+  else{
+    r->doc = fld[ 0 ];
+    if( nf >= 2 ){
+      s = fld[ 1 ];
+    }
+  }
+
+  if( s != NULL ){
+    r->score = strtod( s, &end );
+    /* NaN or not a number: no score */
+    r->scored = ( end != s && *end == '\0' && r->score == r->score );
+  }
+
+  return( nf );
+
+}/* of label_parse */
+
+/******************************************************************************
+  label_unsorted
+
+return value: 1 (line y cannot follow line x in a ranked list:
+                 a higher score, a rank not above that of x,
+                 or a score after a line without one)
+              0 (OK)
+******************************************************************************/
+int label_unsorted( x, y )
+     struct labelrec *x;
+     struct labelrec *y;
+{
+  if( x->scored != y->scored ){
+    return( y->scored );
+  }
+  if( x->scored && y->score > x->score ){
+    return( 1 );
+  }
+
+  return( x->rank > 0 && y->rank > 0 && y->rank <= x->rank );
+
+}/* of label_unsorted */
+
+int labelrec_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  const struct labelrec *x = ( const struct labelrec *)a;
+  const struct labelrec *y = ( const struct labelrec *)b;
+  int c;
+
+  if( x->scored != y->scored ){ /* scored lines first */
+    return( y->scored - x->scored );
+  }
+  if( x->scored ){
+    if( x->score != y->score ){
+      return( x->score < y->score ? 1 : -1 );
+    }
+    if( ( c = strcmp( y->doc, x->doc ) ) != 0 ){
+      return( c );
+    }
+  }
+  return( x->order < y->order ? -1 : x->order > y->order );
+}
+
+
+/******************************************************************************
+  eval_compute
+
+reads a relevance assessment file and a labelled ranked list;
+outputs several different evaluation metric values.
+
+The labels in the system output may be illegal so check.
+
+If the labelled ranked list is a condensed list,
+use the -j option to compute bpref.
+
+relevance assessment file format:
+<docID> L0
+<docID> L3
+  :
+
+labelled systemfile format:
+<docID> L0
+<docID>
+<docID> L2
+ :
+
+If -e option is used, the rel file must contain an EC ID in the third field:
+<docID> L3 1
+<docID> L1 1
+<docID> L0 2
+ :
+If -e is used,
+the number of ECs is used as the number of relevant items,
+and the highest rel level within each EC is treated as the 
+rel level of that EC.
+
+
+NOTE: if -e and -j are to be used simultaneously,
+each L0 doc in rel file should have a distinct EC ID.
+Otherwise jnonrel would be 1.
+
+20180909: now computes intentwise RBU (but gcompute does not 
+since RBU is designed to be an IA-measure, not a D-measure).
+
+If -r is not given, the rel assessments are read from ctx->rel
+(set by stream for each topic).
+
+******************************************************************************/
+static int eval_compute( struct nev_ctx *ctx, int ac, char **av )
+{
+
+  FILE *fa = ctx->rel;
+  FILE *fs = ctx->in;
+
+  int argc = 2;
+  int verbose = 0;
+
+  int compute_gap = 0; /* computing GAP is more expensive
+			than others so omit by default */
+
+  long i, j;
+  long rlevel;
+  long rlevel2; /* for GAP */
+
+  long jrelnum;
+  long Xrelnum[ MAXRL_MAX + 1 ]; /* number of X-rel docs */
+  long maxrl_system = 0; /* max rel level in system output: for rp */
+  long maxrl = 0; /* max rel level obtained from gain values */
+  long maxrl_stop = 0; /* max rel level obtained from stop values */
+
+  long r1 = 0; /* rank of the first correct doc */
+  long rp = 0; /* preferred rank for P-measure and P-plus */
+  long syslen; /* length of system ranked list */
+  long maxlen; /* max( syslen, jrelnum )
+		  where jrelnum is the length of a
+		  minimal ideal ranked output */
+  long minlen; /* min(cutoff, syslen) */
+  long cutoff_num = 0; /* 0 means cutoff was not specified by the user */
+  long cutoff[ CUTOFF_NUMMAX ]; /* cutoff for prec, hit, nDCG... */
+
+  double gv[ MAXRL_MAX + 1 ]; /* gain value for an X-relevant doc */
+  double sv[ MAXRL_MAX + 1 ]; /* stop value for an X-relevant doc */
+  double qbeta = DEFAULT_BETA;
+  double gamma = DEFAULT_GAMMA;
+  double logbase = DEFAULT_LOGB;
+
+  double *CGi, *DCGi, *msDCGi;
+/* (cumulative) gain, discounted (cumulative) gain, 
+   Microsoft's discounted (cumulative) gain for the ideal ranked list */
+  double *Gs, *CGs, *DCGs, *msDCGs;
+/* ditto for system ranked list */
+
+  double *count; /* treat is as a double rather than an integer */
+  double *BR;    /* blended ratio */
+  double *Ss;    /* stop value at a given rank for graded-uniform NCU */
+  double RBPp = DEFAULT_RBP; /* RBP persistence parameter p */
+  double *RBPpower;          /* p^(r-1) */
+  double *RBPsum;            /* SUM g(r)p^(r-1) */
+  double *ERR; /* expected reciprocal rank by Chapelle et al CIKM09 */
+  double *ERRdsat; /* dissatisfaction prob at rank r for ERR */
+  double *ERRi; /* ideal ERR for normalisation */
+  double *ERRidsat;
+  double *EBR; /* expected blended ratio, 2018 */
+  double RBUp = 0; /* RBU p parameter: compute iRBU only if this is specified */
+  double *iRBU;/* intentwise RBU, where RBU is from SIGIR18 */
+  double *GAPsum; /* for computing Robertson GAP */
+  double *GAPisum; /* for GAP@l */
+
+  double ratio, ratio2, ratio3;
+  double sum, sum2, sum3;
+  double mini;
+  double penalty;
+  double denom;
+
+  char *buf, *p;
+  char *saveptr; /* for strtok_r */
+
+  struct strstrlist *sysdoclab = NULL; /* labelled ranked list */
+  struct strstrlist *doc;
+  struct strstrlist *doc2; /* for GAP */
+
+  FILE *arc_open();
+  FILE *gzin_fopen();
+  int compute_usage();
+  long count_judged();
+  long count_ECjudged();
+  long file2strstrlist2();
+  long lab2level();
+  double orig_dcglog();
+
+  ctx->ignore_unjudged = 0;
+  /* by default, assume that system list contains unjudged docs.
+     if ignore_unjudged == 1, assume that system list is a condensed list,
+     so output bpref. */
+
+  ctx->ec_mode = 0;
+  /* by default, every relevant item is treated as one EC. */
+
+  while( argc < ac ){
+
+    if( strcmp( av[ argc ], OPTSTR_HELP ) == 0 ){
+      return( compute_usage( ac, av ) );
+    }
+    else if( strcmp( av[ argc ], OPTSTR_VERBOSE ) == 0 ){
+      verbose = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_GAP ) == 0 ){
+      compute_gap = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
+      ctx->ignore_unjudged = 1; /* input contains judged docs only
+			      so output bref etc. */
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_EC ) == 0 ){
+      ctx->ec_mode = 1; /* equivalence class mode */
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_OUTSTR ) == 0 && ( argc + 1 < ac ) ){
+      ctx->outstr = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_RELFILE ) == 0 && ( argc + 1 < ac ) ){
+      if( ( fa = gzin_fopen( av[ argc + 1 ] ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
+#endif
+	return( -1 );
+      }
+
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_BETA ) == 0 && ( argc + 1 < ac ) ){
+      qbeta = atof( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_GAMMA ) == 0 && ( argc + 1 < ac ) ){
+      gamma = atof( av[ argc + 1 ] );
+      if( gamma > 1 ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_GAMMA );
+#endif
+	return( -1 );
+      }
+
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_LOGB ) == 0 && ( argc + 1 < ac ) ){
+      logbase = atof( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_RBP ) == 0 && ( argc + 1 < ac ) ){
+      RBPp = atof( av[ argc + 1 ] );
+      if( RBPp > 1 ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_RBP );
+#endif
+	return( -1 );
+      }
+
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_RBUP ) == 0 && ( argc + 1 < ac ) ){
+      RBUp = atof( av[ argc + 1 ] );
+      if( RBUp > 1 ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_RBUP );
+#endif
+	return( -1 );
+      }
+
+      /* compute iRBU only if RBUp (> 0) is specified */
+
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_CUTOFF ) == 0 && ( argc + 1 < ac ) ){
+
+      buf = strdup( av[ argc + 1 ] );
+      cutoff_num = 0;
+      if( ( p = strtok_r( buf, ",", &saveptr ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "strtok failed\n" );
+#endif
+	return( -1 );
+      }
+      do{
+	cutoff[ cutoff_num ] = atof( p );
+	cutoff_num++;
+	if( cutoff_num >= CUTOFF_NUMMAX ){
+
+#ifdef OUTERR
+	  fprintf( stderr, "Too many cutoffs\n" );
+#endif
+	  return( -1 );
+	}
+
+      }while( ( p = strtok_r( NULL, ",", &saveptr ) ) != NULL );
+	
+      free( buf );
+      argc += 2;
+    }
+    /* user specified gain values (REQUIRED):
+       input format: -g 1:2:3 least relevant first
+       (maxrl is obtained from this) */
+    else if( strcmp( av[ argc ], OPTSTR_GAIN ) == 0 && ( argc + 1 < ac ) ){
+
+      buf = strdup( av[ argc + 1 ] );
+      maxrl = 0;
+      if( ( p = strtok_r( buf, RLEVEL_RLEVEL_SEP, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "strtok failed\n" );
+#endif
+	return( -1 );
+
+      }
+      do{
+	maxrl++;
+	if( maxrl > MAXRL_MAX ){
+
+#ifdef OUTERR
+	  fprintf( stderr, "maxrl overflow\n" );
+#endif
+	  return( -1 );
+
+	}
+
+	gv[ maxrl ] = atof( p );
+		
+      }while( ( p = strtok_r( NULL, RLEVEL_RLEVEL_SEP, &saveptr ) ) != NULL );
+
+      free( buf );
+      argc += 2;
+	  
+    }
+    /* user specified stop values (NOT REQUIRED):
+       input format: -s 1:2:3 least relevant first */
+    else if( strcmp( av[ argc ], OPTSTR_STOP ) == 0 && ( argc + 1 < ac ) ){
+      
+      buf = strdup( av[ argc + 1 ] );
+      maxrl_stop = 0;
+      if( ( p = strtok_r( buf, RLEVEL_RLEVEL_SEP, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR	  
+	fprintf( stderr, "strtok failed\n" );
+#endif
+	return( -1 );
+
+      }
+
+      do{
+	maxrl_stop++;
+	if( maxrl_stop > MAXRL_MAX ){
+
+#ifdef OUTERR	    
+	  fprintf( stderr, "maxrl_stop overflow\n" );
+#endif
+	  return( -1 );
+
+	}
+	sv[ maxrl_stop ] = atof( p );
+
+	if( sv[ maxrl_stop ] == 0.0 ){
+
+#ifdef OUTERR
+	  fprintf( stderr, "stop value must be positive\n" );
+#endif
+	  return( -1 );
+	}
+	  
+      }while( ( p = strtok_r( NULL, RLEVEL_RLEVEL_SEP, &saveptr ) ) != NULL );
+
+      free( buf );
+      argc += 2;
+      
+    }
+    /* labelled system file */
+    else{
+      if( ( fs = arc_open( ctx, NULL, av[ argc ] ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+#endif
+	return( -1 );
+
+      }
+      argc++;
+    }
+  }
+
+  ctx->rel = NULL; /* fa is closed below */
+
+  if( fa == NULL || maxrl == 0 ){ /* rel file and gain values are required */
+    return( compute_usage( ac, av ) );
+  }
+
+  if( fs == ctx->in && fs != NULL &&
+      ( fs = arc_open( ctx, fs, NULL ) ) == NULL ){
+    return( -1 ); /* -topic: the topic is not in the archive on stdin */
+  }
+
+  if( ctx->outstr == NULL ){
+    ctx->outstr = strdup( "" );
+  }
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+
+
+  /* L0-relevant (judged nonrel) docs */
+  gv[ 0 ] = 0;
+  sv[ 0 ] = 0;
+
+  if( maxrl_stop == 0 ){ /* stop values not specified -> copy gain values */
+    
+    for( i = 1; i <= maxrl; i++ ){
+      sv[ i ] = gv[ i ];
+    }
+
+  }
+  else if( maxrl_stop != maxrl ){ /* number of rel levels do not match */
+
+#ifdef OUTERR
+    fprintf( stderr, "gain/stop rel levels mismatch\n" );
+#endif
+    return( -1 );
+
+  }
+
+  /* so now maxrl_stop == maxrl */
+
+  /* check that gain/stop values for lower relevance levels are lower */
+  for( i = 1; i <= maxrl; i++ ){
+    for( j = i + 1; j <= maxrl; j++ ){
+      if( gv[ i ] > gv[ j ] || sv[ i ] > sv[ j ] ){
+
+#ifdef OUTERR
+	fprintf( stderr, "Bad gain/stop values\n" );
+#endif
+	return( -1 );
+
+      }
+    }
+  }
+
+  if( verbose ){
+    for( i = 0; i <= maxrl; i++ ){
+      nev_printf( ctx, "# gain[ %ld ]=%f stop[ %ld ]=%f\n", i, gv[ i ], i, sv[ i ] );
+    }
+  }
+
+  /* if cutoff is not specified, use default */
+  if( cutoff_num == 0 ){
+    cutoff_num = 1;
+    cutoff[ 0 ] = DEFAULT_CUTOFF;
+  }
+
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+  /* set Xrelnum[], jrelnum and jnonrelnum */
+  if( ctx->ec_mode ){
+
+    if( ( jrelnum = count_ECjudged( ctx, maxrl, Xrelnum, fa ) ) < 0 ){
+
+#ifdef OUTERR
+      fprintf( stderr, "count_ECjudged failed\n" );
+#endif
+      return( -1 );
+    }
+
+  }
+  else{ /* not ec_mode */
+
+    if( ( jrelnum = count_judged( ctx, maxrl, Xrelnum, fa ) ) < 0 ){
+
+#ifdef OUTERR
+      fprintf( stderr, "count_judged failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+
+  fclose( fa );
+
+  if( jrelnum == 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "no rel doc\n" );
+#endif
+    return( -1 );
+  }
+
+  if( ( ctx->ignore_unjudged == 1 ) && ( Xrelnum[ 0 ] == 0 ) ){
+
+#ifdef OUTERR
+    fprintf( stderr,
+             "no judged nonrel: bpref etc. not computable\n" );
+#endif
+    return( -1 );
+  }
+
+  STATS_PHASE( ctx, STATS_LOADRUN );
+
+  /* store system output with labels */
+  if( ( syslen = file2strstrlist2( ctx, fs, &sysdoclab ) ) < 0 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "file2strstrlist2 failed\n" );
+#endif
+    return( -1 );
+  }
+
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
+
+  STATS_PHASE( ctx, STATS_COMPUTE );
+
+  nev_printf( ctx, "%s # syslen=%ld jrel=%ld jnonrel=%ld\n",
+	  ctx->outstr, syslen, jrelnum, Xrelnum[ 0 ] );
+
+  /* maxlen = max( jrelnum, syslen ) */
+  maxlen = jrelnum;
+  if( maxlen < syslen ){
+    maxlen = syslen;
+  }
+  STATS_ARRAYS( ctx, 17 + ( RBUp > 0 ) + 2 * compute_gap, maxlen + 1 );
+
+  CGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  DCGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  msDCGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  Gs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  CGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  DCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  msDCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  count = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  BR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  Ss = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  RBPpower = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  RBPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  ERR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  ERRdsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  ERRi = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  ERRidsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  /* 2018 EBR */
+  EBR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+
+  /* intentwise RBU */
+  if( RBUp > 0 ){ /* RBUp has been specified */
+    iRBU = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  }
+
+  if( compute_gap ){
+    GAPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+    GAPisum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  }
+
+  /* Store ideal cumulative gain etc. */
+
+  ERRi[ 0 ] = 0;
+  ERRidsat[ 0 ] = 1;
+
+  /* koko */
+  
+  i = 1;
+  for( rlevel = maxrl; rlevel >= 1; rlevel-- ){
+    
+    for( j = 1;  j <= Xrelnum[ rlevel ]; j++ ){
+
+      CGi[ i ] = CGi[ i - 1 ] + gv[ rlevel ];
+      DCGi[ i ] = DCGi[ i - 1 ] + gv[ rlevel ]/orig_dcglog( logbase, i );
+      /* For MSnDCG, the logbase is irrelevant */
+      msDCGi[ i ] = msDCGi[ i - 1 ] + gv[ rlevel ]/log( i + 1 );
+
+      if( compute_gap ){
+	GAPisum[ i ] = GAPisum[ i - 1 ] + rlevel * ( rlevel + 1 );
+      }
+
+      ERRi[ i ] = ERRi[ i - 1 ] + ( ERRidsat[ i - 1 ]/i ) * ( gv[ rlevel ]/( gv[ maxrl ]+1 ) );
+      ERRidsat[ i ] = ERRidsat[ i - 1 ] * ( 1 - gv[ rlevel ]/( gv[ maxrl ]+1 ) );
+
+      i++;
+    }
+  }
+  for( i = jrelnum + 1; i <= maxlen; i++ ){ /* if ideal size < system size */
+    CGi[ i ] = CGi[ jrelnum ];
+    DCGi[ i ] = DCGi[ jrelnum ];
+    msDCGi[ i ] = msDCGi[ jrelnum ];
+
+    if( compute_gap ){
+      GAPisum[ i ] = GAPisum[ jrelnum ];
+    }
+
+    ERRi[ i ] = ERRi[ jrelnum ];
+
+  }
+
+  if( verbose ){
+    nev_printf( ctx, "\n" );
+    for( i = 1; i <= maxlen; i++ ){
+      nev_printf( ctx, "#%ld CGi=%.4f DCGi=%.4f msDCGi=%.4f\n",
+	      i, CGi[ i ], DCGi[ i ], msDCGi[ i ] );
+    }
+  }
+
+  /* store system cumulative gain, etc. */
+
+  RBPpower[ 1 ] = 1;
+  RBPsum[ 0 ] = 0;
+  ERR[ 0 ] = 0;
+  ERRdsat[ 0 ] = 1;
+  EBR[ 0 ] = 0; /* 2018 */
+  
+  if( RBUp > 0 )
+    iRBU[ 0 ] = 0; /* intentwise RBU */
+
+  doc = sysdoclab;
+  
+  for( i = 1; i<= syslen; i++ ){
+
+    if( strcmp( doc->string2, "" ) != 0 ){ /* judged doc */
+
+      if( ( rlevel = lab2level( doc->string2 ) ) < 0 ){
+#ifdef OUTERR
+	fprintf( stderr, "lab2level failed for %s\n", doc->string2 );
+#endif
+	return( -1 );
+	
+      }
+
+      if( rlevel > 0 ){ /* relevant doc */
+
+	count[ i ] = count[ i - 1 ] + 1;
+	Gs[ i ] = gv[ rlevel ];
+	Ss[ i ] = sv[ rlevel ];
+	CGs[ i ] = CGs[ i - 1 ] + gv[ rlevel ];
+	DCGs[ i ] = DCGs[ i - 1 ] + gv[ rlevel ]/orig_dcglog( logbase, i );
+	/* For MSnDCG, the logbase is irrelevant */
+	msDCGs[ i ] = msDCGs[ i - 1 ] + gv[ rlevel ]/log( i + 1 );
+
+	if( compute_gap ){ /* do rather expensive GAP computation */
+
+	  doc2 = sysdoclab;
+	  GAPsum[ i ] = 0.0;
+	  for( j = 1; j <= i; j++ ){
+
+	    if( strcmp( doc2->string2, "" ) != 0 ){ /* judged doc */
+
+	      if( ( rlevel2 = lab2level( doc2->string2 ) ) < 0 ){
+#ifdef OUTERR
+		fprintf( stderr, "lab2level failed for %s\n", doc2->string2 );
+#endif
+		return( -1 );
+	      }
+	    }
+	    else{ /* doc at rank j is an unjudged doc */
+	      rlevel2 = 0;
+	    }
+
+	    /* min(rl,rl2) * (min(rl,rl2)+1) */
+	    /* note: compare relevance levels, not the gain values */
+	    if( rlevel < rlevel2 ){
+	      GAPsum[ i ] += rlevel * (rlevel + 1);
+	    }
+	    else{
+	      GAPsum[ i ] += rlevel2 * (rlevel2 + 1);
+	    }
+
+	    doc2 = doc2->next;
+	  }
+	  
+	}
+
+	if( count[ i ] == 1 ){ /* first relevant document */
+	  r1 = i; /* for RR and O-measure */
+	}
+
+	if( maxrl_system < rlevel ){ /* highest relevance level so far? */
+	  maxrl_system = rlevel;
+	  rp = i; /* preferred rank for P-measure and P-plus */
+	}
+      }
+      else{ /* judged nonrel doc */
+
+	count[ i ] = count[ i - 1 ];
+	CGs[ i ] = CGs[ i - 1 ];
+	DCGs[ i ] = DCGs[ i - 1 ];
+	msDCGs[ i ] = msDCGs[ i - 1 ];
+	
+      }
+
+    }
+    else{ /* unjudged doc */
+
+      count[ i ] = count[ i - 1 ];
+      CGs[ i ] = CGs[ i - 1 ];
+      DCGs[ i ] = DCGs[ i - 1 ];
+      msDCGs[ i ] = msDCGs[ i - 1 ];
+    }
+
+    /* blended ratio */
+    BR[ i ] = ( qbeta * CGs[ i ] + count[ i ] )/( qbeta * CGi[ i ] + i );
+
+    if( i > 1 ){
+      RBPpower[ i ] = RBPp * RBPpower[ i - 1 ];
+    }
+    RBPsum[ i ] = RBPsum[ i - 1 ] + Gs[ i ] * RBPpower[ i ];
+
+    /* divide gain by maxgain+1 rather than maxgain to make sure
+       rel prob < 1 even for a highly rel doc.
+       Otherwise, all docs after the first highly rel doc
+       will be ignored.
+       Note that, because of this, ERR in as defined here
+       and in CIKM09 paper Eq.4 does NOT reduce to RR even in the
+       binary relevance case.
+    */
+    ERR[ i ] = ERR[ i - 1 ] + ( ERRdsat[ i - 1 ]/i ) * ( Gs[ i ]/( gv[ maxrl ]+1 ) );
+    ERRdsat[ i ] = ERRdsat[ i - 1 ] * ( 1 - Gs[ i ]/( gv[ maxrl ]+1 ) );
+
+    /* 2018 */
+    EBR[ i ] = EBR[ i - 1 ] + BR[ i ]*ERRdsat[ i - 1 ]*Gs[ i ]/( gv[ maxrl ]+1 );
+
+    if( RBUp > 0 ){ /* if RBUp has been specified */
+      iRBU[ i ] = iRBU[ i - 1 ] +
+	pow( RBUp, i ) * ERRdsat[ i - 1 ]*Gs[ i ]/( gv[ maxrl ]+1 );
+    }
+	
+    doc = doc->next;
+  }
+
+  for( i = syslen + 1; i <= maxlen; i++ ){ /* if system size < ideal size */
+
+    count[ i ] = count[ syslen ];
+    CGs[ i ] = CGs[ syslen ];
+    DCGs[ i ] = DCGs[ syslen ];
+    msDCGs[ i ] = msDCGs[ syslen ];
+    ERR[ i ] = ERR[ syslen ];
+    /* 2018 */
+    EBR[ i ] = EBR[ syslen ];
+    if( RBUp > 0 ){
+      iRBU[ i ] = iRBU[ syslen ];
+    }
+    RBPsum[ i ] = RBPsum[ syslen ]; /* RBP@l 2018 */
+
+    /* no need to compute BR beyond syslen */
+
+  }
+
+  if( verbose ){
+    nev_printf( ctx, "\n" );
+    for( i = 1; i <= syslen; i++ ){
+      if( Gs[ i ] > 0 ){
+	nev_printf( ctx, "#%ld count=%ld Gs=%.4f CGs=%.4f DCGs=%.4f msDCGs=%.4f BR=%.4f\n",
+		i, (long)count[ i ], Gs[ i ], CGs[ i ], DCGs[ i ], msDCGs[ i ], BR[ i ] );
+      }
+    }
+    nev_printf( ctx, "\n" );
+  }
+
+  nev_printf( ctx, "%s # r1=%ld rp=%ld\n", ctx->outstr, r1, rp );
+
+
+  /***** output evaluation metric values *****/
+
+  /* RR, O-measure, P-measure, P-plus */
+  if( r1 == 0 ){ /* no relevant doc in system output */
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "RR=                  " );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "O-measure=           " );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "P-measure=           " );
+    nev_metric( ctx, ctx->outstr, (double)0, 4, "P-plus=              " );
+  }
+  else{ /* at least one rel doc in system output */
+    nev_metric( ctx, ctx->outstr, (double)1/r1, 4, "RR=                  " );
+    nev_metric( ctx, ctx->outstr, BR[ r1 ], 4, "O-measure=           " );
+    nev_metric( ctx, ctx->outstr, BR[ rp ], 4, "P-measure=           " );
+    sum = 0.0;
+    for( i = 1; i <= rp; i++ ){
+      if( Gs[ i ] > 0 ){
+	sum += BR[ i ];
+      }
+    }
+    nev_metric( ctx, ctx->outstr, sum/count[ rp ], 4, "P-plus=              " );
+  }
+
+  /* AP and Q */ 
+  sum = 0.0; sum2 = 0.0; 
+  for( i = 1; i <= syslen; i++ ){
+    if( Gs[ i ] > 0 ){
+      sum += count[ i ]/i;
+      sum2 += BR[ i ];
+    }
+  }
+  nev_metric( ctx, ctx->outstr, sum/jrelnum, 4, "AP=                  " );
+  nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4, "Q-measure=           " );
+    
+  /* NCU measures */
+
+  /* graded-uniform NCU */
+
+  denom = 0.0;
+  for( i = 1; i <= maxrl; i++ ){
+    denom += Xrelnum[ i ] * sv[ i ];
+  }
+
+  sum = 0.0; sum2 = 0.0;
+  for( i = 1; i <= syslen; i++ ){
+    if( Gs[ i ] > 0 ){
+      sum += ( count[ i ]/i ) * Ss[ i ];
+      sum2 += BR[ i ] * Ss[ i ];
+    }
+  }
+  nev_metric( ctx, ctx->outstr, sum/denom, 4, "NCUgu,P=             " );
+  nev_metric( ctx, ctx->outstr, sum2/denom, 4, "NCUgu,BR=            " );
+
+  /* rank-biased NCU */
+
+  denom = 0.0;
+  for( i = 1; i <= jrelnum; i++ ){
+    denom += pow( gamma, i-1 );
+  }
+
+  sum = 0.0; sum2 = 0.0;
+  for( i = 1; i <= syslen; i++ ){
+    if( Gs[ i ] > 0 ){
+      sum += ( count[ i ]/i ) * pow( gamma, count[ i ]-1 );
+      sum2 += BR[ i ] * pow( gamma, count[ i ]-1 );
+    }
+  }
+  nev_metric( ctx, ctx->outstr, sum/denom, 4, "NCUrb,P=             " );
+  nev_metric( ctx, ctx->outstr, sum2/denom, 4, "NCUrb,BR=            " );
+
+  /* GAP */
+  if( compute_gap ){
+
+    sum = 0.0;
+    for( i = 1; i <= syslen; i++ ){
+      sum += GAPsum[ i ]/i;
+    }
+    nev_metric( ctx, ctx->outstr, sum/GAPisum[ jrelnum ], 4,
+		"GAP=                 " );
+  }
+
+  /* RBP */
+  nev_metric( ctx, ctx->outstr, (1-RBPp)*RBPsum[ syslen ]/gv[ maxrl ], 4,
+	      "RBP=                 " );
+  /* ERR */
+  nev_metric( ctx, ctx->outstr, ERR[ syslen ], 4, "ERR=                 " );
+  /* 2018 EBR */
+  nev_metric( ctx, ctx->outstr, EBR[ syslen ], 4, "EBR=                 " );
+
+  /* cutoff-based metrics */
+  for( i = 0; i < cutoff_num; i++ ){
+
+    /* cutoff-based Q */ 
+    minlen = cutoff[ i ];
+    if( minlen > syslen ){
+      minlen = syslen;
+    }/* minlen = min(cutoff, syslen) */
+    
+    sum = 0.0; sum2 = 0.0;
+    for( j = 1; j <= minlen; j++ ){
+      if( Gs[ j ] > 0 ){
+        sum += count[ j ]/j;
+        sum2 += BR[ j ];
+      }
+    }
+
+    /* divide by min(cutoff, jrelnum ) */
+    if( cutoff[ i ] < jrelnum ){
+      nev_metric( ctx, ctx->outstr, sum/cutoff[ i ], 4,
+		  "AP@%04ld=             ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, sum2/cutoff[ i ], 4,
+		  "Q@%04ld=              ", cutoff[ i ] );
+    }
+    else{ 
+      nev_metric( ctx, ctx->outstr, sum/jrelnum, 4,
+		  "AP@%04ld=             ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4,
+		  "Q@%04ld=              ", cutoff[ i ] );
+    }
+
+    if( compute_gap ){
+
+      sum = 0.0;
+      for( j = 1; j <= minlen; j++ ){
+	sum += GAPsum[ j ]/j;
+      }
+
+      if( cutoff[ i ] < jrelnum ){
+	nev_metric( ctx, ctx->outstr, sum/GAPisum[ cutoff[ i ] ], 4,
+		    "GAP@%04ld=            ", cutoff[ i ] );
+      }
+      else{
+	nev_metric( ctx, ctx->outstr, sum/GAPisum[ jrelnum ], 4,
+		    "GAP@%04ld=            ", cutoff[ i ] );
+      }
+      
+    }
+
+    if( cutoff[ i ] <= maxlen ){
+      
+      nev_metric( ctx, ctx->outstr, DCGs[ cutoff[ i ] ]/DCGi[ cutoff[ i ] ], 4,
+		  "nDCG@%04ld=           ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, msDCGs[ cutoff[ i ] ]/msDCGi[ cutoff[ i ] ], 4,
+		  "MSnDCG@%04ld=         ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, count[ cutoff[ i ] ]/cutoff[ i ], 4,
+		  "P@%04ld=              ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, (1-RBPp)*RBPsum[ cutoff[ i ] ]/gv[ maxrl ], 4,
+		  "RBP@%04ld=            ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, ERR[ cutoff[ i ] ], 4,
+		  "ERR@%04ld=            ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, ERR[ cutoff[ i ] ]/ERRi[ cutoff[ i ] ], 4,
+		  "nERR@%04ld=           ", cutoff[ i ] );
+      /* 2018 */
+      nev_metric( ctx, ctx->outstr, EBR[ cutoff[ i ] ], 4,
+		  "EBR@%04ld=            ", cutoff[ i ] );
+
+      /* In version 180312, ERR@l was included in gcompute but NOT in compute. */
+      /* 20180909 RBP@l */
+
+      /* 20180909 intentwise iRBP */
+      if( RBUp > 0 ){
+	nev_metric( ctx, ctx->outstr, iRBU[ cutoff[ i ] ], 4,
+		    "iRBU@%04ld=           ", cutoff[ i ] );
+      }
+
+      if( (long)count[ cutoff[ i ] ] > 0 ){
+	nev_metric( ctx, ctx->outstr, (double)1, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
+      }
+      else{
+	nev_metric( ctx, ctx->outstr, (double)0, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
+      }
+      
+    }
+    else{ /* cutoff exceeds maxlen */
+      
+      nev_metric( ctx, ctx->outstr, DCGs[ maxlen ]/DCGi[ maxlen ], 4,
+		  "nDCG@%04ld=           ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, msDCGs[ maxlen ]/msDCGi[ maxlen ], 4,
+		  "MSnDCG@%04ld=         ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, count[ maxlen ]/cutoff[ i ], 4,
+		  "P@%04ld=              ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, (1-RBPp)*RBPsum[ maxlen ]/gv[ maxrl ], 4,
+		  "RBP@%04ld=            ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, ERR[ maxlen ], 4,
+		  "ERR@%04ld=            ", cutoff[ i ] );
+      nev_metric( ctx, ctx->outstr, ERR[ maxlen ]/ERRi[ maxlen ], 4,
+		  "nERR@%04ld=           ", cutoff[ i ] );
+      /* 2018 */
+      nev_metric( ctx, ctx->outstr, EBR[ maxlen ], 4,
+		  "EBR@%04ld=            ", cutoff[ i ] );
+
+      /* In version 180312, ERR@l was included in gcompute but NOT in compute. */
+      /* 20180909 RBP@l */
+
+      /* 20180909 intentwise iRBP */
+
+      if( RBUp > 0 ){
+	nev_metric( ctx, ctx->outstr, iRBU[ maxlen ], 4,
+		    "iRBU@%04ld=           ", cutoff[ i ] );
+      }
+
+      if( (long)count[ maxlen ] > 0 ){
+	nev_metric( ctx, ctx->outstr, (double)1, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
+      }
+      else{
+	nev_metric( ctx, ctx->outstr, (double)0, 4,
+		    "Hit@%04ld=            ", cutoff[ i ] );
+      }
+	
+    }
+  }
+
+  if( ctx->ignore_unjudged ){ /* compute bpref etc */
+    
+    /* bpref and bpref_R */
+    sum = 0.0; sum2 = 0.0;
+    for( i = 1; i <= syslen; i++ ){
+
+      if( Gs[ i ] > 0 ){
+
+	mini = i - count[ i ];
+	if( jrelnum < mini ){ mini = jrelnum; };
+	/* min(R, r'-count(r')) */
+
+	/* bpref */
+	if( jrelnum > Xrelnum[ 0 ] ){
+	  ratio = 1 - mini/Xrelnum[ 0 ];
+	}
+	else{ /* jrelnum <= jnonrelnum */
+	  ratio = 1 - mini/jrelnum;
+	}
+	/* 1- min(R, r'-count(r')/min(R,N) */
+	sum += ratio;
+
+	/* bpref_R */
+	ratio2 = 1 - mini/jrelnum;
+	/* 1- min(R, r'-count(r')/R */
+	sum2 += ratio2;
+      }
+
+    }
+    nev_metric( ctx, ctx->outstr, sum/jrelnum, 4, "bpref=               " );
+    nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4, "bpref_R=             " );
+
+    /* bpref_N and bpref_relative */
+    sum = 0.0; sum2 = 0.0;
+    for( i = 1; i <= syslen; i++ ){
+
+      if( Gs[ i ] > 0 ){
+
+	/* bpref_N */
+	ratio = 1 - (double)(i-count[ i ])/Xrelnum[ 0 ];
+	sum += ratio;
+
+	/* bpref_relative */
+	if( i > 1 ){
+	  ratio2 = 1 - (double)(i-count[ i ])/(i-1);
+	}
+	else{ /* ignore relevant doc at Rank 1 */
+	  ratio2 = 0.0;
+	}
+	sum2 += ratio2;
+      }
+    }
+    nev_metric( ctx, ctx->outstr, sum/jrelnum, 4, "bpref_N=             " );
+    nev_metric( ctx, ctx->outstr, sum2/jrelnum, 4, "bpref_relative=      " );
+
+    /* rpref_N, rpref_relative and rpref_relative2 */
+    sum = 0.0; sum2 = 0.0; sum3 = 0.0;
+    for( i = 1; i <= syslen; i++ ){
+
+      if( Gs[ i ] > 0 ){
+
+	/* rpref_N */
+	penalty = 0.0; /* penalty for rank i: examine Ranks 1-(i-1) */
+	for( j = 1; j < i; j++ ){
+	  if( Gs[ i ] - Gs[ j ] > 0 ){
+	    penalty += (Gs[ i ]-Gs[ j ])/Gs[ i ];
+	  }
+	}
+	ratio = 1 - penalty/( jrelnum + Xrelnum[ 0 ] - CGi[ jrelnum ]/gv[ maxrl ] );
+	sum += Gs[ i ] * ratio;
+
+	/* rpref_relative */
+	if( i > 1 ){
+	  ratio2 = 1 - penalty/(i-1);
+	}
+	else{  /* ignore relevant doc at Rank 1 */
+	  ratio2 = 0.0;
+	}
+	sum2 += Gs[ i ] * ratio2;
+
+	/* rpref_relative2 */
+	ratio3 = 1 - penalty/i;
+	sum3 += Gs[ i ] * ratio3;
+
+      }
+    }
+
+    /* note: CGi can be used instead of cgi here */
+    nev_metric( ctx, ctx->outstr, sum/CGi[ jrelnum ], 4, "rpref_N=             " );
+    nev_metric( ctx, ctx->outstr, sum2/CGi[ jrelnum ], 4, "rpref_relative=      " );
+    nev_metric( ctx, ctx->outstr, sum3/CGi[ jrelnum ], 4, "rpref_relative2=     " );
+  }
+
+  /* end */
+
+
+  free( CGi );
+  free( DCGi );
+  free( msDCGi );
+
+  free( Gs );
+  free( CGs );
+  free( DCGs );
+  free( msDCGs );
+
+  free( count );
+  free( BR );
+  free( Ss );
+
+  free( RBPpower );
+  free( RBPsum );
+
+  free( ERR );
+  free( ERRdsat );
+  free( ERRi );
+  free( ERRidsat );
+
+  free( EBR );
+
+/* intentwise RBP*/
+  if( RBUp > 0 ){
+      free( iRBU);
+  }
+
+  if( compute_gap ){
+
+    free( GAPsum );
+    free( GAPisum );
+    
+  }
+
+  return( 0 );
+
+}/* of eval_compute */
+
+/******************************************************************************
+  eval_1click
+
+- read gold standard nug file with nug weights and vital strlen
+- read system output (matched nuggets with offsets)
+    1st line contains "syslen= <syslen>"
+- compute S-measure, weighted recall etc.
+
+With -nuggets, read a 1CLICK format nugget file and
+batch match files instead, and evaluate all topics at once.
+******************************************************************************/
+static int eval_1click( struct nev_ctx *ctx, int ac, char **av )
+{
+  FILE *fa = NULL;
+  FILE *fs = ctx->in;
+
+  int argc = 2;
+  int verbose = 0;
+
+  long Lparam[ SWEEP_NUMMAX ]; /* for S-measure */
+  long Lnum = 0;
+  long i;
+  long nugnum = 0; /* number of nuggets */
+  long Xlen = -1; /* T-measure denominator = system output len
+		      not yet read (1st line of output) */
+  long nrun = 0;
+
+  double fflatbeta[ SWEEP_NUMMAX ];
+  long fbnum = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char *pos;
+  char *p;
+  char *buf;
+  char *nugfile = NULL;
+  char **runfiles;
+  char *saveptr; /* for strtok_r */
+
+  struct nugtab nugtab; /* sorted nuggets */
+  struct matchlist ml; /* matched nuggets */
+
+  FILE *arc_open();
+  int free_nugtab();
+  long file2nugtab();
+  int matchlist_add();
+  int matchlist_free();
+  void *arena_alloc();
+  FILE *gzin_fopen();
+
+  if( ( runfiles = ( char **)arena_alloc( &ctx->arena, ac * sizeof( char *) ) )
+      == NULL ){
+    return( -1 );
+  }
+
+  while( argc < ac ){
+
+    if( strcmp( av[ argc ], OPTSTR_1CLICK_L ) == 0 && ( argc + 1 < ac ) ){
+
+      /* comma separated list, e.g. 250,500,1000 */
+      buf = strdup( av[ argc + 1 ] );
+      Lnum = 0;
+      for( p = strtok_r( buf, ",", &saveptr ); p != NULL; p = strtok_r( NULL, ",", &saveptr ) ){
+
+	if( Lnum >= SWEEP_NUMMAX ){
+#ifdef OUTERR
+	  fprintf( stderr, "Too many %s values\n", OPTSTR_1CLICK_L );
+#endif
+	  return( -1 );
+	}
+	Lparam[ Lnum++ ] = atol( p );
+	/* sanity check is done later */
+      }
+      free( buf );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_VERBOSE ) == 0 ){
+      verbose = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_OUTSTR ) == 0 && ( argc + 1 < ac ) ){
+      ctx->outstr = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_BETA ) == 0 && ( argc + 1 < ac ) ){
+      /* for F-flat: comma separated list, e.g. 0.5,1,2 */
+      buf = strdup( av[ argc + 1 ] );
+      fbnum = 0;
+      for( p = strtok_r( buf, ",", &saveptr ); p != NULL; p = strtok_r( NULL, ",", &saveptr ) ){
+
+	if( fbnum >= SWEEP_NUMMAX ){
+#ifdef OUTERR
+	  fprintf( stderr, "Too many %s values\n", OPTSTR_BETA );
+#endif
+	  return( -1 );
+	}
+	fflatbeta[ fbnum++ ] = atof( p );
+      }
+      free( buf );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_1CLICK_N ) == 0 && ( argc + 1 < ac ) ){
+
+      if( ( fa = gzin_fopen( av[ argc + 1 ] ) ) == NULL ){
+#ifdef OUTERR
+        fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
+#endif
+        return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_1CLICK_NUGGETS ) == 0 &&
+	     ( argc + 1 < ac ) ){
+      nugfile = av[ argc + 1 ];
+      argc += 2;
+    }
+    else{ /* system output, that is, matched nugget file */
+
+      runfiles[ nrun++ ] = av[ argc ];
+      argc++;
+    }
+  }
+
+  for( i = 0; i < Lnum && Lparam[ i ] >= 1; i++ );
+  if( Lnum == 0 || i < Lnum || ( fa == NULL && nugfile == NULL ) ){
+
+#ifdef OUTERR
+    fprintf( stderr,
+	     "Usage: %s %s [%s] [%s <separator>] [%s <outstr>] [%s <beta1,beta2...>] %s <L1,L2...> %s <nuggetfile> [matched nugget file]\n",
+	     av[ 0 ], av[ 1 ],
+	     OPTSTR_VERBOSE, OPTSTR_SEP,
+	     OPTSTR_OUTSTR, OPTSTR_BETA,
+	     OPTSTR_1CLICK_L, OPTSTR_1CLICK_N );
+    fprintf( stderr,
+	     "       %s %s [%s] [%s <separator>] [%s <beta1,beta2...>] %s <L1,L2...> %s <1CLICK nugget file> [batch match file...]\n",
+	     av[ 0 ], av[ 1 ],
+	     OPTSTR_VERBOSE, OPTSTR_SEP, OPTSTR_BETA,
+	     OPTSTR_1CLICK_L, OPTSTR_1CLICK_NUGGETS );
+    
+#endif
+
+    return( 0 );
+    
+  }
+
+  if( ctx->outstr == NULL ){
+    ctx->outstr = strdup( "" );
+  }
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+  if( fbnum == 0 ){
+    fflatbeta[ fbnum++ ] = DEFAULT_FFLATBETA;
+  }
+
+  if( nugfile ){ /* all topics at once; topicIDs are used as outstr */
+
+    if( fa ){
+      fclose( fa );
+    }
+    if( oneclick_batch( ctx, nugfile, runfiles, nrun,
+			Lparam, Lnum, fflatbeta, fbnum, verbose ) < 0 ){
+      return( -1 );
+    }
+
+    return( 0 );
+  }
+
+  if( nrun > 0 && ( fs = arc_open( ctx, NULL, runfiles[ nrun - 1 ] ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", runfiles[ nrun - 1 ] );
+#endif
+    return( -1 );
+  }
+
+  if( fs == ctx->in && fs != NULL &&
+      ( fs = arc_open( ctx, fs, NULL ) ) == NULL ){
+    return( -1 ); /* -topic: the topic is not in the archive on stdin */
+  }
+
+  /* store and sort gold standard nuggets with weights and vital lens*/
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+
+  if( ( nugnum = file2nugtab( ctx, fa, &nugtab ) ) < 1 ){
+
+#ifdef OUTERR
+    fprintf( stderr, "file2nugtab failed\n" );
+#endif
+    return( -1 );
+
+  }
+  fclose( fa );
+
+  /* read system output (matched nuggets) */
+  STATS_PHASE( ctx, STATS_LOADRUN );
+  
+  memset( &ml, 0, sizeof( struct matchlist ) );
+  while( fgets( line, sizeof( line ), fs ) ){
+    STATS_LINE( ctx, line );
+
+    /* input file format: <nugID> <offset> 
+       except the first line: Xlen= <Xlen> */
+
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+
+#ifdef OUTERR   
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif  
+      return( -1 );
+    }
+    *pos = '\0';
+
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR   
+      fprintf( stderr, "strtok failed\n" );
+#endif  
+      return( -1 );
+      
+    }
+    buf = p; /* nuggetID */
+
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR   
+      fprintf( stderr, "strtok failed\n" );
+#endif  
+      return( -1 );
+    }
+
+
+    if( Xlen < 0 ){ /* first line of file */
+
+      Xlen = atol( p ); /* denominator of T-measure */
+    }
+    else{ /* matched nugget line */
+
+      if( matchlist_add( &ctx->arena, &ml, buf, atol( p ) ) < 0 ){
+	return( -1 );
+      }
+    }
+    
+  }/* of while fgets */
+
+  if( Xlen < 0 ){ /* handle empty file */
+
+    Xlen = 0;
+
+  }
+  ml.Xlen = Xlen;
+
+  if( oneclick_topic( ctx, &nugtab, &ml, ctx->outstr,
+		      Lparam, Lnum, fflatbeta, fbnum, verbose ) < 0 ){
+    return( -1 );
+  }
+
+  free_nugtab( &nugtab );
+  matchlist_free( &ml );
+
+  return( 0 );
+
+  
+}/* of eval_1click */
+
+/******************************************************************************
+  oneclick_topic
+
+computes and outputs S-measure, weighted recall etc. for one topic
+from its sorted nuggets and matched nuggets,
+for each L in Lparam[] and each beta in fflatbeta[].
+
+As the nuggets are sorted and vital strlens are positive,
+the S-measure denominator for L is
+ sum_{i: cumvlen_i < L} w_i (L - cumvlen_i)
+ = L * W( k ) - CW( k )
+where k is the number of nuggets with cumvlen_i < L,
+W and CW are prefix sums of w_i and w_i cumvlen_i.
+The numerator is computed similarly from the matches sorted by offset.
+
+If more than one L or beta is given,
+metrics that depend on them are output with @L (and beta) suffixes.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int oneclick_topic( struct nev_ctx *ctx,
+			   struct nugtab *t, struct matchlist *m,
+			   char *prefix, long *Lparam, long Lnum,
+			   double *fflatbeta, long fbnum, int verbose )
+{
+  int sweep = ( Lnum > 1 || fbnum > 1 );
+
+  long i, j, k;
+  long matchednum = 0; /* number of matched nuggets */
+  long offset;
+  long vlen;
+  long summatchvlen = 0; /* T-measure numerator */
+  long Xlen = m->Xlen; /* T-measure denominator = system output len */
+  long L;
+  long *cumvlen;
+  /* vital strlen cumulated for computing S-measure denominator */
+
+  double nugw;
+  double beta;
+  double wrec_nume = 0.0;
+  double wrec_denom = 0.0;
+  double Smeasure_nume;
+  double Smeasure_denom[ SWEEP_NUMMAX ];
+  double Sflat[ SWEEP_NUMMAX ], Tflat;
+  double *W, *CW; /* prefix sums over sorted nuggets */
+  double *MW, *MWO; /* prefix sums over matches sorted by offset */
+
+  char *buf;
+  char name[ BUFSIZ + 1 ];
+
+  struct nugrec *q;
+  struct nugoffset *mo; /* matches with weights */
+
+  double nugtab_lookup();
+  int nugoffset_cmp();
+
+  if( ( cumvlen = ( long *)malloc( ( t->num + 1 ) * sizeof( long ) ) )
+      == NULL ||
+      ( W = ( double *)malloc( ( t->num + 1 ) * sizeof( double ) ) ) == NULL ||
+      ( CW = ( double *)malloc( ( t->num + 1 ) * sizeof( double ) ) ) == NULL ||
+      ( mo = ( struct nugoffset *)
+	malloc( ( m->num + 1 ) * sizeof( struct nugoffset ) ) ) == NULL ||
+      ( MW = ( double *)malloc( ( m->num + 1 ) * sizeof( double ) ) ) == NULL ||
+      ( MWO = ( double *)malloc( ( m->num + 1 ) * sizeof( double ) ) )
+      == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+  STATS_PHASE( ctx, STATS_COMPUTE );
+  STATS_ARRAYS( ctx, 6, ( t->num > m->num ? t->num : m->num ) + 1 );
+
+  /* prefix sums for S-measure denominators etc. */
+  W[ 0 ] = CW[ 0 ] = 0.0;
+  for( i = 0; i < t->num; i++ ){
+    /* scan sorted nuggets, i.e. pseudo minimal output */
+
+    q = &t->rec[ i ];
+
+    /* vital strlen cumulated */
+    cumvlen[ i ] = ( i > 0 ? cumvlen[ i - 1 ] : 0 ) + q->vlen;
+
+    W[ i + 1 ] = W[ i ] + q->weight;
+    CW[ i + 1 ] = CW[ i ] + q->weight * cumvlen[ i ];
+
+    if( verbose ){
+      nev_printf( ctx, "#%s w= %f vl= %ld offset*= %ld\n",
+	      q->nugid, q->weight, q->vlen, cumvlen[ i ] );
+    }
+  }
+  wrec_denom = W[ t->num ]; /* nugget weights for weighted recall */
+
+  /* S-measure denominators */
+  for( i = 0; i < Lnum; i++ ){
+
+    L = Lparam[ i ];
+
+    /* number of nuggets with cumvlen < L (cumvlen is increasing) */
+    for( j = 0, k = t->num; j < k; ){
+      if( cumvlen[ ( j + k ) / 2 ] < L ){
+	j = ( j + k ) / 2 + 1;
+      }
+      else{
+	k = ( j + k ) / 2;
+      }
+    }
+    Smeasure_denom[ i ] = L * W[ k ] - CW[ k ];
+
+    if( verbose && sweep ){
+      nev_printf( ctx, "#L= %ld wrec_denom= %f S-measure_denom= %f\n",
+	      L, wrec_denom, Smeasure_denom[ i ] );
+    }
+    else if( verbose ){
+      nev_printf( ctx, "#wrec_denom= %f S-measure_denom= %f\n",
+	      wrec_denom, Smeasure_denom[ i ] );
+    }
+  }
+
+  /* one pass over the matched nuggets */
+  
+  for( i = 0; i < m->num; i++ ){
+
+    buf = m->rec[ i ].nugid;
+    offset = m->rec[ i ].offset;
+
+    STATS_LOOKUP( ctx );
+    if( ( nugw = nugtab_lookup( t, buf, &vlen ) ) < 0 ){
+      /* lookup failed */
+      
+#ifdef OUTERR   
+      fprintf( stderr, "nugtab_lookup failed: %s\n", buf );
+#endif  
+      return( -1 );
+    }
+
+    matchednum++; /* count nugget matches for unweighted recall */
+    wrec_nume += nugw; /* add weights of nugget matches for weighted recall */
+    summatchvlen += vlen; /* T-measure numerator */
+
+    mo[ i ].offset = offset;
+    mo[ i ].weight = nugw;
+
+    if( verbose ){
+      nev_printf( ctx, "#matched=%s w=%f offset=%ld\n", buf, nugw, offset );
+    }
+  }
+
+  qsort( mo, m->num, sizeof( struct nugoffset ), nugoffset_cmp );
+  MW[ 0 ] = MWO[ 0 ] = 0.0;
+  for( i = 0; i < m->num; i++ ){
+    MW[ i + 1 ] = MW[ i ] + mo[ i ].weight;
+    MWO[ i + 1 ] = MWO[ i ] + mo[ i ].weight * mo[ i ].offset;
+  }
+
+  /* output metrics */
+
+  nev_printf( ctx, "%s #nuggets= %ld #matched= %ld #syslen= %ld\n",
+	  prefix, t->num, matchednum, Xlen );
+  nev_metric( ctx, prefix, (double)matchednum/t->num, 3,
+	      "Recall=              " );
+  nev_metric( ctx, prefix, wrec_nume/wrec_denom, 3, "W-recall=            " );
+
+  for( i = 0; i < Lnum; i++ ){
+
+    L = Lparam[ i ];
+
+    /* number of matches with offset < L:
+       add to S-measure only if within L */
+    for( j = 0, k = m->num; j < k; ){
+      if( mo[ ( j + k ) / 2 ].offset < L ){
+	j = ( j + k ) / 2 + 1;
+      }
+      else{
+	k = ( j + k ) / 2;
+      }
+    }
+    Smeasure_nume = L * MW[ k ] - MWO[ k ];
+
+    if( Smeasure_nume > Smeasure_denom[ i ] ){
+      Sflat[ i ] = 1.0;
+    }
+    else{ /* Sflat = S-measure */
+      Sflat[ i ] = Smeasure_nume/Smeasure_denom[ i ];
+    }
+
+    if( sweep ){
+      sprintf( name, "S-measure@%04ld=", L );
+      nev_metric( ctx, prefix, Smeasure_nume/Smeasure_denom[ i ], 3,
+		  "%-21s", name );
+      sprintf( name, "S-flat@%04ld=", L );
+      nev_metric( ctx, prefix, Sflat[ i ], 3, "%-21s", name );
+    }
+    else{
+      nev_metric( ctx, prefix, Smeasure_nume/Smeasure_denom[ i ], 3,
+		  "S-measure=           " );
+      nev_metric( ctx, prefix, Sflat[ i ], 3, "S-flat=              " );
+    }
+  }
+
+
+  if( Xlen == 0 ){
+    nev_metric( ctx, prefix, (double)0, 3, "T-measure=           " );
+    Tflat = 0.0;
+  }
+  else{
+    
+    nev_metric( ctx, prefix, (double)summatchvlen/Xlen, 3,
+		"T-measure=           " );
+
+    if( summatchvlen > Xlen ){
+      Tflat = 1.0;
+    }
+    else{
+      Tflat = (double)summatchvlen/Xlen;
+    }
+  }
+  nev_metric( ctx, prefix, Tflat, 3, "T-flat=              " );
+
+
+  for( i = 0; i < Lnum; i++ ){
+    for( j = 0; j < fbnum; j++ ){
+
+      beta = fflatbeta[ j ];
+      if( sweep ){
+	sprintf( name, "F-flat@%04ld(%.2f)=", Lparam[ i ], beta );
+      }
+      else{
+	strcpy( name, "F-flat=" );
+      }
+
+      if( Sflat[ i ] > 0.0 || Tflat > 0.0 ){
+	nev_metric( ctx, prefix,
+		    (1+beta*beta)*Tflat*Sflat[ i ]/(beta*beta*Tflat+Sflat[ i ]), 3,
+		    "%-21s", name );
+      }
+      else{
+	nev_metric( ctx, prefix, (double)0, 3, "%-21s", name );
+      }
+    }
+  }
+
+  free( cumvlen );
+  free( W );
+  free( CW );
+  free( mo );
+  free( MW );
+  free( MWO );
+
+  return( 0 );
+
+}/* of oneclick_topic */
+
+/******************************************************************************
+  oneclick_batch
+
+evaluates all topics of a 1CLICK format nugget file
+(as 1CLICK-splitnuggets, 1CLICK-splitmatch and 1CLICK-eval do)
+for each batch match file (stdin if none).
+
+1CLICK format nugget file:
+<topicID> <nuggetID> <nugget weight> <vital strlen> [...]
+duplicate lines are ignored.
+
+batch match file:
+<topicID> syslen= <syslen>
+<topicID> <nuggetID> <offset>
+only the smallest offset is used for each nugget.
+
+Topics are output in the order of the nugget file
+with topicIDs as outstr.
+A topic that cannot be evaluated is skipped.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+static int oneclick_batch( struct nev_ctx *ctx,
+			   char *nugfile, char **runfiles, long nrun,
+			   long *Lparam, long Lnum,
+			   double *fflatbeta, long fbnum, int verbose )
+{
+  FILE *f;
+
+  long i, j, r;
+  long ntopics = 0;
+  long idx;
+  long seplen = strlen( ctx->sep );
+
+  char line[ BUFSIZ + 1 ];
+  char *pos;
+  char *p;
+  char *tid;
+  char *nugid;
+  char **lines;
+  char *saveptr; /* for strtok_r */
+
+  long *nugnum;
+
+  struct strhash tidhash; /* topicID -> topic */
+  struct splittopic *topics = NULL; /* nugget lines of each topic */
+  struct splittopic *t;
+  struct nugtab *nt;
+  struct matchlist *ml;
+
+  FILE *arc_open();
+  struct splittopic *splittopic_get();
+  int splittopic_add();
+  int splittopic_free();
+  int strp_cmp();
+  int nugtab_addline();
+  long nugtab_index();
+  int free_nugtab();
+  int matchlist_add();
+  long matchlist_first();
+  int matchlist_free();
+  int strhash_init();
+  long strhash_get();
+  int strhash_free();
+  FILE *gzin_fopen();
+
+  if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ){
+    return( -1 );
+  }
+
+  /* nugget file: group lines by topic */
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+  if( ( f = gzin_fopen( nugfile ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", nugfile );
+#endif
+    return( -1 );
+  }
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
+
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif
+      return( -1 );
+    }
+    *pos = '\0';
+
+    if( ( p = strstr( line, ctx->sep ) ) == NULL || p == line ){
+      continue;
+    }
+    *p = '\0';
+    if( ( t = splittopic_get( &ctx->arena, &tidhash, &topics, &ntopics,
+			      line ) ) == NULL ||
+	splittopic_add( &ctx->arena, t, p + seplen, NULL, 0 ) < 0 ){
+      return( -1 );
+    }
+  }
+  fclose( f );
+
+  if( ( nt = ( struct nugtab *)calloc( ntopics + 1, sizeof( struct nugtab ) ) )
+      == NULL ||
+      ( nugnum = ( long *)calloc( ntopics + 1, sizeof( long ) ) ) == NULL ||
+      ( ml = ( struct matchlist *)
+	calloc( ntopics + 1, sizeof( struct matchlist ) ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "calloc failed\n" );
+#endif
+    return( -1 );
+  }
+
+  /* per-topic nugget tables, from sorted unique lines */
+  for( i = 0; i < ntopics; i++ ){
+
+    t = &topics[ i ];
+    if( ( lines = ( char **)malloc( t->num * sizeof( char *) ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "malloc failed\n" );
+#endif
+      return( -1 );
+    }
+    for( j = 0; j < t->num; j++ ){
+      lines[ j ] = t->rec[ j ].str;
+    }
+    qsort( lines, t->num, sizeof( char *), strp_cmp );
+
+    for( j = 0; j < t->num; j++ ){
+
+      if( j > 0 && strcmp( lines[ j ], lines[ j - 1 ] ) == 0 ){
+	continue;
+      }
+      strcpy( line, lines[ j ] );
+      if( nugtab_addline( ctx, &nt[ i ], line ) < 0 ){
+	break;
+      }
+    }
+    if( j < t->num || ( nugnum[ i ] = nugtab_index( &nt[ i ] ) ) < 1 ){
+#ifdef OUTERR
+      fprintf( stderr, "%s: cannot read nuggets\n", t->tid );
+#endif
+      nugnum[ i ] = -1;
+    }
+    free( lines );
+  }
+
+  for( r = 0; r < nrun || ( r == 0 && nrun == 0 ); r++ ){
+
+    if( nrun == 0 ){
+      if( ( f = arc_open( ctx, ctx->in, NULL ) ) == NULL ){
+	return( -1 ); /* -topic: the topic is not in the archive on stdin */
+      }
+    }
+    else if( ( f = arc_open( ctx, NULL, runfiles[ r ] ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Cannot open %s\n", runfiles[ r ] );
+#endif
+      return( -1 );
+    }
+
+    for( i = 0; i < ntopics; i++ ){
+      ml[ i ].Xlen = -1;
+    }
+    STATS_PHASE( ctx, STATS_LOADRUN );
+
+    while( fgets( line, sizeof( line ), f ) ){
+      STATS_LINE( ctx, line );
+
+      if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "Line too long: %s\n", line );
+#endif
+	return( -1 );
+      }
+      *pos = '\0';
+
+      if( ( tid = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ||
+	  ( nugid = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ||
+	  ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ||
+	  ( idx = strhash_get( &tidhash, tid ) ) < 0 ){
+	continue;
+      }
+
+      if( strcmp( nugid, "syslen=" ) == 0 ){ /* the first one is used */
+	if( ml[ idx ].Xlen < 0 ){
+	  ml[ idx ].Xlen = atol( p );
+	}
+      }
+      else if( matchlist_add( &ctx->arena, &ml[ idx ], nugid, atol( p ) ) < 0 ){
+	return( -1 );
+      }
+    }
+    if( f != ctx->in ){
+      fclose( f );
+    }
+
+    if( nrun > 1 ){
+      nev_printf( ctx, "# run=%s\n", runfiles[ r ] );
+    }
+
+    for( i = 0; i < ntopics; i++ ){
+
+      if( ml[ i ].Xlen < 0 ){
+	ml[ i ].Xlen = 0;
+      }
+      matchlist_first( &ml[ i ] );
+
+      if( nugnum[ i ] > 0 &&
+	  oneclick_topic( ctx, &nt[ i ], &ml[ i ], topics[ i ].tid,
+			  Lparam, Lnum, fflatbeta, fbnum, verbose ) < 0 ){
+#ifdef OUTERR
+	fprintf( stderr, "%s: evaluation failed\n", topics[ i ].tid );
+#endif
+      }
+      matchlist_free( &ml[ i ] );
+    }
+  }
+
+  for( i = 0; i < ntopics; i++ ){
+    free_nugtab( &nt[ i ] );
+    splittopic_free( &topics[ i ] );
+  }
+  free( nt );
+  free( nugnum );
+  free( ml );
+  free( topics );
+  strhash_free( &tidhash );
+
+  return( 0 );
+
+}/* of oneclick_batch */
+
+/******************************************************************************
+  eval_splitqrels
+
+breaks up a qrels file into per-topic files in one pass
+(native version of NTCIRsplitqrels and DIN-splitqrels).
+
+NTCIR mode:
+  ntcir_eval splitqrels [-sep <sep>] <qrelsfile> <relsuf>
+reads an NTCIR-format qrels file
+<topicID> <docID> <rel level>
+ :
+and creates <qrelsfile>.tid (sorted list of topicIDs) and
+<topicID>/<topicID>.<relsuf> files (topicID field removed).
+
+Diversity mode:
+  ntcir_eval splitqrels -intprob <DINprob/Iprob> [-sep <sep>] [-g <gains>]
+                        <Dqrelsfile> <relprefix>
+reads an intent probability file
+<topicID> <intentnum> <prob> [inf/nav]
+and a Dqrels file
+<topicID> <intentnum> <docID> <rel level>
+and creates <DINprob>.tid and, for each topic in it,
+<topicID>/<topicID>.<relprefix>.Irelv<intentnum>,
+<topicID>/<topicID>.<relprefix>.din and
+<topicID>/<topicID>.<relprefix>.Grelv
+exactly as DIN-splitqrels does (lines with rel levels other than
+L1, L2... are ignored; by default, the gain value of Lx is x).
+
+Each input file is read only once; lines are bucketed by topic in memory.
+Files are sorted bytewise (i.e., like sort(1) in the C locale).
+
+******************************************************************************/
+static int eval_splitqrels( struct nev_ctx *ctx, int ac, char **av )
+{
+  int argc = 2;
+
+  long rlnum = 0; /* number of rel levels */
+
+  double gv[ MAXRL_MAX + 1 ]; /* gain value for an Lx-relevant doc */
+
+  char *buf, *p;
+  char *intprob = NULL;
+  char *qrels = NULL;
+  char *suffix = NULL; /* relsuf or relprefix */
+  char *saveptr; /* for strtok_r */
+
+  int split_ntcirqrels();
+  int split_dinqrels();
+
+  while( argc < ac ){
+
+    if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_INTPROB ) == 0 && ( argc + 1 < ac ) ){
+      intprob = av[ argc + 1 ];
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_GAIN ) == 0 && ( argc + 1 < ac ) ){
+      /* input format: -g 1:2:3 least relevant first */
+      buf = strdup( av[ argc + 1 ] );
+      rlnum = 0;
+      if( ( p = strtok_r( buf, RLEVEL_RLEVEL_SEP, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "strtok failed\n" );
+#endif
+	return( -1 );
+      }
+      do{
+	rlnum++;
+	if( rlnum > MAXRL_MAX ){
+
+#ifdef OUTERR
+	  fprintf( stderr, "maxrl overflow\n" );
+#endif
+	  return( -1 );
+	}
+	gv[ rlnum ] = atof( p );
+      }while( ( p = strtok_r( NULL, RLEVEL_RLEVEL_SEP, &saveptr ) ) != NULL );
+
+      free( buf );
+      argc += 2;
+    }
+    else if( qrels == NULL ){
+      qrels = av[ argc ];
+      argc++;
+    }
+    else if( suffix == NULL ){
+      suffix = av[ argc ];
+      argc++;
+    }
+    else{
+      qrels = NULL; /* too many arguments */
+      break;
+    }
+  }
+
+  if( qrels == NULL || suffix == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr,
+	     "Usage: %s %s [%s <separator>] <NTCIR_qrelsfile> <relsuf>\n",
+	     av[ 0 ], av[ 1 ], OPTSTR_SEP );
+    fprintf( stderr,
+	     "       %s %s %s <intent prob file> [%s <separator>] [%s <gain for L1>:<gain for L2>...] <Dqrels file> <relprefix>\n",
+	     av[ 0 ], av[ 1 ], OPTSTR_INTPROB, OPTSTR_SEP, OPTSTR_GAIN );
+    fprintf( stderr, "\t(default gains for the latter: %d:%d:...:%d)\n",
+	     1, 2, DEFAULT_SPLIT_RLNUM );
+#endif
+    return( -1 );
+  }
+
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+
+  if( rlnum == 0 ){ /* default gain values as in DIN-splitqrels */
+    for( rlnum = 1; rlnum <= DEFAULT_SPLIT_RLNUM; rlnum++ ){
+      gv[ rlnum ] = rlnum;
+    }
+    rlnum = DEFAULT_SPLIT_RLNUM;
+  }
+
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+  if( intprob == NULL ){
+    if( split_ntcirqrels( ctx, qrels, suffix ) < 0 ){
+      return( -1 );
+    }
+  }
+  else{
+    if( split_dinqrels( ctx, intprob, qrels, suffix, gv, rlnum ) < 0 ){
+      return( -1 );
+    }
+  }
+
+
+  return( 0 );
+
+}/* of eval_splitqrels */
+
+/******************************************************************************
+  split_ntcirqrels
+
+NTCIR mode of splitqrels
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int split_ntcirqrels( ctx, qrels, relsuf )
+     struct nev_ctx *ctx;
+     char *qrels;  /* i */
+     char *relsuf; /* i */
+{
+  FILE *f, *fo;
+
+  long i, j;
+  long ntopics = 0;
+  long len;
+
+  char line[ BUFSIZ + 1 ];
+  char copy[ BUFSIZ + 1 ];
+  char *pos;
+  char *fld[ 1 ];
+  char *path;
+
+  struct strhash tidhash;
+  struct splittopic *topics = NULL;
+  struct splittopic *t;
+
+  long splitfields();
+  struct splittopic *splittopic_get();
+  int splittopic_add();
+  int splittopic_sort();
+  int splittopic_free();
+  FILE *split_open();
+  int split_close();
+  int strhash_init();
+  int strhash_free();
+  FILE *gzin_fopen();
+  int gzin_stem();
+
+  if( ( f = gzin_fopen( qrels ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", qrels );
+#endif
+    return( -1 );
+  }
+
+  if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ){
+    return( -1 );
+  }
+
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
+
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif
+      return( -1 );
+    }
+    *pos = '\0';
+
+    strcpy( copy, line );
+    if( splitfields( ctx, copy, fld, 1 ) < 1 || fld[ 0 ][ 0 ] == '\0' ){
+      continue; /* no topicID */
+    }
+
+    if( ( t = splittopic_get( &ctx->arena, &tidhash, &topics, &ntopics,
+			      fld[ 0 ] ) ) == NULL ){
+      return( -1 );
+    }
+
+    /* remove "<topicID><sep>" as NTCIRsplitqrels does */
+    len = strlen( t->tid );
+    pos = line;
+    if( strncmp( line, t->tid, len ) == 0 &&
+	strncmp( line + len, ctx->sep, strlen( ctx->sep ) ) == 0 ){
+      pos = line + len + strlen( ctx->sep );
+    }
+
+    if( splittopic_add( &ctx->arena, t, pos, NULL, 0 ) < 0 ){
+      return( -1 );
+    }
+  }
+  fclose( f );
+
+  STATS_PHASE( ctx, STATS_PRINT );
+  splittopic_sort( topics, ntopics );
+
+  /* topicID file */
+  if( ( path = ( char *)malloc( strlen( qrels ) + strlen( TIDSUF ) + 2 ) ) == NULL ){
+    return( -1 );
+  }
+  sprintf( path, "%.*s.%s", gzin_stem( qrels ), qrels, TIDSUF );
+  if( ( fo = split_open( path ) ) == NULL ){
+    return( -1 );
+  }
+  for( i = 0; i < ntopics; i++ ){
+    fprintf( fo, "%s\n", topics[ i ].tid );
+  }
+  split_close( fo, path );
+  free( path );
+
+  /* rel file for each topic */
+  for( i = 0; i < ntopics; i++ ){
+
+    t = &topics[ i ];
+    mkdir( t->tid, 0777 );
+
+    if( ( path = ( char *)malloc( 2 * strlen( t->tid ) + strlen( relsuf ) + 3 ) )
+	== NULL ){
+      return( -1 );
+    }
+    sprintf( path, "%s/%s.%s", t->tid, t->tid, relsuf );
+    if( ( fo = split_open( path ) ) == NULL ){
+      return( -1 );
+    }
+    for( j = 0; j < t->num; j++ ){
+      fprintf( fo, "%s\n", t->rec[ j ].str );
+    }
+    split_close( fo, path );
+    free( path );
+  }
+
+  for( i = 0; i < ntopics; i++ ){
+    splittopic_free( &topics[ i ] );
+  }
+  free( topics );
+  strhash_free( &tidhash );
+
+  return( 0 );
+
+}/* of split_ntcirqrels */
+
+/******************************************************************************
+  split_dinqrels
+
+diversity mode of splitqrels
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int split_dinqrels( ctx, intprob, dqrels, relpref, gv, rlnum )
+     struct nev_ctx *ctx;
+     char *intprob; /* i: DINprob or Iprob file */
+     char *dqrels;  /* i */
+     char *relpref; /* i */
+     double *gv;    /* i: gv[ 1..rlnum ] */
+     long rlnum;    /* i */
+{
+  FILE *f, *fo;
+
+  long i, j, k, m;
+  long ntopics = 0;
+  long nprobs = 0;
+  long probsize = 0;
+  long nfld;
+  long rlevel;
+  long nintents;
+  long ngrelv;
+  long idx;
+  long len;
+
+  double val;
+
+  char line[ BUFSIZ + 1 ];
+  char *pos;
+  char *fld[ 4 ];
+  char *path;
+  char *key;
+  char numbuf[ BUFSIZ + 1 ];
+  char **prob = NULL;   /* prob of each (topicID, intentnum) */
+  char **infnav = NULL; /* inf/nav label of each (topicID, intentnum) */
+  char **intents;
+  char **relv;    /* "<gain> <docID>" or "<docID> <P(i|q)*gi>" lines */
+  char **grelv;   /* "<gg> <docID>" lines */
+
+  struct strhash tidhash;  /* topicID -> topic */
+  struct strhash probhash; /* "<topicID>\001<intentnum>" -> prob index */
+  struct splittopic *topics = NULL;
+  struct splittopic *t;
+
+  long splitfields();
+  struct splittopic *splittopic_get();
+  int splittopic_add();
+  int splittopic_sort();
+  long rlevelstr2long();
+  int awknum();
+  int sortn_cmp();
+  int sortnr_cmp();
+  int strp_cmp();
+  int splittopic_free();
+  FILE *split_open();
+  int split_close();
+  char *split_key();
+  int strhash_init();
+  long strhash_add();
+  long strhash_get();
+  int strhash_free();
+  FILE *gzin_fopen();
+  int gzin_stem();
+
+  if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ||
+      strhash_init( &probhash, STRHASH_INITSIZE ) < 0 ){
+    return( -1 );
+  }
+
+  /* intent probability file: defines the topics */
+  if( ( f = gzin_fopen( intprob ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", intprob );
+#endif
+    return( -1 );
+  }
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
+
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif
+      return( -1 );
+    }
+    *pos = '\0';
+
+    if( ( nfld = splitfields( ctx, line, fld, 4 ) ) < 1 || fld[ 0 ][ 0 ] == '\0' ){
+      continue;
+    }
+    if( splittopic_get( &ctx->arena, &tidhash, &topics, &ntopics,
+			fld[ 0 ] ) == NULL ){
+      return( -1 );
+    }
+    if( nfld < 3 ){
+      continue;
+    }
+
+    /* the first line for (topicID, intentnum) is used */
+    key = split_key( fld[ 0 ], fld[ 1 ] );
+    if( ( idx = strhash_add( &probhash, key, nprobs ) ) < 0 ){
+      return( -1 );
+    }
+    free( key );
+    if( idx == nprobs ){
+      if( nprobs >= probsize ){
+	probsize = ( probsize == 0 ) ? BUFSIZ : 2 * probsize;
+	if( ( prob = ( char **)realloc( prob, probsize * sizeof( char * ) ) )
+	    == NULL ||
+	    ( infnav = ( char **)realloc( infnav, probsize * sizeof( char * ) ) )
+	    == NULL ){
+
+#ifdef OUTERR
+	  fprintf( stderr, "realloc failed\n" );
+#endif
+	  return( -1 );
+	}
+      }
+      prob[ nprobs ] = strdup( fld[ 2 ] );
+      infnav[ nprobs ] = strdup( nfld > 3 ? fld[ 3 ] : INFSTR );
+      nprobs++;
+    }
+  }
+  fclose( f );
+
+  /* Dqrels file: keep L1, L2... lines of known topics */
+  if( ( f = gzin_fopen( dqrels ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", dqrels );
+#endif
+    return( -1 );
+  }
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
+
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif
+      return( -1 );
+    }
+    *pos = '\0';
+
+    if( splitfields( ctx, line, fld, 4 ) < 4 ||
+	( rlevel = rlevelstr2long( fld[ 3 ] ) ) < 1 || rlevel > rlnum ||
+	( idx = strhash_get( &tidhash, fld[ 0 ] ) ) < 0 ){
+      continue;
+    }
+    if( splittopic_add( &ctx->arena, &topics[ idx ], fld[ 2 ], fld[ 1 ],
+			rlevel ) < 0 ){
+      return( -1 );
+    }
+  }
+  fclose( f );
+
+  STATS_PHASE( ctx, STATS_PRINT );
+  splittopic_sort( topics, ntopics );
+
+  /* topicID file */
+  if( ( path = ( char *)malloc( strlen( intprob ) + strlen( TIDSUF ) + 2 ) )
+      == NULL ){
+    return( -1 );
+  }
+  sprintf( path, "%.*s.%s", gzin_stem( intprob ), intprob, TIDSUF );
+  if( ( fo = split_open( path ) ) == NULL ){
+    return( -1 );
+  }
+  for( i = 0; i < ntopics; i++ ){
+    fprintf( fo, "%s\n", topics[ i ].tid );
+  }
+  split_close( fo, path );
+  free( path );
+
+  for( i = 0; i < ntopics; i++ ){
+
+    t = &topics[ i ];
+    mkdir( t->tid, 0777 );
+
+    len = 2 * strlen( t->tid ) + strlen( relpref ) +
+      strlen( IRELSUF ) + strlen( GRELSUF ) + strlen( DINSUF ) + BUFSIZ;
+    if( ( path = ( char *)malloc( len ) ) == NULL ||
+	( intents = ( char **)calloc( t->num + 1, sizeof( char * ) ) ) == NULL ||
+	( relv = ( char **)calloc( t->num + 1, sizeof( char * ) ) ) == NULL ||
+	( grelv = ( char **)calloc( t->num + 1, sizeof( char * ) ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "malloc failed\n" );
+#endif
+      return( -1 );
+    }
+
+    /* Irelv files: intents in numerical order */
+    nintents = 0;
+    for( j = 0; j < t->num; j++ ){
+      intents[ nintents++ ] = t->rec[ j ].intnum;
+    }
+    qsort( intents, nintents, sizeof( char * ), strp_cmp );
+    for( j = 0, k = 0; j < nintents; j++ ){ /* sort -u */
+      if( k == 0 || strcmp( intents[ k - 1 ], intents[ j ] ) != 0 ){
+	intents[ k++ ] = intents[ j ];
+      }
+    }
+    nintents = k;
+    qsort( intents, nintents, sizeof( char * ), sortn_cmp );
+
+    for( k = 0; k < nintents; k++ ){
+
+      m = 0;
+      for( j = 0; j < t->num; j++ ){
+	if( strcmp( t->rec[ j ].intnum, intents[ k ] ) == 0 ){
+	  awknum( numbuf, gv[ t->rec[ j ].rlevel ] );
+	  relv[ m ] = ( char *)malloc( strlen( numbuf ) +
+				       strlen( t->rec[ j ].str ) + 2 );
+	  sprintf( relv[ m ], "%s %s", numbuf, t->rec[ j ].str );
+	  m++;
+	}
+      }
+      qsort( relv, m, sizeof( char * ), sortnr_cmp );
+
+      sprintf( path, "%s/%s.%s.%s%s", t->tid, t->tid, relpref, IRELSUF,
+	       intents[ k ] );
+      if( ( fo = split_open( path ) ) == NULL ){
+	return( -1 );
+      }
+      for( j = 0; j < m; j++ ){
+	pos = strchr( relv[ j ], ' ' );
+	*pos = '\0';
+	fprintf( fo, "%s%s%s\n", pos + 1, ctx->sep, relv[ j ] );
+	free( relv[ j ] );
+      }
+      split_close( fo, path );
+    }
+
+    /* din file: one line per relevant Dqrels line, in file order */
+    sprintf( path, "%s/%s.%s.%s", t->tid, t->tid, relpref, DINSUF );
+    if( ( fo = split_open( path ) ) == NULL ){
+      return( -1 );
+    }
+    for( j = 0; j < t->num; j++ ){
+
+      key = split_key( t->tid, t->rec[ j ].intnum );
+      idx = strhash_get( &probhash, key );
+      free( key );
+
+      /* zero if not found */
+      awknum( numbuf, idx < 0 ? (double)0 :
+	      atof( prob[ idx ] ) * gv[ t->rec[ j ].rlevel ] );
+
+      fprintf( fo, "%s%s%s%s%s%s%s\n", t->rec[ j ].intnum, ctx->sep,
+	       idx < 0 ? "" : infnav[ idx ], ctx->sep, t->rec[ j ].str, ctx->sep, numbuf );
+
+      relv[ j ] = ( char *)malloc( strlen( t->rec[ j ].str ) +
+				   strlen( numbuf ) + 2 );
+      sprintf( relv[ j ], "%s %s", t->rec[ j ].str, numbuf );
+    }
+    split_close( fo, path );
+
+    /* Grelv file: sum P(i|q)*gi over intents for each doc */
+    qsort( relv, t->num, sizeof( char * ), strp_cmp );
+    ngrelv = 0;
+    for( j = 0; j < t->num; j = m ){
+
+      pos = strrchr( relv[ j ], ' ' );
+      *pos = '\0';
+      strcpy( numbuf, pos + 1 ); /* a single value is copied verbatim */
+      val = atof( pos + 1 );
+
+      for( m = j + 1; m < t->num; m++ ){
+	pos = strrchr( relv[ m ], ' ' );
+	*pos = '\0';
+	if( strcmp( relv[ m ], relv[ j ] ) != 0 ){
+	  *pos = ' ';
+	  break;
+	}
+	val += atof( pos + 1 );
+	awknum( numbuf, val );
+      }
+
+      grelv[ ngrelv ] = ( char *)malloc( strlen( numbuf ) +
+					 strlen( relv[ j ] ) + 2 );
+      sprintf( grelv[ ngrelv ], "%s %s", numbuf, relv[ j ] );
+      ngrelv++;
+    }
+    qsort( grelv, ngrelv, sizeof( char * ), sortnr_cmp );
+
+    sprintf( path, "%s/%s.%s.%s", t->tid, t->tid, relpref, GRELSUF );
+    if( ( fo = split_open( path ) ) == NULL ){
+      return( -1 );
+    }
+    for( j = 0; j < ngrelv; j++ ){
+      pos = strchr( grelv[ j ], ' ' );
+      *pos = '\0';
+      fprintf( fo, "%s%s%s\n", pos + 1, ctx->sep, grelv[ j ] );
+      free( grelv[ j ] );
+    }
+    split_close( fo, path );
+
+    for( j = 0; j < t->num; j++ ){
+      free( relv[ j ] );
+    }
+    free( relv );
+    free( grelv );
+    free( intents );
+    free( path );
+  }
+
+  for( i = 0; i < nprobs; i++ ){
+    free( prob[ i ] );
+    free( infnav[ i ] );
+  }
+  free( prob );
+  free( infnav );
+  for( i = 0; i < ntopics; i++ ){
+    splittopic_free( &topics[ i ] );
+  }
+  free( topics );
+  strhash_free( &tidhash );
+  strhash_free( &probhash );
+
+  return( 0 );
+
+}/* of split_dinqrels */
+
+/******************************************************************************
+  eval_splitruns
+
+breaks up run files into per-topic res files, reading each run once
+(native version of TRECsplitruns, IR4QAsplitruns and CQA-splitruns).
+
+  ntcir_eval splitruns [-format trec|ir4qa|cqa] [-sep <sep>]
+                       [-truncate <doclimit>] [-tid <topicIDlist>]
+                       [-archive] [runfile...]
+
+If no runfile is given, run file paths are read from stdin
+(one per line, as the runpathlist of the scripts).
+
+-format trec (default): TREC run format
+<topicID> Q0 <docID> <rank> <score> <runname>
+ :
+docIDs are kept in file order (the rank field is not used).
+
+-format ir4qa: IR4QA XML run
+<TOPIC ID="<topicID>">
+ ... DOCID="<docID>" ...
+</TOPIC>
+
+-format cqa: CQA run (<run>.run.csv)
+<questionID>,<answerID>,<answerID>...
+
+For each run and each topic, creates <topicID>/<topicID>.<run>.res
+with at most doclimit (default: DEFAULT_SPLIT_DOCLIMIT) docIDs.
+<run> is the file name without directories
+(and without ".xml" for ir4qa and ".run.csv" for cqa, as in the scripts).
+With -tid, exactly the topics in topicIDlist get a res file
+(an empty one if the run has no docs for the topic) and other topics
+are ignored; otherwise the topics that appear in the run get one.
+
+-archive: instead of the per-topic res files, creates a single
+<run>.arc per run (see arc_write); any subcommand reads a topic
+from it with -topic <topicID>, e.g.
+  ntcir_eval label -r 0001/0001.rel -topic 0001 TRECRUN.arc
+
+return value: 0 (OK)
+             -1 (NG)
+******************************************************************************/
+static int eval_splitruns( struct nev_ctx *ctx, int ac, char **av )
+{
+  int argc = 2;
+  int format = SPLITRUNS_TREC;
+  int archive = 0;
+
+  long i;
+  long r;
+  long limit = DEFAULT_SPLIT_DOCLIMIT;
+  long nrun = 0;
+  long runsize = 0;
+  long ntopics = 0;
+  long nfixed = 0; /* topics from the -tid list */
+
+  char line[ BUFSIZ + 1 ];
+  char *p, *q;
+  char *tidfile = NULL;
+  char **runs = NULL;
+
+  FILE *f;
+
+  struct splittopic *topics = NULL;
+  struct strhash tidhash;
+  struct arenamark mark;
+
+  char *arena_strdup();
+  int arena_mark();
+  int arena_release();
+  int strhash_init();
+  int strhash_free();
+  struct splittopic *splittopic_get();
+  int splittopic_free();
+  int split_run();
+  FILE *gzin_fopen();
+
+  while( argc < ac ){
+
+    if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_FORMAT ) == 0 && ( argc + 1 < ac ) ){
+      if( strcmp( av[ argc + 1 ], "trec" ) == 0 ){
+	format = SPLITRUNS_TREC;
+      }
+      else if( strcmp( av[ argc + 1 ], "ir4qa" ) == 0 ){
+	format = SPLITRUNS_IR4QA;
+      }
+      else if( strcmp( av[ argc + 1 ], "cqa" ) == 0 ){
+	format = SPLITRUNS_CQA;
+      }
+      else{
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_FORMAT );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
+      if( ( limit = atol( av[ argc + 1 ] ) ) < 1 ){
+#ifdef OUTERR
+	fprintf( stderr, "Bad %s value\n", OPTSTR_TRUNCATE );
+#endif
+	return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_TIDFILE ) == 0 && ( argc + 1 < ac ) ){
+      tidfile = av[ argc + 1 ];
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_ARCHIVE ) == 0 ){
+      archive = 1;
+      argc++;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_HELP ) == 0 ){
+#ifdef OUTERR
+      fprintf( stderr,
+	       "Usage: %s %s [%s trec|ir4qa|cqa] [%s <separator>] [%s <doclimit>] [%s <topicIDlist>] [%s] [runfile...]\n",
+	       av[ 0 ], av[ 1 ], OPTSTR_FORMAT, OPTSTR_SEP, OPTSTR_TRUNCATE,
+	       OPTSTR_TIDFILE, OPTSTR_ARCHIVE );
+      fprintf( stderr, "\t(run file paths are read from stdin if no runfile is given)\n" );
+#endif
+      return( 0 );
+    }
+    else{ /* the rest are run files */
+      runs = av + argc;
+      nrun = ac - argc;
+      break;
+    }
+  }
+
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+
+  if( nrun == 0 ){ /* runpathlist from stdin */
+
+    runs = NULL;
+    while( fgets( line, sizeof( line ), ctx->in ) ){
+      STATS_LINE( ctx, line );
+
+      /* as "read": without surrounding white space */
+      for( p = line; *p == ' ' || *p == '\t'; p++ );
+      for( q = p + strlen( p );
+	   q > p && ( q[ -1 ] == '\n' || q[ -1 ] == ' ' || q[ -1 ] == '\t' );
+	   q-- );
+      *q = '\0';
+      if( *p == '\0' ){
+	continue;
+      }
+
+      if( nrun == runsize ){
+	runsize = runsize ? 2 * runsize : 64;
+	if( ( runs = ( char **)realloc( runs, runsize * sizeof( char * ) ) )
+	    == NULL ){
+#ifdef OUTERR
+	  fprintf( stderr, "realloc failed\n" );
+#endif
+	  return( -1 );
+	}
+      }
+      if( ( runs[ nrun++ ] = arena_strdup( &ctx->arena, p ) ) == NULL ){
+	return( -1 );
+      }
+    }
+  }
+
+  if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ){
+    return( -1 );
+  }
+
+  if( tidfile ){ /* fixed set of topics */
+
+    if( ( f = gzin_fopen( tidfile ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Cannot open %s\n", tidfile );
+#endif
+      return( -1 );
+    }
+    while( fgets( line, sizeof( line ), f ) ){
+      STATS_LINE( ctx, line );
+
+      for( p = line; *p == ' ' || *p == '\t'; p++ );
+      for( q = p + strlen( p );
+	   q > p && ( q[ -1 ] == '\n' || q[ -1 ] == ' ' || q[ -1 ] == '\t' );
+	   q-- );
+      *q = '\0';
+      if( *p == '\0' ){
+	continue;
+      }
+      if( splittopic_get( &ctx->arena, &tidhash, &topics, &ntopics, p )
+	  == NULL ){
+	return( -1 );
+      }
+    }
+    fclose( f );
+    nfixed = ntopics;
+  }
+
+  STATS_PHASE( ctx, STATS_LOADRUN );
+
+  for( r = 0; r < nrun; r++ ){
+
+    arena_mark( &ctx->arena, &mark );
+
+    if( split_run( ctx, runs[ r ], format, limit, archive,
+		   &tidhash, &topics, &ntopics, nfixed ) < 0 ){
+      return( -1 );
+    }
+
+    arena_release( &ctx->arena, &mark );
+    if( nfixed > 0 ){ /* keep the topics, drop their docs */
+      for( i = 0; i < ntopics; i++ ){
+	topics[ i ].num = 0;
+      }
+    }
+    else{ /* topics of this run only */
+      for( i = 0; i < ntopics; i++ ){
+	splittopic_free( &topics[ i ] );
+      }
+      ntopics = 0;
+      strhash_free( &tidhash );
+      if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ){
+	return( -1 );
+      }
+    }
+  }
+
+  for( i = 0; i < ntopics; i++ ){
+    splittopic_free( &topics[ i ] );
+  }
+  free( topics );
+  strhash_free( &tidhash );
+  if( runs != av + argc ){
+    free( runs );
+  }
+
+  return( 0 );
+
+}/* of eval_splitruns */
+
+/******************************************************************************
+  split_run
+
+reads one run file for splitruns, buckets its docIDs by topic
+(at most limit per topic) and writes the per-topic res files
+(or the run archive <run>.arc if archive is set).
+
+If nfixed > 0, only the first nfixed topics (from -tid) are used;
+otherwise topics are added as they appear in the run.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int split_run( ctx, path, format, limit, archive, h, topics, ntopics, nfixed )
+     struct nev_ctx *ctx;
+     char *path;                  /* i: run file */
+     int format;                  /* i: SPLITRUNS_* */
+     long limit;                  /* i: docs per topic */
+     int archive;                 /* i: write <run>.arc */
+     struct strhash *h;           /* i/o: topicID -> index */
+     struct splittopic **topics;  /* i/o */
+     long *ntopics;               /* i/o */
+     long nfixed;                 /* i */
+{
+  char line[ BUFSIZ + 1 ];
+  char *fld[ 3 ];
+  char *run;
+  char *outpath;
+  char *p, *q;
+  char *saveptr; /* for strtok_r */
+
+  long i, j;
+
+  FILE *f;
+  FILE *fo;
+
+  struct splittopic *t;
+  struct splittopic *cur = NULL; /* ir4qa: topic being read */
+  struct genseen done;           /* ir4qa: topics already read */
+
+  long splitfields();
+  char *split_runname();
+  struct splittopic *split_runtopic();
+  int splittopic_add();
+  int genseen_init();
+  int genseen_set();
+  int genseen_test();
+  int genseen_free();
+  FILE *split_open();
+  int split_close();
+  int arc_write();
+  void *arena_alloc();
+  FILE *gzin_fopen();
+
+  if( ( f = gzin_fopen( path ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", path );
+#endif
+    return( -1 );
+  }
+  if( ( run = split_runname( &ctx->arena, path, format ) ) == NULL ||
+      genseen_init( &done, GENSEEN_INITSIZE ) < 0 ){
+    return( -1 );
+  }
+
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
+
+    if( ( p = strchr( line, '\n' ) ) != NULL ){
+      *p = '\0';
+    }
+    else if( strlen( line ) == sizeof( line ) - 1 ){
+#ifdef OUTERR
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif
+      return( -1 );
+    }
+
+    if( format == SPLITRUNS_TREC ){ /* <topicID> Q0 <docID> ... */
+
+      if( splitfields( ctx, line, fld, 3 ) < 3 ||
+	  ( t = split_runtopic( ctx, h, topics, ntopics, nfixed, fld[ 0 ] ) )
+	  == NULL ){
+	continue;
+      }
+      if( t->num < limit &&
+	  splittopic_add( &ctx->arena, t, fld[ 2 ], NULL, 0 ) < 0 ){
+	return( -1 );
+      }
+    }
+    else if( format == SPLITRUNS_IR4QA ){
+
+      if( ( p = strstr( line, "<TOPIC ID=\"" ) ) != NULL &&
+	  ( q = strchr( p + 11, '"' ) ) != NULL ){ /* start of a topic */
+
+	*q = '\0';
+	cur = split_runtopic( ctx, h, topics, ntopics, nfixed, p + 11 );
+	if( cur && genseen_test( &done, cur - *topics ) ){
+	  cur = NULL; /* only the first block of a topic is used */
+	}
+	continue;
+      }
+      if( cur == NULL ){
+	continue;
+      }
+      if( strstr( line, "</TOPIC>" ) ){
+	genseen_set( &done, cur - *topics );
+	cur = NULL;
+	continue;
+      }
+      if( strstr( line, " DOCID=" ) == NULL ){
+	continue;
+      }
+      /* as sub( /^.* DOCID="/ ) and sub( /" .*$/ ) of the script */
+      for( p = line; ( q = strstr( p, " DOCID=\"" ) ) != NULL; p = q + 8 );
+      if( ( q = strstr( p, "\" " ) ) != NULL ){
+	*q = '\0';
+      }
+      if( splittopic_add( &ctx->arena, cur, p, NULL, 0 ) < 0 ){
+	return( -1 );
+      }
+      if( cur->num >= limit ){
+	genseen_set( &done, cur - *topics );
+	cur = NULL;
+      }
+    }
+    else{ /* SPLITRUNS_CQA: <questionID>,<answerID>,<answerID>... */
+
+      if( ( p = strtok_r( line, ", \t", &saveptr ) ) == NULL ||
+	  ( t = split_runtopic( ctx, h, topics, ntopics, nfixed, p ) )
+	  == NULL ){
+	continue;
+      }
+      t->num = 0; /* a later line for the same question overwrites */
+      while( ( p = strtok_r( NULL, ", \t", &saveptr ) ) != NULL &&
+	     t->num < limit ){
+	if( splittopic_add( &ctx->arena, t, p, NULL, 0 ) < 0 ){
+	  return( -1 );
+	}
+      }
+    }
+  }
+  fclose( f );
+  genseen_free( &done );
+
+  STATS_PHASE( ctx, STATS_PRINT );
+
+  if( archive ){
+    if( ( outpath = ( char *)arena_alloc( &ctx->arena,
+					  strlen( run ) + strlen( ARCSUF ) + 2 ) )
+	== NULL ){
+      return( -1 );
+    }
+    sprintf( outpath, "%s.%s", run, ARCSUF );
+    if( arc_write( outpath, *topics, *ntopics ) < 0 ){
+      return( -1 );
+    }
+    STATS_PHASE( ctx, STATS_LOADRUN );
+    return( 0 );
+  }
+
+  for( i = 0; i < *ntopics; i++ ){
+
+    t = &(*topics)[ i ];
+    mkdir( t->tid, 0777 );
+
+    if( ( outpath = ( char *)arena_alloc( &ctx->arena,
+					  2 * strlen( t->tid ) + strlen( run ) +
+					  strlen( RESSUF ) + 4 ) ) == NULL ){
+      return( -1 );
+    }
+    sprintf( outpath, "%s/%s.%s.%s", t->tid, t->tid, run, RESSUF );
+    if( ( fo = split_open( outpath ) ) == NULL ){
+      return( -1 );
+    }
+    for( j = 0; j < t->num; j++ ){
+      fputs( t->rec[ j ].str, fo );
+      putc( '\n', fo );
+    }
+    split_close( fo, outpath );
+  }
+
+  STATS_PHASE( ctx, STATS_LOADRUN );
+
+  return( 0 );
+
+}/* of split_run */
+
+/******************************************************************************
+  arc_write
+
+writes a run archive: the docIDs of all topics of a run in one file,
+readable a topic at a time (arc_open) instead of one res file per topic.
+
+#NTCIREVAL-ARCHIVE <ntopics>
+<topicID> <offset> <length>
+ :
+#END
+<docs of the first topic, one docID per line, as in a res file>
+ :
+
+offset and length are in bytes; offsets count from the first byte
+after the #END line. A topic without docs has length 0
+(an empty res file).
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int arc_write( path, topics, ntopics )
+     char *path;                 /* i: output file */
+     struct splittopic *topics;  /* i */
+     long ntopics;               /* i */
+{
+  long i, j;
+  long off = 0;
+  long len;
+
+  FILE *fo;
+
+  FILE *split_open();
+  int split_close();
+
+  if( ( fo = split_open( path ) ) == NULL ){
+    return( -1 );
+  }
+
+  fprintf( fo, "%s %ld\n", ARC_MAGIC, ntopics );
+  for( i = 0; i < ntopics; i++ ){
+    for( len = j = 0; j < topics[ i ].num; j++ ){
+      len += strlen( topics[ i ].rec[ j ].str ) + 1;
+    }
+    fprintf( fo, "%s %ld %ld\n", topics[ i ].tid, off, len );
+    off += len;
+  }
+  fprintf( fo, "%s\n", ARC_END );
+
+  for( i = 0; i < ntopics; i++ ){
+    for( j = 0; j < topics[ i ].num; j++ ){
+      fputs( topics[ i ].rec[ j ].str, fo );
+      putc( '\n', fo );
+    }
+  }
+  split_close( fo, path );
+
+  return( 0 );
+
+}/* of arc_write */
+
+/******************************************************************************
+  arc_open
+
+opens an input file of a subcommand. With -topic (ctx->topic),
+a run archive of splitruns -archive is read for that topic only:
+the header is searched for the topic, the topic's docs are read
+by seeking to its offset, and a stream of just those docs is returned
+(so that the subcommand reads it as the topic's res file).
+Other files, and all files without -topic, are read as they are.
+
+If f is NULL, path is opened; otherwise f is an open stream
+(e.g. stdin), which is left open if it is an archive.
+On a stream that cannot seek (a pipe, a gzip-compressed file),
+the docs of the topic are reached by reading past those before it;
+such a stream is taken as an archive if its first byte is '#',
+as a res file never starts with ARC_MAGIC, and fails if it is not one.
+
+return value: file pointer (OK)
+              NULL (cannot open, the topic is not in the archive,
+                    or a bad archive)
+******************************************************************************/
+FILE *arc_open( ctx, f, path )
+     struct nev_ctx *ctx;
+     FILE *f;    /* i: open stream or NULL */
+     char *path; /* i: file to open if f is NULL */
+{
+  char line[ BUFSIZ + 1 ];
+  char *p, *q;
+  char *buf;
+  int c;
+  int found = 0;
+  int ended = 0;
+
+  long start;
+  long off = 0;
+  long len = 0;
+  long base;
+  size_t n;
+
+  FILE *fa = f;
+
+  void *arena_alloc();
+  FILE *gzin_fopen();
+
+  if( fa == NULL && ( fa = gzin_fopen( path ) ) == NULL ){
+    return( NULL );
+  }
+  if( ctx->topic == NULL ){
+    return( fa );
+  }
+
+  if( ( start = ftell( fa ) ) < 0 ){ /* cannot seek back: peek one byte */
+    if( ( c = getc( fa ) ) == EOF ){
+      return( fa );
+    }
+    ungetc( c, fa );
+    if( c != ARC_MAGIC[ 0 ] ){ /* not an archive */
+      return( fa );
+    }
+  }
+
+  if( fgets( line, sizeof( line ), fa ) == NULL ||
+      strncmp( line, ARC_MAGIC, strlen( ARC_MAGIC ) ) != 0 ){
+    if( start < 0 ){
+#ifdef OUTERR
+      fprintf( stderr, "%s: not an archive, and cannot seek back\n",
+	       path ? path : "(stdin)" );
+#endif
+      if( f == NULL ){
+	fclose( fa );
+      }
+      return( NULL );
+    }
+    fseek( fa, start, SEEK_SET ); /* not an archive */
+    return( fa );
+  }
+
+  /* header lines: <topicID> <offset> <length> */
+  while( fgets( line, sizeof( line ), fa ) ){
+    if( strncmp( line, ARC_END, strlen( ARC_END ) ) == 0 ){
+      ended = 1;
+      break;
+    }
+    if( ( q = strrchr( line, ' ' ) ) == NULL ){
+      continue;
+    }
+    *q = '\0';
+    if( ( p = strrchr( line, ' ' ) ) == NULL ){
+      continue;
+    }
+    *p = '\0';
+    if( !found && strcmp( line, ctx->topic ) == 0 ){
+      off = atol( p + 1 );
+      len = atol( q + 1 );
+      found = 1;
+    }
+  }
+  base = ftell( fa ); /* -1 if fa cannot seek */
+
+  if( !found || !ended || off < 0 || len < 0 ){
+#ifdef OUTERR
+    if( !found ){
+      fprintf( stderr, "Topic %s not in archive %s\n",
+	       ctx->topic, path ? path : "(stdin)" );
+    }
+    else{
+      fprintf( stderr, "Bad archive header in %s\n",
+	       path ? path : "(stdin)" );
+    }
+#endif
+    if( f == NULL ){
+      fclose( fa );
+    }
+    return( NULL );
+  }
+
+  if( ( buf = ( char *)arena_alloc( &ctx->arena, len + 1 ) ) == NULL ){
+    if( f == NULL ){
+      fclose( fa );
+    }
+    return( NULL );
+  }
+  if( base >= 0 ){
+    if( fseek( fa, base + off, SEEK_SET ) == 0 ){
+      off = 0;
+    }
+  }
+  else{ /* skip the docs of the topics before this one */
+    while( off > 0 &&
+	   ( n = fread( line, 1, off < BUFSIZ ? off : BUFSIZ, fa ) ) > 0 ){
+      off -= n;
+    }
+  }
+  if( off != 0 || ( long )fread( buf, 1, len, fa ) != len ){
+#ifdef OUTERR
+    fprintf( stderr, "Truncated archive %s\n", path ? path : "(stdin)" );
+#endif
+    if( f == NULL ){
+      fclose( fa );
+    }
+    return( NULL );
+  }
+  if( f == NULL ){
+    fclose( fa );
+  }
+  STATS_LOOKUP( ctx );
+
+  if( len == 0 ){ /* no docs: an empty res file */
+    return( fopen( "/dev/null", "r" ) );
+  }
+  return( fmemopen( buf, len, "r" ) );
+
+}/* of arc_open */
+
+/******************************************************************************
+  gzin_fopen, gzin_wrap
+
+gzin_fopen opens an input file for reading; if it is gzip-compressed
+(it starts with the gzip magic number), the returned stream yields the
+decompressed data, so that every loader reads .gz files as they are.
+gzin_wrap does the same for a stream already opened from path.
+
+Decompression runs on a second thread (gzin_thread) into two buffers:
+while the subcommand parses one, the next one is filled.
+Concatenated gzip members (cat a.gz b.gz) are read as one file.
+Zstandard (.zst) files are not supported: decompress them with zstd -dc.
+
+Needs a build with -DNEVZLIB (and -lz -lpthread); otherwise gzip input
+is reported as an error.
+
+return value: file pointer (OK)
+              NULL (cannot open, or compressed input not supported)
+******************************************************************************/
+FILE *gzin_fopen( path )
+     char *path; /* i */
+{
+  FILE *f;
+
+  FILE *gzin_wrap();
+
+  if( ( f = fopen( path, "r" ) ) == NULL ){
+    return( NULL );
+  }
+
+  return( gzin_wrap( f, path ) );
+
+}/* of gzin_fopen */
+
+FILE *gzin_wrap( f, path )
+     FILE *f;    /* i: stream opened from path (closed with the result) */
+     char *path; /* i */
+{
+  int c;
+  size_t len;
+
+#ifdef NEVZLIB
+  FILE *fz;
+  struct gzin *g;
+  z_stream *z;
+  cookie_io_functions_t io = { gzin_read, NULL, NULL, gzin_close };
+#endif
+
+  len = strlen( path );
+  if( len > 4 && strcmp( path + len - 4, ".zst" ) == 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "%s: zstd input not supported (use zstd -dc)\n", path );
+#endif
+    fclose( f );
+    return( NULL );
+  }
+
+  /* a text file never starts with 0x1f (the first byte of the
+     gzip magic number), so one byte of pushback is enough */
+  if( ( c = getc( f ) ) == EOF ){
+    rewind( f );
+    return( f );
+  }
+  ungetc( c, f );
+  if( c != 0x1f ){
+    return( f );
+  }
+
+#ifdef NEVZLIB
+  if( ( g = ( struct gzin *)calloc( 1, sizeof( struct gzin ) ) ) == NULL ||
+      ( g->z = z = ( z_stream *)calloc( 1, sizeof( z_stream ) ) ) == NULL ||
+      ( g->in = ( unsigned char *)malloc( GZIN_BUFSIZ ) ) == NULL ||
+      ( g->buf[ 0 ] = ( char *)malloc( GZIN_BUFSIZ ) ) == NULL ||
+      ( g->buf[ 1 ] = ( char *)malloc( GZIN_BUFSIZ ) ) == NULL ||
+      ( g->path = strdup( path ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    gzin_free( g );
+    fclose( f );
+    return( NULL );
+  }
+  g->src = f;
+
+  if( inflateInit2( z, 16 + MAX_WBITS ) != Z_OK ){ /* gzip format */
+#ifdef OUTERR
+    fprintf( stderr, "%s: inflateInit2 failed\n", path );
+#endif
+    gzin_free( g );
+    fclose( f );
+    return( NULL );
+  }
+  pthread_mutex_init( &g->lock, NULL );
+  pthread_cond_init( &g->cond, NULL );
+  if( pthread_create( &g->thread, NULL, gzin_thread, g ) != 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "%s: pthread_create failed\n", path );
+#endif
+    pthread_mutex_destroy( &g->lock );
+    pthread_cond_destroy( &g->cond );
+    inflateEnd( z );
+    gzin_free( g );
+    fclose( f );
+    return( NULL );
+  }
+
+  if( ( fz = fopencookie( g, "r", io ) ) == NULL ){
+    gzin_close( g );
+    return( NULL );
+  }
+  return( fz );
+#else
+
+#ifdef OUTERR
+  fprintf( stderr, "%s: gzip input needs a build with -DNEVZLIB\n", path );
+#endif
+  fclose( f );
+  return( NULL );
+#endif
+
+}/* of gzin_wrap */
+
+/******************************************************************************
+  gzin_stem
+
+returns the length of path without a ".gz" suffix, for the names of
+files derived from an input file (<qrels>.tid, <tid>.<run>.res).
+
+return value: length
+******************************************************************************/
+int gzin_stem( path )
+     char *path; /* i */
+{
+  int len;
+
+  len = strlen( path );
+  if( len > 3 && strcmp( path + len - 3, ".gz" ) == 0 ){
+    return( len - 3 );
+  }
+  return( len );
+
+}/* of gzin_stem */
+
+#ifdef NEVZLIB
+/******************************************************************************
+  gzin_inflate
+
+decompresses up to size bytes of a gzin stream into out.
+
+return value: number of bytes (0: end of the data) (OK)
+              -1 (corrupt or truncated input)
+******************************************************************************/
+long gzin_inflate( g, out, size )
+     struct gzin *g;
+     char *out;    /* o */
+     size_t size;  /* i */
+{
+  int r;
+  size_t n;
+
+  z_stream *z = ( z_stream *)g->z;
+
+  z->next_out = ( unsigned char *)out;
+  z->avail_out = size;
+
+  while( z->avail_out > 0 ){
+
+    if( z->avail_in == 0 ){
+      if( ( n = fread( g->in, 1, GZIN_BUFSIZ, g->src ) ) == 0 ){
+	if( ferror( g->src ) || g->member ){
+	  return( -1 );
+	}
+	break; /* end of the last member */
+      }
+      z->next_in = g->in;
+      z->avail_in = n;
+    }
+
+    if( !g->member ){ /* the next member starts */
+      inflateReset( z );
+      g->member = 1;
+    }
+    if( ( r = inflate( z, Z_NO_FLUSH ) ) == Z_STREAM_END ){
+      g->member = 0;
+    }
+    else if( r != Z_OK && r != Z_BUF_ERROR ){
+      return( -1 );
+    }
+  }
+
+  return( ( long )( size - z->avail_out ) );
+
+}/* of gzin_inflate */
+
+/******************************************************************************
+  gzin_thread
+
+decompresses a gzin stream into buf[ 0 ], buf[ 1 ], buf[ 0 ], ...
+waiting while the buffer to be filled is still being read.
+******************************************************************************/
+static void *gzin_thread( void *arg )
+{
+  int w = 0;
+  long n;
+
+  struct gzin *g = ( struct gzin *)arg;
+
+  long gzin_inflate();
+
+  while( 1 ){
+
+    pthread_mutex_lock( &g->lock );
+    while( g->full[ w ] && !g->stop ){
+      pthread_cond_wait( &g->cond, &g->lock );
+    }
+    if( g->stop ){
+      pthread_mutex_unlock( &g->lock );
+      break;
+    }
+    pthread_mutex_unlock( &g->lock );
+
+    n = gzin_inflate( g, g->buf[ w ], GZIN_BUFSIZ );
+
+    pthread_mutex_lock( &g->lock );
+    if( n > 0 ){
+      g->len[ w ] = n;
+      g->full[ w ] = 1;
+    }
+    else{
+      g->err = ( n < 0 );
+      g->eof = 1;
+    }
+    pthread_cond_broadcast( &g->cond );
+    pthread_mutex_unlock( &g->lock );
+
+    if( n <= 0 ){
+#ifdef OUTERR
+      if( n < 0 ){
+	fprintf( stderr, "%s: corrupt or truncated gzip data\n", g->path );
+      }
+#endif
+      break;
+    }
+    w ^= 1;
+  }
+
+  return( NULL );
+
+}/* of gzin_thread */
+
+/******************************************************************************
+  gzin_read, gzin_close
+
+read and close functions of a gzin stream (fopencookie)
+******************************************************************************/
+static ssize_t gzin_read( void *cookie, char *buf, size_t n )
+{
+  size_t done = 0;
+  size_t m;
+
+  struct gzin *g = ( struct gzin *)cookie;
+
+  while( done < n ){
+
+    pthread_mutex_lock( &g->lock );
+    while( !g->full[ g->rd ] && !g->eof ){
+      pthread_cond_wait( &g->cond, &g->lock );
+    }
+    if( !g->full[ g->rd ] ){ /* buffers are filled in order: no more data */
+      pthread_mutex_unlock( &g->lock );
+      break;
+    }
+    pthread_mutex_unlock( &g->lock );
+
+    m = g->len[ g->rd ] - g->pos;
+    if( m > n - done ){
+      m = n - done;
+    }
+    memcpy( buf + done, g->buf[ g->rd ] + g->pos, m );
+    done += m;
+    g->pos += m;
+
+    if( g->pos == g->len[ g->rd ] ){ /* hand the buffer back */
+      pthread_mutex_lock( &g->lock );
+      g->full[ g->rd ] = 0;
+      pthread_cond_broadcast( &g->cond );
+      pthread_mutex_unlock( &g->lock );
+      g->rd ^= 1;
+      g->pos = 0;
+    }
+  }
+
+  if( done == 0 && g->err ){
+    return( -1 );
+  }
+  return( ( ssize_t )done );
+
+}/* of gzin_read */
+
+static int gzin_close( void *cookie )
+{
+  struct gzin *g = ( struct gzin *)cookie;
+
+  pthread_mutex_lock( &g->lock );
+  g->stop = 1;
+  pthread_cond_broadcast( &g->cond );
+  pthread_mutex_unlock( &g->lock );
+  pthread_join( g->thread, NULL );
+
+  pthread_mutex_destroy( &g->lock );
+  pthread_cond_destroy( &g->cond );
+  inflateEnd( ( z_stream *)g->z );
+  fclose( g->src );
+  gzin_free( g );
+
+  return( 0 );
+
+}/* of gzin_close */
+
+/******************************************************************************
+  gzin_free
+
+frees a gzin structure and its buffers (any of which may still be NULL
+when gzin_wrap fails halfway); g->src is left to the caller.
+******************************************************************************/
+static void gzin_free( struct gzin *g )
+{
+  if( g == NULL ){
+    return;
+  }
+  free( g->z );
+  free( g->in );
+  free( g->buf[ 0 ] );
+  free( g->buf[ 1 ] );
+  free( g->path );
+  free( g );
+
+}/* of gzin_free */
+#endif
+
+/******************************************************************************
+  split_runtopic
+
+finds the topic of a run line for splitruns:
+a topic from the -tid list (nfixed > 0) or a new/known topic of the run.
+
+return value: topic (OK)
+              NULL (not in the -tid list, or ERROR)
+******************************************************************************/
+struct splittopic *split_runtopic( ctx, h, topics, ntopics, nfixed, tid )
+     struct nev_ctx *ctx;
+     struct strhash *h;           /* i/o: topicID -> index */
+     struct splittopic **topics;  /* i/o */
+     long *ntopics;               /* i/o */
+     long nfixed;                 /* i */
+     char *tid;                   /* i */
+{
+  long idx;
+
+  long strhash_get();
+  struct splittopic *splittopic_get();
+
+  STATS_LOOKUP( ctx );
+  if( nfixed > 0 ){
+    if( ( idx = strhash_get( h, tid ) ) < 0 ){
+      return( NULL );
+    }
+    return( &(*topics)[ idx ] );
+  }
+
+  return( splittopic_get( &ctx->arena, h, topics, ntopics, tid ) );
+
+}/* of split_runtopic */
+
+/******************************************************************************
+  split_runname
+
+returns the run name of a run file path for splitruns (in arena a):
+the file name without directories, as sed 's/^.*\///' does,
+and without ".xml" (ir4qa, as sed 's/.xml//') or ".run.csv"
+(cqa, as basename <path> .run.csv).
+A ".gz" suffix is removed first, so that a compressed run
+gives the same file names as the uncompressed one.
+
+return value: run name (OK)
+              NULL (ERROR)
+******************************************************************************/
+char *split_runname( a, path, format )
+     struct arena *a;
+     char *path; /* i */
+     int format; /* i */
+{
+  char *run;
+  char *p;
+  size_t len;
+
+  char *arena_strdup();
+  int gzin_stem();
+
+  if( ( p = strrchr( path, '/' ) ) != NULL ){
+    path = p + 1;
+  }
+  if( ( run = arena_strdup( a, path ) ) == NULL ){
+    return( NULL );
+  }
+
+  run[ len = gzin_stem( run ) ] = '\0';
+  if( format == SPLITRUNS_IR4QA ){
+    if( len > 3 && ( p = strstr( run + 1, "xml" ) ) != NULL ){
+      memmove( p - 1, p + 3, strlen( p + 3 ) + 1 );
     }
-    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
-      argc += 2;
+  }
+  else if( format == SPLITRUNS_CQA ){
+    if( len > 8 && strcmp( run + len - 8, ".run.csv" ) == 0 ){
+      run[ len - 8 ] = '\0';
     }
-    else if( strcmp( av[ argc ], OPTSTR_RELFILE ) == 0 && ( argc + 1 < ac ) ){
-      if( ( fa = fopen( av[ argc + 1 ], "r" ) ) == NULL ){
+  }
+
+  return( run );
+
+}/* of split_runname */
+
+/******************************************************************************
+  eval_convqrels
+
+converts a TREC, early-NTCIR or CACM qrels file into an NTCIR-format
+qrels file (native version of TRECrobust2NTCIRqrels,
+EarlyNTCIRqrels2NTCIRqrels and dealQrels.py), in one buffered pass.
+
+  ntcir_eval convqrels [-format trec|early|cacm] [-map <grade>:<label>,...]
+                       [-pad <width>] [-sep <sep>] [qrelsfile]
+
+-format trec (default): <topicID> 0 <docID> <grade>
+-format early: <topicID> <SABC> <docID> <01>
+-format cacm: <topicID> <docID> 0 0 (cacm/qrels.text)
+
+Output (to stdout): <topicID> <docID> <relevance_level>
+
+Fields are separated by runs of white space (or by -sep), whatever
+their widths. -map gives the label of each grade (default:
+DEFAULT_TRECMAP, DEFAULT_EARLYMAP or DEFAULT_CACMMAP; "*" matches
+any grade); lines with other grades are dropped, as in the scripts.
+-pad zero-pads numeric topicIDs and docIDs to the given width
+(default: DEFAULT_CACMPAD for cacm, none otherwise). A (topicID, docID)
+pair judged more than once keeps its first judgment.
+
+return value: 0 (OK)
+             -1 (NG)
+******************************************************************************/
+static int eval_convqrels( struct nev_ctx *ctx, int ac, char **av )
+{
+  int argc = 2;
+  int format = CONVQRELS_TREC;
+
+  long i, n;
+  long nmap = 0;
+  long nfld;
+  long pad = -1;
+  long ndup = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char tid[ BUFSIZ + 1 ];
+  char doc[ BUFSIZ + 1 ];
+  char *fld[ 4 ];
+  char *map = NULL;
+  char *grade;
+  char *label;
+  char *key;
+  char *p, *q;
+  char *saveptr; /* for strtok_r */
+  char *mkey[ MAXRL_MAX + 2 ];
+  char *mlabel[ MAXRL_MAX + 2 ];
+
+  FILE *fs = ctx->in;
+
+  struct strhash seen;
+
+  long splitfields();
+  char *split_key();
+  char *arena_strdup();
+  int strhash_init();
+  long strhash_add();
+  int strhash_free();
+  int convqrels_pad();
+  FILE *gzin_fopen();
+
+  while( argc < ac ){
 
+    if( strcmp( av[ argc ], OPTSTR_FORMAT ) == 0 && ( argc + 1 < ac ) ){
+      if( strcmp( av[ argc + 1 ], "trec" ) == 0 ){
+	format = CONVQRELS_TREC;
+      }
+      else if( strcmp( av[ argc + 1 ], "early" ) == 0 ){
+	format = CONVQRELS_EARLY;
+      }
+      else if( strcmp( av[ argc + 1 ], "cacm" ) == 0 ){
+	format = CONVQRELS_CACM;
+      }
+      else{
 #ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
+	fprintf( stderr, "Bad %s value\n", OPTSTR_FORMAT );
 #endif
 	return( -1 );
       }
-
       argc += 2;
     }
-    else if( strcmp( av[ argc ], OPTSTR_BETA ) == 0 && ( argc + 1 < ac ) ){
-      qbeta = atof( av[ argc + 1 ] );
+    else if( strcmp( av[ argc ], OPTSTR_MAP ) == 0 && ( argc + 1 < ac ) ){
+      map = av[ argc + 1 ];
       argc += 2;
     }
-    else if( strcmp( av[ argc ], OPTSTR_GAMMA ) == 0 && ( argc + 1 < ac ) ){
-      gamma = atof( av[ argc + 1 ] );
-      if( gamma > 1 ){
-
+    else if( strcmp( av[ argc ], OPTSTR_PAD ) == 0 && ( argc + 1 < ac ) ){
+      if( ( pad = atol( av[ argc + 1 ] ) ) < 0 || pad > BUFSIZ / 2 ){
 #ifdef OUTERR
-	fprintf( stderr, "Bad %s value\n", OPTSTR_GAMMA );
+	fprintf( stderr, "Bad %s value\n", OPTSTR_PAD );
 #endif
 	return( -1 );
       }
-
       argc += 2;
     }
-    else if( strcmp( av[ argc ], OPTSTR_LOGB ) == 0 && ( argc + 1 < ac ) ){
-      logbase = atof( av[ argc + 1 ] );
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
       argc += 2;
     }
-    else if( strcmp( av[ argc ], OPTSTR_RBP ) == 0 && ( argc + 1 < ac ) ){
-      RBPp = atof( av[ argc + 1 ] );
-      if( RBPp > 1 ){
-
+    else if( strcmp( av[ argc ], OPTSTR_HELP ) == 0 ){
 #ifdef OUTERR
-	fprintf( stderr, "Bad %s value\n", OPTSTR_RBP );
+      fprintf( stderr,
+	       "Usage: %s %s [%s trec|early|cacm] [%s <grade>:<label>,...] [%s <width>] [%s <separator>] [qrelsfile]\n",
+	       av[ 0 ], av[ 1 ], OPTSTR_FORMAT, OPTSTR_MAP, OPTSTR_PAD,
+	       OPTSTR_SEP );
 #endif
-	return( -1 );
-      }
-
-      argc += 2;
+      return( 0 );
     }
-    else if( strcmp( av[ argc ], OPTSTR_RBUP ) == 0 && ( argc + 1 < ac ) ){
-      RBUp = atof( av[ argc + 1 ] );
-      if( RBUp > 1 ){
-
+    else{
+      if( fs != ctx->in ){
+	fclose( fs );
+      }
+      if( ( fs = gzin_fopen( av[ argc ] ) ) == NULL ){
 #ifdef OUTERR
-	fprintf( stderr, "Bad %s value\n", OPTSTR_RBUP );
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
 #endif
 	return( -1 );
       }
+      argc++;
+    }
+  }
 
-      /* compute iRBU only if RBUp (> 0) is specified */
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+  if( map == NULL ){
+    map = format == CONVQRELS_EARLY ? DEFAULT_EARLYMAP :
+      format == CONVQRELS_CACM ? DEFAULT_CACMMAP : DEFAULT_TRECMAP;
+  }
+  if( pad < 0 ){
+    pad = format == CONVQRELS_CACM ? DEFAULT_CACMPAD : 0;
+  }
 
-      argc += 2;
+  /* <grade>:<label>,... */
+  if( ( map = arena_strdup( &ctx->arena, map ) ) == NULL ){
+    return( -1 );
+  }
+  for( p = strtok_r( map, ",", &saveptr ); p;
+       p = strtok_r( NULL, ",", &saveptr ) ){
+    if( ( q = strchr( p, ':' ) ) == NULL || q == p || q[ 1 ] == '\0' ||
+	nmap == MAXRL_MAX + 2 ){
+#ifdef OUTERR
+      fprintf( stderr, "Bad %s value\n", OPTSTR_MAP );
+#endif
+      return( -1 );
     }
-    else if( strcmp( av[ argc ], OPTSTR_CUTOFF ) == 0 && ( argc + 1 < ac ) ){
+    *q = '\0';
+    mkey[ nmap ] = p;
+    mlabel[ nmap++ ] = q + 1;
+  }
 
-      buf = strdup( av[ argc + 1 ] );
-      cutoff_num = 0;
-      if( ( p = strtok( buf, "," ) ) == NULL ){
+  if( strhash_init( &seen, STRHASH_INITSIZE ) < 0 ){
+    return( -1 );
+  }
+
+  STATS_PHASE( ctx, STATS_LOADQRELS );
+
+  while( fgets( line, sizeof( line ), fs ) ){
+    STATS_LINE( ctx, line );
 
+    if( ( p = strchr( line, '\n' ) ) != NULL ){
+      *p = '\0';
+    }
+    else if( strlen( line ) == sizeof( line ) - 1 ){
 #ifdef OUTERR
-	fprintf( stderr, "strtok failed\n" );
+      fprintf( stderr, "Line too long: %s\n", line );
 #endif
-	return( -1 );
+      return( -1 );
+    }
+    if( ( p = strchr( line, '\r' ) ) != NULL ){
+      *p = '\0';
+    }
+
+    nfld = splitfields( ctx, line, fld, 4 );
+    if( format == CONVQRELS_TREC ){ /* <topicID> 0 <docID> <grade> */
+      if( nfld < 4 ){
+	continue;
       }
-      do{
-	cutoff[ cutoff_num ] = atof( p );
-	cutoff_num++;
-	if( cutoff_num >= CUTOFF_NUMMAX ){
+      p = fld[ 2 ];
+      grade = fld[ 3 ];
+    }
+    else if( format == CONVQRELS_EARLY ){ /* <topicID> <SABC> <docID> ... */
+      if( nfld < 3 ){
+	continue;
+      }
+      p = fld[ 2 ];
+      grade = fld[ 1 ];
+    }
+    else{ /* CONVQRELS_CACM: <topicID> <docID> ... */
+      if( nfld < 2 ){
+	continue;
+      }
+      p = fld[ 1 ];
+      grade = nfld > 2 ? fld[ 2 ] : "";
+    }
+
+    for( label = NULL, i = 0; i < nmap; i++ ){
+      if( strcmp( mkey[ i ], "*" ) == 0 || strcmp( mkey[ i ], grade ) == 0 ){
+	label = mlabel[ i ];
+	break;
+      }
+    }
+    if( label == NULL ){
+      continue;
+    }
+
+    convqrels_pad( tid, fld[ 0 ], pad );
+    convqrels_pad( doc, p, pad );
+
+    /* the first judgment of (topicID, docID) is kept */
+    STATS_LOOKUP( ctx );
+    n = seen.num;
+    if( ( key = split_key( tid, doc ) ) == NULL ||
+	( i = strhash_add( &seen, key, n ) ) < 0 ){
+      return( -1 );
+    }
+    free( key );
+    if( i != n ){
+      ndup++;
+      continue;
+    }
+
+    nev_printf( ctx, "%s%s%s%s%s\n", tid, ctx->sep, doc, ctx->sep, label );
+  }
+
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
+  strhash_free( &seen );
 
 #ifdef OUTERR
-	  fprintf( stderr, "Too many cutoffs\n" );
+  if( ndup > 0 ){
+    fprintf( stderr, "%s: %ld duplicate judgments ignored\n", av[ 1 ], ndup );
+  }
 #endif
-	  return( -1 );
-	}
 
-      }while( ( p = strtok( NULL, "," ) ) != NULL );
-	
-      free( buf );
-      argc += 2;
-    }
-    /* user specified gain values (REQUIRED):
-       input format: -g 1:2:3 least relevant first
-       (maxrl is obtained from this) */
-    else if( strcmp( av[ argc ], OPTSTR_GAIN ) == 0 && ( argc + 1 < ac ) ){
+  return( 0 );
 
-      buf = strdup( av[ argc + 1 ] );
-      maxrl = 0;
-      if( ( p = strtok( buf, RLEVEL_RLEVEL_SEP ) ) == NULL ){
+}/* of eval_convqrels */
+
+/******************************************************************************
+  convqrels_pad
+
+copies id to buf (of BUFSIZ + 1 bytes), zero-padded to width
+if it is all digits (as zfill, but non-numeric IDs are kept as they are)
+
+return value: 0 (OK)
+******************************************************************************/
+int convqrels_pad( buf, id, width )
+     char *buf;  /* o */
+     char *id;   /* i */
+     long width; /* i */
+{
+  long len = strlen( id );
+  long n = 0;
+
+  char *p;
+
+  for( p = id; *p >= '0' && *p <= '9'; p++ );
+  if( *p == '\0' && len < width ){
+    n = width - len;
+    memset( buf, '0', n );
+  }
+  memcpy( buf + n, id, len + 1 );
+
+  return( 0 );
+
+}/* of convqrels_pad */
+
+/******************************************************************************
+  eval_sortrun
+
+sorts TREC runs by topicID (bytewise), score (descending) and docID
+(descending on ties, as trec_eval does), e.g. runs merged from parallel
+retrieval workers, so that splitruns can keep the top docs of each topic.
+Replaces sort -k1,1 -k5,5gr -k3,3r on large runs.
+
+  ntcir_eval sortrun [-mem <megabytes>] [-sep <sep>] [runfile...]
+
+Input (runfiles concatenated, or stdin):
+<topicID> Q0 <docID> <rank> <score> <runname>
+Output (to stdout): the same lines, sorted. Lines with fewer fields
+or a bad score are skipped (and counted on stderr).
+
+The lines are radix sorted on the topicID, interned and ranked, and the
+bits of the score; docIDs are compared only within tied scores.
+A run larger than -mem (default: DEFAULT_SORTRUN_MEM) is sorted in
+chunks of that size, written to temporary files and merged.
+
+return value: 0 (OK)
+             -1 (NG)
+******************************************************************************/
+static int eval_sortrun( struct nev_ctx *ctx, int ac, char **av )
+{
+  int argc = 2;
+
+  long i;
+  long t;
+  long n = 0;
+  long nrecsize = 0;
+  long ntids = 0;
+  long ntidsize = 0;
+  long nchunks = 0;
+  long nbad = 0;
+  long nfiles = 0;
+
+  size_t mem = ( size_t )DEFAULT_SORTRUN_MEM << 20;
+  size_t used = 0;
+
+  char line[ BUFSIZ + 1 ];
+  char buf[ BUFSIZ + 1 ];
+  char *fld[ 5 ];
+  char *p;
+  char *end;
+  char **tids = NULL;
+  char **files = NULL;
+
+  double score;
+
+  FILE *f;
+  FILE **chunks = NULL;
+
+  struct strhash tidhash;
+  struct sortrec *recs = NULL;
+  struct sortrec *tmp = NULL;
+  struct arenamark mark;
+
+  long splitfields();
+  char *arena_strdup();
+  int arena_mark();
+  int arena_release();
+  int strhash_init();
+  long strhash_add();
+  int strhash_free();
+  unsigned long long sortrun_scorekey();
+  int sortrun_sort();
+  FILE *sortrun_spill();
+  int sortrun_merge();
+  FILE *gzin_fopen();
+
+  while( argc < ac ){
 
+    if( strcmp( av[ argc ], OPTSTR_MEM ) == 0 && ( argc + 1 < ac ) ){
+      if( atol( av[ argc + 1 ] ) < 1 ){
 #ifdef OUTERR
-	fprintf( stderr, "strtok failed\n" );
+	fprintf( stderr, "Bad %s value\n", OPTSTR_MEM );
 #endif
 	return( -1 );
-
       }
-      do{
-	maxrl++;
-	if( maxrl > MAXRL_MAX ){
-
+      mem = ( size_t )atol( av[ argc + 1 ] ) << 20;
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_HELP ) == 0 ){
 #ifdef OUTERR
-	  fprintf( stderr, "maxrl overflow\n" );
+      fprintf( stderr,
+	       "Usage: %s %s [%s <megabytes>] [%s <separator>] [runfile...]\n",
+	       av[ 0 ], av[ 1 ], OPTSTR_MEM, OPTSTR_SEP );
 #endif
-	  return( -1 );
+      return( 0 );
+    }
+    else{
+      break;
+    }
+  }
+  files = av + argc;
+  nfiles = ac - argc;
 
-	}
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+  if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ){
+    return( -1 );
+  }
 
-	gv[ maxrl ] = atof( p );
-		
-      }while( ( p = strtok( NULL, RLEVEL_RLEVEL_SEP ) ) != NULL );
+  STATS_PHASE( ctx, STATS_LOADRUN );
 
-      free( buf );
-      argc += 2;
-	  
+  arena_mark( &ctx->arena, &mark );
+
+  for( i = 0; i == 0 || i < nfiles; i++ ){
+
+    if( nfiles == 0 ){
+      f = ctx->in;
+    }
+    else if( ( f = gzin_fopen( files[ i ] ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Cannot open %s\n", files[ i ] );
+#endif
+      return( -1 );
     }
-    /* user specified stop values (NOT REQUIRED):
-       input format: -s 1:2:3 least relevant first */
-    else if( strcmp( av[ argc ], OPTSTR_STOP ) == 0 && ( argc + 1 < ac ) ){
-      
-      buf = strdup( av[ argc + 1 ] );
-      maxrl_stop = 0;
-      if( ( p = strtok( buf, RLEVEL_RLEVEL_SEP ) ) == NULL ){
 
-#ifdef OUTERR	  
-	fprintf( stderr, "strtok failed\n" );
+    while( fgets( line, sizeof( line ), f ) ){
+      STATS_LINE( ctx, line );
+
+      if( ( p = strchr( line, '\n' ) ) != NULL ){
+	*p = '\0';
+      }
+      else if( strlen( line ) == sizeof( line ) - 1 ){
+#ifdef OUTERR
+	fprintf( stderr, "Line too long: %s\n", line );
 #endif
 	return( -1 );
-
       }
 
-      do{
-	maxrl_stop++;
-	if( maxrl_stop > MAXRL_MAX ){
+      strcpy( buf, line );
+      if( splitfields( ctx, buf, fld, 5 ) < 5 ){
+	nbad++;
+	continue;
+      }
+      score = strtod( fld[ 4 ], &end );
+      if( end == fld[ 4 ] || *end != '\0' || score != score ){
+	nbad++;
+	continue;
+      }
 
-#ifdef OUTERR	    
-	  fprintf( stderr, "maxrl_stop overflow\n" );
+      if( ( t = strhash_add( &tidhash, fld[ 0 ], ntids ) ) < 0 ){
+	return( -1 );
+      }
+      if( t == ntids ){ /* new topic */
+	if( ntids >= ntidsize ){
+	  ntidsize = ( ntidsize == 0 ) ? BUFSIZ : 2 * ntidsize;
+	  if( ( tids = ( char **)realloc( tids, ntidsize * sizeof( char * ) ) )
+	      == NULL ){
+#ifdef OUTERR
+	    fprintf( stderr, "realloc failed\n" );
+#endif
+	    return( -1 );
+	  }
+	}
+	if( ( tids[ ntids++ ] = strdup( fld[ 0 ] ) ) == NULL ){
+#ifdef OUTERR
+	  fprintf( stderr, "strdup failed\n" );
 #endif
 	  return( -1 );
-
 	}
-	sv[ maxrl_stop ] = atof( p );
-
-	if( sv[ maxrl_stop ] == 0.0 ){
+      }
 
+      if( n >= nrecsize ){
+	nrecsize = ( nrecsize == 0 ) ? BUFSIZ : 2 * nrecsize;
+	if( ( recs = ( struct sortrec *)
+	      realloc( recs, nrecsize * sizeof( struct sortrec ) ) ) == NULL ||
+	    ( tmp = ( struct sortrec *)
+	      realloc( tmp, nrecsize * sizeof( struct sortrec ) ) ) == NULL ){
 #ifdef OUTERR
-	  fprintf( stderr, "stop value must be positive\n" );
+	  fprintf( stderr, "realloc failed\n" );
 #endif
 	  return( -1 );
 	}
-	  
-      }while( ( p = strtok( NULL, RLEVEL_RLEVEL_SEP ) ) != NULL );
-
-      free( buf );
-      argc += 2;
-      
+      }
+      if( ( recs[ n ].line = arena_strdup( &ctx->arena, line ) ) == NULL ||
+	  ( recs[ n ].doc = arena_strdup( &ctx->arena, fld[ 2 ] ) ) == NULL ){
+	return( -1 );
+      }
+      recs[ n ].skey = sortrun_scorekey( score );
+      recs[ n ].tkey = t;
+      recs[ n ].order = n;
+      recs[ n ].tid = NULL;
+      n++;
+
+      used += strlen( line ) + strlen( fld[ 2 ] ) + 2 +
+	2 * sizeof( struct sortrec );
+      if( used >= mem ){ /* sort this chunk and write it out */
+	if( nchunks % BUFSIZ == 0 &&
+	    ( chunks = ( FILE **)realloc( chunks, ( nchunks + BUFSIZ ) *
+					  sizeof( FILE * ) ) ) == NULL ){
+#ifdef OUTERR
+	  fprintf( stderr, "realloc failed\n" );
+#endif
+	  return( -1 );
+	}
+	if( sortrun_sort( recs, tmp, n, tids, ntids, &tidhash ) < 0 ||
+	    ( chunks[ nchunks++ ] = sortrun_spill( recs, n ) ) == NULL ){
+	  return( -1 );
+	}
+	arena_release( &ctx->arena, &mark );
+	n = 0;
+	used = 0;
+      }
     }
-    /* labelled system file */
-    else{
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
+    if( f != ctx->in ){
+      fclose( f );
+    }
+  }
+
+  if( sortrun_sort( recs, tmp, n, tids, ntids, &tidhash ) < 0 ){
+    return( -1 );
+  }
+
+  STATS_PHASE( ctx, STATS_PRINT );
 
+  if( nchunks == 0 ){ /* all in memory */
+    for( i = 0; i < n; i++ ){
+      nev_printf( ctx, "%s\n", recs[ i ].line );
+    }
+  }
+  else{
+    if( n > 0 ){
+      if( nchunks % BUFSIZ == 0 &&
+	  ( chunks = ( FILE **)realloc( chunks, ( nchunks + BUFSIZ ) *
+					sizeof( FILE * ) ) ) == NULL ){
 #ifdef OUTERR
-	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+	fprintf( stderr, "realloc failed\n" );
 #endif
 	return( -1 );
-
       }
-      argc++;
+      if( ( chunks[ nchunks++ ] = sortrun_spill( recs, n ) ) == NULL ){
+	return( -1 );
+      }
+    }
+    if( sortrun_merge( ctx, chunks, nchunks ) < 0 ){
+      return( -1 );
+    }
+    for( i = 0; i < nchunks; i++ ){
+      fclose( chunks[ i ] );
     }
   }
 
-  if( fa == NULL || maxrl == 0 ){ /* rel file and gain values are required */
-    return( compute_usage( ac, av ) );
+  for( i = 0; i < ntids; i++ ){
+    free( tids[ i ] );
+  }
+  free( tids );
+  free( recs );
+  free( tmp );
+  free( chunks );
+  strhash_free( &tidhash );
+
+#ifdef OUTERR
+  if( nbad > 0 ){
+    fprintf( stderr, "%s: %ld malformed lines skipped\n", av[ 1 ], nbad );
+  }
+#endif
+
+  return( 0 );
+
+}/* of eval_sortrun */
+
+/******************************************************************************
+  sortrun_scorekey
+
+maps a score to an unsigned key such that
+a higher score has a smaller key (-0.0 and 0.0 are the same).
+
+return value: key
+******************************************************************************/
+unsigned long long sortrun_scorekey( score )
+     double score;
+{
+  unsigned long long u;
+
+  if( score == 0.0 ){
+    score = 0.0;
   }
+  memcpy( &u, &score, sizeof( u ) );
 
-  if( outstr == NULL ){
-    outstr = strdup( "" );
+  /* IEEE 754 bits in ascending order of the value */
+  if( u >> 63 ){
+    u = ~u;
   }
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
+  else{
+    u |= 1ULL << 63;
   }
 
+  return( ~u );
 
-  /* L0-relevant (judged nonrel) docs */
-  gv[ 0 ] = 0;
-  sv[ 0 ] = 0;
+}/* of sortrun_scorekey */
 
-  if( maxrl_stop == 0 ){ /* stop values not specified -> copy gain values */
-    
-    for( i = 1; i <= maxrl; i++ ){
-      sv[ i ] = gv[ i ];
-    }
+/******************************************************************************
+  sortrun_sort
+
+sorts the n lines of a chunk by topicID, score and docID:
+an LSD radix sort (one byte per pass) on the score keys and then on
+the ranks of the topicIDs; passes in which all keys share the byte are
+skipped. Ties of topic and score are then sorted by docID.
+recs[ i ].tkey is the interned topicID on entry and its rank on return.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int sortrun_sort( recs, tmp, n, tids, ntids, h )
+     struct sortrec *recs;  /* i/o */
+     struct sortrec *tmp;   /* n records of work space */
+     long n;                /* i */
+     char **tids;           /* i: interned topicIDs */
+     long ntids;            /* i */
+     struct strhash *h;     /* i: topicID -> index in tids */
+{
+  int pass;
+  int shift;
+  int tpasses;
+
+  long i, j;
+  long count[ 256 ];
+  long *rank;
+
+  char **sorted;
+
+  unsigned long long key;
 
+  struct sortrec *src = recs;
+  struct sortrec *dst = tmp;
+  struct sortrec *sw;
+
+  long strhash_get();
+  int strp_cmp();
+  int sortrec_cmp();
+
+  if( n < 2 ){
+    return( 0 );
   }
-  else if( maxrl_stop != maxrl ){ /* number of rel levels do not match */
 
+  /* rank the topicIDs bytewise */
+  if( ( sorted = ( char **)malloc( ntids * sizeof( char * ) ) ) == NULL ||
+      ( rank = ( long *)malloc( ntids * sizeof( long ) ) ) == NULL ){
 #ifdef OUTERR
-    fprintf( stderr, "gain/stop rel levels mismatch\n" );
+    fprintf( stderr, "malloc failed\n" );
 #endif
     return( -1 );
-
   }
+  memcpy( sorted, tids, ntids * sizeof( char * ) );
+  qsort( sorted, ntids, sizeof( char * ), strp_cmp );
+  for( i = 0; i < ntids; i++ ){
+    rank[ strhash_get( h, sorted[ i ] ) ] = i;
+  }
+  for( i = 0; i < n; i++ ){
+    recs[ i ].tkey = rank[ recs[ i ].tkey ];
+  }
+  free( sorted );
+  free( rank );
 
-  /* so now maxrl_stop == maxrl */
-
-  /* check that gain/stop values for lower relevance levels are lower */
-  for( i = 1; i <= maxrl; i++ ){
-    for( j = i + 1; j <= maxrl; j++ ){
-      if( gv[ i ] > gv[ j ] || sv[ i ] > sv[ j ] ){
+  for( tpasses = 0; tpasses < ( int )sizeof( unsigned long ) &&
+	 ( ( unsigned long )ntids - 1 ) >> ( 8 * tpasses ) > 0; tpasses++ );
 
-#ifdef OUTERR
-	fprintf( stderr, "Bad gain/stop values\n" );
-#endif
-	return( -1 );
+  for( pass = 0; pass < 8 + tpasses; pass++ ){
 
-      }
+    shift = 8 * ( pass < 8 ? pass : pass - 8 );
+    memset( count, 0, sizeof( count ) );
+    for( i = 0; i < n; i++ ){
+      key = pass < 8 ? src[ i ].skey : src[ i ].tkey;
+      count[ ( key >> shift ) & 0xff ]++;
     }
+    key = pass < 8 ? src[ 0 ].skey : src[ 0 ].tkey;
+    if( count[ ( key >> shift ) & 0xff ] == n ){ /* nothing to do */
+      continue;
+    }
+    for( i = 0, j = 0; i < 256; i++ ){ /* bucket offsets */
+      j += count[ i ];
+      count[ i ] = j - count[ i ];
+    }
+    for( i = 0; i < n; i++ ){
+      key = pass < 8 ? src[ i ].skey : src[ i ].tkey;
+      dst[ count[ ( key >> shift ) & 0xff ]++ ] = src[ i ];
+    }
+    sw = src;
+    src = dst;
+    dst = sw;
+  }
+  if( src != recs ){
+    memcpy( recs, src, n * sizeof( struct sortrec ) );
   }
 
-  if( verbose ){
-    for( i = 0; i <= maxrl; i++ ){
-      printf( "# gain[ %ld ]=%f stop[ %ld ]=%f\n", i, gv[ i ], i, sv[ i ] );
+  /* ties of topic and score */
+  for( i = 0; i < n; i = j ){
+    for( j = i + 1; j < n && recs[ j ].tkey == recs[ i ].tkey &&
+	   recs[ j ].skey == recs[ i ].skey; j++ );
+    if( j - i > 1 ){
+      qsort( recs + i, j - i, sizeof( struct sortrec ), sortrec_cmp );
     }
   }
 
-  /* if cutoff is not specified, use default */
-  if( cutoff_num == 0 ){
-    cutoff_num = 1;
-    cutoff[ 0 ] = DEFAULT_CUTOFF;
+  return( 0 );
+
+}/* of sortrun_sort */
+
+int sortrec_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  const struct sortrec *x = ( const struct sortrec *)a;
+  const struct sortrec *y = ( const struct sortrec *)b;
+  int c;
+
+  if( ( c = strcmp( y->doc, x->doc ) ) != 0 ){ /* docID descending */
+    return( c );
   }
+  return( x->order < y->order ? -1 : x->order > y->order );
+}
 
-  /* set Xrelnum[], jrelnum and jnonrelnum */
-  if( ec_mode ){
+/******************************************************************************
+  sortrun_spill
+
+writes n sorted lines to a temporary file (removed when closed).
+
+return value: the file, rewound (OK)
+              NULL (ERROR)
+******************************************************************************/
+FILE *sortrun_spill( recs, n )
+     struct sortrec *recs; /* i */
+     long n;               /* i */
+{
+  long i;
 
-    if( ( jrelnum = count_ECjudged( maxrl, Xrelnum, fa ) ) < 0 ){
+  FILE *f;
 
+  if( ( f = tmpfile() ) == NULL ){
 #ifdef OUTERR
-      fprintf( stderr, "count_ECjudged failed\n" );
+    fprintf( stderr, "Cannot create a temporary file\n" );
 #endif
-      return( -1 );
-    }
-
+    return( NULL );
   }
-  else{ /* not ec_mode */
-
-    if( ( jrelnum = count_judged( maxrl, Xrelnum, fa ) ) < 0 ){
-
+  for( i = 0; i < n; i++ ){
+    fputs( recs[ i ].line, f );
+    putc( '\n', f );
+  }
+  if( fflush( f ) != 0 || ferror( f ) ){
 #ifdef OUTERR
-      fprintf( stderr, "count_judged failed\n" );
+    fprintf( stderr, "Cannot write a temporary file\n" );
 #endif
-      return( -1 );
-    }
+    fclose( f );
+    return( NULL );
   }
+  rewind( f );
 
-  fclose( fa );
+  return( f );
 
-  if( jrelnum == 0 ){
+}/* of sortrun_spill */
+
+/******************************************************************************
+  sortrun_merge
+
+merges sorted chunk files and outputs their lines.
+On complete ties, the line of the earlier chunk comes first.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int sortrun_merge( ctx, chunks, nchunks )
+     struct nev_ctx *ctx;
+     FILE **chunks;   /* i */
+     long nchunks;    /* i */
+{
+  long i;
+  long best;
+
+  char *bufs;
+
+  struct sortrec *heads; /* next line of each chunk (line NULL: done) */
 
+  int sortrun_next();
+  int sortrun_cmp();
+
+  if( ( heads = ( struct sortrec *)
+	malloc( nchunks * sizeof( struct sortrec ) ) ) == NULL ||
+      ( bufs = ( char *)malloc( nchunks * 2 * ( BUFSIZ + 1 ) ) ) == NULL ){
 #ifdef OUTERR
-    fprintf( stderr, "no rel doc\n" );
+    fprintf( stderr, "malloc failed\n" );
 #endif
     return( -1 );
   }
+  for( i = 0; i < nchunks; i++ ){
+    heads[ i ].line = bufs + i * 2 * ( BUFSIZ + 1 );
+    sortrun_next( ctx, chunks[ i ], &heads[ i ] );
+  }
 
-  if( ( ignore_unjudged == 1 ) && ( Xrelnum[ 0 ] == 0 ) ){
+  while( 1 ){
 
-#ifdef OUTERR
-    fprintf( stderr,
-             "no judged nonrel: bpref etc. not computable\n" );
-#endif
-    return( -1 );
+    best = -1;
+    for( i = 0; i < nchunks; i++ ){
+      if( heads[ i ].line != NULL &&
+	  ( best < 0 || sortrun_cmp( &heads[ i ], &heads[ best ] ) < 0 ) ){
+	best = i;
+      }
+    }
+    if( best < 0 ){
+      break;
+    }
+    nev_printf( ctx, "%s\n", heads[ best ].line );
+    sortrun_next( ctx, chunks[ best ], &heads[ best ] );
   }
 
-  /* store system output with labels */
-  if( ( syslen = file2strstrlist2( fs, &sysdoclab ) ) < 0 ){
+  free( heads );
+  free( bufs );
 
-#ifdef OUTERR
-    fprintf( stderr, "file2strstrlist2 failed\n" );
-#endif
-    return( -1 );
+  return( 0 );
+
+}/* of sortrun_merge */
+
+/******************************************************************************
+  sortrun_next
+
+reads the next line of a chunk file into r
+(r->line points to 2 * ( BUFSIZ + 1 ) bytes: the line and its fields;
+r->line is set to NULL at the end of the file).
+
+return value: 1 (a line was read)
+              0 (end of file)
+******************************************************************************/
+int sortrun_next( ctx, f, r )
+     struct nev_ctx *ctx;
+     FILE *f;            /* i */
+     struct sortrec *r;  /* i/o */
+{
+  char *fld[ 5 ];
+  char *p;
+
+  long splitfields();
+  unsigned long long sortrun_scorekey();
+
+  if( r->line == NULL ||
+      fgets( r->line, BUFSIZ + 1, f ) == NULL ){
+    r->line = NULL;
+    return( 0 );
+  }
+  if( ( p = strchr( r->line, '\n' ) ) != NULL ){
+    *p = '\0';
   }
 
-  fclose( fs );
+  /* lines were checked before they were written */
+  strcpy( r->line + BUFSIZ + 1, r->line );
+  splitfields( ctx, r->line + BUFSIZ + 1, fld, 5 );
+  r->tid = fld[ 0 ];
+  r->doc = fld[ 2 ];
+  r->skey = sortrun_scorekey( strtod( fld[ 4 ], NULL ) );
 
-  printf( "%s # syslen=%ld jrel=%ld jnonrel=%ld\n",
-	  outstr, syslen, jrelnum, Xrelnum[ 0 ] );
+  return( 1 );
 
-  /* maxlen = max( jrelnum, syslen ) */
-  maxlen = jrelnum;
-  if( maxlen < syslen ){
-    maxlen = syslen;
+}/* of sortrun_next */
+
+int sortrun_cmp( x, y )
+     struct sortrec *x;
+     struct sortrec *y;
+{
+  int c;
+
+  if( ( c = strcmp( x->tid, y->tid ) ) != 0 ){
+    return( c );
   }
+  if( x->skey != y->skey ){
+    return( x->skey < y->skey ? -1 : 1 );
+  }
+  return( strcmp( y->doc, x->doc ) );
+}
 
-  CGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  DCGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  msDCGi = ( double *)calloc( maxlen + 1, sizeof( double ) );
+/******************************************************************************
+  eval_stream
 
-  Gs = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  CGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  DCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  msDCGs = ( double *)calloc( maxlen + 1, sizeof( double ) );
+evaluates a TREC run against an NTCIR-format qrels file topic by topic,
+as splitqrels, splitruns, label and compute would, without per-topic
+files and without holding the run in memory:
 
-  count = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  BR = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  Ss = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  ntcir_eval stream -r <qrels> -g <gains> [-j] [-truncate <rank>]
+                    [-sep <sep>] [compute options] [runfile]
 
-  RBPpower = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  RBPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+qrels: <topicID> <docID> <relevance_level>
+run (stdin if no runfile): <topicID> Q0 <docID> <rank> <score> <runname>
 
-  ERR = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  ERRdsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  ERRi = ( double *)calloc( maxlen + 1, sizeof( double ) );
-  ERRidsat = ( double *)calloc( maxlen + 1, sizeof( double ) );
+The qrels stay in memory, bucketed by topic. The run is read line by
+line and must be grouped by topic (see sortrun); docIDs are kept in
+file order, as splitruns does. As soon as the next topic starts, the
+labelled list of the current topic (built as label does) is evaluated
+by compute with -out <topicID>, and its memory is released, so memory
+is bounded by the qrels and the largest topic of the run
+(ctx->res keeps the results of the last topic only).
 
-  /* 2018 EBR */
-  EBR = ( double *)calloc( maxlen + 1, sizeof( double ) );
+Topics of the run that are not in the qrels are skipped; topics of the
+qrels that are not in the run are evaluated last (in topicID order)
+with an empty list, as their empty res files would be.
+-truncate keeps the first <rank> docs of each topic
+(splitruns keeps DEFAULT_SPLIT_DOCLIMIT); -j and -ec are used by label
+and compute. Other options are passed to compute.
 
-  /* intentwise RBU */
-  if( RBUp > 0 ){ /* RBUp has been specified */
-    iRBU = ( double *)calloc( maxlen + 1, sizeof( double ) );
+return value: 0 (OK)
+             -1 (NG: e.g. a topic that compute could not evaluate)
+******************************************************************************/
+static int eval_stream( struct nev_ctx *ctx, int ac, char **av )
+{
+  int argc = 2;
+  int cac = 2;
+  int gains = 0;
+  int retv = 0;
+  int r;
+
+  long i;
+  long idx;
+  long cur = -1; /* index of the topic being read */
+  long ndocs = 0;
+  long ntopics = 0;
+  long nmissing = 0;
+  long nfailed = 0;
+  long *ecids = NULL;  /* -ec: EC IDs of the rel lines of the topic */
+  long truncaterank = 0;
+  /* by default, do not truncate */
+
+  size_t lablen = 0;
+  size_t labsize = 0;
+  size_t len;
+
+  char line[ BUFSIZ + 1 ];
+  char copy[ BUFSIZ + 1 ];
+  char *fld[ 3 ];
+  char *pos;
+  char *qrels = NULL;
+  char *lab = NULL;   /* labelled list of the current topic */
+  char **labels = NULL;
+  char ecbuf[ 32 ];   /* -ec: <EC ID> of a labelled doc */
+  char **cav;         /* arguments for compute */
+  char **missing = NULL;
+
+  void *p;
+
+  FILE *fs = ctx->in;
+  FILE *f;
+
+  struct splittopic *topics = NULL;
+  struct splittopic *t;
+  struct strhash tidhash;
+  struct strhash relh;  /* docID -> row in the rel lines of the topic */
+  struct genseen done;
+  struct arenamark mark;
+
+  long splitfields();
+  long strhash_get();
+  int strhash_init();
+  int strhash_free();
+  struct splittopic *splittopic_get();
+  int splittopic_add();
+  int splittopic_free();
+  int genseen_init();
+  int genseen_reset();
+  int genseen_set();
+  int genseen_test();
+  int genseen_free();
+  int arena_mark();
+  int arena_release();
+  int strp_cmp();
+  int stream_index();
+  int stream_puts();
+  FILE *gzin_fopen();
+
+  if( ( cav = ( char **)malloc( ( ac + 3 ) * sizeof( char * ) ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
   }
+  cav[ 0 ] = av[ 0 ];
+  cav[ 1 ] = "compute";
 
-  if( compute_gap ){
-    GAPsum = ( double *)calloc( maxlen + 1, sizeof( double ) );
-    GAPisum = ( double *)calloc( maxlen + 1, sizeof( double ) );
+  memset( &tidhash, 0, sizeof( struct strhash ) );
+  memset( &relh, 0, sizeof( struct strhash ) );
+  memset( &done, 0, sizeof( struct genseen ) );
+
+  ctx->ignore_unjudged = 0;
+
+  while( argc < ac ){
+
+    if( strcmp( av[ argc ], OPTSTR_RELFILE ) == 0 && ( argc + 1 < ac ) ){
+      qrels = av[ argc + 1 ];
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_TRUNCATE ) == 0 && ( argc + 1 < ac ) ){
+      truncaterank = atol( av[ argc + 1 ] );
+      if( truncaterank < 1 ){
+
+#ifdef OUTERR
+        fprintf( stderr, "Bad %s value\n", OPTSTR_TRUNCATE );
+#endif
+	if( fs != ctx->in ){
+	  fclose( fs );
+	}
+	free( cav );
+        return( -1 );
+      }
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
+      ctx->sep = strdup( av[ argc + 1 ] );
+      argc += 2;
+    }
+    else if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ||
+	     strcmp( av[ argc ], OPTSTR_VERBOSE ) == 0 ||
+	     strcmp( av[ argc ], OPTSTR_GAP ) == 0 ||
+	     strcmp( av[ argc ], OPTSTR_EC ) == 0 ||
+	     strcmp( av[ argc ], OPTSTR_HELP ) == 0 ){ /* compute flags */
+      if( strcmp( av[ argc ], OPTSTR_IGNORE_UNJUDGED ) == 0 ){
+	ctx->ignore_unjudged = 1; /* for labelling */
+      }
+      else if( strcmp( av[ argc ], OPTSTR_EC ) == 0 ){
+	ctx->ec_mode = 1; /* for labelling */
+      }
+      cav[ cac++ ] = av[ argc ];
+      argc++;
+    }
+    else if( av[ argc ][ 0 ] == '-' && av[ argc ][ 1 ] != '\0' &&
+	     ( argc + 1 < ac ) ){ /* compute option with a value */
+      if( strcmp( av[ argc ], OPTSTR_GAIN ) == 0 ){
+	gains = 1;
+      }
+      cav[ cac++ ] = av[ argc ];
+      cav[ cac++ ] = av[ argc + 1 ];
+      argc += 2;
+    }
+    /* run file */
+    else{
+      if( fs != ctx->in ){
+	fclose( fs );
+      }
+      if( ( fs = gzin_fopen( av[ argc ] ) ) == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "Cannot open %s\n", av[ argc ] );
+#endif
+	free( cav );
+	return( -1 );
+      }
+      argc++;
+    }
   }
 
-  /* Store ideal cumulative gain etc. */
-
-  ERRi[ 0 ] = 0;
-  ERRidsat[ 0 ] = 1;
+  if( qrels == NULL || gains == 0 ){
 
-  /* koko */
-  
-  i = 1;
-  for( rlevel = maxrl; rlevel >= 1; rlevel-- ){
-    
-    for( j = 1;  j <= Xrelnum[ rlevel ]; j++ ){
+#ifdef OUTERR
+    fprintf( stderr,
+	     "Usage: %s %s %s <qrels> %s <gains> [%s] [%s <rank>] [%s <separator>] [compute options] [runfile]\n",
+	     av[ 0 ], av[ 1 ], OPTSTR_RELFILE, OPTSTR_GAIN,
+	     OPTSTR_IGNORE_UNJUDGED, OPTSTR_TRUNCATE, OPTSTR_SEP );
+#endif
+    if( fs != ctx->in ){
+      fclose( fs );
+    }
+    free( cav );
+    return( 0 );
+  }
 
-      CGi[ i ] = CGi[ i - 1 ] + gv[ rlevel ];
-      DCGi[ i ] = DCGi[ i - 1 ] + gv[ rlevel ]/orig_dcglog( logbase, i );
-      /* For MSnDCG, the logbase is irrelevant */
-      msDCGi[ i ] = msDCGi[ i - 1 ] + gv[ rlevel ]/log( i + 1 );
+  if( ctx->sep == NULL ){
+    ctx->sep = strdup( DEFAULT_SEP );
+  }
+  cav[ cac++ ] = OPTSTR_OUTSTR;
+  cav[ cac ] = NULL; /* topicID: set by stream_topic */
+  cav[ cac + 1 ] = NULL;
 
-      if( compute_gap ){
-	GAPisum[ i ] = GAPisum[ i - 1 ] + rlevel * ( rlevel + 1 );
-      }
+  STATS_PHASE( ctx, STATS_LOADQRELS );
 
-      ERRi[ i ] = ERRi[ i - 1 ] + ( ERRidsat[ i - 1 ]/i ) * ( gv[ rlevel ]/( gv[ maxrl ]+1 ) );
-      ERRidsat[ i ] = ERRidsat[ i - 1 ] * ( 1 - gv[ rlevel ]/( gv[ maxrl ]+1 ) );
+  /* qrels, bucketed by topic as splitqrels does */
+  if( ( f = gzin_fopen( qrels ) ) == NULL ){
 
-      i++;
-    }
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", qrels );
+#endif
+    retv = -1;
   }
-  for( i = jrelnum + 1; i <= maxlen; i++ ){ /* if ideal size < system size */
-    CGi[ i ] = CGi[ jrelnum ];
-    DCGi[ i ] = DCGi[ jrelnum ];
-    msDCGi[ i ] = msDCGi[ jrelnum ];
+  else if( strhash_init( &tidhash, STRHASH_INITSIZE ) < 0 ||
+	   genseen_init( &done, GENSEEN_INITSIZE ) < 0 ){
+    retv = -1;
+  }
+  while( retv == 0 && fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
-    if( compute_gap ){
-      GAPisum[ i ] = GAPisum[ jrelnum ];
+    if( ( pos = strchr( line, '\n' ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "Line too long: %s\n", line );
+#endif
+      retv = -1;
+      break;
     }
+    *pos = '\0';
 
-    ERRi[ i ] = ERRi[ jrelnum ];
+    strcpy( copy, line );
+    if( splitfields( ctx, copy, fld, 1 ) < 1 || fld[ 0 ][ 0 ] == '\0' ){
+      continue; /* no topicID */
+    }
+    if( ( t = splittopic_get( &ctx->arena, &tidhash, &topics, &ntopics,
+			      fld[ 0 ] ) ) == NULL ){
+      retv = -1;
+      break;
+    }
 
+    /* remove "<topicID><sep>" as splitqrels does */
+    len = strlen( t->tid );
+    pos = line;
+    if( strncmp( line, t->tid, len ) == 0 &&
+	strncmp( line + len, ctx->sep, strlen( ctx->sep ) ) == 0 ){
+      pos = line + len + strlen( ctx->sep );
+    }
+    if( splittopic_add( &ctx->arena, t, pos, NULL, 0 ) < 0 ){
+      retv = -1;
+      break;
+    }
+  }
+  if( f != NULL ){
+    fclose( f );
   }
 
-  if( verbose ){
-    printf( "\n" );
-    for( i = 1; i <= maxlen; i++ ){
-      printf( "#%ld CGi=%.4f DCGi=%.4f msDCGi=%.4f\n",
-	      i, CGi[ i ], DCGi[ i ], msDCGi[ i ] );
+  /* keep the index compact: trim the rel lines of each topic */
+  for( i = 0; i < ntopics; i++ ){
+    t = &topics[ i ];
+    if( t->num > 0 && t->num < t->size &&
+	( p = realloc( t->rec, t->num * sizeof( struct splitrec ) ) ) != NULL ){
+      t->rec = ( struct splitrec *)p;
+      t->size = t->num;
     }
   }
 
-  /* store system cumulative gain, etc. */
+  /* -ec: ECs seen in the ranked list of a topic, as label keeps them */
+  if( retv == 0 && ctx->ec_mode && ctx->ecseen.stamp == NULL &&
+      genseen_init( &ctx->ecseen, GENSEEN_INITSIZE ) < 0 ){
+    retv = -1;
+  }
 
-  RBPpower[ 1 ] = 1;
-  RBPsum[ 0 ] = 0;
-  ERR[ 0 ] = 0;
-  ERRdsat[ 0 ] = 1;
-  EBR[ 0 ] = 0; /* 2018 */
-  
-  if( RBUp > 0 )
-    iRBU[ 0 ] = 0; /* intentwise RBU */
+  arena_mark( &ctx->arena, &mark );
 
-  doc = sysdoclab;
-  
-  for( i = 1; i<= syslen; i++ ){
+  STATS_PHASE( ctx, STATS_LABEL );
 
-    if( strcmp( doc->string2, "" ) != 0 ){ /* judged doc */
+  while( retv == 0 && fgets( line, sizeof( line ), fs ) ){
+    STATS_LINE( ctx, line );
 
-      if( ( rlevel = lab2level( doc->string2 ) ) < 0 ){
+    if( ( pos = strchr( line, '\n' ) ) != NULL ){
+      *pos = '\0';
+    }
+    else if( strlen( line ) == sizeof( line ) - 1 ){
 #ifdef OUTERR
-	fprintf( stderr, "lab2level failed for %s\n", doc->string2 );
+      fprintf( stderr, "Line too long: %s\n", line );
 #endif
-	return( -1 );
-	
-      }
-
-      if( rlevel > 0 ){ /* relevant doc */
-
-	count[ i ] = count[ i - 1 ] + 1;
-	Gs[ i ] = gv[ rlevel ];
-	Ss[ i ] = sv[ rlevel ];
-	CGs[ i ] = CGs[ i - 1 ] + gv[ rlevel ];
-	DCGs[ i ] = DCGs[ i - 1 ] + gv[ rlevel ]/orig_dcglog( logbase, i );
-	/* For MSnDCG, the logbase is irrelevant */
-	msDCGs[ i ] = msDCGs[ i - 1 ] + gv[ rlevel ]/log( i + 1 );
-
-	if( compute_gap ){ /* do rather expensive GAP computation */
+      retv = -1;
+      break;
+    }
 
-	  doc2 = sysdoclab;
-	  GAPsum[ i ] = 0.0;
-	  for( j = 1; j <= i; j++ ){
+    /* <topicID> Q0 <docID> ... */
+    if( splitfields( ctx, line, fld, 3 ) < 3 ||
+	( idx = strhash_get( &tidhash, fld[ 0 ] ) ) < 0 ){
+      continue; /* not in the qrels */
+    }
 
-	    if( strcmp( doc2->string2, "" ) != 0 ){ /* judged doc */
+    if( idx != cur ){ /* a new topic */
 
-	      if( ( rlevel2 = lab2level( doc2->string2 ) ) < 0 ){
+      if( genseen_test( &done, idx ) ){
 #ifdef OUTERR
-		fprintf( stderr, "lab2level failed for %s\n", doc2->string2 );
+	fprintf( stderr, "%s: run not grouped by topic (%s): use sortrun\n",
+		 av[ 1 ], fld[ 0 ] );
 #endif
-		return( -1 );
-	      }
-	    }
-	    else{ /* doc at rank j is an unjudged doc */
-	      rlevel2 = 0;
-	    }
-
-	    /* min(rl,rl2) * (min(rl,rl2)+1) */
-	    /* note: compare relevance levels, not the gain values */
-	    if( rlevel < rlevel2 ){
-	      GAPsum[ i ] += rlevel * (rlevel + 1);
-	    }
-	    else{
-	      GAPsum[ i ] += rlevel2 * (rlevel2 + 1);
-	    }
-
-	    doc2 = doc2->next;
-	  }
-	  
-	}
-
-	if( count[ i ] == 1 ){ /* first relevant document */
-	  r1 = i; /* for RR and O-measure */
-	}
-
-	if( maxrl_system < rlevel ){ /* highest relevance level so far? */
-	  maxrl_system = rlevel;
-	  rp = i; /* preferred rank for P-measure and P-plus */
+	retv = -1;
+	break;
+      }
+      if( cur >= 0 ){ /* the previous topic is complete */
+	if( stream_topic( ctx, &topics[ cur ], lab, lablen, cac, cav ) < 0 ){
+	  nfailed++;
 	}
+	strhash_free( &relh );
+	arena_release( &ctx->arena, &mark );
+	STATS_PHASE( ctx, STATS_LABEL );
       }
-      else{ /* judged nonrel doc */
 
-	count[ i ] = count[ i - 1 ];
-	CGs[ i ] = CGs[ i - 1 ];
-	DCGs[ i ] = DCGs[ i - 1 ];
-	msDCGs[ i ] = msDCGs[ i - 1 ];
-	
+      cur = idx;
+      genseen_set( &done, cur );
+      lablen = 0;
+      ndocs = 0;
+      if( ctx->ec_mode ){
+	genseen_reset( &ctx->ecseen );
+      }
+      if( stream_index( ctx, &topics[ cur ], &relh, &labels, &ecids ) < 0 ){
+	retv = -1;
+	break;
       }
-
     }
-    else{ /* unjudged doc */
 
-      count[ i ] = count[ i - 1 ];
-      CGs[ i ] = CGs[ i - 1 ];
-      DCGs[ i ] = DCGs[ i - 1 ];
-      msDCGs[ i ] = msDCGs[ i - 1 ];
+    if( truncaterank > 0 && ndocs >= truncaterank ){
+      continue;
     }
+    ndocs++;
 
-    /* blended ratio */
-    BR[ i ] = ( qbeta * CGs[ i ] + count[ i ] )/( qbeta * CGi[ i ] + i );
-
-    if( i > 1 ){
-      RBPpower[ i ] = RBPp * RBPpower[ i - 1 ];
+    /* label: <docID><sep><label>[<sep><EC ID>] if judged */
+    STATS_LOOKUP( ctx );
+    if( ( i = strhash_get( &relh, fld[ 2 ] ) ) < 0 &&
+	ctx->ignore_unjudged ){ /* condensed-list mode */
+      continue;
     }
-    RBPsum[ i ] = RBPsum[ i - 1 ] + Gs[ i ] * RBPpower[ i ];
+    if( i >= 0 && ctx->ec_mode ){ /* as label_doc does */
+      if( ( r = genseen_set( &ctx->ecseen, ecids[ i ] - 1 ) ) < 0 ){
+	retv = -1;
+	break;
+      }
+      if( r == 1 ){
+	i = -1; /* EC already seen: regard as nonrelevant */
+      }
+      else{
+	snprintf( ecbuf, sizeof( ecbuf ), "%ld", ecids[ i ] );
+      }
+    }
+    if( stream_puts( &lab, &lablen, &labsize, fld[ 2 ] ) < 0 ||
+	( i >= 0 &&
+	  ( stream_puts( &lab, &lablen, &labsize, ctx->sep ) < 0 ||
+	    stream_puts( &lab, &lablen, &labsize, labels[ i ] ) < 0 ) ) ||
+	( i >= 0 && ctx->ec_mode &&
+	  ( stream_puts( &lab, &lablen, &labsize, ctx->sep ) < 0 ||
+	    stream_puts( &lab, &lablen, &labsize, ecbuf ) < 0 ) ) ||
+	stream_puts( &lab, &lablen, &labsize, "\n" ) < 0 ){
+      retv = -1;
+      break;
+    }
+  }
+  if( fs != ctx->in ){
+    fclose( fs );
+  }
+  if( retv == 0 && cur >= 0 ){
+    if( stream_topic( ctx, &topics[ cur ], lab, lablen, cac, cav ) < 0 ){
+      nfailed++;
+    }
+    strhash_free( &relh );
+    arena_release( &ctx->arena, &mark );
+  }
 
-    /* divide gain by maxgain+1 rather than maxgain to make sure
-       rel prob < 1 even for a highly rel doc.
-       Otherwise, all docs after the first highly rel doc
-       will be ignored.
-       Note that, because of this, ERR in as defined here
-       and in CIKM09 paper Eq.4 does NOT reduce to RR even in the
-       binary relevance case.
-    */
-    ERR[ i ] = ERR[ i - 1 ] + ( ERRdsat[ i - 1 ]/i ) * ( Gs[ i ]/( gv[ maxrl ]+1 ) );
-    ERRdsat[ i ] = ERRdsat[ i - 1 ] * ( 1 - Gs[ i ]/( gv[ maxrl ]+1 ) );
+  /* topics without docs in the run */
+  if( retv == 0 &&
+      ( missing = ( char **)malloc( ( ntopics + 1 ) * sizeof( char * ) ) )
+      == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    retv = -1;
+  }
+  for( i = 0; retv == 0 && i < ntopics; i++ ){
+    if( !genseen_test( &done, i ) ){
+      missing[ nmissing++ ] = topics[ i ].tid;
+    }
+  }
+  if( nmissing > 0 ){
+    qsort( missing, nmissing, sizeof( char * ), strp_cmp );
+  }
+  for( i = 0; i < nmissing; i++ ){
+    if( stream_topic( ctx, &topics[ strhash_get( &tidhash, missing[ i ] ) ],
+		      NULL, 0, cac, cav ) < 0 ){
+      nfailed++;
+    }
+    arena_release( &ctx->arena, &mark );
+  }
 
-    /* 2018 */
-    EBR[ i ] = EBR[ i - 1 ] + BR[ i ]*ERRdsat[ i - 1 ]*Gs[ i ]/( gv[ maxrl ]+1 );
+  free( missing );
+  free( lab );
+  free( cav );
+  for( i = 0; i < ntopics; i++ ){
+    splittopic_free( &topics[ i ] );
+  }
+  free( topics );
+  strhash_free( &relh ); /* still set if an error stopped the run */
+  strhash_free( &tidhash );
+  genseen_free( &done );
 
-    if( RBUp > 0 ){ /* if RBUp has been specified */
-      iRBU[ i ] = iRBU[ i - 1 ] +
-	pow( RBUp, i ) * ERRdsat[ i - 1 ]*Gs[ i ]/( gv[ maxrl ]+1 );
-    }
-	
-    doc = doc->next;
+  if( retv == 0 && nfailed > 0 ){
+#ifdef OUTERR
+    fprintf( stderr, "%s: %ld topics not evaluated\n", av[ 1 ], nfailed );
+#endif
+    retv = -1;
   }
 
-  freestrstrlist( &sysdoclab );
+  return( retv );
 
-  for( i = syslen + 1; i <= maxlen; i++ ){ /* if system size < ideal size */
+}/* of eval_stream */
 
-    count[ i ] = count[ syslen ];
-    CGs[ i ] = CGs[ syslen ];
-    DCGs[ i ] = DCGs[ syslen ];
-    msDCGs[ i ] = msDCGs[ syslen ];
-    ERR[ i ] = ERR[ syslen ];
-    /* 2018 */
-    EBR[ i ] = EBR[ syslen ];
-    if( RBUp > 0 ){
-      iRBU[ i ] = iRBU[ syslen ];
-    }
-    RBPsum[ i ] = RBPsum[ syslen ]; /* RBP@l 2018 */
+/******************************************************************************
+  stream_topic
 
-    /* no need to compute BR beyond syslen */
+evaluates one topic for stream: runs compute with the labelled list
+lab (lablen bytes) as system output and the rel lines of t as the
+rel assessments, with -out <topicID>.
+The results of the previous topic are cleared from ctx->res first.
+
+return value: return value of compute (0: OK)
+******************************************************************************/
+static int stream_topic( struct nev_ctx *ctx, struct splittopic *t,
+			 char *lab, size_t lablen, int cac, char **cav )
+{
+  int retv;
+
+  long j;
 
+  size_t len = 0;
+  size_t n;
+
+  char *rel;
+
+  FILE *in = ctx->in;
+
+  void *arena_alloc();
+
+  for( j = 0; j < t->num; j++ ){
+    len += strlen( t->rec[ j ].str ) + 1;
+  }
+  if( ( rel = ( char *)arena_alloc( &ctx->arena, len + 1 ) ) == NULL ){
+    return( -1 );
+  }
+  for( len = 0, j = 0; j < t->num; j++ ){
+    n = strlen( t->rec[ j ].str );
+    memcpy( rel + len, t->rec[ j ].str, n );
+    rel[ len + n ] = '\n';
+    len += n + 1;
   }
 
-  if( verbose ){
-    printf( "\n" );
-    for( i = 1; i <= syslen; i++ ){
-      if( Gs[ i ] > 0 ){
-	printf( "#%ld count=%ld Gs=%.4f CGs=%.4f DCGs=%.4f msDCGs=%.4f BR=%.4f\n",
-		i, (long)count[ i ], Gs[ i ], CGs[ i ], DCGs[ i ], msDCGs[ i ], BR[ i ] );
-      }
-    }
-    printf( "\n" );
+  if( ( ctx->rel = fmemopen( rel, len, "r" ) ) == NULL ||
+      ( ctx->in = ( lablen == 0 ) ? fopen( "/dev/null", "r" ) :
+	fmemopen( lab, lablen, "r" ) ) == NULL ){
+#ifdef OUTERR
+    fprintf( stderr, "fmemopen failed\n" );
+#endif
+    ctx->in = in;
+    return( -1 );
   }
 
-  printf( "%s # r1=%ld rp=%ld\n", outstr, r1, rp );
+  cav[ cac ] = t->tid; /* -out <topicID> */
+  nev_clear( ctx ); /* keep ctx->res to one topic */
+  retv = eval_compute( ctx, cac + 1, cav );
 
+  fclose( ctx->in );
+  ctx->in = in;
+  if( ctx->rel ){ /* compute failed before reading it */
+    fclose( ctx->rel );
+    ctx->rel = NULL;
+  }
+  free( ctx->outstr );
+  ctx->outstr = NULL;
 
-  /***** output evaluation metric values *****/
+  return( retv );
 
-  /* RR, O-measure, P-measure, P-plus */
-  if( r1 == 0 ){ /* no relevant doc in system output */
-    printf( "%s RR=                  %.4f\n", outstr, (double)0 );
-    printf( "%s O-measure=           %.4f\n", outstr, (double)0 );
-    printf( "%s P-measure=           %.4f\n", outstr, (double)0 );
-    printf( "%s P-plus=              %.4f\n", outstr, (double)0 );
+}/* of stream_topic */
+
+/******************************************************************************
+  stream_index
+
+indexes the rel lines of a topic for stream, as label reads a rel file:
+labels[ i ] is the relevance level of the docID found at row i of h
+and, with -ec, ecids[ i ] is its EC ID (the first line of a docID is used).
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int stream_index( ctx, t, h, labels, ecids )
+     struct nev_ctx *ctx;
+     struct splittopic *t;  /* i */
+     struct strhash *h;     /* o: docID -> row */
+     char ***labels;        /* o */
+     long **ecids;          /* o: -ec only */
+{
+  long j;
+
+  char *buf;
+  char *doc;
+  char *ec;
+  char *saveptr; /* for strtok_r */
+
+  void *arena_alloc();
+  char *arena_strdup();
+  int strhash_init();
+  long strhash_add();
+
+  if( strhash_init( h, STRHASH_INITSIZE ) < 0 ||
+      ( *labels = ( char **)arena_alloc( &ctx->arena,
+					 ( t->num + 1 ) * sizeof( char * ) ) )
+      == NULL ){
+    return( -1 );
   }
-  else{ /* at least one rel doc in system output */
-    printf( "%s RR=                  %.4f\n", outstr, (double)1/r1 );
-    printf( "%s O-measure=           %.4f\n", outstr, BR[ r1 ] );
-    printf( "%s P-measure=           %.4f\n", outstr, BR[ rp ] );
-    sum = 0.0;
-    for( i = 1; i <= rp; i++ ){
-      if( Gs[ i ] > 0 ){
-	sum += BR[ i ];
-      }
-    }
-    printf( "%s P-plus=              %.4f\n", outstr, sum/count[ rp ] );
+  if( ctx->ec_mode &&
+      ( *ecids = ( long *)arena_alloc( &ctx->arena,
+				       ( t->num + 1 ) * sizeof( long ) ) )
+      == NULL ){
+    return( -1 );
   }
 
-  /* AP and Q */ 
-  sum = 0.0; sum2 = 0.0; 
-  for( i = 1; i <= syslen; i++ ){
-    if( Gs[ i ] > 0 ){
-      sum += count[ i ]/i;
-      sum2 += BR[ i ];
+  for( j = 0; j < t->num; j++ ){
+
+    if( ( buf = arena_strdup( &ctx->arena, t->rec[ j ].str ) ) == NULL ){
+      return( -1 );
+    }
+    if( ( doc = strtok_r( buf, ctx->sep, &saveptr ) ) == NULL ||
+	( ( *labels )[ j ] = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ||
+	( ctx->ec_mode &&
+	  ( ( ec = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ||
+	    ( ( *ecids )[ j ] = atol( ec ) ) < 1 ||
+	    ( *ecids )[ j ] > EC_NUMMAX ) ) ){
+#ifdef OUTERR
+      fprintf( stderr, "Bad rel line for topic %s: %s\n",
+	       t->tid, t->rec[ j ].str );
+#endif
+      return( -1 );
+    }
+    if( strhash_add( h, doc, j ) < 0 ){
+      return( -1 );
     }
   }
-  printf( "%s AP=                  %.4f\n", outstr, sum/jrelnum );
-  printf( "%s Q-measure=           %.4f\n", outstr, sum2/jrelnum );
-    
-  /* NCU measures */
 
-  /* graded-uniform NCU */
+  return( 0 );
 
-  denom = 0.0;
-  for( i = 1; i <= maxrl; i++ ){
-    denom += Xrelnum[ i ] * sv[ i ];
-  }
+}/* of stream_index */
 
-  sum = 0.0; sum2 = 0.0;
-  for( i = 1; i <= syslen; i++ ){
-    if( Gs[ i ] > 0 ){
-      sum += ( count[ i ]/i ) * Ss[ i ];
-      sum2 += BR[ i ] * Ss[ i ];
-    }
-  }
-  printf( "%s NCUgu,P=             %.4f\n", outstr, sum/denom );
-  printf( "%s NCUgu,BR=            %.4f\n", outstr, sum2/denom );
+/******************************************************************************
+  stream_puts
 
-  /* rank-biased NCU */
+appends s to a growing buffer (not terminated)
 
-  denom = 0.0;
-  for( i = 1; i <= jrelnum; i++ ){
-    denom += pow( gamma, i-1 );
-  }
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int stream_puts( buf, len, size, s )
+     char **buf;    /* i/o */
+     size_t *len;   /* i/o */
+     size_t *size;  /* i/o */
+     const char *s; /* i */
+{
+  size_t n;
 
-  sum = 0.0; sum2 = 0.0;
-  for( i = 1; i <= syslen; i++ ){
-    if( Gs[ i ] > 0 ){
-      sum += ( count[ i ]/i ) * pow( gamma, count[ i ]-1 );
-      sum2 += BR[ i ] * pow( gamma, count[ i ]-1 );
+  n = strlen( s );
+  if( *len + n > *size ){
+    while( *len + n > *size ){
+      *size = ( *size == 0 ) ? BUFSIZ : 2 * *size;
+    }
+    if( ( *buf = ( char *)realloc( *buf, *size ) ) == NULL ){
+#ifdef OUTERR
+      fprintf( stderr, "realloc failed\n" );
+#endif
+      return( -1 );
     }
   }
-  printf( "%s NCUrb,P=             %.4f\n", outstr, sum/denom );
-  printf( "%s NCUrb,BR=            %.4f\n", outstr, sum2/denom );
+  memcpy( *buf + *len, s, n );
+  *len += n;
 
-  /* GAP */
-  if( compute_gap ){
+  return( 0 );
 
-    sum = 0.0;
-    for( i = 1; i <= syslen; i++ ){
-      sum += GAPsum[ i ]/i;
-    }
-    printf( "%s GAP=                 %.4f\n",
-	    outstr, sum/GAPisum[ jrelnum ] );
-  }
+}/* of stream_puts */
 
-  /* RBP */
-  printf( "%s RBP=                 %.4f\n",
-	  outstr,(1-RBPp)*RBPsum[ syslen ]/gv[ maxrl ] );
-  /* ERR */
-  printf( "%s ERR=                 %.4f\n", outstr, ERR[ syslen ] );
-  /* 2018 EBR */
-  printf( "%s EBR=                 %.4f\n", outstr, EBR[ syslen ] );
+/******************************************************************************
+  splitfields
 
-  /* cutoff-based metrics */
-  for( i = 0; i < cutoff_num; i++ ){
+splits line into fields like awk -F <sep>:
+if sep is a single space, fields are separated by runs of blanks
+(leading and trailing blanks are ignored);
+otherwise, fields are separated by sep itself.
+line is modified and the first maxfld fields are set to fld[].
 
-    /* cutoff-based Q */ 
-    minlen = cutoff[ i ];
-    if( minlen > syslen ){
-      minlen = syslen;
-    }/* minlen = min(cutoff, syslen) */
-    
-    sum = 0.0; sum2 = 0.0;
-    for( j = 1; j <= minlen; j++ ){
-      if( Gs[ j ] > 0 ){
-        sum += count[ j ]/j;
-        sum2 += BR[ j ];
-      }
-    }
+returns the number of fields (NF), which may exceed maxfld
+******************************************************************************/
+long splitfields( ctx, line, fld, maxfld )
+     struct nev_ctx *ctx;
+     char *line;   /* i/o */
+     char **fld;   /* o */
+     long maxfld;  /* i */
+{
+  long nf = 0;
+  long seplen;
 
-    /* divide by min(cutoff, jrelnum ) */
-    if( cutoff[ i ] < jrelnum ){
-      printf( "%s AP@%04ld=             %.4f\n",
-              outstr, cutoff[ i ], sum/cutoff[ i ] );
-      printf( "%s Q@%04ld=              %.4f\n",
-              outstr, cutoff[ i ], sum2/cutoff[ i ] );
-    }
-    else{ 
-      printf( "%s AP@%04ld=             %.4f\n",
-              outstr, cutoff[ i ], sum/jrelnum );
-      printf( "%s Q@%04ld=              %.4f\n",
-              outstr, cutoff[ i ], sum2/jrelnum );
-    }
+  char *p, *q;
 
-    if( compute_gap ){
+  if( strcmp( ctx->sep, " " ) == 0 ){
 
-      sum = 0.0;
-      for( j = 1; j <= minlen; j++ ){
-	sum += GAPsum[ j ]/j;
+    p = line;
+    while( 1 ){
+      while( *p == ' ' || *p == '\t' ){
+	p++;
+      }
+      if( *p == '\0' ){
+	break;
       }
+      q = p;
+      while( *q != '\0' && *q != ' ' && *q != '\t' ){
+	q++;
+      }
+      if( nf < maxfld ){
+	fld[ nf ] = p;
+      }
+      nf++;
+      if( *q == '\0' ){
+	break;
+      }
+      *q = '\0';
+      p = q + 1;
+    }
+  }
+  else if( *line != '\0' ){
 
-      if( cutoff[ i ] < jrelnum ){
-	printf( "%s GAP@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], sum/GAPisum[ cutoff[ i ] ] );
+    seplen = strlen( ctx->sep );
+    p = line;
+    while( 1 ){
+      q = strstr( p, ctx->sep );
+      if( nf < maxfld ){
+	fld[ nf ] = p;
       }
-      else{
-	printf( "%s GAP@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], sum/GAPisum[ jrelnum ] );
+      nf++;
+      if( q == NULL ){
+	break;
       }
-      
+      *q = '\0';
+      p = q + seplen;
     }
+  }
 
-    if( cutoff[ i ] <= maxlen ){
-      
-      printf( "%s nDCG@%04ld=           %.4f\n",
-	      outstr, cutoff[ i ], DCGs[ cutoff[ i ] ]/DCGi[ cutoff[ i ] ]);
-      printf( "%s MSnDCG@%04ld=         %.4f\n",
-	      outstr, cutoff[ i ], msDCGs[ cutoff[ i ] ]/msDCGi[ cutoff[ i ] ]);
-      printf( "%s P@%04ld=              %.4f\n",
-	      outstr, cutoff[ i ], count[ cutoff[ i ] ]/cutoff[ i ] );
-      printf( "%s RBP@%04ld=            %.4f\n",
-	      outstr, cutoff[ i ], (1-RBPp)*RBPsum[ cutoff[ i ] ]/gv[ maxrl ] );
-      printf( "%s ERR@%04ld=            %.4f\n",
-	      outstr, cutoff[ i ], ERR[ cutoff[ i ] ] );
-      printf( "%s nERR@%04ld=           %.4f\n",
-	      outstr, cutoff[ i ], ERR[ cutoff[ i ] ]/ERRi[ cutoff[ i ] ]);
-      /* 2018 */
-      printf( "%s EBR@%04ld=            %.4f\n",
-	      outstr, cutoff[ i ], EBR[ cutoff[ i ] ] );
+  return( nf );
 
-      /* In version 180312, ERR@l was included in gcompute but NOT in compute. */
-      /* 20180909 RBP@l */
+}/* of splitfields */
 
-      /* 20180909 intentwise iRBP */
-      if( RBUp > 0 ){
-	printf( "%s iRBU@%04ld=           %.4f\n",
-		outstr, cutoff[ i ], iRBU[ cutoff[ i ] ] );
-      }
+/******************************************************************************
+  splittopic_get
 
-      if( (long)count[ cutoff[ i ] ] > 0 ){
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)1 );
-      }
-      else{
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)0 );
-      }
-      
-    }
-    else{ /* cutoff exceeds maxlen */
-      
-      printf( "%s nDCG@%04ld=           %.4f\n",
-	      outstr, cutoff[ i ], DCGs[ maxlen ]/DCGi[ maxlen ]);
-      printf( "%s MSnDCG@%04ld=         %.4f\n",
-	      outstr, cutoff[ i ], msDCGs[ maxlen ]/msDCGi[ maxlen ]);
-      printf( "%s P@%04ld=              %.4f\n",
-	      outstr, cutoff[ i ], count[ maxlen ]/cutoff[ i ] );
-      printf( "%s RBP@%04ld=            %.4f\n",
-	      outstr, cutoff[ i ], (1-RBPp)*RBPsum[ maxlen ]/gv[ maxrl ] );
-      printf( "%s ERR@%04ld=            %.4f\n",
-	      outstr, cutoff[ i ], ERR[ maxlen ] );
-      printf( "%s nERR@%04ld=           %.4f\n",
-	      outstr, cutoff[ i ], ERR[ maxlen ]/ERRi[ maxlen ]);
-      /* 2018 */
-      printf( "%s EBR@%04ld=            %.4f\n",
-	      outstr, cutoff[ i ], EBR[ maxlen ] );
+returns the topic for topicID tid, adding a new one if necessary
 
-      /* In version 180312, ERR@l was included in gcompute but NOT in compute. */
-      /* 20180909 RBP@l */
+return value: pointer to topic (OK)
+              NULL (ERROR)
+******************************************************************************/
+struct splittopic *splittopic_get( a, h, topics, ntopics, tid )
+     struct arena *a;
+     struct strhash *h;           /* i/o: topicID -> index */
+     struct splittopic **topics;  /* i/o */
+     long *ntopics;               /* i/o */
+     char *tid;                   /* i */
+{
+  long idx;
 
-      /* 20180909 intentwise iRBP */
+  long strhash_add();
+  char *arena_strdup();
 
-      if( RBUp > 0 ){
-	printf( "%s iRBU@%04ld=           %.4f\n",
-		outstr, cutoff[ i ], iRBU[ maxlen ] );
-      }
+  if( ( idx = strhash_add( h, tid, *ntopics ) ) < 0 ){
+    return( NULL );
+  }
 
-      if( (long)count[ maxlen ] > 0 ){
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)1 );
-      }
-      else{
-	printf( "%s Hit@%04ld=            %.4f\n",
-		outstr, cutoff[ i ], (double)0 );
+  if( idx == *ntopics ){ /* new topic */
+
+    if( ( *ntopics & ( *ntopics - 1 ) ) == 0 ){ /* 0, 1, 2, 4, ...: grow */
+      if( ( *topics = ( struct splittopic *)
+	    realloc( *topics, ( 2 * *ntopics + 1 ) * sizeof( struct splittopic ) ) )
+	  == NULL ){
+
+#ifdef OUTERR
+	fprintf( stderr, "realloc failed\n" );
+#endif
+	return( NULL );
       }
-	
     }
+    memset( &(*topics)[ idx ], 0, sizeof( struct splittopic ) );
+    if( ( (*topics)[ idx ].tid = arena_strdup( a, tid ) ) == NULL ){
+      return( NULL );
+    }
+    (*ntopics)++;
   }
 
-  if( ignore_unjudged ){ /* compute bpref etc */
-    
-    /* bpref and bpref_R */
-    sum = 0.0; sum2 = 0.0;
-    for( i = 1; i <= syslen; i++ ){
+  return( &(*topics)[ idx ] );
 
-      if( Gs[ i ] > 0 ){
+}/* of splittopic_get */
 
-	mini = i - count[ i ];
-	if( jrelnum < mini ){ mini = jrelnum; };
-	/* min(R, r'-count(r')) */
+/******************************************************************************
+  splittopic_add
 
-	/* bpref */
-	if( jrelnum > Xrelnum[ 0 ] ){
-	  ratio = 1 - mini/Xrelnum[ 0 ];
-	}
-	else{ /* jrelnum <= jnonrelnum */
-	  ratio = 1 - mini/jrelnum;
-	}
-	/* 1- min(R, r'-count(r')/min(R,N) */
-	sum += ratio;
+appends a line (NTCIR mode) or a relevant doc (diversity mode) to a topic
 
-	/* bpref_R */
-	ratio2 = 1 - mini/jrelnum;
-	/* 1- min(R, r'-count(r')/R */
-	sum2 += ratio2;
-      }
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int splittopic_add( a, t, str, intnum, rlevel )
+     struct arena *a;
+     struct splittopic *t; /* i/o */
+     char *str;            /* i: line or docID */
+     char *intnum;         /* i: intent number (NULL in NTCIR mode) */
+     long rlevel;          /* i */
+{
+  char *arena_strdup();
 
-    }
-    printf( "%s bpref=               %.4f\n", outstr, sum/jrelnum );
-    printf( "%s bpref_R=             %.4f\n", outstr, sum2/jrelnum );
+  if( t->num >= t->size ){
+    t->size = ( t->size == 0 ) ? BUFSIZ : 2 * t->size;
+    if( ( t->rec = ( struct splitrec *)
+	  realloc( t->rec, t->size * sizeof( struct splitrec ) ) ) == NULL ){
 
-    /* bpref_N and bpref_relative */
-    sum = 0.0; sum2 = 0.0;
-    for( i = 1; i <= syslen; i++ ){
+#ifdef OUTERR
+      fprintf( stderr, "realloc failed\n" );
+#endif
+      return( -1 );
+    }
+  }
 
-      if( Gs[ i ] > 0 ){
+  if( ( t->rec[ t->num ].str = arena_strdup( a, str ) ) == NULL ){
+    return( -1 );
+  }
+  t->rec[ t->num ].intnum =
+    ( intnum == NULL ) ? NULL : arena_strdup( a, intnum );
+  t->rec[ t->num ].rlevel = rlevel;
+  t->num++;
 
-	/* bpref_N */
-	ratio = 1 - (double)(i-count[ i ])/Xrelnum[ 0 ];
-	sum += ratio;
+  return( 0 );
 
-	/* bpref_relative */
-	if( i > 1 ){
-	  ratio2 = 1 - (double)(i-count[ i ])/(i-1);
-	}
-	else{ /* ignore relevant doc at Rank 1 */
-	  ratio2 = 0.0;
-	}
-	sum2 += ratio2;
-      }
-    }
-    printf( "%s bpref_N=             %.4f\n", outstr, sum/jrelnum );
-    printf( "%s bpref_relative=      %.4f\n", outstr, sum2/jrelnum );
+}/* of splittopic_add */
 
-    /* rpref_N, rpref_relative and rpref_relative2 */
-    sum = 0.0; sum2 = 0.0; sum3 = 0.0;
-    for( i = 1; i <= syslen; i++ ){
+/******************************************************************************
+  splittopic_sort
 
-      if( Gs[ i ] > 0 ){
+sorts topics by topicID (bytewise)
 
-	/* rpref_N */
-	penalty = 0.0; /* penalty for rank i: examine Ranks 1-(i-1) */
-	for( j = 1; j < i; j++ ){
-	  if( Gs[ i ] - Gs[ j ] > 0 ){
-	    penalty += (Gs[ i ]-Gs[ j ])/Gs[ i ];
-	  }
-	}
-	ratio = 1 - penalty/( jrelnum + Xrelnum[ 0 ] - CGi[ jrelnum ]/gv[ maxrl ] );
-	sum += Gs[ i ] * ratio;
+return value: 0 (OK)
+******************************************************************************/
+int splittopic_sort( topics, ntopics )
+     struct splittopic *topics;
+     long ntopics;
+{
+  int splittopic_cmp();
 
-	/* rpref_relative */
-	if( i > 1 ){
-	  ratio2 = 1 - penalty/(i-1);
-	}
-	else{  /* ignore relevant doc at Rank 1 */
-	  ratio2 = 0.0;
-	}
-	sum2 += Gs[ i ] * ratio2;
+  if( ntopics > 0 ){
+    qsort( topics, ntopics, sizeof( struct splittopic ), splittopic_cmp );
+  }
 
-	/* rpref_relative2 */
-	ratio3 = 1 - penalty/i;
-	sum3 += Gs[ i ] * ratio3;
+  return( 0 );
 
-      }
-    }
+}/* of splittopic_sort */
 
-    /* note: CGi can be used instead of cgi here */
-    printf( "%s rpref_N=             %.4f\n", outstr, sum/CGi[ jrelnum ] );
-    printf( "%s rpref_relative=      %.4f\n", outstr, sum2/CGi[ jrelnum ] );
-    printf( "%s rpref_relative2=     %.4f\n", outstr, sum3/CGi[ jrelnum ] );
-  }
+int splittopic_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  return( strcmp( ( ( struct splittopic *)a )->tid,
+		  ( ( struct splittopic *)b )->tid ) );
+}
 
-  /* end */
+/******************************************************************************
+  splittopic_free
 
-  free( outstr );
-  free( sep );
+return value: 0 (OK)
+******************************************************************************/
+int splittopic_free( t )
+     struct splittopic *t;
+{
+  /* strings are in the arena */
+  free( t->rec );
 
-  free( CGi );
-  free( DCGi );
-  free( msDCGi );
+  return( 0 );
 
-  free( Gs );
-  free( CGs );
-  free( DCGs );
-  free( msDCGs );
+}/* of splittopic_free */
 
-  free( count );
-  free( BR );
-  free( Ss );
+/******************************************************************************
+  split_open, split_close
 
-  free( RBPpower );
-  free( RBPsum );
+open/close an output file of splitqrels with a large output buffer;
+split_close reports the file as the shell scripts do.
 
-  free( ERR );
-  free( ERRdsat );
-  free( ERRi );
-  free( ERRidsat );
+return value: file pointer (OK) / NULL (ERROR); 0 (OK)
+******************************************************************************/
+FILE *split_open( path )
+     char *path;
+{
+  FILE *fo;
 
-  free( EBR );
+  if( ( fo = fopen( path, "w" ) ) == NULL ){
 
-/* intentwise RBP*/
-  if( RBUp > 0 ){
-      free( iRBU);
+#ifdef OUTERR
+    fprintf( stderr, "Cannot open %s\n", path );
+#endif
+    return( NULL );
   }
+  setvbuf( fo, NULL, _IOFBF, SPLIT_BUFSIZ );
+
+  return( fo );
+
+}/* of split_open */
+
+int split_close( fo, path )
+     FILE *fo;
+     char *path;
+{
+  fclose( fo );
+
+#ifdef OUTERR
+  fprintf( stderr, "created %s\n", path );
+#endif
+
+  return( 0 );
 
-  if( compute_gap ){
+}/* of split_close */
 
-    free( GAPsum );
-    free( GAPisum );
-    
+/******************************************************************************
+  split_key
+
+returns a newly allocated "<s1>\001<s2>" key for strhash
+******************************************************************************/
+char *split_key( s1, s2 )
+     char *s1;
+     char *s2;
+{
+  char *key;
+
+  if( ( key = ( char *)malloc( strlen( s1 ) + strlen( s2 ) + 2 ) ) != NULL ){
+    sprintf( key, "%s\001%s", s1, s2 );
   }
 
-  return( 0 );
+  return( key );
 
-}/* of eval_compute */
+}/* of split_key */
 
 /******************************************************************************
-  eval_1click
+  rlevelstr2long
 
-- read gold standard nug file with nug weights and vital strlen
-- read system output (matched nuggets with offsets)
-    1st line contains "syslen= <syslen>"
-- compute S-measure, weighted recall etc.
+converts "L1", "L2"... to 1, 2...
+
+return value: rel level (OK)
+              -1 (not a positive rel level)
 ******************************************************************************/
-static int eval_1click( int ac, char **av )
+long rlevelstr2long( s )
+     char *s;
 {
-  FILE *fa = NULL;
-  FILE *fs = stdin;
+  long lv = 0;
 
-  int argc = 2;
-  int verbose = 0;
+  if( s[ 0 ] != 'L' || s[ 1 ] < '1' || s[ 1 ] > '9' ){
+    return( -1 );
+  }
+  for( s++; *s != '\0'; s++ ){
+    if( *s < '0' || *s > '9' ){
+      return( -1 );
+    }
+    lv = lv * 10 + ( *s - '0' );
+  }
 
-  long Lparam = 0; /* for S-measure */
-  long nugnum = 0; /* number of nuggets */
-  long matchednum = 0; /* number of matched nuggets */
-  long offset;
-  long cumvlen = 0;
-  /* vital strlen cumulated for computing S-measure denominator */
-  long vlen;
-  long summatchvlen = 0; /* T-measure numerator */
-  long Xlen = -1; /* T-measure denominator = system output len
-		      not yet read (1st line of output) */
+  return( lv );
 
-  double nugw;
-  double wrec_nume = 0.0;
-  double wrec_denom = 0.0;
-  double Smeasure_nume = 0.0;
-  double Smeasure_denom = 0.0;
-  double fflatbeta = DEFAULT_FFLATBETA;
-  double Sflat, Tflat;
+}/* of rlevelstr2long */
 
-  char line[ BUFSIZ + 1 ];
-  char *pos;
-  char *p;
-  char *buf;
+/******************************************************************************
+  awknum
 
-  struct strdoublonglist *sortnug = NULL;
-  /* sorted nuggets */
-  struct strdoublonglist *q;
+prints a number as awk's print does:
+integral values as integers, others with "%.6g"
 
-  int freestrdoublonglist();
-  long file2sortnug();
-  double nugget2weightvlen();
+return value: 0 (OK)
+******************************************************************************/
+int awknum( buf, val )
+     char *buf;  /* o */
+     double val; /* i */
+{
+  if( val == (double)(long)val ){
+    sprintf( buf, "%ld", (long)val );
+  }
+  else{
+    sprintf( buf, "%.6g", val );
+  }
 
-  while( argc < ac ){
+  return( 0 );
 
-    if( strcmp( av[ argc ], OPTSTR_1CLICK_L ) == 0 && ( argc + 1 < ac ) ){
+}/* of awknum */
 
-      Lparam =atol( av[ argc + 1 ] );
-      /* sanity check is done later */
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_VERBOSE ) == 0 ){
-      verbose = 1;
-      argc++;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_OUTSTR ) == 0 && ( argc + 1 < ac ) ){
-      outstr = strdup( av[ argc + 1 ] );
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_SEP ) == 0 && ( argc + 1 < ac ) ){
-      sep = strdup( av[ argc + 1 ] );
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_BETA ) == 0 && ( argc + 1 < ac ) ){
-      /* for F-flat */
-      fflatbeta = atof( av[ argc + 1 ] );
-      argc += 2;
-    }
-    else if( strcmp( av[ argc ], OPTSTR_1CLICK_N ) == 0 && ( argc + 1 < ac ) ){
+/******************************************************************************
+  sortnval
 
-      if( ( fa = fopen( av[ argc + 1 ], "r" ) ) == NULL ){
-#ifdef OUTERR
-        fprintf( stderr, "Cannot open %s\n", av[ argc + 1 ] );
-#endif
-        return( -1 );
-      }
-      argc += 2;
-    }
-    else{ /* system output, that is, matched nugget file */
+leading numeric value of a string as sort -n sees it
+(optional blanks and minus sign, digits and a decimal point only)
+******************************************************************************/
+double sortnval( s )
+     const char *s;
+{
+  double val = 0.0;
+  double scale = 0.1;
+  double sign = 1.0;
 
-      if( ( fs = fopen( av[ argc ], "r" ) ) == NULL ){
-#ifdef OUTERR
-        fprintf( stderr, "Cannot open %s\n", av[ argc ] );
-#endif
-          return( -1 );
-      }
-      
-      argc++;
+  while( *s == ' ' || *s == '\t' ){
+    s++;
+  }
+  if( *s == '-' ){
+    sign = -1.0;
+    s++;
+  }
+  while( *s >= '0' && *s <= '9' ){
+    val = val * 10 + ( *s - '0' );
+    s++;
+  }
+  if( *s == '.' ){
+    for( s++; *s >= '0' && *s <= '9'; s++ ){
+      val += scale * ( *s - '0' );
+      scale /= 10;
     }
   }
 
-  if( Lparam < 1 || fa == NULL ){
+  return( sign * val );
 
-#ifdef OUTERR
-    fprintf( stderr,
-	     "Usage: %s %s [%s] [%s <separator>] [%s <outstr>] [%s <outstr>] %s <Lparameter> %s <nuggetfile> [matched nugget file]\n",
-	     av[ 0 ], av[ 1 ],
-	     OPTSTR_VERBOSE, OPTSTR_SEP,
-	     OPTSTR_OUTSTR, OPTSTR_BETA,
-	     OPTSTR_1CLICK_L, OPTSTR_1CLICK_N );
-    
-#endif
+}/* of sortnval */
 
-    return( 0 );
-    
-  }
+/******************************************************************************
+  strp_cmp, sortn_cmp, sortnr_cmp
+
+qsort comparators for arrays of strings:
+bytewise (sort), numeric (sort -n) and reverse numeric (sort -nr).
+Ties in numeric comparison are resolved bytewise, as sort(1) does.
+******************************************************************************/
+int strp_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  return( strcmp( *( char **)a, *( char **)b ) );
+}
+
+int sortn_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  double va, vb;
+
+  double sortnval();
 
-  if( outstr == NULL ){
-    outstr = strdup( "" );
+  va = sortnval( *( char **)a );
+  vb = sortnval( *( char **)b );
+  if( va < vb ){
+    return( -1 );
   }
-  if( sep == NULL ){
-    sep = strdup( DEFAULT_SEP );
+  else if( va > vb ){
+    return( 1 );
   }
 
-  /* store and sort gold standard nuggets with weights and vital lens*/
-
+  return( strcmp( *( char **)a, *( char **)b ) );
+}
 
-  if( ( nugnum = file2sortnug( fa, &sortnug ) ) < 1 ){
+int sortnr_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  int sortn_cmp();
 
-#ifdef OUTERR
-    fprintf( stderr, "file2sortnug failed\n" );
-#endif
-    return( -1 );
+  return( sortn_cmp( b, a ) );
+}
 
-  }
-  fclose( fa );
+/******************************************************************************
+  file2nugtab
 
-  /* compute denominators for S-measure etc. */
-  q = sortnug;
-  while( q ){ /* scan sorted nuggets, i.e. pseudo minimal output */
+reads nug file (nuggetID, weight, vitalstrlen) into an array,
+sorts it by
+(1) weight (bigger the better)
+(2) vitalstrlen (shorter the bettter)
+(3) line number in nug file
+and builds a hash index on nuggetID.
 
-    wrec_denom += q->val1; /* add nugget weights for weighted recall */
+nug file format:
+<nuggetID> <nugget weight> <vital strlen> [...]
 
-    cumvlen += q->val2; /* vital strlen cumulated */
+Note that this module does not check nuggetID duplicates:
+the first one in the sorted order is found by nugtab_lookup.
 
-    if( verbose ){
-      printf( "#%s w= %f vl= %ld offset*= %ld\n",
-	      q->string, q->val1, q->val2, cumvlen );
-    }
-    
-    if( cumvlen < Lparam ){
-      Smeasure_denom += q->val1 * (Lparam - cumvlen);
-    }
-    
-    q = q->next;
-  }
+return value: number of nuggets found >0 (OK)
+              0 (empty nugget file)
+             -1 (ERROR)
+******************************************************************************/
+long file2nugtab( ctx, f, t )
+struct nev_ctx *ctx;
+FILE *f;
+struct nugtab *t; /* o */
+{
+  char line[ BUFSIZ + 1 ];
+  char *pos;
 
-  if( verbose ){
-    printf( "#wrec_denom= %f S-measure_denom= %f\n",
-	    wrec_denom, Smeasure_denom );
-  }
+  int nugtab_addline();
+  long nugtab_index();
 
-  /* read system output (matched nuggets) and compute numerators for
-  S-measure etc */
-  
-  while( fgets( line, sizeof( line ), fs ) ){
+  memset( t, 0, sizeof( struct nugtab ) );
 
-    /* input file format: <nugID> <offset> 
-       except the first line: Xlen= <Xlen> */
+  while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
-
 #ifdef OUTERR   
       fprintf( stderr, "Line too long: %s\n", line );
 #endif  
@@ -3161,323 +9334,342 @@ static int eval_1click( int ac, char **av )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
-
-#ifdef OUTERR   
-      fprintf( stderr, "strtok failed\n" );
-#endif  
+    if( nugtab_addline( ctx, t, line ) < 0 ){
       return( -1 );
-      
     }
-    buf = p; /* nuggetID */
+    
+  }/* of while fgets */
+
+  return( nugtab_index( t ) );
+  
+}/* of file2nugtab */
+
+/******************************************************************************
+  nugtab_addline
+
+parses a nug file line (modified by strtok) and appends it to t
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int nugtab_addline( ctx, t, line )
+     struct nev_ctx *ctx;
+     struct nugtab *t; /* i/o */
+     char *line;       /* i/o */
+{
+  char *p;
+  char *buf;
+  char *saveptr; /* for strtok_r */
+  double weight;
+  long vlen;
+
+  struct nugrec *newrec;
+
+  char *arena_strdup();
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+  if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
-      fprintf( stderr, "strtok failed\n" );
+    fprintf( stderr, "strtok failed\n" );
 #endif  
-      return( -1 );
-    }
+    return( -1 );
+  }
+  buf = p;
 
+  if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
-    if( Xlen < 0 ){ /* first line of file */
+#ifdef OUTERR   
+    fprintf( stderr, "strtok failed\n" );
+#endif  
+    return( -1 );
+  }
+  weight = atof( p );
 
-      Xlen = atol( p ); /* denominator of T-measure */
-    }
-    else{ /* matched nugget line */
+  if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
-      offset = atol( p );
-      if( ( nugw = nugget2weightvlen( sortnug, buf, &vlen ) ) < 0 ){
-	/* lookup failed */
-      
 #ifdef OUTERR   
-	fprintf( stderr, "nugget2weightvlen failed: %s\n", buf );
+    fprintf( stderr, "strtok failed\n" );
 #endif  
-	return( -1 );
-      }
+    return( -1 );
+  }
+  vlen = atol( p );
 
-      matchednum++; /* count nugget matches for unweighted recall */
-      wrec_nume += nugw; /* add weights of nugget matches for weighted recall */
-      summatchvlen += vlen; /* T-measure numerator */
+  /* the remaining fields, if any, are igored */
 
-      if( offset < Lparam ){ /* add to S-measure only if within L */
+  if( weight <= 0.0 || vlen <= 0 ){
 
-	Smeasure_nume += nugw * (Lparam - offset);
-      }
+#ifdef OUTERR   
+    fprintf( stderr, "invalid weight or vital strlen for %s\n", buf );
+#endif  
+    return( -1 );
+  }
 
-      if( verbose ){
-	printf( "#matched=%s w=%f offset=%ld\n", buf, nugw, offset );
-      }
+  if( t->num == t->size ){
+
+    t->size = t->size ? 2 * t->size : 64;
+    if( ( newrec = ( struct nugrec *)
+	  realloc( t->rec, t->size * sizeof( struct nugrec ) ) ) == NULL ){
+#ifdef OUTERR   
+      fprintf( stderr, "realloc failed: %s\n", buf );
+#endif  
+      return( -1 );
     }
-    
-  }/* of while fgets */
+    t->rec = newrec;
+  }
 
-  if( Xlen < 0 ){ /* handle empty file */
+  if( ( t->rec[ t->num ].nugid = arena_strdup( &ctx->arena, buf ) )
+      == NULL ){
+#ifdef OUTERR   
+    fprintf( stderr, "arena_strdup failed: %s\n", buf );
+#endif  
+    return( -1 );
+  }
+  t->rec[ t->num ].weight = weight;
+  t->rec[ t->num ].vlen = vlen;
+  t->rec[ t->num ].order = t->num;
+  t->num++;
 
-    Xlen = 0;
+  return( 0 );
 
-  }
+}/* of nugtab_addline */
 
-  /* output metrics */
+/******************************************************************************
+  nugtab_index
 
-  printf( "%s #nuggets= %ld #matched= %ld #syslen= %ld\n",
-	  outstr, nugnum, matchednum, Xlen );
-  printf( "%s Recall=              %.3f\n", outstr,
-	  (double)matchednum/nugnum );
-  printf( "%s W-recall=            %.3f\n", outstr,
-	  wrec_nume/wrec_denom );
-  printf( "%s S-measure=           %.3f\n", outstr,
-	  Smeasure_nume/Smeasure_denom );
+sorts the nuggets in t and builds the hash index on nuggetID
 
-  
-  if( Smeasure_nume > Smeasure_denom ){
-    Sflat = 1.0;
-  }
-  else{ /* Sflat = S-measure */
-    Sflat = Smeasure_nume/Smeasure_denom;
-  }
-  printf( "%s S-flat=              %.3f\n", outstr, Sflat );
+return value: number of nuggets >0 (OK)
+              0 (no nuggets)
+             -1 (ERROR)
+******************************************************************************/
+long nugtab_index( t )
+     struct nugtab *t; /* i/o */
+{
+  long i;
 
+  int nugrec_cmp();
+  int strhash_init();
+  long strhash_add();
 
-  if( Xlen == 0 ){
-    printf( "%s T-measure=           %.3f\n", outstr, (double)0 );
-    Tflat = 0.0;
+  if( t->num == 0 ){
+    return( 0 );
   }
-  else{
-    
-    printf( "%s T-measure=           %.3f\n", outstr,
-	    (double)summatchvlen/Xlen );
 
-    if( summatchvlen > Xlen ){
-      Tflat = 1.0;
-    }
-    else{
-      Tflat = (double)summatchvlen/Xlen;
+  qsort( t->rec, t->num, sizeof( struct nugrec ), nugrec_cmp );
+
+  if( strhash_init( &t->idx, t->num ) < 0 ){
+    return( -1 );
+  }
+  for( i = 0; i < t->num; i++ ){
+    if( strhash_add( &t->idx, t->rec[ i ].nugid, i ) < 0 ){
+      return( -1 );
     }
   }
-  printf( "%s T-flat=              %.3f\n", outstr, Tflat );
 
+  return( t->num );
 
-  if( Sflat > 0.0 || Tflat > 0.0 ){
-    printf( "%s F-flat=              %.3f\n", outstr,
-	    (1+fflatbeta*fflatbeta)*Tflat*Sflat/(fflatbeta*fflatbeta*Tflat+Sflat) );
-    
+}/* of nugtab_index */
+
+/******************************************************************************
+  nugrec_cmp
+
+for sorting nuggets by weight desc, vital strlen asc, line number asc
+******************************************************************************/
+int nugrec_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  const struct nugrec *x = ( const struct nugrec *)a;
+  const struct nugrec *y = ( const struct nugrec *)b;
+
+  if( x->weight != y->weight ){
+    return( x->weight > y->weight ? -1 : 1 );
   }
-  else{
-    printf( "%s F-flat=              %.3f\n", outstr, (double)0 );
-    
+  if( x->vlen != y->vlen ){
+    return( x->vlen < y->vlen ? -1 : 1 );
+  }
+  return( x->order < y->order ? -1 : x->order > y->order );
+
+}/* of nugrec_cmp */
+
+/******************************************************************************
+  nugtab_lookup
+
+looks up a nugget and returns its nugget weight AND vital strlen
+
+return value: nugget weight >=0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+double nugtab_lookup( t, nugid, len )
+     struct nugtab *t;
+     const char *nugid;
+     long *len;
+{
+  long i;
+
+  long strhash_get();
+
+  if( ( i = strhash_get( &t->idx, nugid ) ) < 0 ){
+    return( -1 );
   }
 
-  free( outstr );
-  free( sep );
-  freestrdoublonglist( &sortnug );
-
-  return( 0 );
+  *len = t->rec[ i ].vlen;
 
+  return( t->rec[ i ].weight );
   
-}/* of eval_1click */
+}/* of nugtab_lookup */
 
 /******************************************************************************
-  file2sortnug
-
-reads nug file (nuggetID, weight, vitalstrlen)
-and stores them, after sorting them by
-(1) weight (bigger the better)
-(2) vitalstrlen (shorter the bettter).
-
-nug file format:
-<nuggetID> <nugget weight> <vital strlen> [...]
+  free_nugtab
 
-return value: number of nuggets found >0 (OK)
-              0 (empty nugget file)
-             -1 (ERROR)
+return value: 0 (OK)
 ******************************************************************************/
-long file2sortnug( f, list )
-FILE *f;
-struct strdoublonglist **list;
+int free_nugtab( t )
+     struct nugtab *t;
 {
-  long retv = 0;
+  int strhash_free();
 
-  char line[ BUFSIZ + 1 ];
-  char *p;
-  char *pos;
-  char *buf;
-  double weight;
-  long vlen;
+  /* nuggetIDs are in the arena */
+  free( t->rec );
+  t->rec = NULL;
+  t->num = t->size = 0;
 
-  int addto_sortnug();
+  if( t->idx.bucket ){
+    strhash_free( &t->idx );
+  }
 
-  while( fgets( line, sizeof( line ), f ) ){
+  return( 0 );
 
-    if( ( pos = strchr( line, '\n' ) ) == NULL ){
-#ifdef OUTERR   
-      fprintf( stderr, "Line too long: %s\n", line );
-#endif  
-      return( -1 );
-    }
-    *pos = '\0';
+}/* of free_nugtab */
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+/******************************************************************************
+  matchlist_add
 
-#ifdef OUTERR   
-      fprintf( stderr, "strtok failed\n" );
-#endif  
-      return( -1 );
-    }
-    buf = strdup( p );
+appends a matched nugget to m
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int matchlist_add( a, m, nugid, offset )
+     struct arena *a;
+     struct matchlist *m; /* i/o */
+     char *nugid;         /* i */
+     long offset;         /* i */
+{
+  struct nugmatch *newrec;
 
-#ifdef OUTERR   
-      fprintf( stderr, "strtok failed\n" );
-#endif  
-      return( -1 );
-    }
-    weight = atof( p );
+  char *arena_strdup();
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+  if( m->num == m->size ){
 
+    m->size = m->size ? 2 * m->size : 64;
+    if( ( newrec = ( struct nugmatch *)
+	  realloc( m->rec, m->size * sizeof( struct nugmatch ) ) ) == NULL ){
 #ifdef OUTERR   
-      fprintf( stderr, "strtok failed\n" );
+      fprintf( stderr, "realloc failed: %s\n", nugid );
 #endif  
       return( -1 );
     }
-    vlen = atol( p );
-
-    /* the remaining fields, if any, are igored */
-
-    if( addto_sortnug( list, buf, weight, vlen ) < 0 ){
+    m->rec = newrec;
+  }
 
+  if( ( m->rec[ m->num ].nugid = arena_strdup( a, nugid ) ) == NULL ){
 #ifdef OUTERR   
-      fprintf( stderr, "addto_sortnug failed for %s\n", buf );
+    fprintf( stderr, "arena_strdup failed: %s\n", nugid );
 #endif  
-      return( -1 );
-    }
+    return( -1 );
+  }
+  m->rec[ m->num ].offset = offset;
+  m->num++;
 
-    retv++;
-    
-  }/* of while fgets */
+  return( 0 );
 
-  return( retv );
-  
-}/* of file2sortnug */
+}/* of matchlist_add */
 
 /******************************************************************************
-  addto_sortnug
-
-add a nugget record to list sorted by 
-nugget weight (bigger the better) and vital strlen (shorter the better)
+  matchlist_first
 
-Note that this module does not check nuggetID duplicates.
+sorts m by nuggetID and keeps only the first match
+(i.e. the smallest offset) for each nugget
 
-return value: 0 (added successfully)
-             -1 (ERROR)
+return value: number of matched nuggets
 ******************************************************************************/
-int addto_sortnug( p, s, weight, vlen )
-     struct strdoublonglist **p;
-     char *s;
-     double weight;
-     long vlen;
+long matchlist_first( m )
+     struct matchlist *m; /* i/o */
 {
-  struct strdoublonglist *p1, *p2;
+  long i, j;
 
-  if( s == NULL || weight <= 0.0 || vlen <=0 )
-    return( -1 );
+  int nugmatch_cmp();
 
-  p1 = *p;
+  if( m->num == 0 ){
+    return( 0 );
+  }
 
-  if( ( p1 == NULL ) || /* start of list */
-      ( p1->val1 < weight ) ||
-      /* new nugget weight bigger than any existing nuggets */
-      ( p1->val1 == weight && p1->val2 > vlen ) ){
-    /* new nugget weight equal to the highest existing nuggets AND
-       new vital strlen smaller or equal */
+  qsort( m->rec, m->num, sizeof( struct nugmatch ), nugmatch_cmp );
 
-    if( ( p2 = ( struct strdoublonglist * )
-	  malloc( sizeof( struct strdoublonglist ) ) ) == NULL ){
-#ifdef OUTERR   
-      fprintf( stderr, "malloc failed: %s\n", s );
-#endif  
-      return( -1 );
+  for( i = 1, j = 1; i < m->num; i++ ){
+    if( strcmp( m->rec[ i ].nugid, m->rec[ j - 1 ].nugid ) != 0 ){
+      m->rec[ j++ ] = m->rec[ i ];
     }
-    p2->string = s;
-    p2->val1 = weight;
-    p2->val2 = vlen;
-    p2->next = p1;
-    *p = p2;
-    return( 0 ); /* added a new record */
   }
+  m->num = j;
 
-  while( p1 ){
+  return( m->num );
 
-    if( ( p1->next == NULL ) || /* end of list */
-	( ( p1->next )->val1 < weight ) ||
-	( ( p1->next )->val1 == weight && ( p1->next )->val2 > vlen ) ){
-      
-      if( ( p2 = ( struct strdoublonglist * )
-	    malloc( sizeof( struct strdoublonglist ) ) ) == NULL ){
-#ifdef OUTERR   
-	fprintf( stderr, "malloc failed: %s\n", s );
-#endif  
-	return( -1 );
-      }
-      p2->string = s;
-      p2->val1 = weight;
-      p2->val2 = vlen;
-      p2->next = p1->next;
-      p1->next = p2;
-      return( 1 ); /* added a new record */
+}/* of matchlist_first */
 
-    }
-    
-    p1 = p1->next;
-  }
+int nugmatch_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  const struct nugmatch *x = ( const struct nugmatch *)a;
+  const struct nugmatch *y = ( const struct nugmatch *)b;
+  int c;
 
-  return( -1 );
-  
-}/* of addto_sortnug */
+  if( ( c = strcmp( x->nugid, y->nugid ) ) != 0 ){
+    return( c );
+  }
+  return( x->offset < y->offset ? -1 : x->offset > y->offset );
+}
 
 /******************************************************************************
-  nugget2weight
+  matchlist_free
 
-looks up a nugget and returns its nugget weight
-
-return value: nugget weight >=0 (OK)
-             -1 (ERROR)
+return value: 0 (OK)
 ******************************************************************************/
-double nugget2weight( p, nugid )
-     struct strdoublonglist *p;
-     const char *nugid;
+int matchlist_free( m )
+     struct matchlist *m;
 {
-  struct strdoublonglist *q;
-
-  q = p;
-  while( q ){
+  /* nuggetIDs are in the arena */
+  free( m->rec );
+  m->rec = NULL;
+  m->num = m->size = 0;
 
-    if( strcmp( q->string, nugid ) == 0 ){ /* found */
+  return( 0 );
 
-      return( q->val1 );
-    }
+}/* of matchlist_free */
 
-    q = q->next;
-  }
+int nugoffset_cmp( a, b )
+     const void *a;
+     const void *b;
+{
+  const struct nugoffset *x = ( const struct nugoffset *)a;
+  const struct nugoffset *y = ( const struct nugoffset *)b;
 
-  return( -1 );
-  
-}/* of nugget2weight */
+  return( x->offset < y->offset ? -1 : x->offset > y->offset );
+}
 
 /******************************************************************************
-  nugget2weightvlen
+  nugget2weight
 
-looks up a nugget and returns its nugget weight AND vital strlen
+looks up a nugget and returns its nugget weight
 
 return value: nugget weight >=0 (OK)
              -1 (ERROR)
 ******************************************************************************/
-double nugget2weightvlen( p, nugid, len )
+double nugget2weight( p, nugid )
      struct strdoublonglist *p;
      const char *nugid;
-     long *len;
 {
   struct strdoublonglist *q;
 
@@ -3486,8 +9678,6 @@ double nugget2weightvlen( p, nugid, len )
 
     if( strcmp( q->string, nugid ) == 0 ){ /* found */
 
-      *len = q->val2 ;
-
       return( q->val1 );
     }
 
@@ -3496,7 +9686,7 @@ double nugget2weightvlen( p, nugid, len )
 
   return( -1 );
   
-}/* of nugget2weightvlen */
+}/* of nugget2weight */
 
 /******************************************************************************
   count_ECjudged
@@ -3517,7 +9707,8 @@ Then the relevance level for Class 1 is L3.
 return value: number of judged rel classes >=0 (OK)
              -1 (ERROR)
 ******************************************************************************/
-long count_ECjudged( maxrl, Xrel, f )
+long count_ECjudged( ctx, maxrl, Xrel, f )
+     struct nev_ctx *ctx;
      long maxrl;
      long Xrel[];/* number of X-rel docs */
      FILE *f; /* rel assessment file */
@@ -3525,47 +9716,51 @@ long count_ECjudged( maxrl, Xrel, f )
   long i;
   long num; /* ec num */
   long jrel; /* return value */
+  long ecsize = 0; /* number of slots in highest */
+  long newsize;
 
-  long highest[ EC_NUMMAX ];
+  long *highest = NULL, *tmp;
   /* highest rel level for each equiv class.
-     Class 1 <==> highest[ 0 ], Class 2 <==> highest[ 1 ]... */
+     Class 1 <==> highest[ 0 ], Class 2 <==> highest[ 1 ]...
+     grown on demand as larger EC IDs are read */
 
   char *p;
   char *pos;
   char line[ BUFSIZ + 1 ];
+  char *saveptr; /* for strtok_r */
 
   long lab2level();
 
-  for( i = 0; i <= EC_NUMMAX; i++ ){
-    highest[ i ] = 0;
-  }
-
 
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
       fprintf( stderr, "Line too long: %s\n", line );
 #endif  
+      free( highest );
       return( -1 );
     }
 
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){ /* string: not used */
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){ /* string: not used */
 
 #ifdef OUTERR
       fprintf( stderr, "strtok failed: %s\n", line );
 #endif
+      free( highest );
       return( -1 );
 
     }
     
-    if( ( p = strtok( NULL, sep ) ) == NULL ){ /* rel label */
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){ /* rel label */
 
 #ifdef OUTERR
       fprintf( stderr, "strtok failed\n" );
 #endif
+      free( highest );
       return( -1 );
 
     }
@@ -3574,6 +9769,7 @@ long count_ECjudged( maxrl, Xrel, f )
 #ifdef OUTERR
       fprintf( stderr, "lab2level failed\n" );
 #endif
+      free( highest );
       return( -1 );
 
     }
@@ -3582,15 +9778,17 @@ long count_ECjudged( maxrl, Xrel, f )
 #ifdef OUTERR
       fprintf( stderr, "max rel level mismatch: %s\n", p );
 #endif
+      free( highest );
       return( -1 );
 
     }
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){ /* equiv class num */
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){ /* equiv class num */
 
 #ifdef OUTERR
       fprintf( stderr, "strtok failed\n" );
 #endif
+      free( highest );
       return( -1 );
 
     }
@@ -3601,9 +9799,32 @@ long count_ECjudged( maxrl, Xrel, f )
 #ifdef OUTERR
       fprintf( stderr, "bad ec number: %ld\n", num );
 #endif
+      free( highest );
       return( -1 );
     }
 
+    if( num > ecsize ){ /* grow geometrically */
+
+      newsize = ecsize > 0 ? ecsize : GENSEEN_INITSIZE;
+      while( newsize < num ){
+	newsize *= 2;
+      }
+      if( newsize > EC_NUMMAX ){
+	newsize = EC_NUMMAX;
+      }
+      if( ( tmp = ( long * )realloc( highest, newsize * sizeof( long ) ) )
+	  == NULL ){
+#ifdef OUTERR
+	fprintf( stderr, "realloc failed\n" );
+#endif
+	free( highest );
+	return( -1 );
+      }
+      highest = tmp;
+      memset( highest + ecsize, 0, ( newsize - ecsize ) * sizeof( long ) );
+      ecsize = newsize;
+    }
+
     if( highest[ num - 1 ] < i ){
       highest[ num - 1 ] = i;
       /* highest rel level seen so far for Class num */
@@ -3617,7 +9838,7 @@ long count_ECjudged( maxrl, Xrel, f )
   }
   jrel = 0;
 
-  for( i = 0; i < EC_NUMMAX; i++ ){
+  for( i = 0; i < ecsize; i++ ){
 
     if( highest[ i ] > 0 ){ /* Class i+1 exists and
 			       its rel level is highest[i](>0) */
@@ -3627,6 +9848,7 @@ long count_ECjudged( maxrl, Xrel, f )
 
   }
 
+  free( highest );
   return( jrel );
     
   
@@ -3642,7 +9864,8 @@ read rel assessment file and count
 return value: number of judged rel docs >=0 (OK)
              -1 (ERROR)
 ******************************************************************************/
-long count_judged( maxrl, Xrel, f )
+long count_judged( ctx, maxrl, Xrel, f )
+     struct nev_ctx *ctx;
      long maxrl;
      long Xrel[];/* number of X-rel docs */
      FILE *f; /* rel assessment file */
@@ -3653,6 +9876,7 @@ long count_judged( maxrl, Xrel, f )
   char *p;
   char *pos;
   char line[ BUFSIZ + 1 ];
+  char *saveptr; /* for strtok_r */
 
   long lab2level();
 
@@ -3661,6 +9885,7 @@ long count_judged( maxrl, Xrel, f )
   }
 
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -3671,7 +9896,7 @@ long count_judged( maxrl, Xrel, f )
 
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR
       fprintf( stderr, "strtok failed: %s\n", line );
@@ -3680,7 +9905,7 @@ long count_judged( maxrl, Xrel, f )
 
     }
     
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR
       fprintf( stderr, "strtok failed\n" );
@@ -3813,9 +10038,11 @@ int gcompute_usage( ac, av )
 
 #ifdef OUTERR  
   fprintf( stderr,
-	   "Usage: %s %s %s <idealfile> [OPTIONS] [labelled ranked list]\n",
+	   "Usage: %s %s %s <idealfile> [OPTIONS] [labelled ranked list...]\n",
 	   av[ 0 ], av[ 1 ],
 	   OPTSTR_IDEALFILE );
+  fprintf( stderr, "\tIf several ranked lists are given, the ideal list is read once\n" );
+  fprintf( stderr, "\tand each run's output is preceded by a '# run=<file>' line.\n" );
   fprintf( stderr, "OPTIONS:\n" );
   fprintf( stderr, "\t%s: show this message\n", OPTSTR_HELP );
   fprintf( stderr, "\t%s: verbose output\n", OPTSTR_VERBOSE );
@@ -3842,6 +10069,9 @@ int gcompute_usage( ac, av )
 	   "\t%s <document rank[,document rank,...]>: cutoffs for P@n, Hit@n, nDCG@n... (default: %d)\n",
 	   OPTSTR_CUTOFF, DEFAULT_CUTOFF );
   fprintf( stderr, "\t%s: compute Robertson/Kanoulas/Yilmaz GAP\n", OPTSTR_GAP );
+  fprintf( stderr, "\t%s: reuse precomputed ideal gains from <idealfile>%s\n",
+	   OPTSTR_ICACHE, ICACHE_SUFFIX );
+  fprintf( stderr, "\t    (created if missing or older than <idealfile>)\n" );
 #endif
 
   return( 0 );
@@ -3900,53 +10130,190 @@ int compute_usage( ac, av )
 }/* of compute usage */
 
 /******************************************************************************
- freestrdoublist
+  arena_alloc
+
+returns n bytes (aligned to ARENA_ALIGN) from arena a.
+The memory is never freed individually: see arena_release and arena_reset.
+
+return value: pointer to memory (OK)
+              NULL (ERROR)
+******************************************************************************/
+void *arena_alloc( a, n )
+     struct arena *a;
+     size_t n;
+{
+  size_t hsize;
+  size_t bsize;
+
+  struct arenablock *b;
+
+  hsize = ( sizeof( struct arenablock ) + ARENA_ALIGN - 1 ) /
+    ARENA_ALIGN * ARENA_ALIGN;
+  n = ( n + ARENA_ALIGN - 1 ) / ARENA_ALIGN * ARENA_ALIGN;
+
+  if( ( b = a->head ) == NULL || b->used + n > b->size ){ /* new block */
+
+    bsize = ( n > ARENA_BLOCKSIZE ) ? n : ARENA_BLOCKSIZE;
+    if( a->spare && a->spare->size >= bsize ){
+      b = a->spare;
+      a->spare = NULL;
+    }
+    else if( ( b = ( struct arenablock *)malloc( hsize + bsize ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "malloc failed\n" );
+#endif
+      return( NULL );
+    }
+    else{
+      b->size = bsize;
+    }
+    b->used = 0;
+    b->next = a->head;
+    a->head = b;
+  }
+
+#ifdef NEVSTATS
+  a->allocs++;
+#endif
+  b->used += n;
+  return( ( char *)b + hsize + b->used - n );
+
+}/* of arena_alloc */
+
+/******************************************************************************
+  arena_strdup
+
+strdup into arena a
+
+return value: copy of s (OK)
+              NULL (ERROR)
+******************************************************************************/
+char *arena_strdup( a, s )
+     struct arena *a;
+     const char *s;
+{
+  size_t len;
+  char *p;
+
+  void *arena_alloc();
+
+  len = strlen( s ) + 1;
+  if( ( p = ( char *)arena_alloc( a, len ) ) == NULL ){
+    return( NULL );
+  }
+  memcpy( p, s, len );
+
+  return( p );
+
+}/* of arena_strdup */
+
+/******************************************************************************
+  arena_mark, arena_release
+
+arena_mark records the current position of arena a in m;
+arena_release frees everything allocated from a since then.
+One released block is kept as a spare for the next allocations.
 
 return value: 0 (OK)
 ******************************************************************************/
-int freestrdoublist( p )
-     struct strdoublist **p;
+int arena_mark( a, m )
+     struct arena *a;
+     struct arenamark *m; /* o */
 {
-  struct strdoublist *p1, *p2;
+  m->block = a->head;
+  m->used = a->head ? a->head->used : 0;
 
-  p1 = *p;
-  while( p1 ){
+  return( 0 );
 
-    p2 = p1;
-    p1 = p1->next;
-    free( p2->string );
-    free( p2 );
+}/* of arena_mark */
+
+int arena_release( a, m )
+     struct arena *a;
+     struct arenamark *m;
+{
+  struct arenablock *b;
 
+  while( ( b = a->head ) != NULL && b != m->block ){
+    a->head = b->next;
+    if( a->spare == NULL && b->size == ARENA_BLOCKSIZE ){
+      a->spare = b;
+    }
+    else{
+      free( b );
+    }
+  }
+  if( a->head ){
+    a->head->used = m->used;
   }
 
-  *p = NULL;
   return( 0 );
-  
-}/* of freestrlintlist */
+
+}/* of arena_release */
+
+/******************************************************************************
+  arena_reset, arena_free
+
+arena_reset frees everything allocated from arena a but keeps a spare block;
+arena_free also frees the spare.
+
+return value: 0 (OK)
+******************************************************************************/
+int arena_reset( a )
+     struct arena *a;
+{
+  struct arenamark m;
+
+  int arena_release();
+
+  m.block = NULL;
+  m.used = 0;
+  arena_release( a, &m );
+
+  return( 0 );
+
+}/* of arena_reset */
+
+int arena_free( a )
+     struct arena *a;
+{
+  int arena_reset();
+
+  arena_reset( a );
+  free( a->spare );
+  a->spare = NULL;
+
+  return( 0 );
+
+}/* of arena_free */
 
 /******************************************************************************
  addtostrdoublist
 
 add <str,double> to end of list
+(the node is allocated from arena a)
 
 return value: <lastrecord>->next
               NULL (error)
 ******************************************************************************/
-struct strdoublist **addtostrdoublist( p, s, val )
+struct strdoublist **addtostrdoublist( a, p, s, val )
+     struct arena *a;
      struct strdoublist **p;
      char *s; /* must be allocated outside */
      double val;
 {
   struct strdoublist *q;
 
+  void *arena_alloc();
+
   if( s == NULL )
     return( NULL );
 
   if( ( q = ( struct strdoublist * )
-	malloc( sizeof( struct strdoublist ) ) ) == NULL ){
+	arena_alloc( a, sizeof( struct strdoublist ) ) ) == NULL ){
 
 #ifdef OUTERR
-    fprintf( stderr, "malloc failed\n" );
+    fprintf( stderr, "arena_alloc failed\n" );
 #endif
 
     return( NULL );
@@ -3971,13 +10338,16 @@ return value: 1 (added a new record)
               0 (record already existed so updated int only
              -1 (error)
 ******************************************************************************/
-int addtouniqstrdoublist( p, s, val )
+int addtouniqstrdoublist( a, p, s, val )
+     struct arena *a;
      struct strdoublist **p;
      char *s; /* must be allocated outside */
      double val;
 {
   struct strdoublist *p1, *p2;
 
+  void *arena_alloc();
+
   p1 = *p;
 
   if( s == NULL )
@@ -3987,10 +10357,10 @@ int addtouniqstrdoublist( p, s, val )
       ( strcmp( p1->string, s ) > 0 ) ){ /* insert at top */
 
     if( ( p2 = ( struct strdoublist * )
-	  malloc( sizeof( struct strdoublist ) ) ) == NULL ){
+	  arena_alloc( a, sizeof( struct strdoublist ) ) ) == NULL ){
 
 #ifdef OUTERR
-      fprintf( stderr, "malloc failed\n" );
+      fprintf( stderr, "arena_alloc failed\n" );
 #endif
 
       return( -1 );
@@ -4013,10 +10383,10 @@ int addtouniqstrdoublist( p, s, val )
 	( strcmp( ( p1->next )->string, s ) > 0 ) ){ /* insert in middle */
 
       if( ( p2 = ( struct strdoublist * )
-	    malloc( sizeof( struct strdoublist ) ) ) == NULL ){
+	    arena_alloc( a, sizeof( struct strdoublist ) ) ) == NULL ){
 
 #ifdef OUTERR
-	fprintf( stderr, "malloc failed\n" );
+	fprintf( stderr, "arena_alloc failed\n" );
 #endif
 
 	return( -1 );
@@ -4043,7 +10413,8 @@ read first field of file and addtostrlist
 return value: size of strlist (OK)
              -1 (ERROR)
 ******************************************************************************/
-long firstfield2strlist( f, list )
+long firstfield2strlist( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strlist **list;
 {
@@ -4051,13 +10422,16 @@ long firstfield2strlist( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf;
+  char *saveptr; /* for strtok_r */
 
   struct strlist **pp1, **pp2;
 
   struct strlist **addtostrlist();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4067,7 +10441,7 @@ long firstfield2strlist( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
       /* get only the first field in file */
 
 #ifdef OUTERR   
@@ -4076,9 +10450,9 @@ long firstfield2strlist( f, list )
       return( -1 );
     }
 
-    buf = strdup( p );
+    buf = arena_strdup( &ctx->arena, p );
 
-    if( ( pp2 = addtostrlist( pp1, buf ) ) == NULL ){
+    if( ( pp2 = addtostrlist( &ctx->arena, pp1, buf ) ) == NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "addtostrlist failed for %s\n", buf );
@@ -4099,23 +10473,28 @@ long firstfield2strlist( f, list )
  addtostrlist
 
 add <str> to end of list
+(the node is allocated from arena a)
 
 return value: <lastrecord>->next
               NULL (error)
 ******************************************************************************/
-struct strlist **addtostrlist( p, s )
+struct strlist **addtostrlist( a, p, s )
+     struct arena *a;
      struct strlist **p;
      char *s;
 {
   struct strlist *q;
 
+  void *arena_alloc();
+
   if( s == NULL )
     return( NULL );
 
-  if( ( q = ( struct strlist * ) malloc( sizeof( struct strlist ) ) ) == NULL ){
+  if( ( q = ( struct strlist * )
+	arena_alloc( a, sizeof( struct strlist ) ) ) == NULL ){
 
 #ifdef OUTERR
-    fprintf( stderr, "malloc failed: %s\n", s );
+    fprintf( stderr, "arena_alloc failed: %s\n", s );
 #endif
 
     return( NULL );
@@ -4128,75 +10507,6 @@ struct strlist **addtostrlist( p, s )
   
 }/* of addtostrlist */
 
-/******************************************************************************
-  freestrdoublong2list
-
-return value: 0 (OK)
-******************************************************************************/
-int freestrdoublong2list( p )
-     struct strdoublong2list **p;
-{
-  struct strdoublong2list *p1, *p2;
-
-  p1 = *p;
-  while( p1 ){
-    p2 = p1;
-    p1 = p1->next;
-    free( p2->string );
-    free( p2 );
-  }
-
-  *p = NULL;
-  return( 0 );
-    
-}/* of freestrdoublong2list */
-
-/******************************************************************************
-  freestrdoublonglist
-
-return value: 0 (OK)
-******************************************************************************/
-int freestrdoublonglist( p )
-     struct strdoublonglist **p;
-{
-  struct strdoublonglist *p1, *p2;
-
-  p1 = *p;
-  while( p1 ){
-    p2 = p1;
-    p1 = p1->next;
-    free( p2->string );
-    free( p2 );
-  }
-
-  *p = NULL;
-  return( 0 );
-    
-}/* of freestrdoublonglist */
-
-/******************************************************************************
-  freestrlist
-
-return value: 0 (OK)
-******************************************************************************/
-int freestrlist( p )
-     struct strlist **p;
-{
-  struct strlist *p1, *p2;
-
-  p1 = *p;
-  while( p1 ){
-    p2 = p1;
-    p1 = p1->next;
-    free( p2->string );
-    free( p2 );
-  }
-
-  *p = NULL;
-  return( 0 );
-    
-}/* of freestrlist */
-
 /******************************************************************************
   strlistmatch
 
@@ -4255,7 +10565,8 @@ din file format:
 return value: highest intent number in din (OK)
               0 (ERROR)
 ******************************************************************************/
-long store_din( f, list )
+long store_din( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strdoublong2list **list;
 {
@@ -4265,13 +10576,16 @@ long store_din( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf;
+  char *saveptr; /* for strtok_r */
 
   struct strdoublong2list **pp1, **pp2;
 
   struct strdoublong2list **addtostrdoublong2list();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4281,28 +10595,27 @@ long store_din( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
+
+#ifdef OUTERR   
+      fprintf( stderr, "strtok failed\n" );
+#endif  
+      return( -1 );
+    }
+    intnum = atol( p );
+    if( intnum < 1 ){
 
 #ifdef OUTERR   
-      fprintf( stderr, "strtok failed\n" );
+      fprintf( stderr, "bad intent number: %ld\n", intnum );
 #endif  
       return( -1 );
     }
-    intnum = atol( p );
     if( intnum > retv ){
 
       retv = intnum; /* max intent number in din */
-
-      if( retv > INTENT_NUMMAX ){
-
-#ifdef OUTERR   
-	fprintf( stderr, "INTENT NUMMAX overflow\n" );
-#endif  
-      return( -1 );
-      }
     }
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
@@ -4322,16 +10635,16 @@ long store_din( f, list )
       return( -1 );
     }
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf = strdup( p ); /* docno */
+    buf = arena_strdup( &ctx->arena, p ); /* docno */
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
@@ -4341,7 +10654,8 @@ long store_din( f, list )
     intgain = atof( p );
 
     if( ( pp2 =
-	  addtostrdoublong2list( pp1, buf, intgain, intnum, infnav ) )
+	  addtostrdoublong2list( &ctx->arena, pp1, buf, intgain, intnum,
+				 infnav ) )
 	== NULL ){
       
 #ifdef OUTERR   
@@ -4377,7 +10691,8 @@ Other fields are ignored.
 return value: size of strstrlonglist (OK)
              -1 (ERROR)
 ******************************************************************************/
-long file2strstrcountlist( f, list )
+long file2strstrcountlist( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strstrlonglist **list;
 {
@@ -4385,13 +10700,16 @@ long file2strstrcountlist( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf, *buf2;
+  char *saveptr; /* for strtok_r */
 
   struct strstrlonglist **pp1, **pp2;
 
   struct strstrlonglist **addtostrstrlonglist();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4401,28 +10719,28 @@ long file2strstrcountlist( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf = strdup( p ); /* string */
+    buf = arena_strdup( &ctx->arena, p ); /* string */
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf2 = strdup( p ); /* rlabel */
+    buf2 = arena_strdup( &ctx->arena, p ); /* rlabel */
 
     retv++; /* each relevant item consitute its own EC */
 
     if( ( pp2 =
-	  addtostrstrlonglist( pp1, buf, buf2, retv ) ) == NULL ){
+	  addtostrstrlonglist( &ctx->arena, pp1, buf, buf2, retv ) ) == NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "addtostrstrlonglist failed for %s,%s\n", buf, buf2 );
@@ -4447,12 +10765,13 @@ First three fields are REQUIRED
 
 <string> <rlabel> <ec_num>
 
-NOTE: if ec_num > EC_NUMMAX, return ERROR
+NOTE: if ec_num < 1 or ec_num > EC_NUMMAX, return ERROR
 
 return value: size of strstrlonglist (OK)
              -1 (ERROR)
 ******************************************************************************/
-long file2strstrlonglist( f, list )
+long file2strstrlonglist( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strstrlonglist **list;
 {
@@ -4461,13 +10780,16 @@ long file2strstrlonglist( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf, *buf2;
+  char *saveptr; /* for strtok_r */
 
   struct strstrlonglist **pp1, **pp2;
 
   struct strstrlonglist **addtostrstrlonglist();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4477,25 +10799,25 @@ long file2strstrlonglist( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf = strdup( p ); /* string */
+    buf = arena_strdup( &ctx->arena, p ); /* string */
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf2 = strdup( p ); /* rlabel */
+    buf2 = arena_strdup( &ctx->arena, p ); /* rlabel */
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
@@ -4504,7 +10826,7 @@ long file2strstrlonglist( f, list )
     }
 
     num = atol( p );
-    if( num < 1 || num >= EC_NUMMAX ){
+    if( num < 1 || num > EC_NUMMAX ){
 #ifdef OUTERR
       fprintf( stderr, "bad ec number: %ld\n", num );
 #endif
@@ -4512,7 +10834,7 @@ long file2strstrlonglist( f, list )
     }
 
     if( ( pp2 =
-	  addtostrstrlonglist( pp1, buf, buf2, num ) ) == NULL ){
+	  addtostrstrlonglist( &ctx->arena, pp1, buf, buf2, num ) ) == NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "addtostrstrlonglist failed for %s,%s\n", buf, buf2 );
@@ -4539,7 +10861,8 @@ First two fields are REQUIRED
 return value: size of strstrlist (OK)
              -1 (ERROR)
 ******************************************************************************/
-long file2strstrlist( f, list )
+long file2strstrlist( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strstrlist **list;
 {
@@ -4547,13 +10870,16 @@ long file2strstrlist( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf, *buf2;
+  char *saveptr; /* for strtok_r */
 
   struct strstrlist **pp1, **pp2;
 
   struct strstrlist **addtostrstrlist();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4563,25 +10889,25 @@ long file2strstrlist( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf = strdup( p );
+    buf = arena_strdup( &ctx->arena, p );
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf2 = strdup( p );
+    buf2 = arena_strdup( &ctx->arena, p );
 
-    if( ( pp2 = addtostrstrlist( pp1, buf, buf2 ) ) == NULL ){
+    if( ( pp2 = addtostrstrlist( &ctx->arena, pp1, buf, buf2 ) ) == NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "addtostrstrlist failed for %s,%s\n", buf, buf2 );
@@ -4609,7 +10935,8 @@ In this case, "" is stored for the second field.
 return value: size of strstrlonglist (OK)
              -1 (ERROR)
 ******************************************************************************/
-long file2strstrlonglist2( f, list )
+long file2strstrlonglist2( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strstrlonglist **list;
 {
@@ -4618,13 +10945,16 @@ long file2strstrlonglist2( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf, *buf2;
+  char *saveptr; /* for strtok_r */
 
   struct strstrlonglist **pp1, **pp2;
 
   struct strstrlonglist **addtostrstrlonglist();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4634,25 +10964,25 @@ long file2strstrlonglist2( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf = strdup( p );
+    buf = arena_strdup( &ctx->arena, p );
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){ /* 2nd field missing */
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){ /* 2nd field missing */
 
-      buf2 = strdup( "" );
+      buf2 = arena_strdup( &ctx->arena, "" );
       num = 0;
     }
     else{ /* found 2nd field */
 
-      buf2 = strdup( p );
+      buf2 = arena_strdup( &ctx->arena, p );
 
-      if( ( p = strtok( NULL, sep ) ) == NULL ){ /* 3rd field missing */
+      if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){ /* 3rd field missing */
 
 	/* rel label found but equiv class not found */
 #ifdef OUTERR   
@@ -4668,7 +10998,8 @@ long file2strstrlonglist2( f, list )
     }
 
 
-    if( ( pp2 = addtostrstrlonglist( pp1, buf, buf2, num ) ) == NULL ){
+    if( ( pp2 = addtostrstrlonglist( &ctx->arena, pp1, buf, buf2, num ) )
+	== NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "addtostrstrlonglist failed for %s,%s\n", buf, buf2 );
@@ -4698,7 +11029,8 @@ Third and other fields are ignored.
 return value: size of strstrlist (OK)
              -1 (ERROR)
 ******************************************************************************/
-long file2strstrlist2( f, list )
+long file2strstrlist2( ctx, f, list )
+     struct nev_ctx *ctx;
      FILE *f;
      struct strstrlist **list;
 {
@@ -4706,13 +11038,16 @@ long file2strstrlist2( f, list )
 
   char line[ BUFSIZ + 1 ];
   char *p, *pos, *buf, *buf2;
+  char *saveptr; /* for strtok_r */
 
   struct strstrlist **pp1, **pp2;
 
   struct strstrlist **addtostrstrlist();
+  char *arena_strdup();
 
   pp1 = list;
   while( fgets( line, sizeof( line ), f ) ){
+    STATS_LINE( ctx, line );
 
     if( ( pos = strchr( line, '\n' ) ) == NULL ){
 #ifdef OUTERR   
@@ -4722,25 +11057,26 @@ long file2strstrlist2( f, list )
     }
     *pos = '\0';
 
-    if( ( p = strtok( line, sep ) ) == NULL ){
+    if( ( p = strtok_r( line, ctx->sep, &saveptr ) ) == NULL ){
 
 #ifdef OUTERR   
       fprintf( stderr, "strtok failed\n" );
 #endif  
       return( -1 );
     }
-    buf = strdup( p );
+    buf = arena_strdup( &ctx->arena, p );
 
-    if( ( p = strtok( NULL, sep ) ) == NULL ){
+    if( ( p = strtok_r( NULL, ctx->sep, &saveptr ) ) == NULL ){
 
-      buf2 = strdup( "" ); /* second field missing -> store "" */
+      /* second field missing -> store "" */
+      buf2 = arena_strdup( &ctx->arena, "" );
     }
     else{
 
-      buf2 = strdup( p );
+      buf2 = arena_strdup( &ctx->arena, p );
     }
 
-    if( ( pp2 = addtostrstrlist( pp1, buf, buf2 ) ) == NULL ){
+    if( ( pp2 = addtostrstrlist( &ctx->arena, pp1, buf, buf2 ) ) == NULL ){
       
 #ifdef OUTERR   
       fprintf( stderr, "addtostrstrlist failed for %s,%s\n", buf, buf2 );
@@ -4761,11 +11097,13 @@ long file2strstrlist2( f, list )
  addtostrstrlonglist
 
 add <str1>,<str2>,<val> to end of list
+(the node is allocated from arena a)
 
 return value: <lastrecord>->next
               NULL (error)
 ******************************************************************************/
-struct strstrlonglist **addtostrstrlonglist( p, s1, s2, val )
+struct strstrlonglist **addtostrstrlonglist( a, p, s1, s2, val )
+     struct arena *a;
      struct strstrlonglist **p;
      char *s1;
      char *s2;
@@ -4773,14 +11111,16 @@ struct strstrlonglist **addtostrstrlonglist( p, s1, s2, val )
 {
   struct strstrlonglist *q;
 
+  void *arena_alloc();
+
   if( s1 == NULL || s2 == NULL )
     return( NULL );
 
   if( ( q = ( struct strstrlonglist * )
-	malloc( sizeof( struct strstrlonglist ) ) ) == NULL ){
+	arena_alloc( a, sizeof( struct strstrlonglist ) ) ) == NULL ){
 
 #ifdef OUTERR
-    fprintf( stderr, "malloc failed: %s,%s,%ld\n", s1, s2, val );
+    fprintf( stderr, "arena_alloc failed: %s,%s,%ld\n", s1, s2, val );
 #endif
 
     return( NULL );
@@ -4795,30 +11135,6 @@ struct strstrlonglist **addtostrstrlonglist( p, s1, s2, val )
   
 }/* of addtostrstrlonglist */
 
-/******************************************************************************
-  freestrstrlonglist
-
-return value: 0 (OK)
-******************************************************************************/
-int freestrstrlonglist( p )
-     struct strstrlonglist **p;
-{
-  struct strstrlonglist *p1, *p2;
-
-  p1 = *p;
-  while( p1 ){
-    p2 = p1;
-    p1 = p1->next;
-    free( p2->string1 );
-    free( p2->string2 );
-    free( p2 );
-  }
-
-  *p = NULL;
-  return( 0 );
-    
-}/* of freestrstrlonglist */
-
 /******************************************************************************
   fprintstrstrlonglist
 return value: 0 (OK)  
@@ -4844,11 +11160,13 @@ int fprintstrstrlonglist( fp, p )
  addtostrdoublong2list
 
 add <str1>,<double>,<long>,<long> to end of list
+(the node is allocated from arena a)
 
 return value: <lastrecord>->next
               NULL (error)
 ******************************************************************************/
-struct strdoublong2list **addtostrdoublong2list( p, s1, dval, lval1, lval2 )
+struct strdoublong2list **addtostrdoublong2list( a, p, s1, dval, lval1, lval2 )
+     struct arena *a;
      struct strdoublong2list **p;
      char *s1;
      double dval;
@@ -4857,14 +11175,16 @@ struct strdoublong2list **addtostrdoublong2list( p, s1, dval, lval1, lval2 )
 {
   struct strdoublong2list *q;
 
+  void *arena_alloc();
+
   if( s1 == NULL )
     return( NULL );
 
   if( ( q = ( struct strdoublong2list * )
-	malloc( sizeof( struct strdoublong2list ) ) ) == NULL ){
+	arena_alloc( a, sizeof( struct strdoublong2list ) ) ) == NULL ){
 
 #ifdef OUTERR
-    fprintf( stderr, "malloc failed: %s\n", s1 );
+    fprintf( stderr, "arena_alloc failed: %s\n", s1 );
 #endif
 
     return( NULL );
@@ -4884,25 +11204,29 @@ struct strdoublong2list **addtostrdoublong2list( p, s1, dval, lval1, lval2 )
  addtostrstrlist
 
 add <str1>,<str2> to end of list
+(the node is allocated from arena a)
 
 return value: <lastrecord>->next
               NULL (error)
 ******************************************************************************/
-struct strstrlist **addtostrstrlist( p, s1, s2 )
+struct strstrlist **addtostrstrlist( a, p, s1, s2 )
+     struct arena *a;
      struct strstrlist **p;
      char *s1;
      char *s2;
 {
   struct strstrlist *q;
 
+  void *arena_alloc();
+
   if( s1 == NULL || s2 == NULL )
     return( NULL );
 
   if( ( q = ( struct strstrlist * )
-	malloc( sizeof( struct strstrlist ) ) ) == NULL ){
+	arena_alloc( a, sizeof( struct strstrlist ) ) ) == NULL ){
 
 #ifdef OUTERR
-    fprintf( stderr, "malloc failed: %s,%s\n", s1, s2 );
+    fprintf( stderr, "arena_alloc failed: %s,%s\n", s1, s2 );
 #endif
 
     return( NULL );
@@ -4916,30 +11240,6 @@ struct strstrlist **addtostrstrlist( p, s1, s2 )
   
 }/* of addtostrstrlist */
 
-/******************************************************************************
-  freestrstrlist
-
-return value: 0 (OK)
-******************************************************************************/
-int freestrstrlist( p )
-     struct strstrlist **p;
-{
-  struct strstrlist *p1, *p2;
-
-  p1 = *p;
-  while( p1 ){
-    p2 = p1;
-    p1 = p1->next;
-    free( p2->string1 );
-    free( p2->string2 );
-    free( p2 );
-  }
-
-  *p = NULL;
-  return( 0 );
-    
-}/* of freestrstrlist */
-
 /******************************************************************************
   fprintstrstrlist
 return value: 0 (OK)  
@@ -4960,3 +11260,420 @@ int fprintstrstrlist( fp, p )
   return( 0 );
 
 }/* of fprintstrstrlist */
+
+/******************************************************************************
+  bitset_init
+
+prepare an empty set of nbits small integers (0...nbits-1).
+Sets of up to BITSET_WORDBITS members (e.g. the usual number of intents)
+live in a single word; larger sets get an array of words.
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int bitset_init( b, nbits )
+     struct bitset *b;
+     long nbits;
+{
+  b->nbits = nbits;
+  b->nwords = ( nbits + BITSET_WORDBITS - 1 )/BITSET_WORDBITS;
+  b->word = 0;
+  b->words = NULL;
+
+  if( nbits > BITSET_WORDBITS ){
+
+    if( ( b->words = ( unsigned long long * )
+	  calloc( b->nwords, sizeof( unsigned long long ) ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "calloc failed\n" );
+#endif
+      return( -1 );
+    }
+  }
+
+  return( 0 );
+
+}/* of bitset_init */
+
+/******************************************************************************
+  bitset_set
+
+add i to the set
+
+return value: 1 (i was already in the set)
+              0 (i has been newly added)
+             -1 (ERROR: out of range)
+******************************************************************************/
+int bitset_set( b, i )
+     struct bitset *b;
+     long i;
+{
+  unsigned long long mask;
+  unsigned long long *w;
+
+  if( i < 0 || i >= b->nbits ){
+    return( -1 );
+  }
+
+  mask = 1ULL << ( i % BITSET_WORDBITS );
+  w = ( b->words == NULL ) ? &b->word : &b->words[ i/BITSET_WORDBITS ];
+
+  if( *w & mask ){
+    return( 1 );
+  }
+  *w |= mask;
+  return( 0 );
+
+}/* of bitset_set */
+
+/******************************************************************************
+  bitset_test
+
+return value: 1 (i is in the set)
+              0 (i is not in the set, or out of range)
+******************************************************************************/
+int bitset_test( b, i )
+     struct bitset *b;
+     long i;
+{
+  if( i < 0 || i >= b->nbits ){
+    return( 0 );
+  }
+
+  if( b->words == NULL ){ /* single word */
+    return( ( b->word >> i ) & 1 );
+  }
+
+  return( ( b->words[ i/BITSET_WORDBITS ] >> ( i % BITSET_WORDBITS ) ) & 1 );
+
+}/* of bitset_test */
+
+/******************************************************************************
+  bitset_free
+
+return value: 0 (OK)
+******************************************************************************/
+int bitset_free( b )
+     struct bitset *b;
+{
+  free( b->words );
+  b->words = NULL;
+  b->nbits = 0;
+  b->nwords = 0;
+  b->word = 0;
+
+  return( 0 );
+
+}/* of bitset_free */
+
+/******************************************************************************
+  genseen_init
+
+prepare a seen array with size slots, all unseen.
+Slot i is regarded as seen iff its stamp equals the current generation,
+so that genseen_reset can forget everything in O(1).
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int genseen_init( s, size )
+     struct genseen *s;
+     long size;
+{
+  if( size < 1 ){
+    size = 1;
+  }
+
+  if( ( s->stamp = ( unsigned long * )
+	calloc( size, sizeof( unsigned long ) ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "calloc failed\n" );
+#endif
+    s->size = 0;
+    return( -1 );
+  }
+
+  s->size = size;
+  s->gen = 1; /* stamps are zero, so nothing is seen */
+
+  return( 0 );
+
+}/* of genseen_init */
+
+/******************************************************************************
+  genseen_reset
+
+mark every slot as unseen, e.g. before processing the next topic.
+
+return value: 0 (OK)
+******************************************************************************/
+int genseen_reset( s )
+     struct genseen *s;
+{
+  s->gen++;
+
+  if( s->gen == 0 ){ /* wrapped around: old stamps may collide */
+    memset( s->stamp, 0, s->size * sizeof( unsigned long ) );
+    s->gen = 1;
+  }
+
+  return( 0 );
+
+}/* of genseen_reset */
+
+/******************************************************************************
+  genseen_set
+
+mark slot i as seen, growing the array if i is beyond its current size.
+
+return value: 1 (slot i had already been seen)
+              0 (slot i is newly seen)
+             -1 (ERROR)
+******************************************************************************/
+int genseen_set( s, i )
+     struct genseen *s;
+     long i;
+{
+  long newsize;
+  unsigned long *tmp;
+
+  /* below this bound, doubling the size (in bytes) cannot overflow */
+  if( i < 0 || i >= LONG_MAX / 2 / ( long )sizeof( unsigned long ) ){
+#ifdef OUTERR
+    fprintf( stderr, "seen array: slot %ld out of range\n", i );
+#endif
+    return( -1 );
+  }
+
+  if( i >= s->size ){ /* grow geometrically */
+
+    newsize = ( s->size > 0 ) ? s->size : GENSEEN_INITSIZE;
+    while( newsize <= i ){
+      newsize *= 2;
+    }
+
+    if( ( tmp = ( unsigned long * )
+	  realloc( s->stamp, newsize * sizeof( unsigned long ) ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "realloc failed\n" );
+#endif
+      return( -1 );
+    }
+    memset( tmp + s->size, 0, ( newsize - s->size ) * sizeof( unsigned long ) );
+    s->stamp = tmp;
+    s->size = newsize;
+  }
+
+  if( s->stamp[ i ] == s->gen ){
+    return( 1 );
+  }
+  s->stamp[ i ] = s->gen;
+  return( 0 );
+
+}/* of genseen_set */
+
+/******************************************************************************
+  genseen_test
+
+return value: 1 (slot i has been seen)
+              0 (not seen)
+******************************************************************************/
+int genseen_test( s, i )
+     struct genseen *s;
+     long i;
+{
+  if( i < 0 || i >= s->size ){
+    return( 0 );
+  }
+
+  return( s->stamp[ i ] == s->gen );
+
+}/* of genseen_test */
+
+/******************************************************************************
+  genseen_free
+
+return value: 0 (OK)
+******************************************************************************/
+int genseen_free( s )
+     struct genseen *s;
+{
+  free( s->stamp );
+  s->stamp = NULL;
+  s->size = 0;
+
+  return( 0 );
+
+}/* of genseen_free */
+
+/******************************************************************************
+  strhash_init
+
+return value: 0 (OK)
+             -1 (ERROR)
+******************************************************************************/
+int strhash_init( h, size )
+     struct strhash *h; /* o */
+     long size;         /* i: initial number of buckets (>0) */
+{
+  h->size = size;
+  h->num = 0;
+
+  if( ( h->bucket = ( struct strlonglist **)
+	calloc( size, sizeof( struct strlonglist * ) ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "calloc failed\n" );
+#endif
+    return( -1 );
+  }
+
+  return( 0 );
+
+}/* of strhash_init */
+
+/******************************************************************************
+  strhash_key
+
+FNV-1a hash of a string
+
+return value: hash value
+******************************************************************************/
+unsigned long strhash_key( s )
+     const char *s;
+{
+  unsigned long key = 2166136261UL;
+
+  while( *s ){
+    key ^= (unsigned char)*s++;
+    key *= 16777619UL;
+  }
+
+  return( key );
+
+}/* of strhash_key */
+
+/******************************************************************************
+  strhash_get
+
+return value: value stored for s (OK)
+              -1 (not found)
+******************************************************************************/
+long strhash_get( h, s )
+     struct strhash *h;
+     const char *s;
+{
+  struct strlonglist *p;
+
+  unsigned long strhash_key();
+
+  for( p = h->bucket[ strhash_key( s ) % h->size ]; p != NULL; p = p->next ){
+    if( strcmp( p->string, s ) == 0 ){
+      return( p->val );
+    }
+  }
+
+  return( -1 );
+
+}/* of strhash_get */
+
+/******************************************************************************
+  strhash_add
+
+adds s with value val (>=0) unless s is already in the table.
+The number of buckets is doubled when the table gets full.
+
+return value: value stored for s, i.e. val if s is new (OK)
+              -1 (ERROR)
+******************************************************************************/
+long strhash_add( h, s, val )
+     struct strhash *h;
+     const char *s;
+     long val;
+{
+  long i;
+  long newsize;
+
+  unsigned long key;
+
+  struct strlonglist *p, *next;
+  struct strlonglist **newbucket;
+
+  unsigned long strhash_key();
+
+  key = strhash_key( s );
+  for( p = h->bucket[ key % h->size ]; p != NULL; p = p->next ){
+    if( strcmp( p->string, s ) == 0 ){
+      return( p->val );
+    }
+  }
+
+  if( h->num >= h->size ){ /* rehash */
+
+    newsize = 2 * h->size;
+    if( ( newbucket = ( struct strlonglist **)
+	  calloc( newsize, sizeof( struct strlonglist * ) ) ) == NULL ){
+
+#ifdef OUTERR
+      fprintf( stderr, "calloc failed\n" );
+#endif
+      return( -1 );
+    }
+    for( i = 0; i < h->size; i++ ){
+      for( p = h->bucket[ i ]; p != NULL; p = next ){
+	next = p->next;
+	p->next = newbucket[ strhash_key( p->string ) % newsize ];
+	newbucket[ strhash_key( p->string ) % newsize ] = p;
+      }
+    }
+    free( h->bucket );
+    h->bucket = newbucket;
+    h->size = newsize;
+  }
+
+  if( ( p = ( struct strlonglist *)malloc( sizeof( struct strlonglist ) ) )
+      == NULL || ( p->string = strdup( s ) ) == NULL ){
+
+#ifdef OUTERR
+    fprintf( stderr, "malloc failed\n" );
+#endif
+    return( -1 );
+  }
+  p->val = val;
+  p->next = h->bucket[ key % h->size ];
+  h->bucket[ key % h->size ] = p;
+  h->num++;
+
+  return( val );
+
+}/* of strhash_add */
+
+/******************************************************************************
+  strhash_free
+
+return value: 0 (OK)
+******************************************************************************/
+int strhash_free( h )
+     struct strhash *h;
+{
+  long i;
+
+  struct strlonglist *p, *next;
+
+  for( i = 0; i < h->size; i++ ){
+    for( p = h->bucket[ i ]; p != NULL; p = next ){
+      next = p->next;
+      free( p->string );
+      free( p );
+    }
+  }
+  free( h->bucket );
+  h->bucket = NULL;
+  h->size = h->num = 0;
+
+  return( 0 );
+
+}/* of strhash_free */
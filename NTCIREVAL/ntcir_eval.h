@@ -9,36 +9,73 @@
 #define _NTCIR_EVAL_H_
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <limits.h>
 #ifdef __APPLE__
   #include <stdlib.h>
 #else
   #include <malloc.h>
 #endif
+#ifdef NEVZLIB
+  #include <pthread.h>
+#endif
 
 #define MAXRL_MAX 15 /* max number of relevance levels */
 
-#define INTENT_NUMMAX 64      /* number of intents for diversified output */
-#define EC_NUMMAX 1024 /* number of equivalence classes
-			   for subtopic mining.
-			  Set to a high value for handling
-			  unclustered erel files where
-			  each string is regarded as an equiv class */
+#define BITSET_WORDBITS 64 /* bits per bitset word: intent sets of
+			      up to this size fit in a single word */
+#define STRHASH_INITSIZE 1024 /* initial number of buckets of a string hash;
+				 doubled on demand */
+#define ARENA_BLOCKSIZE 65536 /* bytes per arena block (larger requests
+				 get a block of their own) */
+#define ARENA_ALIGN 16 /* alignment of memory returned by arena_alloc */
+#define OUT_BUFSIZ 65536 /* bytes of text output buffered per context
+			    (see nev_flush) */
+#define NAMECACHE_SIZE 64 /* hash buckets for rendered metric names */
+#define GENSEEN_INITSIZE 1024 /* initial number of slots for seen arrays
+				 (e.g. for equivalence classes);
+				 grown on demand */
+#define EC_NUMMAX 4194304 /* largest EC ID: the per-topic arrays of
+			     equivalence classes grow up to this many slots.
+			     Renumber sparse EC IDs from 1 */
+#define GZIN_BUFSIZ 65536 /* bytes per buffer of a gzip-compressed input
+			     (compressed data and two decompressed buffers) */
 
 #define DEFAULT_BETA 1.0       /* for Q-measure */
 #define DEFAULT_GAMMA 0.95     /* for rank-biased NCU */
 #define DEFAULT_CUTOFF 1000    /* cutoff for prec, hit, nDCG */
 #define CUTOFF_NUMMAX 10       /* how many cutoffs? */
+#define SWEEP_NUMMAX 32        /* how many L and beta values for 1click? */
 #define DEFAULT_LOGB 2.0       /* for original nDCG */
 #define DEFAULT_RBP 0.95       /* for RBP */
 #define DEFAULT_FFLATBETA 1.0  /* for 1click F-flat */
+#define DEFAULT_NRBPBETA 0.5   /* for NRBP (irec) */
+
+#define STATS_OTHER 0     /* phases timed by -stats: option parsing etc. */
+#define STATS_LOADQRELS 1 /* rel/ideal/din/nugget files */
+#define STATS_LOADRUN 2   /* system output */
+#define STATS_LABEL 3     /* label/glabel/dinlabel/irec: reading and
+			     labelling the system output */
+#define STATS_COMPUTE 4
+#define STATS_PRINT 5     /* nev_printf and nev_metric */
+#define STATS_PHASENUM 6
 
 #define INFORMATIONAL 0
 #define NAVIGATIONAL 1
 
+#define ICACHE_SUFFIX ".icache" /* sidecar file name: <idealfile>.icache */
+#define ICACHE_MAGIC "NTIC0001" /* 8 bytes: bump when the layout changes */
+#define AICACHE_SUFFIX ".aicache" /* sidecar file name of irec's ideal list:
+				     <first rellist minus trailing digits>.aicache
+				     e.g. 0001.test.Irelv.aicache */
+#define AICACHE_MAGIC "NTAI0001"
+
 #define DEFAULT_SEP " " /* default field separator for input/output files
 			   do not use this default if fields contain
 			   white spaces etc. */
@@ -47,6 +84,32 @@
                                  gain/stop values for different
                                  rel levels */
 
+#define TIDSUF "tid"     /* suffixes of files created by splitqrels */
+#define IRELSUF "Irelv"
+#define DINSUF "din"
+#define GRELSUF "Grelv"
+#define DEFAULT_SPLIT_RLNUM 9 /* splitqrels: L1-L9 with gains 1-9 by default */
+#define SPLIT_BUFSIZ 65536    /* output buffer size for splitqrels */
+#define RESSUF "res"          /* suffix of files created by splitruns */
+#define DEFAULT_SPLIT_DOCLIMIT 1000 /* splitruns: docs kept per topic */
+#define ARCSUF "arc"          /* suffix of run archives created by
+				 splitruns -archive: <run>.arc */
+#define ARC_MAGIC "#NTCIREVAL-ARCHIVE" /* first line: ARC_MAGIC <ntopics> */
+#define ARC_END "#END"        /* last line of the archive header */
+
+#define SPLITRUNS_TREC 0  /* run formats for splitruns */
+#define SPLITRUNS_IR4QA 1
+#define SPLITRUNS_CQA 2
+
+#define CONVQRELS_TREC 0  /* qrels formats for convqrels */
+#define CONVQRELS_EARLY 1
+#define CONVQRELS_CACM 2
+#define DEFAULT_TRECMAP "2:L3,1:L1,0:L0" /* as TRECrobust2NTCIRqrels */
+#define DEFAULT_EARLYMAP "S:L3,A:L2,B:L1,C:L0" /* as EarlyNTCIRqrels2NTCIRqrels */
+#define DEFAULT_CACMMAP "*:L1" /* cacm/qrels.text lists relevant docs only */
+#define DEFAULT_CACMPAD 4 /* cacm topicIDs/docIDs: 0001 as in query_results */
+#define DEFAULT_SORTRUN_MEM 512 /* sortrun: megabytes sorted in memory at once */
+
 #define INFSTR "inf"
 #define NAVSTR "nav"
 
@@ -54,15 +117,38 @@
 #define OPTSTR_VERBOSE "-v"
 #define OPTSTR_IGNORE_UNJUDGED  "-j" /* condensed list mode */
 #define OPTSTR_EC "-ec" /* equivalence class mode */
+#define OPTSTR_DEDUPE "-dedupe" /* label: drop repeated docIDs of a ranked list */
+#define OPTSTR_SORT "-sort" /* label: re-sort a ranked list by score */
 #define OPTSTR_IDEALFILE "-I" /* ideal ranked list with gain values */
 #define OPTSTR_DINFILE "-din" /* diversify for inf/nav file */
+#define OPTSTR_INTPROB "-intprob" /* intent probability (DINprob/Iprob) file
+				     for splitqrels */
+#define OPTSTR_FORMAT "-format" /* run format for splitruns:
+				   trec (default), ir4qa or cqa;
+				   qrels format for convqrels:
+				   trec (default), early or cacm */
+#define OPTSTR_TIDFILE "-tid" /* topicID list for splitruns */
+#define OPTSTR_MAP "-map" /* convqrels: <grade>:<label>,... ("*": any grade) */
+#define OPTSTR_PAD "-pad" /* convqrels: zero-pad numeric IDs to this width */
+#define OPTSTR_MEM "-mem" /* sortrun: memory for sorting (MB); larger runs
+			     are sorted in chunks and merged */
+#define OPTSTR_ARCHIVE "-archive" /* splitruns: write one <run>.arc per run
+				     instead of per-topic res files */
+#define OPTSTR_TOPIC "-topic" /* read the given topic from run archives
+				 (any subcommand) */
 #define OPTSTR_BETA    "-beta"  /* for Q-measure and F-flat */
 #define OPTSTR_GAMMA   "-gamma" /* for rank-biased NCU */
 #define OPTSTR_LOGB    "-logb"  /* for original DCG */
 #define OPTSTR_RBP     "-rbp"   /* RBP persistence */
 #define OPTSTR_RBUP     "-rbup" /* RBU p: compute iRBP only if this val is specified */
+#define OPTSTR_ALPHA   "-alpha" /* alpha for alpha-nDCG and NRBP (irec):
+				   compute them only if this val is specified */
+#define OPTSTR_NRBPBETA "-nrbpbeta" /* patience for NRBP (irec) */
 #define OPTSTR_GAP     "-gap"   /* compute computationally
 				   expensive Robertson GAP */
+#define OPTSTR_ICACHE  "-icache" /* keep precomputed ideal gains of gcompute
+				     (or irec's greedy ideal list)
+				     in a sidecar file next to the ideal file */
 #define OPTSTR_CUTOFF  "-cutoffs" /* cutoffs for prec, hit, nDCG... */
 #define OPTSTR_TRUNCATE "-truncate" /* truncate ranked list
 				       when labelling (label and glabel) */
@@ -71,6 +157,11 @@
 				   This should be useful for printing
 				   topicIDs etc. */
 #define OPTSTR_SEP     "-sep" /* field separator for input and output files */
+#define OPTSTR_STATS   "-stats" /* print per-phase times and counters
+				   to stderr (any subcommand;
+				   needs a build with -DNEVSTATS) */
+#define OPTSTR_STATSFILE "-statsfile" /* same as -stats but write them
+					 to a JSON file */
 
 #define OPTSTR_RELFILE "-r" /* judged rel/nonrel docs with rel labels */
 #define OPTSTR_GAIN "-g" /* gain values for q_eval_compute */
@@ -78,6 +169,8 @@
 
 #define OPTSTR_1CLICK_L "-L" /* L param for computing S-measure */
 #define OPTSTR_1CLICK_N "-N" /* gold starndard Nugget file */
+#define OPTSTR_1CLICK_NUGGETS "-nuggets" /* 1CLICK format nugget file:
+					    evaluate all topics at once */
 
 struct strlist
 {
@@ -124,10 +217,309 @@ struct strstrlonglist
   struct strstrlonglist *next;
 };
 
+struct strlonglist
+{
+  char *string;
+  long val;
+  struct strlonglist *next;
+};
+
+struct strhash /* chained hash table: string -> long (e.g. docID -> row) */
+{
+  long size; /* number of buckets */
+  long num;  /* number of entries */
+  struct strlonglist **bucket;
+};
+
+struct nugrec /* a gold standard nugget */
+{
+  char *nugid;
+  double weight;
+  long vlen;  /* vital strlen */
+  long order; /* line number in nug file (for stable sorting) */
+};
+
+struct nugtab /* nuggets sorted by weight desc, vital strlen asc */
+{
+  long num;
+  long size;
+  struct nugrec *rec;
+  struct strhash idx; /* nuggetID -> row in rec */
+};
+
+struct nugmatch /* a matched nugget in a system output */
+{
+  char *nugid;
+  long offset;
+};
+
+struct nugoffset /* weight of a matched nugget at an offset */
+{
+  long offset;
+  double weight;
+};
+
+struct matchlist /* matched nuggets of one topic, in file order */
+{
+  long Xlen; /* system output length (-1: not yet known) */
+  long num;
+  long size;
+  struct nugmatch *rec;
+};
+
+struct splitrec /* a line of a qrels file bucketed by splitqrels */
+{
+  char *str;    /* line without topicID (NTCIR mode) or docID */
+  char *intnum; /* intent number (diversity mode) */
+  long rlevel;  /* rel level (diversity mode) */
+};
+
+struct splittopic /* lines of one topic, in file order */
+{
+  char *tid;
+  long num;
+  long size;
+  struct splitrec *rec;
+};
+
+struct labelrec /* a line of a ranked list read by label -dedupe/-sort:
+		    <docID> [<score>] or a TREC run line */
+{
+  char *doc;
+  double score;
+  int scored; /* the line has a score */
+  long rank;  /* TREC run lines; 0 otherwise */
+  long order; /* line number (for stable sorting) */
+};
+
+struct sortrec /* a TREC run line for sortrun */
+{
+  unsigned long long skey; /* score bits: higher scores have smaller keys */
+  unsigned long tkey;      /* interned topicID; its rank in topicID order
+			      while sorting */
+  long order;              /* line number in the chunk (for stable sorting) */
+  char *tid;               /* merge: topicID of the chunk's next line */
+  char *doc;
+  char *line;              /* as read, without newline */
+};
+
+#ifdef NEVZLIB
+struct gzin /* a gzip-compressed input file: a second thread decompresses
+	       into one buffer while the reader parses the other */
+{
+  FILE *src;           /* compressed data */
+  char *path;          /* for error messages */
+  void *z;             /* z_stream */
+  unsigned char *in;   /* compressed data read from src */
+  char *buf[ 2 ];      /* decompressed data */
+  size_t len[ 2 ];     /* bytes in buf[ i ] */
+  int full[ 2 ];       /* buf[ i ] is ready for the reader */
+  int rd;              /* buffer being read */
+  size_t pos;          /* read position in buf[ rd ] */
+  int member;          /* inside a gzip member (not at its end) */
+  int eof;             /* set by the thread after the last buffer */
+  int err;             /* corrupt or truncated input */
+  int stop;            /* the reader closed the file */
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+#endif
+
+struct gainheap /* max-heap entry: doc row with (an upper bound of) its gain */
+{
+  double key;
+  long row;
+};
+
+struct bitset /* set of small integers, e.g. intents covered so far */
+{
+  long nbits;
+  long nwords;
+  unsigned long long word;   /* used if nbits <= BITSET_WORDBITS */
+  unsigned long long *words; /* used otherwise */
+};
+
+struct genseen /* generation-stamped seen array: O(1) reset */
+{
+  long size;
+  unsigned long gen;    /* current generation */
+  unsigned long *stamp; /* slot i is seen iff stamp[ i ] == gen */
+};
+
+struct arenablock /* a chunk of an arena; followed by size bytes */
+{
+  struct arenablock *next; /* older block */
+  size_t size;
+  size_t used;
+};
+
+struct arena /* bump allocator for list nodes and strings:
+		nothing is freed individually,
+		everything after a mark is freed at once */
+{
+  struct arenablock *head;  /* newest block */
+  struct arenablock *spare; /* a released block kept for reuse */
+  long allocs;              /* number of arena_alloc calls (-DNEVSTATS) */
+};
+
+struct arenamark /* position in an arena to release back to */
+{
+  struct arenablock *block;
+  size_t used;
+};
+
+struct idealcache /* precomputed ideal-side arrays for gcompute */
+{
+  char *path;     /* ideal file, e.g. Grelv */
+  char *sep;      /* separator the ideal file was read with */
+  double logbase; /* for DCGi */
+  long srcsize;   /* size of the ideal file */
+  long srcmtime;  /* modification time of the ideal file */
+  long jrelnum;
+  long jnonrelnum;
+  double hgain;   /* highest gain value in the ideal list */
+  double *CGi;    /* arrays below are indexed 0..jrelnum */
+  double *DCGi;
+  double *msDCGi;
+  double *ERRi;
+  double *GAPisum;
+  struct idealcache *next;
+};
+
+struct icachehead /* header of an ICACHE_SUFFIX sidecar file.
+		     followed by seplen bytes of sep and then
+		     CGi, DCGi, msDCGi, ERRi, GAPisum (jrelnum+1 doubles each).
+		     Native byte order: the file is a cache, not an archive */
+{
+  char magic[ 8 ];
+  long srcsize;
+  long srcmtime;
+  double logbase;
+  long seplen;
+  long jrelnum;
+  long jnonrelnum;
+  double hgain;
+};
+
+struct aicachehead /* header of an AICACHE_SUFFIX sidecar file.
+		      followed by seplen bytes of sep,
+		      intent_num (size, mtime) pairs of longs for the rellists
+		      and then the ndocs gains of the ideal list */
+{
+  char magic[ 8 ];
+  double alpha;
+  unsigned long pathkey; /* hash of the rellist file names */
+  long seplen;
+  long intent_num;
+  long ndocs;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ libntcireval: the subcommands of ntcir_eval as a reentrant library.
+ All state lives in a struct nev_ctx, so different threads can
+ evaluate concurrently as long as each uses its own context.
+
+ e.g.
+   struct nev_ctx ctx;
+   char *av[] = { "ntcir_eval", "compute", "-r", "0001.rel", "-g", "1:2" };
+
+   nev_init( &ctx );
+   ctx.in = fopen( "0001.run.lab", "r" );
+   ctx.out = NULL;   (no text output; results only)
+   if( nev_run( &ctx, 6, av ) == 0 ){
+     for( i = 0; i < ctx.resnum; i++ )
+       use ctx.res[ i ].name and ctx.res[ i ].value;
+   }
+   nev_free( &ctx );
+
+ Text output is buffered in the context: nev_run flushes it before
+ returning, but output from direct calls of nev_printf/nev_metric
+ reaches ctx->out only after nev_flush (or nev_free).
+*/
+
+struct nev_result /* a metric value, e.g. ("0001", "nDCG@0010", 0.5123) */
+{
+  char *prefix; /* output prefix, e.g. topicID */
+  char *name;
+  double value; /* not rounded */
+};
+
+struct nev_name /* a rendered metric name of nev_metric,
+		   e.g. "nDCG@%04ld=           " with 10 */
+{
+  const char *fmtp; /* namefmt as passed */
+  char *fmt;        /* copy of namefmt: the pointer alone may be reused */
+  long arg;         /* the %04ld argument, if any */
+  char *text;       /* as printed, e.g. "nDCG@0010=           " */
+  size_t textlen;
+  char *key;        /* as stored in ctx->res, e.g. "nDCG@0010" */
+  struct nev_name *next;
+};
+
+struct nev_stats /* -stats: timings and counters of the last nev_run.
+		    Only a build with -DNEVSTATS updates these */
+{
+  int on;       /* -stats or -statsfile given */
+  char *file;   /* -statsfile: JSON output file */
+  int phase;    /* STATS_* phase being timed */
+  double since; /* when the current phase started (seconds) */
+  double sec[ STATS_PHASENUM ]; /* wall time per phase */
+  long lines;   /* lines read from input files */
+  long bytes;   /* bytes read from input files */
+  long lookups; /* docID/nuggetID lookups */
+  long allocs;  /* arena allocations and per-rank arrays */
+  long peakarray; /* longest per-rank array (elements) */
+};
+
+struct nev_ctx /* evaluation context */
+{
+  /* options of the current subcommand */
+  char *sep;           /* separator for input and output files */
+  char *outstr;        /* used as output prefix for (g)compute/irec.
+			  This can be a topicID, for example. */
+  int ignore_unjudged; /* flag for ignoring unjudged docs */
+  int ec_mode;         /* equivalence class based evaluation */
+
+  FILE *in;  /* system output (default: stdin) */
+  FILE *rel; /* rel assessments for compute if -r is not given
+		(closed by compute) */
+  char *topic; /* -topic: topicID to read from run archives */
+  FILE *out; /* text output as in ntcir_eval (default: stdout; NULL: none) */
+
+  /* metric values output by the last nev_run */
+  long resnum;
+  long ressize;
+  struct nev_result *res;
+  struct arena resarena; /* prefixes and names of res; reset by nev_clear */
+  struct nev_name *names[ NAMECACHE_SIZE ]; /* names rendered since then */
+
+  char *outbuf;  /* OUT_BUFSIZ bytes of text output not yet written */
+  size_t outlen;
+
+  struct idealcache *icache; /* ideal lists kept by gcompute */
+  struct genseen ecseen;     /* label -ec: ECs seen in the ranked list;
+				reset (not reallocated) by each label */
+
+  struct arena arena; /* list nodes and strings of the current subcommand;
+			 reset by nev_run */
+
+  struct nev_stats stats;
+};
+
+int nev_init( struct nev_ctx *ctx );
+int nev_run( struct nev_ctx *ctx, int ac, char **av );
+int nev_clear( struct nev_ctx *ctx );
+int nev_free( struct nev_ctx *ctx );
+int nev_printf( struct nev_ctx *ctx, const char *fmt, ... );
+int nev_flush( struct nev_ctx *ctx );
+int nev_metric( struct nev_ctx *ctx, const char *prefix, double value,
+		int prec, const char *namefmt, ... );
+
 #ifdef __cplusplus
 }
 #endif
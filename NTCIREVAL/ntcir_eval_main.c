@@ -0,0 +1,60 @@
+/******************************************************************************
+  ntcir_eval_main.c
+
+ ntcir_eval command: a thin wrapper around libntcireval (ntcir_eval.c)
+******************************************************************************/
+#include "ntcir_eval.h"
+
+int main( int ac, char **av )
+{
+  struct nev_ctx ctx;
+    
+  if( ac < 2 ){
+
+#ifdef OUTERR      
+    fprintf(stderr, "Usage: %s command args...\n", av[0]);
+    fprintf(stderr, " command= glabel|dinlabel|gcompute|irec|label|compute|1click|splitqrels|splitruns|convqrels|sortrun|stream\n\n" );
+    fprintf(stderr, "   *glabel* reads an ideal ranked list with gain values\n" );
+    fprintf(stderr, "    and a system ranked list WITHOUT gain values;\n" );
+    fprintf(stderr, "    outputs a system ranked list WITH gain values.\n\n" );
+    fprintf(stderr, "   *dinlabel* reads a din (diversify for inf and nav) file\n" );
+    fprintf(stderr, "    and a system ranked list WITHOUT gain values;\n" );
+    fprintf(stderr, "    outputs a system ranked list WITH gain values.\n" );
+    fprintf(stderr, "    dup docs for nav intents are ignored.\n\n" );
+    fprintf(stderr, "   *gcompute* reads an ideal ranked list with gain values\n" );
+    fprintf(stderr, "    and a system ranked list WITH gain values;\n" );
+    fprintf(stderr, "    outputs evaluation metric values.\n\n" );
+    fprintf(stderr, "   *irec reads one or more reldoclist (possibly with other info)\n" );
+    fprintf(stderr, "    for each intent, and a system ranked list;\n" );
+    fprintf(stderr, "    outputs I-recall.\n\n" );
+    fprintf(stderr, "   *label* reads a list of judged docs with rel levels\n" );
+    fprintf(stderr, "    and a system ranked list;\n" );
+    fprintf(stderr, "    outputs a system ranked list WITH rel levels.\n\n" );
+    fprintf(stderr, "   *compute* reads a list of judged docs with rel levels\n" );
+    fprintf(stderr, "    and a system ranked list WITH rel levels;\n" );
+    fprintf(stderr, "    outputs evaluation metric values.\n\n" );
+    fprintf(stderr, "   *1click* reads a gold-standard nugget file and a\n" );
+    fprintf(stderr, "    matched nugget file and outputs evaluation metric values\n\n" );
+    fprintf(stderr, "   *splitqrels* reads a qrels file (and an intent prob file)\n" );
+    fprintf(stderr, "    and creates per-topic rel (or Irelv, din and Grelv) files.\n\n" );
+    fprintf(stderr, "   *splitruns* reads TREC (IR4QA, CQA) run files\n" );
+    fprintf(stderr, "    and creates per-topic res files (or run archives, -archive).\n" );
+    fprintf(stderr, "    Any command reads a topic from a run archive with -topic <topicID>.\n\n" );
+    fprintf(stderr, "   *convqrels* reads a TREC (early-NTCIR, CACM) qrels file\n" );
+    fprintf(stderr, "    and outputs an NTCIR-format qrels file.\n\n" );
+    fprintf(stderr, "   *sortrun* reads TREC run files and outputs their lines\n" );
+    fprintf(stderr, "    sorted by topicID, score and docID.\n\n" );
+    fprintf(stderr, "   *stream* reads a qrels file and a TREC run grouped by topic\n" );
+    fprintf(stderr, "    and outputs evaluation metric values topic by topic.\n\n" );
+#endif
+	
+    exit(1);
+  }
+
+  nev_init( &ctx );
+  nev_run( &ctx, ac, av ); /* unknown commands are reported by nev_run */
+  nev_free( &ctx );
+
+  return( 0 );
+
+}/* of main */